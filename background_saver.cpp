@@ -0,0 +1,171 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "background_saver.h"
+#include "xml_writer.h"
+#include <fstream>
+
+namespace edge
+{
+	// Binary images are written in pieces of this size, so that progress is seen while a big one is written.
+	static constexpr size_t write_chunk_size = 1024 * 1024;
+
+	struct progress_out_stream : out_stream_i
+	{
+		std::ofstream& file;
+		std::atomic<uint64_t>& bytes_written;
+
+		using out_stream_i::write;
+
+		progress_out_stream (std::ofstream& file, std::atomic<uint64_t>& bytes_written)
+			: file(file), bytes_written(bytes_written)
+		{ }
+
+		virtual void write (const void* data, size_t size) override
+		{
+			file.write (static_cast<const char*>(data), size);
+			bytes_written.store (bytes_written.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+		}
+	};
+
+	background_saver::background_saver (object* root, std::span<const concrete_type* const> known_types)
+		: _known_types(known_types.begin(), known_types.end())
+		, _capture(root)
+		, _thread(&background_saver::thread_proc, this)
+	{ }
+
+	background_saver::~background_saver()
+	{
+		{
+			std::lock_guard lock(_mutex);
+			_stopping = true;
+		}
+		_queue_changed.notify_all();
+		_thread.join();
+	}
+
+	void background_saver::save_async (const std::filesystem::path& path, save_format format)
+	{
+		vector_out_stream image;
+		_capture.serialize (&image);
+
+		{
+			std::lock_guard lock(_mutex);
+			_queue.push_back ({ path, format, std::move(image.buffer) });
+		}
+		_queue_changed.notify_all();
+	}
+
+	bool background_saver::busy() const
+	{
+		std::lock_guard lock(_mutex);
+		return !_queue.empty();
+	}
+
+	void background_saver::poll()
+	{
+		bool in_progress;
+		std::vector<completion> completed;
+		{
+			std::lock_guard lock(_mutex);
+			in_progress = !_queue.empty();
+			completed.swap (_completed);
+		}
+
+		if (in_progress)
+		{
+			uint64_t written = _bytes_written.load(std::memory_order_relaxed);
+			if (written != _reported_bytes)
+			{
+				_reported_bytes = written;
+				this->event_invoker<save_progress_e>()(this, written, _bytes_expected.load(std::memory_order_relaxed));
+			}
+		}
+
+		for (auto& c : completed)
+			this->event_invoker<save_completed_e>()(this, c.path, c.exception);
+	}
+
+	void background_saver::wait()
+	{
+		{
+			std::unique_lock lock(_mutex);
+			_queue_changed.wait (lock, [this] { return _queue.empty(); });
+		}
+
+		poll();
+	}
+
+	void background_saver::thread_proc()
+	{
+		std::unique_lock lock(_mutex);
+		while (true)
+		{
+			_queue_changed.wait (lock, [this] { return _stopping || !_queue.empty(); });
+			if (_queue.empty())
+				return;
+
+			// The front job stays where it is while the lock is released: the other thread only adds jobs at the back.
+			const job& j = _queue.front();
+			_bytes_written = 0;
+			_bytes_expected = (j.format == save_format::binary) ? j.image.size() : 0;
+			lock.unlock();
+
+			std::exception_ptr exception;
+			try
+			{
+				write(j);
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+
+			lock.lock();
+			_completed.push_back ({ std::move(_queue.front().path), exception });
+			_queue.pop_front();
+			_queue_changed.notify_all();
+		}
+	}
+
+	void background_saver::write (const job& j)
+	{
+		auto temp_path = j.path;
+		temp_path += ".tmp";
+
+		try
+		{
+			std::ofstream file;
+			file.exceptions (std::ios::failbit | std::ios::badbit);
+			file.open (temp_path, std::ios::binary | std::ios::trunc);
+			progress_out_stream s (file, _bytes_written);
+
+			if (j.format == save_format::binary)
+			{
+				for (size_t offset = 0; offset < j.image.size(); offset += write_chunk_size)
+					s.write (j.image.data() + offset, std::min(write_chunk_size, j.image.size() - offset));
+			}
+			else
+			{
+				// backed_string_p values of the loaded tree point into the image, which outlives the tree.
+				binary_reader reader = { j.image.data(), j.image.data() + j.image.size() };
+				auto root = deserialize (reader, _known_types);
+
+				xml_writer writer (&s);
+				writer.write_declaration();
+				serialize (writer, root.get(), true);
+				writer.flush();
+			}
+
+			file.close();
+			std::filesystem::rename (temp_path, j.path);
+		}
+		catch (...)
+		{
+			std::error_code ec;
+			std::filesystem::remove (temp_path, ec);
+			throw;
+		}
+	}
+}
@@ -0,0 +1,98 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "binary_serializer.h"
+#include "events.h"
+#include <filesystem>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+namespace edge
+{
+	enum class save_format { binary, xml };
+
+	// Saves an object tree on a worker thread, so that the thread that edits the tree (usually the UI thread)
+	// doesn't wait for the whole save.
+	//
+	// save_async() captures the tree as a binary image, on the calling thread, with an incremental_binary_serializer:
+	// the first capture serializes the whole tree, later ones copy the bytes of the subtrees that didn't change since
+	// the previous capture. That is the only time the tree is touched; once save_async() returns the tree can be edited again,
+	// while the worker writes the image to a temporary file next to the destination and renames it over the destination.
+	// The destination thus always holds a complete document, either the previous one or the new one.
+	//
+	// For save_format::binary the file is the image itself, an ordinary binary document (see incremental_binary_serializer).
+	// For save_format::xml the worker loads the image into a tree of its own, using "known_types", and writes that
+	// with serialize(xml_writer&, ...). The known types must then be safe to create and read on another thread.
+	//
+	// Saves run one at a time, in the order they were requested. Since events work on a single thread,
+	// the worker doesn't raise any; it records its progress, and poll() raises the events for it on the calling thread.
+	// Call poll() from a timer or from the message loop of the thread that owns the tree.
+	class background_saver : public event_manager
+	{
+		struct job
+		{
+			std::filesystem::path path;
+			save_format format;
+			std::vector<uint8_t> image;
+		};
+
+		struct completion
+		{
+			std::filesystem::path path;
+			std::exception_ptr exception;
+		};
+
+		std::vector<const concrete_type*> const _known_types;
+		incremental_binary_serializer _capture;
+		mutable std::mutex _mutex;
+		std::condition_variable _queue_changed;
+		std::deque<job> _queue;                   // guarded by _mutex; the front job is the one being saved
+		std::vector<completion> _completed;       // guarded by _mutex; not yet reported by poll()
+		bool _stopping = false;                   // guarded by _mutex
+		std::atomic<uint64_t> _bytes_written = 0; // by the save in progress
+		std::atomic<uint64_t> _bytes_expected = 0;
+		uint64_t _reported_bytes = (uint64_t)-1;
+		std::thread _thread;                      // declared last so that it starts after everything else is constructed
+
+	public:
+		background_saver (object* root, std::span<const concrete_type* const> known_types);
+
+		// Finishes the saves already requested, without raising events for them.
+		~background_saver();
+
+		background_saver (const background_saver&) = delete;
+		background_saver& operator= (const background_saver&) = delete;
+
+		void save_async (const std::filesystem::path& path, save_format format = save_format::binary);
+
+		// True from save_async() until the save (and any requested after it) is written, which may be before poll() reports it.
+		bool busy() const;
+
+		// Raises save_progress_e for the save in progress, if it made progress since the previous call,
+		// and save_completed_e for the saves that finished since the previous call.
+		void poll();
+
+		// Blocks until all requested saves are written, then calls poll().
+		void wait();
+
+		// Bytes written to the temporary file so far, and the size the file will have, or zero where that isn't known
+		// in advance (XML).
+		struct save_progress_e : event<save_progress_e, background_saver*, uint64_t, uint64_t> { };
+		save_progress_e::subscriber save_progress() { return save_progress_e::subscriber(this); }
+
+		// The destination path, and the exception that made the save fail, or nullptr if it succeeded.
+		// When a save fails, the temporary file is deleted and the destination is left as it was.
+		struct save_completed_e : event<save_completed_e, background_saver*, const std::filesystem::path&, std::exception_ptr> { };
+		save_completed_e::subscriber save_completed() { return save_completed_e::subscriber(this); }
+
+	private:
+		void thread_proc();
+		void write (const job& j);
+	};
+}
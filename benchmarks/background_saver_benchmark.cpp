@@ -0,0 +1,98 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// How long the thread that edits the tree (the UI thread) is paused by a background save of a tree of N objects
+// (default 1M), against saving on that thread. The first save_async captures the whole tree; the following R ones
+// (default 20) come after E edits each (default 100) and copy the unchanged subtrees from the previous capture.
+// The pause is the time spent in save_async; the rest of the save runs on the saver's thread.
+
+#include "test_support.h"
+#include "background_saver.h"
+#include "xml_writer.h"
+#include <fstream>
+#include <iterator>
+#include <random>
+
+using namespace test;
+
+struct file_out_stream : out_stream_i
+{
+	std::ofstream file;
+
+	using out_stream_i::write;
+
+	file_out_stream (const char* path)
+		: file(path, std::ios::binary | std::ios::trunc)
+	{ }
+
+	virtual void write (const void* data, size_t size) override { file.write (static_cast<const char*>(data), size); }
+};
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t rounds = size_arg(argc, argv, 2, 20);
+	size_t edits = size_arg(argc, argv, 3, 100);
+	const char path[] = "background_saver_benchmark.bin";
+
+	auto r = make_tree(n);
+
+	double t = now_ms();
+	{
+		file_out_stream s (path);
+		serialize (r.get(), &s);
+	}
+	double sync_binary = now_ms() - t;
+
+	t = now_ms();
+	{
+		file_out_stream s (path);
+		xml_writer writer (&s);
+		writer.write_declaration();
+		serialize (writer, r.get(), true);
+	}
+	double sync_xml = now_ms() - t;
+
+	background_saver saver (r.get(), known_types);
+
+	t = now_ms();
+	saver.save_async (path);
+	double first_pause = now_ms() - t;
+	saver.wait();
+	double first_total = now_ms() - t;
+
+	std::mt19937_64 rng (1);
+	double pause_sum = 0;
+	double pause_max = 0;
+	double total_sum = 0;
+	for (size_t round = 0; round < rounds; round++)
+	{
+		for (size_t e = 0; e < edits; e++)
+			r->child_at(rng() % n)->set_x((int32_t)rng());
+
+		t = now_ms();
+		saver.save_async (path, (round % 2) ? save_format::xml : save_format::binary);
+		double pause = now_ms() - t;
+		saver.wait();
+		total_sum += now_ms() - t;
+		pause_sum += pause;
+		pause_max = std::max (pause_max, pause);
+	}
+
+	saver.save_async (path);
+	saver.wait();
+	std::ifstream file (path, std::ios::binary);
+	auto saved = from_binary(std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+	CHECK(same_tree(r.get(), static_cast<root*>(saved.get())));
+
+	std::printf ("%zu objects\n", n);
+	std::printf ("save on the UI thread:      binary %7.1f ms, XML %7.1f ms\n", sync_binary, sync_xml);
+	std::printf ("first background save:      pause  %7.1f ms, until written %7.1f ms\n", first_pause, first_total);
+	if (rounds > 0)
+		std::printf ("after %zu edits (%zu saves, binary and XML alternately): pause %.2f ms mean, %.2f ms max; until written %.1f ms mean\n",
+			edits, rounds, pause_sum / rounds, pause_max, total_sum / rounds);
+
+	std::filesystem::remove (path);
+	return 0;
+}
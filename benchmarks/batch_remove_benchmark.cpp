@@ -0,0 +1,96 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Time to remove a random 10% of the children of an indexed collection of N children (default 1M), with remove()
+// of the whole set, against removing them one at a time from the last to the first; with a std::vector store
+// and with a btree_child_store. Also counts the property_changed notifications each way raises.
+// The one-at-a-time removal is given the indexes; remove() is given the children, and looks up their indexes.
+
+#include "test_support.h"
+#include "child_stores.h"
+#include <random>
+
+using namespace test;
+
+template<typename store_t>
+struct indexed_list : object, indexed_object_collection_i<child, store_t>
+{
+	store_t _children;
+
+	virtual store_t& children_store() override { return _children; }
+	virtual const typed_object_collection_property<child, store_t>* collection_property() const override { return &children_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<child, store_t>* get_children (object* obj) { return static_cast<indexed_list*>(obj); }
+
+	static inline const typed_object_collection_property<child, store_t> children_p { "Children", nullptr, nullptr, false, &get_children };
+	static inline const property* const _props[] = { &children_p };
+	static inline const xtype<> _type = { "IndexedList", nullptr, _props };
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+static size_t changed_count;
+
+static void on_changed (void*, object*, const property_change_args&)
+{
+	changed_count++;
+}
+
+template<typename store_t>
+static void run (const char* name, size_t n)
+{
+	std::mt19937 rng (1);
+	std::vector<size_t> indexes (n);
+	std::iota (indexes.begin(), indexes.end(), 0);
+	std::shuffle (indexes.begin(), indexes.end(), rng);
+	indexes.resize(n / 10);
+
+	double batch, one_by_one;
+	size_t batch_changed, one_by_one_changed;
+	for (bool use_batch : { true, false })
+	{
+		indexed_list<store_t> list;
+		std::vector<std::unique_ptr<child>> children;
+		for (size_t i = 0; i < n; i++)
+			children.push_back(std::make_unique<child>());
+		list.insert_range (0, std::move(children));
+
+		std::vector<child*> to_remove;
+		for (size_t i : indexes)
+			to_remove.push_back(list.child_at(i));
+		std::vector<size_t> descending = indexes;
+		std::sort (descending.begin(), descending.end(), std::greater<size_t>());
+
+		list.property_changed().add_handler(&on_changed, nullptr);
+		changed_count = 0;
+		double t = now_ms();
+		if (use_batch)
+		{
+			auto removed = list.remove(std::span<child* const>(to_remove));
+			CHECK(removed.size() == to_remove.size());
+		}
+		else
+		{
+			for (size_t i : descending)
+				list.remove(i);
+		}
+		(use_batch ? batch : one_by_one) = now_ms() - t;
+		(use_batch ? batch_changed : one_by_one_changed) = changed_count;
+		CHECK(list.child_count() == n - to_remove.size());
+		list.property_changed().remove_handler(&on_changed, nullptr);
+	}
+
+	std::printf ("%-18s batch %8.1f ms (%zu notifications), one by one %8.1f ms (%zu notifications)\n",
+		name, batch, batch_changed, one_by_one, one_by_one_changed);
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	std::printf ("removing %zu of %zu children\n", n / 10, n);
+	run<std::vector<std::unique_ptr<child>>> ("std::vector", n);
+	run<btree_child_store<child>> ("btree_child_store", n);
+	return 0;
+}
@@ -0,0 +1,164 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Save and load times of the binary serializer against the XML ones, for a tree of N objects (default 1M).
+// The XML serializer of the Windows build builds an MSXML DOM; where libxml2 is available, a DOM load with it is measured too,
+// as the closest portable equivalent. The portable xml_writer and xml_reader stream without a DOM.
+
+#include "test_support.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+#ifdef EDGE_HAVE_LIBXML2
+	#include <libxml/parser.h>
+	#include <libxml/tree.h>
+#endif
+
+using namespace test;
+
+#ifdef EDGE_HAVE_LIBXML2
+// Loads the way the DOM-based deserializer does: parse the whole document into a DOM, then walk it,
+// copying names and values to strings and setting properties from strings.
+static void dom_read (xmlNode* element, object* obj)
+{
+	for (xmlAttr* a = element->properties; a != nullptr; a = a->next)
+	{
+		xmlChar* value = xmlNodeListGetString(element->doc, a->children, 1);
+		std::string value_str = reinterpret_cast<const char*>(value);
+		xmlFree(value);
+		auto prop = static_cast<const value_property*>(obj->type()->find_property(reinterpret_cast<const char*>(a->name)));
+		prop->set_from_string (value_str, obj);
+	}
+
+	for (xmlNode* e = element->children; e != nullptr; e = e->next)
+	{
+		if (e->type != XML_ELEMENT_NODE)
+			continue;
+
+		auto prop = obj->type()->find_property(reinterpret_cast<const char*>(e->name));
+		if (prop == &root::children_p)
+		{
+			auto collection = root::children_p.collection_cast(obj);
+			for (xmlNode* c = e->children; c != nullptr; c = c->next)
+			{
+				if (c->type != XML_ELEMENT_NODE)
+					continue;
+				auto child = std::make_unique<test::child>();
+				dom_read (c, child.get());
+				collection->append(std::move(child));
+			}
+		}
+		else if (prop == &root::vals_p)
+		{
+			for (xmlNode* c = e->children; c != nullptr; c = c->next)
+			{
+				if (c->type != XML_ELEMENT_NODE)
+					continue;
+				xmlChar* index = xmlGetProp(c, reinterpret_cast<const xmlChar*>("index"));
+				xmlChar* value = xmlGetProp(c, reinterpret_cast<const xmlChar*>("Value"));
+				size_t i;
+				size_t_property_traits::from_string (reinterpret_cast<const char*>(index), i);
+				root::vals_p.insert_value (reinterpret_cast<const char*>(value), obj, i);
+				xmlFree(index);
+				xmlFree(value);
+			}
+		}
+	}
+}
+
+// Saves the way the DOM-based serializer does: build the whole DOM, formatting values as strings, then write it out.
+static xmlNode* dom_write (xmlDoc* doc, const root* r)
+{
+	auto element = xmlNewDocNode (doc, nullptr, reinterpret_cast<const xmlChar*>("Root"), nullptr);
+	auto children = xmlNewChild (element, nullptr, reinterpret_cast<const xmlChar*>("Children"), nullptr);
+	std::string value;
+	for (size_t i = 0; i < r->child_count(); i++)
+	{
+		auto c = r->child_at(i);
+		auto e = xmlNewChild (children, nullptr, reinterpret_cast<const xmlChar*>("Child"), nullptr);
+		for (auto prop : c->type()->property_list())
+		{
+			auto vp = static_cast<const value_property*>(prop);
+			if (vp->changed_from_default(c))
+			{
+				vp->get_to_string (c, value);
+				xmlSetProp (e, reinterpret_cast<const xmlChar*>(prop->_name), reinterpret_cast<const xmlChar*>(value.c_str()));
+			}
+		}
+	}
+
+	auto vals = xmlNewChild (element, nullptr, reinterpret_cast<const xmlChar*>("Vals"), nullptr);
+	for (size_t i = 0; i < r->val_count(); i++)
+	{
+		auto e = xmlNewChild (vals, nullptr, reinterpret_cast<const xmlChar*>("Entry"), nullptr);
+		xmlSetProp (e, reinterpret_cast<const xmlChar*>("index"), reinterpret_cast<const xmlChar*>(std::to_string(i).c_str()));
+		xmlSetProp (e, reinterpret_cast<const xmlChar*>("Value"), reinterpret_cast<const xmlChar*>(std::to_string(r->val(i)).c_str()));
+	}
+
+	return element;
+}
+#endif
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	auto tree = make_tree(n);
+
+	double t = now_ms();
+	auto binary = to_binary(tree.get());
+	double binary_save = now_ms() - t;
+
+	t = now_ms();
+	auto binary_loaded = from_binary(binary);
+	double binary_load = now_ms() - t;
+	CHECK(same_tree(tree.get(), static_cast<root*>(binary_loaded.get())));
+	binary_loaded = nullptr;
+
+	t = now_ms();
+	vector_out_stream xml;
+	{
+		xml_writer writer (&xml);
+		writer.write_declaration();
+		serialize (writer, tree.get(), true);
+	}
+	double xml_save = now_ms() - t;
+
+	t = now_ms();
+	std::string_view xml_text (reinterpret_cast<const char*>(xml.buffer.data()), xml.buffer.size());
+	xml_reader reader (xml_text);
+	reader.read();
+	auto xml_loaded = deserialize(reader, known_types);
+	double xml_load = now_ms() - t;
+	CHECK(same_tree(tree.get(), static_cast<root*>(xml_loaded.get())));
+	xml_loaded = nullptr;
+
+	std::printf ("%zu objects: binary %.1f MB, XML %.1f MB\n", n, binary.size() / 1e6, xml.buffer.size() / 1e6);
+	std::printf ("binary:             save %7.1f ms, load %7.1f ms\n", binary_save, binary_load);
+	std::printf ("streaming XML:      save %7.1f ms, load %7.1f ms  (binary %.1fx / %.1fx faster)\n",
+		xml_save, xml_load, xml_save / binary_save, xml_load / binary_load);
+
+	#ifdef EDGE_HAVE_LIBXML2
+	t = now_ms();
+	xmlDoc* saved_doc = xmlNewDoc (reinterpret_cast<const xmlChar*>("1.0"));
+	xmlDocSetRootElement (saved_doc, dom_write(saved_doc, tree.get()));
+	xmlChar* saved_text;
+	int saved_size;
+	xmlDocDumpFormatMemory (saved_doc, &saved_text, &saved_size, 1);
+	xmlFree (saved_text);
+	xmlFreeDoc (saved_doc);
+	double dom_save = now_ms() - t;
+
+	t = now_ms();
+	xmlDoc* doc = xmlReadMemory (xml_text.data(), (int)xml_text.size(), nullptr, nullptr, XML_PARSE_HUGE);
+	CHECK(doc != nullptr);
+	root dom_loaded;
+	dom_read (xmlDocGetRootElement(doc), &dom_loaded);
+	xmlFreeDoc(doc);
+	double dom_load = now_ms() - t;
+	CHECK(same_tree(tree.get(), &dom_loaded));
+	std::printf ("DOM XML (libxml2):  save %7.1f ms, load %7.1f ms  (binary %.1fx / %.1fx faster)\n",
+		dom_save, dom_load, dom_save / binary_save, dom_load / binary_load);
+	#endif
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Save time of a document where 95% of the values are defaults, with and without changed_from_default_bits,
+// and the cost of a property set in both cases. N objects (default 1M) with 20 int32 properties each.
+
+#include "wide_item.h"
+#include "xml_writer.h"
+#include <random>
+
+using namespace test;
+
+struct null_out_stream : out_stream_i
+{
+	size_t size = 0;
+
+	using out_stream_i::write;
+
+	virtual void write (const void* data, size_t size) override { this->size += size; }
+};
+
+template<bool tracked>
+static void run (size_t n)
+{
+	using item_t = wide_item<tracked>;
+	item_list<item_t> list;
+	list._items.reserve(n);
+	std::mt19937 rng (1);
+	for (size_t i = 0; i < n; i++)
+	{
+		auto item = std::make_unique<item_t>();
+		for (auto& p : item_t::props)
+		{
+			if (rng() % 20 == 0)
+				p.set ((int32_t)(rng() % 1000) + 1, item.get());
+		}
+		list.append(std::move(item));
+	}
+
+	double t = now_ms();
+	null_out_stream binary;
+	serialize (&list, &binary);
+	double binary_save = now_ms() - t;
+
+	t = now_ms();
+	null_out_stream xml;
+	{
+		xml_writer writer (&xml);
+		serialize (writer, &list, true);
+	}
+	double xml_save = now_ms() - t;
+
+	// Sets through the property, as the deserializers and the property grid do; half of them to the default value.
+	size_t set_count = 20 * n;
+	t = now_ms();
+	for (size_t i = 0; i < set_count; i++)
+		item_t::props[i % 20].set ((int32_t)(i & 1), list._items[(i / 20) % n].get());
+	double sets = now_ms() - t;
+
+	std::printf ("%-9s binary save %6.1f ms (%.1f MB), XML save %6.1f ms (%.1f MB), property set %.2f ns\n",
+		tracked ? "tracked:" : "untracked:", binary_save, binary.size / 1e6, xml_save, xml.size / 1e6, sets * 1e6 / set_count);
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	std::printf ("%zu objects, 20 int32 properties each, 5%% of the values not default\n", n);
+	run<false>(n);
+	run<true>(n);
+	return 0;
+}
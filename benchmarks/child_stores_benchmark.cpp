@@ -0,0 +1,65 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Child stores with N children (default 1M): time per insert and per erase at random indexes (M of each, default 10000),
+// per read at a random index, and per child when iterating over all of them; for std::vector, segmented_child_store
+// and btree_child_store.
+
+#include "test_support.h"
+#include "child_stores.h"
+#include <random>
+
+using namespace test;
+
+template<typename store_t>
+static void run (const char* name, size_t n, size_t m)
+{
+	using ops = child_store_ops<store_t>;
+	store_t store;
+	std::vector<std::unique_ptr<int>> initial;
+	for (size_t i = 0; i < n; i++)
+		initial.push_back(std::make_unique<int>((int)i));
+	ops::insert (store, 0, std::move(initial));
+
+	std::mt19937 rng (1);
+	double t = now_ms();
+	for (size_t i = 0; i < m; i++)
+		ops::insert (store, rng() % (store.size() + 1), std::make_unique<int>(0));
+	double insert = now_ms() - t;
+
+	t = now_ms();
+	for (size_t i = 0; i < m; i++)
+		ops::erase (store, rng() % store.size());
+	double erase = now_ms() - t;
+	CHECK(store.size() == n);
+
+	std::vector<size_t> indexes (m);
+	for (auto& i : indexes)
+		i = rng() % n;
+	int64_t sum = 0;
+	t = now_ms();
+	for (size_t i : indexes)
+		sum += *store[i];
+	double read = now_ms() - t;
+
+	t = now_ms();
+	for (auto& p : store)
+		sum += *p;
+	double iterate = now_ms() - t;
+	CHECK(sum != 0);
+
+	std::printf ("%-22s insert %8.3f us, erase %8.3f us, read %6.3f us, iterate %5.2f ns per child\n",
+		name, insert * 1000 / m, erase * 1000 / m, read * 1000 / m, iterate * 1e6 / n);
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t m = size_arg(argc, argv, 2, 10'000);
+	std::printf ("%zu children, %zu inserts and erases\n", n, m);
+	run<std::vector<std::unique_ptr<int>>> ("std::vector", n, m);
+	run<segmented_child_store<int>> ("segmented_child_store", n, m);
+	run<btree_child_store<int>> ("btree_child_store", n, m);
+	return 0;
+}
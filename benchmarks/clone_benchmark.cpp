@@ -0,0 +1,64 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Time to clone a tree of N objects (default 1M), with objects from the heap, an object_pool and an object_arena,
+// against copying it through a binary and an XML round trip.
+
+#include "test_support.h"
+#include "clone.h"
+#include "object_allocators.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+
+using namespace test;
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	auto tree = make_tree(n);
+	std::printf ("%zu objects\n", n);
+
+	double t = now_ms();
+	auto heap_copy = clone(tree.get());
+	double heap = now_ms() - t;
+	CHECK(same_tree(tree.get(), static_cast<root*>(heap_copy.get())));
+	heap_copy = nullptr;
+
+	double pooled, arena;
+	{
+		object_pool pool;
+		t = now_ms();
+		auto copy = clone(tree.get(), &pool);
+		pooled = now_ms() - t;
+	}
+	{
+		object_arena a;
+		t = now_ms();
+		auto copy = clone(tree.get(), &a);
+		arena = now_ms() - t;
+	}
+
+	t = now_ms();
+	auto binary_copy = from_binary(to_binary(tree.get()));
+	double binary = now_ms() - t;
+	CHECK(same_tree(tree.get(), static_cast<root*>(binary_copy.get())));
+	binary_copy = nullptr;
+
+	t = now_ms();
+	vector_out_stream xml;
+	{
+		xml_writer writer (&xml);
+		serialize (writer, tree.get(), true);
+	}
+	xml_reader reader (std::string_view(reinterpret_cast<const char*>(xml.buffer.data()), xml.buffer.size()));
+	reader.read();
+	auto xml_copy = deserialize(reader, known_types);
+	double xml_round_trip = now_ms() - t;
+	CHECK(same_tree(tree.get(), static_cast<root*>(xml_copy.get())));
+
+	std::printf ("clone: %.1f ms (heap), %.1f ms (object_pool), %.1f ms (object_arena)\n", heap, pooled, arena);
+	std::printf ("binary round trip: %.1f ms (clone %.1fx faster)\n", binary, binary / heap);
+	std::printf ("XML round trip:    %.1f ms (clone %.1fx faster)\n", xml_round_trip, xml_round_trip / heap);
+	return 0;
+}
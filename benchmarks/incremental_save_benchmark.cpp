@@ -0,0 +1,65 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Save time of incremental_binary_serializer after a few edits in a document of N objects (default 1M)
+// in one collection, compared with the first save and with a full serialize().
+
+#include "test_support.h"
+#include <random>
+
+using namespace test;
+
+struct null_out_stream : out_stream_i
+{
+	size_t size = 0;
+
+	using out_stream_i::write;
+
+	virtual void write (const void* data, size_t size) override { this->size += size; }
+};
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t rounds = size_arg(argc, argv, 2, 20);
+	auto r = make_tree(n);
+
+	double t = now_ms();
+	null_out_stream full;
+	serialize (r.get(), &full);
+	double full_save = now_ms() - t;
+
+	incremental_binary_serializer s (r.get());
+	t = now_ms();
+	null_out_stream first;
+	s.serialize (&first);
+	double first_save = now_ms() - t;
+	std::printf ("%zu objects (%.1f MB): serialize() %.1f ms, first incremental save %.1f ms\n", n, first.size / 1e6, full_save, first_save);
+
+	std::mt19937 rng (1);
+	for (size_t edits : { (size_t)0, (size_t)1, (size_t)10, (size_t)1000 })
+	{
+		double total = 0, max = 0;
+		for (size_t round = 0; round < rounds; round++)
+		{
+			for (size_t e = 0; e < edits; e++)
+			{
+				auto c = r->child_at(rng() % n);
+				c->set_x (c->x() + 1);
+			}
+
+			t = now_ms();
+			null_out_stream out;
+			s.serialize (&out);
+			double d = now_ms() - t;
+			CHECK (out.size >= first.size - 4 * edits);
+			total += d;
+			max = std::max(max, d);
+		}
+
+		std::printf ("after %4zu edits: mean %6.2f ms, max %6.2f ms\n", edits, total / rounds, max);
+	}
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Save latency and replay time of a journaled_document for a tree of N objects (default 1M) and E value sets
+// on random children (default 1M), saved every S edits (default 1000). Opening replays the journal, and is compared
+// with opening the same document after compaction, which only loads the snapshot.
+
+#include "test_support.h"
+#include "journaled_document.h"
+#include <random>
+
+using namespace test;
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t edit_count = size_arg(argc, argv, 2, 1'000'000);
+	size_t save_every = size_arg(argc, argv, 3, 1000);
+	const char path[] = "journaled_document_benchmark.bin";
+
+	auto expected = make_tree(n);
+	double edits_ms = 0;
+	double saves_ms = 0;
+	double max_save_ms = 0;
+	size_t save_count = 0;
+	uint64_t journal_size;
+	uint64_t snapshot_size;
+	{
+		double t = now_ms();
+		journaled_document doc (path, make_tree(n));
+		double create_ms = now_ms() - t;
+		auto r = static_cast<root*>(doc.root());
+
+		std::mt19937_64 rng (1);
+		for (size_t e = 0; e < edit_count; )
+		{
+			size_t batch_end = std::min (e + save_every, edit_count);
+			t = now_ms();
+			for (; e < batch_end; e++)
+			{
+				size_t i = rng() % n;
+				int32_t x = (int32_t)(rng() % 1000000);
+				r->child_at(i)->set_x(x);
+				expected->child_at(i)->_x = x;
+			}
+			edits_ms += now_ms() - t;
+
+			t = now_ms();
+			doc.save();
+			double save_ms = now_ms() - t;
+			saves_ms += save_ms;
+			max_save_ms = std::max (max_save_ms, save_ms);
+			save_count++;
+		}
+
+		journal_size = doc.journal_size();
+		snapshot_size = doc.snapshot_size();
+		std::printf ("%zu objects, %zu value sets saved every %zu: snapshot %.1f MB written in %.0f ms, journal %.1f MB (%.1f bytes per edit)\n",
+			n, edit_count, save_every, snapshot_size / 1e6, create_ms, journal_size / 1e6, (double)journal_size / edit_count);
+	}
+
+	// A journal bigger than the snapshot would have been compacted by save().
+	CHECK(journal_size > 0);
+
+	std::printf ("edit, recorded: %7.3f us\n", edits_ms * 1000 / edit_count);
+	std::printf ("save:           %7.3f ms mean, %.3f ms max\n", saves_ms / save_count, max_save_ms);
+
+	double t = now_ms();
+	double replay_ms;
+	{
+		journaled_document doc (path, known_types);
+		replay_ms = now_ms() - t;
+		CHECK(same_tree(static_cast<root*>(doc.root()), expected.get()));
+		doc.compact();
+	}
+
+	t = now_ms();
+	double snapshot_ms;
+	{
+		journaled_document doc (path, known_types);
+		snapshot_ms = now_ms() - t;
+		CHECK(same_tree(static_cast<root*>(doc.root()), expected.get()));
+	}
+
+	std::printf ("open:           %7.1f ms with the journal, %.1f ms after compaction (replay %.3f us per record)\n",
+		replay_ms, snapshot_ms, (replay_ms - snapshot_ms) * 1000 / edit_count);
+
+	std::filesystem::remove (path);
+	return 0;
+}
@@ -0,0 +1,104 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Lookups by key in a keyed_object_collection_i of N children (default 1M): M random finds (default 1M) by an int32 key
+// and by a string key given as std::string_view, against a scan of the children for the same key.
+
+#include "test_support.h"
+#include "keyed_collection.h"
+#include <random>
+
+using namespace test;
+
+template<typename key_traits>
+struct keyed_list : object, keyed_object_collection_i<child, key_traits>
+{
+	using base = object;
+
+	virtual const keyed_object_collection_property<child, key_traits>* collection_property() const override { return &children_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<child>* get_children (object* obj) { return static_cast<keyed_list*>(obj); }
+
+	static const keyed_object_collection_property<child, key_traits> children_p;
+	static inline const property* const _props[] = { &children_p };
+	static inline const xtype<> _type = { "KeyedList", nullptr, _props };
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+template<> const keyed_object_collection_property<child, int32_property_traits> keyed_list<int32_property_traits>::children_p
+	{ "Children", nullptr, nullptr, false, &get_children, &child::x_p };
+template<> const keyed_object_collection_property<child, temp_string_property_traits> keyed_list<temp_string_property_traits>::children_p
+	{ "Children", nullptr, nullptr, false, &get_children, &child::name_p };
+
+static std::string name_of (size_t i)
+{
+	return "child name " + std::to_string(i);
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t m = size_arg(argc, argv, 2, 1'000'000);
+	std::printf ("%zu children, %zu lookups\n", n, m);
+
+	keyed_list<int32_property_traits> by_x;
+	keyed_list<temp_string_property_traits> by_name;
+	double t = now_ms();
+	for (size_t i = 0; i < n; i++)
+	{
+		auto c = std::make_unique<child>();
+		c->_x = (int32_t)i;
+		by_x.append(std::move(c));
+	}
+	double build_x = now_ms() - t;
+
+	t = now_ms();
+	for (size_t i = 0; i < n; i++)
+	{
+		auto c = std::make_unique<child>();
+		c->_name = name_of(i);
+		by_name.append(std::move(c));
+	}
+	double build_name = now_ms() - t;
+
+	std::mt19937 rng (1);
+	std::vector<int32_t> xs (m);
+	std::vector<std::string> names (m);
+	for (size_t i = 0; i < m; i++)
+	{
+		xs[i] = (int32_t)(rng() % n);
+		names[i] = name_of(xs[i]);
+	}
+
+	size_t found = 0;
+	t = now_ms();
+	for (auto x : xs)
+		found += (by_x.find(x) != nullptr);
+	double find_x = now_ms() - t;
+
+	t = now_ms();
+	for (auto& name : names)
+		found += (by_name.find(std::string_view(name)) != nullptr);
+	double find_name = now_ms() - t;
+	CHECK(found == 2 * m);
+
+	// The scan is slow, so only a few lookups.
+	size_t scans = std::min<size_t>(m, 100);
+	t = now_ms();
+	for (size_t i = 0; i < scans; i++)
+	{
+		auto& children = by_x.children();
+		auto it = std::find_if (children.begin(), children.end(), [x = xs[i]](auto& c) { return c->x() == x; });
+		found += (it != children.end());
+	}
+	double scan = now_ms() - t;
+	CHECK(found == 2 * m + scans);
+
+	std::printf ("build: %.1f ms (int32 key), %.1f ms (string key)\n", build_x, build_name);
+	std::printf ("find: %.1f ns (int32 key), %.1f ns (string key); scan: %.1f us\n",
+		find_x * 1e6 / m, find_name * 1e6 / m, scan * 1000 / scans);
+	return 0;
+}
@@ -0,0 +1,159 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// A document with N children (default 10M) in one collection, opened as a paged_document with a lazy collection
+// (memory budget B children, default 100K), against deserializing it into an ordinary collection. Time until
+// the first child can be read, then time to read every child, with the peak RSS after each.
+// Each way of loading runs in a process of its own, so that the peak RSS of one doesn't hide that of the other.
+//
+//   lazy_collection_benchmark [N] [B]
+
+#include "test_support.h"
+#include "lazy_collection.h"
+#include "mapped_document.h"
+#include <fstream>
+#include <string>
+
+using namespace test;
+
+static const char paged_path[] = "lazy_collection_benchmark_paged.bin";
+static const char full_path[] = "lazy_collection_benchmark_full.bin";
+
+struct lazy_root : object, lazy_object_collection_i<child>
+{
+	using base = object;
+
+	virtual const typed_object_collection_property<child, lazy_child_store<child>>* collection_property() const override { return &children_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<child, lazy_child_store<child>>* get_children (object* obj) { return static_cast<lazy_root*>(obj); }
+
+	static const typed_object_collection_property<child, lazy_child_store<child>> children_p;
+	static const property* const _props[];
+	static const xtype<> _type;
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+const typed_object_collection_property<child, lazy_child_store<child>> lazy_root::children_p { "Children", nullptr, nullptr, false, &lazy_root::get_children };
+const property* const lazy_root::_props[] = { &children_p };
+const xtype<> lazy_root::_type = { "LazyRoot", nullptr, lazy_root::_props, []() { return std::unique_ptr<object>(new lazy_root()); } };
+
+static const concrete_type* const types[] = { &child::_type, &root::_type, &lazy_root::_type };
+
+struct file_out_stream : out_stream_i
+{
+	std::ofstream file;
+
+	file_out_stream (const char* path)
+		: file(path, std::ios::binary | std::ios::trunc)
+	{ }
+
+	using out_stream_i::write;
+
+	virtual void write (const void* data, size_t size) override { file.write (static_cast<const char*>(data), size); }
+};
+
+// The same children, written once as a paged document and once as an ordinary one.
+static void write_documents (size_t n)
+{
+	lazy_root lazy;
+	std::vector<std::unique_ptr<child>> children;
+	children.reserve(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		children.push_back(std::make_unique<child>());
+		children.back()->_x = (int32_t)i;
+	}
+	lazy.insert_range (0, std::move(children));
+	{
+		file_out_stream s (paged_path);
+		serialize_paged (&lazy, &s);
+		CHECK(s.file.good());
+		std::printf ("%zu children, %.2f GB\n", n, s.file.tellp() / 1e9);
+		std::fflush (stdout);
+	}
+
+	root r;
+	r.insert_range (0, lazy.remove_range(0, n));
+	file_out_stream s (full_path);
+	serialize (&r, &s);
+	CHECK(s.file.good());
+}
+
+template<typename collection_t>
+static int64_t sum_of_x (const collection_t* c)
+{
+	int64_t sum = 0;
+	for (size_t i = 0, count = c->child_count(); i < count; i++)
+		sum += c->child_at(i)->x();
+	return sum;
+}
+
+static void load (bool lazy, size_t budget)
+{
+	double t = now_ms();
+	double first_access, read_all;
+	size_t first_rss, n;
+	int64_t sum;
+	if (lazy)
+	{
+		paged_document doc (paged_path, types);
+		auto r = static_cast<lazy_root*>(doc.root());
+		r->set_memory_budget(budget);
+		n = r->child_count();
+		sum = r->child_at(n / 2)->x();
+		first_access = now_ms() - t;
+		first_rss = peak_rss();
+
+		t = now_ms();
+		sum += sum_of_x(r);
+		read_all = now_ms() - t;
+	}
+	else
+	{
+		std::ifstream file (full_path, std::ios::binary | std::ios::ate);
+		std::vector<uint8_t> buffer ((size_t)file.tellg());
+		file.seekg(0);
+		file.read (reinterpret_cast<char*>(buffer.data()), buffer.size());
+		CHECK(file.good());
+		auto loaded = from_binary(buffer);
+		auto r = static_cast<root*>(loaded.get());
+		n = r->child_count();
+		sum = r->child_at(n / 2)->x();
+		first_access = now_ms() - t;
+		first_rss = peak_rss();
+
+		t = now_ms();
+		sum += sum_of_x(r);
+		read_all = now_ms() - t;
+	}
+
+	CHECK(sum == (int64_t)(n / 2) + (int64_t)n * (n - 1) / 2);
+	std::printf ("%-9s first child after %8.1f ms, peak RSS %7.1f MB; all children read in %7.1f ms, peak RSS %7.1f MB\n",
+		lazy ? "lazy:" : "ordinary:", first_access, first_rss / 1048576.0, read_all, peak_rss() / 1048576.0);
+}
+
+int main (int argc, char** argv)
+{
+	if ((argc > 2) && (std::string_view(argv[1]) == "--load-lazy" || std::string_view(argv[1]) == "--load-ordinary"))
+	{
+		load (std::string_view(argv[1]) == "--load-lazy", size_arg(argc, argv, 2, 0));
+		return 0;
+	}
+
+	size_t n = size_arg(argc, argv, 1, 10'000'000);
+	size_t budget = size_arg(argc, argv, 2, 100'000);
+	write_documents (n);
+
+	for (const char* mode : { "--load-lazy", "--load-ordinary" })
+	{
+		std::string command = std::string("\"") + argv[0] + "\" " + mode + " " + std::to_string(budget);
+		CHECK(std::system(command.c_str()) == 0);
+	}
+
+	std::remove (paged_path);
+	std::remove (full_path);
+	return 0;
+}
@@ -0,0 +1,142 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Load time and peak RSS of a big binary document (default 2 GB, made of objects with 16 KB backed strings),
+// opened as a mapped_document, against reading the file into a buffer and deserializing from it.
+// Each way of loading runs in a process of its own, so that the peak RSS of one doesn't hide that of the other.
+//
+//   mapped_document_benchmark [size in MB] [string size in bytes]
+
+#include "test_support.h"
+#include "mapped_document.h"
+#include <fstream>
+#include <string>
+#include <utility>
+
+using namespace test;
+
+static const char path[] = "mapped_document_benchmark.bin";
+
+struct file_out_stream : out_stream_i
+{
+	std::ofstream file { path, std::ios::binary | std::ios::trunc };
+
+	using out_stream_i::write;
+
+	virtual void write (const void* data, size_t size) override { file.write (static_cast<const char*>(data), size); }
+};
+
+static void write_document (size_t size_mb, size_t string_size)
+{
+	std::string text (string_size + 256, ' ');
+	for (size_t i = 0; i < text.size(); i++)
+		text[i] = 'a' + (char)(i % 26);
+
+	size_t count = size_mb * 1024 * 1024 / string_size;
+	blob_list list;
+	list._blobs.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		auto b = std::make_unique<blob>();
+		b->_number = (uint32_t)i;
+		b->_data = std::string_view(text).substr(i % 256, string_size);
+		list.append(std::move(b));
+	}
+
+	file_out_stream s;
+	serialize (&list, &s);
+	CHECK(s.file.good());
+	std::printf ("%zu objects, %.2f GB\n", count, s.file.tellp() / 1e9);
+}
+
+// Sums a byte of every page of every string, as a stand-in for using the strings.
+static uint64_t touch (const blob_list* list)
+{
+	uint64_t sum = 0;
+	for (auto& b : list->_blobs)
+	{
+		for (size_t i = 0; i < b->_data.size(); i += 4096)
+			sum += (uint8_t)b->_data[i];
+	}
+
+	return sum;
+}
+
+// Resident memory split into anonymous (heap) memory and pages of mapped files, which the OS can drop and read again
+// when memory is short. Only available on Linux; elsewhere both are zero.
+static std::pair<size_t, size_t> resident_anon_and_file()
+{
+	size_t anon = 0, file = 0;
+	#ifdef __linux__
+	std::ifstream status ("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.rfind("RssAnon:", 0) == 0)
+			anon = std::strtoull(line.c_str() + 8, nullptr, 10) * 1024;
+		else if (line.rfind("RssFile:", 0) == 0)
+			file = std::strtoull(line.c_str() + 8, nullptr, 10) * 1024;
+	}
+	#endif
+	return { anon, file };
+}
+
+static void load (bool mapped)
+{
+	double t = now_ms();
+	std::unique_ptr<mapped_document> doc;
+	std::vector<uint8_t> buffer;
+	std::unique_ptr<object> buffer_root;
+	const blob_list* list;
+	if (mapped)
+	{
+		doc = std::make_unique<mapped_document>(path, known_types);
+		list = static_cast<const blob_list*>(doc->root());
+	}
+	else
+	{
+		std::ifstream file (path, std::ios::binary | std::ios::ate);
+		buffer.resize ((size_t)file.tellg());
+		file.seekg(0);
+		file.read (reinterpret_cast<char*>(buffer.data()), buffer.size());
+		CHECK(file.good());
+		buffer_root = from_binary(buffer);
+		list = static_cast<const blob_list*>(buffer_root.get());
+	}
+	double load_time = now_ms() - t;
+	size_t load_rss = peak_rss();
+	auto [anon, file] = resident_anon_and_file();
+
+	t = now_ms();
+	uint64_t sum = touch(list);
+	double touch_time = now_ms() - t;
+
+	std::printf ("%-15s load %7.1f ms, peak RSS %7.1f MB (after loading: heap %7.1f MB, file pages %7.1f MB); "
+		"then reading every page of the strings %6.1f ms, peak RSS %7.1f MB (%llu)\n",
+		mapped ? "mapped:" : "read to buffer:", load_time, load_rss / 1048576.0, anon / 1048576.0, file / 1048576.0,
+		touch_time, peak_rss() / 1048576.0, (unsigned long long)sum);
+}
+
+int main (int argc, char** argv)
+{
+	if ((argc > 1) && (std::string_view(argv[1]) == "--load-mapped" || std::string_view(argv[1]) == "--load-buffer"))
+	{
+		load (std::string_view(argv[1]) == "--load-mapped");
+		return 0;
+	}
+
+	size_t size_mb = size_arg(argc, argv, 1, 2048);
+	size_t string_size = size_arg(argc, argv, 2, 16384);
+	write_document (size_mb, string_size);
+
+	// The file was just written, so it's likely in the page cache; both loads read it from there.
+	for (const char* mode : { "--load-mapped", "--load-buffer" })
+	{
+		std::string command = std::string("\"") + argv[0] + "\" " + mode;
+		CHECK(std::system(command.c_str()) == 0);
+	}
+
+	std::remove (path);
+	return 0;
+}
@@ -0,0 +1,137 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// N objects (default 1M) of two types of the same size, created alternately.
+//  - The allocation header: new/delete through object::operator new with no scope active, against ::operator new
+//    of the object's size alone, which is what objects would cost without the header.
+//  - Per-size-class pooling (one object_pool for both types, as the library does) against per-type pooling
+//    (one object_pool per type): time to create the objects, to read those of one type in creation order,
+//    and to delete the objects of one type and create as many of the other.
+
+#include "test_support.h"
+#include "object_allocators.h"
+#include <random>
+
+using namespace test;
+
+template<int tag>
+struct item : object
+{
+	int64_t _values[5] = { tag, 0, 0, 0, 0 };
+
+	static inline const xtype<> _type = { "Item", nullptr, { } };
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+using item_a = item<0>;
+using item_b = item<1>;
+static_assert (sizeof(item_a) == sizeof(item_b));
+
+template<typename function_t>
+static double best_of (function_t f)
+{
+	double best = 1e300;
+	for (int i = 0; i < 3; i++)
+		best = std::min (best, f());
+	return best;
+}
+
+struct pooling_times
+{
+	double create;
+	double read;
+	double churn;
+};
+
+// "pool_a" and "pool_b" are the same pool for per-size-class pooling.
+static pooling_times measure_pooling (size_t n, object_pool* pool_a, object_pool* pool_b)
+{
+	std::vector<std::unique_ptr<item_a>> as;
+	std::vector<std::unique_ptr<item_b>> bs;
+	as.reserve(n);
+	bs.reserve(n);
+
+	pooling_times times;
+	double t = now_ms();
+	for (size_t i = 0; i < n / 2; i++)
+	{
+		{
+			object_allocation_scope scope (pool_a);
+			as.push_back(std::make_unique<item_a>());
+		}
+		{
+			object_allocation_scope scope (pool_b);
+			bs.push_back(std::make_unique<item_b>());
+		}
+	}
+	times.create = now_ms() - t;
+
+	t = now_ms();
+	int64_t sum = 0;
+	for (int pass = 0; pass < 10; pass++)
+	{
+		for (auto& a : as)
+			sum += a->_values[0] + a->_values[4];
+	}
+	times.read = (now_ms() - t) / 10;
+	CHECK(sum == 0);
+
+	t = now_ms();
+	size_t count = as.size();
+	as.clear();
+	{
+		object_allocation_scope scope (pool_b);
+		for (size_t i = 0; i < count; i++)
+			bs.push_back(std::make_unique<item_b>());
+	}
+	times.churn = now_ms() - t;
+
+	bs.clear();
+	return times;
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	std::printf ("%zu objects of %zu bytes, allocation header %zu bytes\n", n, sizeof(item_a), alignof(std::max_align_t));
+
+	std::vector<void*> blocks (n);
+	double raw = best_of([&]
+	{
+		double t = now_ms();
+		for (auto& b : blocks)
+			b = ::operator new(sizeof(item_a));
+		for (auto b : blocks)
+			::operator delete(b);
+		return now_ms() - t;
+	});
+
+	std::vector<std::unique_ptr<item_a>> objects (n);
+	double with_header = best_of([&]
+	{
+		double t = now_ms();
+		for (auto& o : objects)
+			o = std::make_unique<item_a>();
+		for (auto& o : objects)
+			o = nullptr;
+		return now_ms() - t;
+	});
+
+	std::printf ("heap new/delete: %.1f ns per object with the header, %.1f ns without (%+.0f%%)\n",
+		with_header * 1e6 / n, raw * 1e6 / n, (with_header / raw - 1) * 100);
+
+	pooling_times shared, per_type;
+	{
+		object_pool pool;
+		shared = measure_pooling (n, &pool, &pool);
+	}
+	{
+		object_pool pool_a, pool_b;
+		per_type = measure_pooling (n, &pool_a, &pool_b);
+	}
+
+	std::printf ("per-size-class pooling: create %.1f ms, read one type %.2f ms, replace one type %.1f ms\n", shared.create, shared.read, shared.churn);
+	std::printf ("per-type pooling:       create %.1f ms, read one type %.2f ms, replace one type %.1f ms\n", per_type.create, per_type.read, per_type.churn);
+	return 0;
+}
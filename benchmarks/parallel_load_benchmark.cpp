@@ -0,0 +1,87 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Scaling of the parallel XML load with the number of workers, from 1 to M (default: the number of cores),
+// for the document xml_writer writes for a tree of N objects (default 1M), against the serial load.
+//
+// Before the workers start, the reader goes once over the children on the calling thread, to find where each one begins;
+// that pass is measured on its own too. It, and appending the children to the collection, are serial,
+// so the speedup can't go above the serial load time divided by their time, however many workers there are.
+
+#include "test_support.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+#include "work_stealing_pool.h"
+
+using namespace test;
+
+// The best of a few runs, so that page faults of the first one don't count.
+template<typename f_t>
+static double best_of (f_t f)
+{
+	double best = 1e300;
+	for (int i = 0; i < 3; i++)
+	{
+		double t = now_ms();
+		f();
+		best = std::min (best, now_ms() - t);
+	}
+	return best;
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t max_workers = size_arg(argc, argv, 2, std::max(std::thread::hardware_concurrency(), 1u));
+
+	auto tree = make_tree(n);
+	vector_out_stream xml;
+	{
+		xml_writer writer (&xml);
+		writer.write_declaration();
+		serialize (writer, tree.get(), true);
+	}
+	std::string_view document (reinterpret_cast<const char*>(xml.buffer.data()), xml.buffer.size());
+
+	std::unique_ptr<object> loaded;
+	double serial = best_of([&]
+	{
+		loaded = nullptr;
+		xml_reader reader (document);
+		reader.read();
+		loaded = deserialize (reader, known_types);
+	});
+	CHECK(same_tree(tree.get(), static_cast<root*>(loaded.get())));
+
+	// The pass that finds the children, as read_new_object_collection_parallel does it.
+	double find_children = best_of([&]
+	{
+		xml_reader reader (document);
+		reader.read();
+		while ((reader.read() == xml_reader::node_type::start_element) && (reader.name() != "Children"))
+			reader.skip_element();
+		while (reader.read() == xml_reader::node_type::start_element)
+			reader.skip_element();
+	});
+
+	std::printf ("%zu objects, %.1f MB of XML, hardware threads: %u\n", n, document.size() / 1e6, std::thread::hardware_concurrency());
+	std::printf ("serial load         %7.1f ms\n", serial);
+	std::printf ("finding children    %7.1f ms (speedup at most %.1fx)\n", find_children, serial / find_children);
+
+	for (size_t workers = 1; workers <= max_workers; workers++)
+	{
+		work_stealing_pool pool (workers - 1);
+		double parallel = best_of([&]
+		{
+			loaded = nullptr;
+			xml_reader reader (document);
+			reader.read();
+			loaded = deserialize (reader, known_types, pool);
+		});
+		CHECK(same_tree(tree.get(), static_cast<root*>(loaded.get())));
+		std::printf ("%2zu worker%s          %7.1f ms (%.2fx)\n", workers, (workers == 1) ? " " : "s", parallel, serial / parallel);
+	}
+
+	return 0;
+}
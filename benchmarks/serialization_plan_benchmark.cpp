@@ -0,0 +1,95 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Time per object of serializing a tree of N objects (default 1M) over the serialization plans: the walk alone,
+// with an object_writer_i that only counts the calls, and the binary and XML serializers into a stream
+// that discards its input.
+
+#include "test_support.h"
+#include "xml_writer.h"
+
+using namespace test;
+
+struct null_out_stream : out_stream_i
+{
+	size_t size = 0;
+
+	using out_stream_i::write;
+
+	virtual void write (const void* data, size_t size) override { this->size += size; }
+};
+
+struct counting_writer : object_writer_i
+{
+	size_t objects = 0;
+	size_t values = 0;
+
+	virtual bool begin_object (const object* obj, const serialization_plan& plan, std::span<const size_t> values, size_t content_count, size_t index, bool force) override
+	{
+		objects++;
+		this->values += values.size();
+		return true;
+	}
+
+	virtual void end_object (const object* obj) override { }
+	virtual void begin_object_collection (const object* obj, const serialization_plan& plan, size_t prop_index, const object_collection_i* collection) override { }
+	virtual void end_object_collection() override { }
+	virtual void write_value_collection (const object* obj, const serialization_plan& plan, size_t prop_index) override { }
+	virtual void begin_object_property (const object* obj, const serialization_plan& plan, size_t prop_index) override { }
+};
+
+template<typename f_t>
+static double best_of (f_t f)
+{
+	double best = 1e300;
+	for (int i = 0; i < 3; i++)
+	{
+		double t = now_ms();
+		f();
+		best = std::min (best, now_ms() - t);
+	}
+	return best;
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	auto tree = make_tree(n);
+
+	size_t objects = 0;
+	size_t values = 0;
+	double walk = best_of([&]
+	{
+		counting_writer writer;
+		write_object (writer, tree.get(), true);
+		objects = writer.objects;
+		values = writer.values;
+	});
+
+	size_t binary_size = 0;
+	double binary = best_of([&]
+	{
+		null_out_stream s;
+		serialize (tree.get(), &s);
+		binary_size = s.size;
+	});
+
+	size_t xml_size = 0;
+	double xml = best_of([&]
+	{
+		null_out_stream s;
+		{
+			xml_writer writer (&s);
+			serialize (writer, tree.get(), true);
+		}
+		xml_size = s.size;
+	});
+
+	std::printf ("%zu objects, %zu values\n", objects, values);
+	std::printf ("walk only: %7.1f ms, %6.1f ns per object\n", walk, walk * 1e6 / objects);
+	std::printf ("binary:    %7.1f ms, %6.1f ns per object, %.1f MB\n", binary, binary * 1e6 / objects, binary_size / 1e6);
+	std::printf ("XML:       %7.1f ms, %6.1f ns per object, %.1f MB\n", xml, xml * 1e6 / objects, xml_size / 1e6);
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Range operations on a soa_object_collection_i of N points (default 1M): insert_range, remove_range
+// and remove of K scattered children (default 100k), and a column scan against a scan through the objects.
+
+#include "soa_points.h"
+#include <random>
+
+using namespace test;
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t k = size_arg(argc, argv, 2, 100'000);
+
+	point_list list;
+	std::vector<std::unique_ptr<point>> initial;
+	for (size_t i = 0; i < n; i++)
+	{
+		auto p = std::make_unique<point>();
+		p->set_x(i * 0.5f);
+		p->set_id((int32_t)i);
+		initial.push_back(std::move(p));
+	}
+
+	double t = now_ms();
+	list.insert_range(0, std::move(initial));
+	double fill = now_ms() - t;
+
+	std::vector<std::unique_ptr<point>> range;
+	for (size_t i = 0; i < k; i++)
+		range.push_back(std::make_unique<point>());
+	t = now_ms();
+	list.insert_range(n / 2, std::move(range));
+	double insert = now_ms() - t;
+
+	t = now_ms();
+	auto removed = list.remove_range(n / 2, k);
+	double remove = now_ms() - t;
+
+	std::mt19937 rng (1);
+	std::vector<point*> scattered;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (rng() % n < k)
+			scattered.push_back(list.child_at(i));
+	}
+	t = now_ms();
+	auto batch = list.remove(scattered);
+	double batch_remove = now_ms() - t;
+	CHECK(list.table().size() == list.child_count());
+
+	t = now_ms();
+	double column_sum = 0;
+	for (float x : list.table().column<0>())
+		column_sum += x;
+	double column_scan = now_ms() - t;
+
+	t = now_ms();
+	double object_sum = 0;
+	for (auto& p : list.children())
+		object_sum += p->x();
+	double object_scan = now_ms() - t;
+	CHECK(column_sum == object_sum);
+
+	std::printf ("%zu points: insert_range of all %.1f ms\n", n, fill);
+	std::printf ("%zu children in the middle: insert_range %.1f ms, remove_range %.1f ms; remove of %zu scattered children %.1f ms\n",
+		k, insert, remove, batch.size(), batch_remove);
+	std::printf ("sum of a column: %.2f ms from the table, %.2f ms through the objects\n", column_scan, object_scan);
+	return 0;
+}
@@ -0,0 +1,109 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// spatial_index with N objects (default 1M) spread over a square drawing: time to build it, and time per query
+// for viewports of several sizes (zoom levels) and for hit-testing, against looking at the bounds of every object.
+
+#include "test_support.h"
+#include "spatial_index.h"
+#include <cmath>
+#include <random>
+
+using namespace test;
+
+static bool bounds_of (const object* obj, spatial_rect& bounds)
+{
+	if (obj->type() != &child::_type)
+		return false;
+
+	auto c = static_cast<const child*>(obj);
+	bounds = { (float)c->_x, c->_y, (float)c->_x + (float)(c->_id % 50), c->_y + (float)(c->_id % 30) };
+	return true;
+}
+
+static size_t brute_force (const root* r, const spatial_rect& rect)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < r->child_count(); i++)
+	{
+		spatial_rect bounds;
+		count += (bounds_of(r->child_at(i), bounds) && rect.intersects(bounds));
+	}
+	return count;
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+
+	// About one object per 100x100 square.
+	float side = std::sqrt ((float)n) * 100;
+	std::mt19937 rng (1);
+	auto r = std::make_unique<root>();
+	for (size_t i = 0; i < n; i++)
+	{
+		auto c = std::make_unique<child>();
+		c->_x = (int32_t)(rng() % (uint32_t)side);
+		c->_y = (float)(rng() % (uint32_t)side);
+		c->_id = rng();
+		r->append(std::move(c));
+	}
+
+	double t = now_ms();
+	spatial_index index (r.get(), &bounds_of);
+	double build = now_ms() - t;
+	std::printf ("%zu objects, drawing %.0f units wide; index built in %.1f ms\n", n, side, build);
+
+	auto random_rect = [&](float size) -> spatial_rect
+	{
+		float left = (float)(rng() % (uint32_t)std::max(1.0f, side - size));
+		float top = (float)(rng() % (uint32_t)std::max(1.0f, side - size));
+		return { left, top, left + size, top + size };
+	};
+
+	std::vector<object*> result;
+	for (float fraction : { 0.001f, 0.01f, 0.1f, 0.5f, 1.0f })
+	{
+		float size = side * fraction;
+		int queries = (fraction < 0.1f) ? 1000 : 10;
+		size_t found = 0;
+		t = now_ms();
+		for (int q = 0; q < queries; q++)
+		{
+			result.clear();
+			index.query_rect (random_rect(size), result);
+			found += result.size();
+		}
+		double indexed = (now_ms() - t) / queries;
+
+		t = now_ms();
+		for (int q = 0; q < 3; q++)
+			brute_force (r.get(), random_rect(size));
+		double scanned = (now_ms() - t) / 3;
+
+		std::printf ("viewport %5.1f%% wide: %9zu objects, %9.3f ms (index), %7.2f ms (all objects), %7.1fx\n",
+			fraction * 100, found / queries, indexed, scanned, scanned / indexed);
+	}
+
+	int hits = 10000;
+	t = now_ms();
+	for (int q = 0; q < hits; q++)
+	{
+		result.clear();
+		index.query_point ({ (float)(rng() % (uint32_t)side), (float)(rng() % (uint32_t)side) }, 3, result);
+	}
+	double point = (now_ms() - t) / hits;
+
+	t = now_ms();
+	for (int q = 0; q < hits; q++)
+		index.nearest ({ (float)(rng() % (uint32_t)side), (float)(rng() % (uint32_t)side) });
+	double nearest = (now_ms() - t) / hits;
+
+	t = now_ms();
+	brute_force (r.get(), { 0, 0, 3, 3 });
+	double point_scan = now_ms() - t;
+
+	std::printf ("hit-test: %.2f us (index), nearest: %.2f us, %.2f ms (all objects)\n", point * 1000, nearest * 1000, point_scan);
+	return 0;
+}
@@ -0,0 +1,103 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Serialization through a static_serializer against the value_property virtuals, for N objects (default 200K)
+// with 40 int32 and float properties, a third of them changed from default (see tests/static_item.h).
+
+#include "static_item.h"
+#include "wide_item.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+
+using namespace test;
+
+struct times
+{
+	double binary_write;
+	double binary_read;
+	double xml_write;
+	double xml_read;
+};
+
+// The best of a few runs, so that page faults of the first one don't count.
+template<typename f_t>
+static double best_of (f_t f)
+{
+	double best = 1e300;
+	for (int i = 0; i < 3; i++)
+	{
+		double t = now_ms();
+		f();
+		best = std::min (best, now_ms() - t);
+	}
+	return best;
+}
+
+template<typename item_t>
+static times measure (size_t n, std::vector<uint8_t>& binary, std::string& xml)
+{
+	item_list<item_t> list;
+	for (size_t i = 0; i < n; i++)
+	{
+		auto item = std::make_unique<item_t>();
+		for (size_t p = 0; p < 40; p++)
+		{
+			if ((i + p) % 3 == 0)
+				static_cast<const value_property*>(item_t::_props[p])->set_from_string (std::to_string((int)(i + p) % 1000 - 500), item.get());
+		}
+		list.append(std::move(item));
+	}
+
+	const concrete_type* const types[] = { &item_t::_type, &item_list<item_t>::_type };
+	times t;
+
+	t.binary_write = best_of([&] { binary = to_binary(&list); });
+
+	t.binary_read = best_of([&]
+	{
+		binary_reader reader = { binary.data(), binary.data() + binary.size() };
+		auto loaded = deserialize (reader, types);
+		CHECK(static_cast<item_list<item_t>*>(loaded.get())->child_count() == n);
+	});
+
+	t.xml_write = best_of([&]
+	{
+		vector_out_stream s;
+		{
+			xml_writer writer (&s);
+			serialize (writer, &list, true);
+		}
+		xml.assign (s.buffer.begin(), s.buffer.end());
+	});
+
+	t.xml_read = best_of([&]
+	{
+		xml_reader reader (xml);
+		reader.read();
+		auto loaded = deserialize (reader, types);
+		CHECK(static_cast<item_list<item_t>*>(loaded.get())->child_count() == n);
+	});
+
+	return t;
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 200'000);
+
+	std::vector<uint8_t> virtual_binary, generated_binary;
+	std::string virtual_xml, generated_xml;
+	auto v = measure<static_item<false>>(n, virtual_binary, virtual_xml);
+	auto g = measure<static_item<true>>(n, generated_binary, generated_xml);
+	CHECK((virtual_binary == generated_binary) && (virtual_xml == generated_xml));
+
+	auto ns = [n](double ms) { return ms * 1e6 / n; };
+	std::printf ("%zu objects with 40 properties, ns per object:\n", n);
+	std::printf ("              virtual  generated\n");
+	std::printf ("binary write  %7.0f  %9.0f  (%.2fx)\n", ns(v.binary_write), ns(g.binary_write), v.binary_write / g.binary_write);
+	std::printf ("binary read   %7.0f  %9.0f  (%.2fx)\n", ns(v.binary_read), ns(g.binary_read), v.binary_read / g.binary_read);
+	std::printf ("XML write     %7.0f  %9.0f  (%.2fx)\n", ns(v.xml_write), ns(g.xml_write), v.xml_write / g.xml_write);
+	std::printf ("XML read      %7.0f  %9.0f  (%.2fx)\n", ns(v.xml_read), ns(g.xml_read), v.xml_read / g.xml_read);
+	return 0;
+}
@@ -0,0 +1,72 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Scaling of parallel_map_reduce with the number of workers, from 1 to M (default: the number of cores),
+// over a tree of N objects (default 10M), against a serial walk with tree_iterator. The work per object is
+// a little arithmetic on its values, about what computing its bounds would cost.
+
+#include "test_support.h"
+#include "tree_traversal.h"
+#include <cmath>
+
+using namespace test;
+
+template<typename f_t>
+static double best_of (f_t f)
+{
+	double best = 1e300;
+	for (int i = 0; i < 3; i++)
+	{
+		double t = now_ms();
+		f();
+		best = std::min (best, now_ms() - t);
+	}
+	return best;
+}
+
+static double work (const object* obj)
+{
+	if (obj->type() != &child::_type)
+		return 0;
+	auto c = static_cast<const child*>(obj);
+	return std::sqrt ((double)c->_x * c->_x + (double)c->_y * c->_y);
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 10'000'000);
+	size_t max_workers = size_arg(argc, argv, 2, std::max(std::thread::hardware_concurrency(), 1u));
+
+	auto tree = make_tree(n);
+	std::printf ("%zu objects, hardware threads: %u\n", n, std::thread::hardware_concurrency());
+
+	double serial_sum = 0;
+	double serial = best_of([&]
+	{
+		serial_sum = 0;
+		for (const object* obj : preorder(tree.get()))
+			serial_sum += work(obj);
+	});
+	std::printf ("serial walk   %8.1f ms\n", serial);
+
+	// Powers of two, and the maximum.
+	std::vector<size_t> worker_counts;
+	for (size_t workers = 1; workers < max_workers; workers *= 2)
+		worker_counts.push_back(workers);
+	worker_counts.push_back(max_workers);
+
+	for (size_t workers : worker_counts)
+	{
+		work_stealing_pool pool (workers - 1);
+		double sum = 0;
+		double parallel = best_of([&]
+		{
+			sum = parallel_map_reduce (pool, tree.get(), 0.0, &work, std::plus<double>());
+		});
+		CHECK(std::abs(sum - serial_sum) <= 1e-9 * serial_sum);
+		std::printf ("%2zu workers    %8.1f ms (%.2fx the serial walk)\n", workers, parallel, serial / parallel);
+	}
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Cost of recording a value set in undo_history, and time to undo and redo a transaction of many edits,
+// in a collection of N children (default 1M) that is indexed (indexed_object_collection_i) or plain.
+
+#include "test_support.h"
+#include "undo_history.h"
+#include <random>
+
+using namespace test;
+
+struct indexed_root : object, indexed_object_collection_i<child>
+{
+	using base = object;
+
+	std::vector<std::unique_ptr<child>> _children;
+
+	virtual std::vector<std::unique_ptr<child>>& children_store() override { return _children; }
+	virtual const typed_object_collection_property<child>* collection_property() const override { return &children_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<child>* get_children (object* obj) { return static_cast<indexed_root*>(obj); }
+
+	static const typed_object_collection_property<child> children_p;
+	static const property* const _props[];
+	static const xtype<> _type;
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+const typed_object_collection_property<child> indexed_root::children_p { "Children", nullptr, nullptr, false, &indexed_root::get_children };
+const property* const indexed_root::_props[] = { &children_p };
+const xtype<> indexed_root::_type = { "IndexedRoot", nullptr, indexed_root::_props, []() { return std::unique_ptr<object>(new indexed_root()); } };
+
+template<typename root_t>
+static void run (const char* name, size_t n, size_t edits)
+{
+	root_t r;
+	r._children.reserve(n);
+	for (size_t i = 0; i < n; i++)
+		r.append(std::make_unique<child>());
+
+	std::mt19937 rng (1);
+	std::vector<child*> targets (edits);
+	for (auto& t : targets)
+		t = r.child_at(rng() % n);
+
+	int32_t value = 1;
+	double t0 = now_ms();
+	for (auto c : targets)
+		c->set_x(value++);
+	double unrecorded = now_ms() - t0;
+
+	undo_history h (&r, known_types, (size_t)-1);
+
+	t0 = now_ms();
+	for (auto c : targets)
+		c->set_x(value++);
+	double single = now_ms() - t0;
+	h.clear();
+
+	t0 = now_ms();
+	{
+		undo_history::transaction t (&h, "edits");
+		for (auto c : targets)
+			c->set_x(value++);
+		t.commit();
+	}
+	double in_transaction = now_ms() - t0;
+
+	t0 = now_ms();
+	h.undo();
+	double undo = now_ms() - t0;
+
+	t0 = now_ms();
+	h.redo();
+	double redo = now_ms() - t0;
+
+	std::printf ("%s: set %.0f ns unrecorded, %.0f ns recorded as its own transaction, %.0f ns in a transaction; "
+		"undo of %zu edits %.1f ms, redo %.1f ms, %.1f MB of history\n",
+		name, unrecorded * 1e6 / edits, single * 1e6 / edits, in_transaction * 1e6 / edits, edits, undo, redo, h.memory_usage() / 1e6);
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t edits = size_arg(argc, argv, 2, 100'000);
+	std::printf ("%zu children, %zu edits of random children\n", n, edits);
+	run<indexed_root>("indexed collection", n, edits);
+
+	// Paths in a plain collection are found by scanning it, so fewer edits here.
+	run<root>("plain collection  ", n, std::max<size_t>(edits / 100, 1));
+	return 0;
+}
@@ -0,0 +1,103 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Parse times of xml_reader against libxml2, for the document xml_writer writes for a tree of N objects (default 1M):
+// pulling every node and attribute with xml_reader, loading the whole document into a libxml2 DOM (what a DOM-based
+// deserializer does before it starts on the objects), and pulling it with libxml2's own pull parser, xmlTextReader.
+// Loading into objects, with both, is measured by binary_vs_xml_benchmark.
+
+#include "test_support.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+#ifdef EDGE_HAVE_LIBXML2
+	#include <libxml/parser.h>
+	#include <libxml/xmlreader.h>
+#endif
+
+using namespace test;
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	auto tree = make_tree(n);
+
+	vector_out_stream xml;
+	{
+		xml_writer writer (&xml);
+		writer.write_declaration();
+		serialize (writer, tree.get(), true);
+	}
+	std::string_view text (reinterpret_cast<const char*>(xml.buffer.data()), xml.buffer.size());
+	double mb = text.size() / 1e6;
+	std::printf ("%zu objects, %.1f MB of XML\n", n, mb);
+
+	// The best of a few runs, so that page faults of the first one don't count.
+	auto best_of = [](auto f)
+	{
+		double best = 1e300;
+		for (int i = 0; i < 3; i++)
+		{
+			double t = now_ms();
+			f();
+			best = std::min (best, now_ms() - t);
+		}
+		return best;
+	};
+
+	size_t elements = 0;
+	size_t attributes = 0;
+	double pull = best_of([&]
+	{
+		elements = 0;
+		attributes = 0;
+		xml_reader reader (text);
+		while (reader.read() != xml_reader::node_type::end_of_document)
+		{
+			if (reader.current_node_type() == xml_reader::node_type::start_element)
+			{
+				elements++;
+				attributes += reader.attributes().size();
+			}
+		}
+	});
+	CHECK(elements > n);
+	std::printf ("xml_reader:               %7.1f ms (%4.0f MB/s), %zu elements, %zu attributes\n", pull, mb * 1000 / pull, elements, attributes);
+
+	#ifdef EDGE_HAVE_LIBXML2
+	double dom = best_of([&]
+	{
+		xmlDoc* doc = xmlReadMemory (text.data(), (int)text.size(), nullptr, nullptr, XML_PARSE_HUGE);
+		CHECK(doc != nullptr);
+		xmlFreeDoc(doc);
+	});
+	std::printf ("libxml2 DOM load:         %7.1f ms (%4.0f MB/s, xml_reader %.1fx faster)\n", dom, mb * 1000 / dom, dom / pull);
+
+	size_t text_reader_elements = 0;
+	size_t text_reader_attributes = 0;
+	double text_reader = best_of([&]
+	{
+		text_reader_elements = 0;
+		text_reader_attributes = 0;
+		xmlTextReader* r = xmlReaderForMemory (text.data(), (int)text.size(), nullptr, nullptr, XML_PARSE_HUGE);
+		CHECK(r != nullptr);
+		while (xmlTextReaderRead(r) == 1)
+		{
+			if (xmlTextReaderNodeType(r) == XML_READER_TYPE_ELEMENT)
+			{
+				text_reader_elements++;
+				while (xmlTextReaderMoveToNextAttribute(r) == 1)
+				{
+					xmlTextReaderConstValue(r);
+					text_reader_attributes++;
+				}
+			}
+		}
+		xmlFreeTextReader(r);
+	});
+	CHECK((text_reader_elements == elements) && (text_reader_attributes == attributes));
+	std::printf ("libxml2 xmlTextReader:    %7.1f ms (%4.0f MB/s, xml_reader %.1fx faster)\n", text_reader, mb * 1000 / text_reader, text_reader / pull);
+	#endif
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Throughput of each xml_scanner implementation (scalar, SSE2, AVX2), alone and inside xml_reader.
+// The searches run over 64 MiB of text made of tokens of a given length (default 32 bytes, about the length
+// of a value in our documents) separated by the character they stop at. The load is that of the document
+// xml_writer writes for a tree of N objects (default 1M), read into objects by deserialize.
+
+#include "test_support.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+
+using namespace test;
+
+static constexpr const char* level_names[] = { "scalar", "SSE2", "AVX2" };
+
+// The best of a few runs, so that page faults of the first one don't count.
+template<typename f_t>
+static double best_of (f_t f)
+{
+	double best = 1e300;
+	for (int i = 0; i < 3; i++)
+	{
+		double t = now_ms();
+		f();
+		best = std::min (best, now_ms() - t);
+	}
+	return best;
+}
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	size_t token_length = size_arg(argc, argv, 2, 32);
+	size_t text_size = (n >= 1'000'000) ? 64 * 1024 * 1024 : 1024 * 1024;
+
+	std::string text (text_size, 'a');
+	for (size_t i = token_length; i < text_size; i += token_length + 1)
+		text[i] = '"';
+	std::string names = text;
+	for (auto& c : names)
+		c = (c == '"') ? ' ' : c;
+
+	std::printf ("%zu MiB of tokens of %zu bytes, GB/s:\n", text_size >> 20, token_length);
+	std::printf ("          find_name_end  find_value_end  structural_mask\n");
+	for (auto level : { simd_level::scalar, simd_level::sse2, simd_level::avx2 })
+	{
+		auto scanner = get_xml_scanner(level);
+		if (scanner == nullptr)
+			continue;
+
+		const char* end = text.data() + text.size();
+		size_t found = 0;
+		double name_ms = best_of([&]
+		{
+			for (const char* p = names.data(), *e = names.data() + names.size(); p != e; p++)
+			{
+				p = scanner->find_name_end(p, e);
+				found++;
+				if (p == e)
+					break;
+			}
+		});
+
+		double value_ms = best_of([&]
+		{
+			bool needs_unescaping;
+			for (const char* p = text.data(); (p = scanner->find_value_end(p, end, '"', needs_unescaping)) != nullptr; p++)
+				found++;
+		});
+
+		uint32_t combined = 0;
+		double mask_ms = best_of([&]
+		{
+			for (const char* p = text.data(); end - p >= 32; p += 32)
+				combined ^= scanner->structural_mask(p);
+		});
+
+		CHECK((found > 0) && (combined != 0xFFFFFFFF));
+		std::printf ("%-8s  %13.2f  %14.2f  %15.2f\n", level_names[(int)level],
+			text_size / name_ms / 1e6, text_size / value_ms / 1e6, text_size / mask_ms / 1e6);
+	}
+
+	auto tree = make_tree(n);
+	vector_out_stream xml;
+	{
+		xml_writer writer (&xml);
+		writer.write_declaration();
+		serialize (writer, tree.get(), true);
+	}
+	std::string_view document (reinterpret_cast<const char*>(xml.buffer.data()), xml.buffer.size());
+
+	std::printf ("\nloading %zu objects from %.1f MB of XML:\n", n, document.size() / 1e6);
+	for (auto level : { simd_level::scalar, simd_level::sse2, simd_level::avx2 })
+	{
+		auto scanner = get_xml_scanner(level);
+		if (scanner == nullptr)
+			continue;
+
+		std::unique_ptr<object> loaded;
+		double load_ms = best_of([&]
+		{
+			loaded = nullptr;
+			xml_reader reader (document, scanner);
+			reader.read();
+			loaded = deserialize (reader, known_types);
+		});
+		CHECK(same_tree(tree.get(), static_cast<root*>(loaded.get())));
+		std::printf ("%-8s  %7.1f ms (%4.0f MB/s)\n", level_names[(int)level], load_ms, document.size() / load_ms / 1e3);
+	}
+
+	return 0;
+}
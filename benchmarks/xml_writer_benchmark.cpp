@@ -0,0 +1,135 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Save throughput of xml_writer for a tree of N objects (default 1M): into a stream that discards its input
+// (the cost of formatting alone) and into memory, with and without indentation, and with
+// incremental_xml_text_serializer after changing a few objects. Where libxml2 is available, its streaming
+// writer (xmlTextWriter) writing the same elements and attributes is measured too.
+
+#include "test_support.h"
+#include "xml_writer.h"
+#ifdef EDGE_HAVE_LIBXML2
+	#include <libxml/xmlwriter.h>
+#endif
+
+using namespace test;
+
+struct null_out_stream : out_stream_i
+{
+	size_t size = 0;
+
+	using out_stream_i::write;
+
+	virtual void write (const void* data, size_t size) override { this->size += size; }
+};
+
+template<typename f_t>
+static double best_of (f_t f)
+{
+	double best = 1e300;
+	for (int i = 0; i < 3; i++)
+	{
+		double t = now_ms();
+		f();
+		best = std::min (best, now_ms() - t);
+	}
+	return best;
+}
+
+static void print (const char* name, double ms, size_t bytes, size_t n)
+{
+	std::printf ("%-34s %8.1f ms, %7.1f MB/s, %6.1f ns per object\n", name, ms, bytes / ms / 1e3, ms * 1e6 / n);
+}
+
+#ifdef EDGE_HAVE_LIBXML2
+static size_t libxml2_save (const root* r)
+{
+	auto buffer = xmlBufferCreate();
+	auto writer = xmlNewTextWriterMemory(buffer, 0);
+	xmlTextWriterSetIndent (writer, 1);
+	xmlTextWriterSetIndentString (writer, reinterpret_cast<const xmlChar*>("\t"));
+	xmlTextWriterStartDocument (writer, "1.0", "UTF-8", "yes");
+	xmlTextWriterStartElement (writer, reinterpret_cast<const xmlChar*>("Root"));
+	xmlTextWriterStartElement (writer, reinterpret_cast<const xmlChar*>("Children"));
+	std::string value;
+	for (size_t i = 0; i < r->child_count(); i++)
+	{
+		auto c = r->child_at(i);
+		xmlTextWriterStartElement (writer, reinterpret_cast<const xmlChar*>("Child"));
+		for (auto prop : c->type()->property_list())
+		{
+			auto vp = static_cast<const value_property*>(prop);
+			vp->get_to_string (c, value);
+			xmlTextWriterWriteAttribute (writer, reinterpret_cast<const xmlChar*>(prop->_name), reinterpret_cast<const xmlChar*>(value.c_str()));
+		}
+		xmlTextWriterEndElement (writer);
+	}
+	xmlTextWriterEndElement (writer);
+	xmlTextWriterEndElement (writer);
+	xmlTextWriterEndDocument (writer);
+	xmlFreeTextWriter (writer);
+	size_t size = xmlBufferLength(buffer);
+	xmlBufferFree (buffer);
+	return size;
+}
+#endif
+
+int main (int argc, char** argv)
+{
+	size_t n = size_arg(argc, argv, 1, 1'000'000);
+	auto tree = make_tree(n);
+
+	size_t size = 0;
+	double to_null = best_of([&]
+	{
+		null_out_stream s;
+		{
+			xml_writer writer (&s);
+			writer.write_declaration();
+			serialize (writer, tree.get(), true);
+		}
+		size = s.size;
+	});
+
+	std::printf ("%zu objects, %.1f MB of XML\n", n, size / 1e6);
+	print ("xml_writer, discarded:", to_null, size, n);
+
+	for (bool indent : { true, false })
+	{
+		size_t memory_size = 0;
+		double to_memory = best_of([&]
+		{
+			vector_out_stream s;
+			{
+				xml_writer writer (&s, indent);
+				writer.write_declaration();
+				serialize (writer, tree.get(), true);
+			}
+			memory_size = s.buffer.size();
+		});
+		print (indent ? "xml_writer, to memory:" : "xml_writer, to memory, no indent:", to_memory, memory_size, n);
+	}
+
+	{
+		incremental_xml_text_serializer s (tree.get());
+		null_out_stream first;
+		s.serialize(&first);
+		double incremental = best_of([&]
+		{
+			for (size_t i = 0; i < 10; i++)
+				tree->child_at(i * (n / 10))->set_x((int32_t)i);
+			vector_out_stream out;
+			s.serialize(&out);
+		});
+		print ("incremental, 10 objects changed:", incremental, first.size, n);
+	}
+
+	#ifdef EDGE_HAVE_LIBXML2
+	size_t libxml2_size = 0;
+	double libxml2 = best_of([&] { libxml2_size = libxml2_save(tree.get()); });
+	print ("libxml2 xmlTextWriter, to memory:", libxml2, libxml2_size, n);
+	#endif
+
+	return 0;
+}
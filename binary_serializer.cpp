@@ -0,0 +1,783 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "binary_serializer.h"
+#include "collections.h"
+#include <unordered_map>
+#include <deque>
+#include <algorithm>
+#include <cstring>
+
+namespace edge
+{
+	static constexpr uint8_t magic[4] = { 'E', 'D', 'G', 'B' };
+	static constexpr uint8_t paged_magic[4] = { 'E', 'D', 'G', 'P' };
+	static constexpr uint64_t format_version = 1;
+
+	struct binary_writer_hooks_i
+	{
+		// Returns true if the hook wrote the object itself, in which case the writer skips it.
+		virtual bool begin_object (const object* obj) = 0;
+		virtual void end_object (const object* obj) = 0;
+
+		// "adjacent_children" is true when nothing is written between the children, so that runs of them may be skipped.
+		virtual void begin_object_collection (const object* obj, const object_collection_i* collection, bool adjacent_children) = 0;
+		virtual size_t skip_collection_children (size_t index) = 0;
+		virtual void begin_collection_child (size_t index) = 0;
+		virtual void end_object_collection() = 0;
+	};
+
+	class binary_writer : object_writer_i
+	{
+		struct collection_entry
+		{
+			bool preallocated;
+			size_t offset_table; // position of the offset table in the body, or -1 if we're not writing one
+			size_t child_count;
+		};
+
+		out_stream_i* const _to;
+		bool const _inline_type_definitions;
+		binary_writer_hooks_i* const _hooks;
+		bool const _write_child_offsets;
+		std::unordered_map<const concrete_type*, size_t> _type_ids;
+		std::vector<const concrete_type*> _types_by_id;
+		std::vector<collection_entry> _collections;
+
+	public:
+		// When inline_type_definitions is false, types are only referenced by id within objects,
+		// and the caller must write their definitions with write_type_table before the objects.
+		// When write_child_offsets is true (see serialize_paged), "to" must be a vector_out_stream.
+		binary_writer (out_stream_i* to, bool inline_type_definitions, binary_writer_hooks_i* hooks = nullptr, bool write_child_offsets = false)
+			: _to(to), _inline_type_definitions(inline_type_definitions), _hooks(hooks), _write_child_offsets(write_child_offsets)
+		{ }
+
+		void write_type_table (out_stream_i* to)
+		{
+			to->write_varint(_types_by_id.size());
+			for (auto type : _types_by_id)
+				write_type_definition (to, type);
+		}
+
+		void write_object (const object* obj)
+		{
+			edge::write_object (*this, obj, true);
+		}
+
+	private:
+		virtual bool begin_object (const object* obj, const serialization_plan& plan, std::span<const size_t> values, size_t content_count, size_t index, bool force) override
+		{
+			if (_hooks && _hooks->begin_object(obj))
+				return false;
+
+			auto type = obj->type();
+			write_type_ref(type);
+
+			for (auto fp : type->factory_props())
+				fp->serialize(obj, _to);
+
+			// Factory values were written above, in the order the factory takes them.
+			if (plan.generated)
+				plan.generated->write_binary_values (obj, plan, _to);
+			else
+			{
+				_to->write_varint (std::count_if(values.begin(), values.end(), [&plan](size_t i) { return !plan.props[i].is_factory_prop; }));
+				for (size_t i : values)
+				{
+					auto& pi = plan.props[i];
+					if (pi.is_factory_prop)
+						continue;
+
+					_to->write_varint(i);
+					static_cast<const value_property*>(pi.prop)->serialize(obj, _to);
+				}
+			}
+
+			_to->write_varint(content_count);
+			return true;
+		}
+
+		virtual void end_object (const object* obj) override
+		{
+			if (_hooks)
+				_hooks->end_object(obj);
+		}
+
+		virtual void begin_object_collection (const object* obj, const serialization_plan& plan, size_t prop_index, const object_collection_i* collection) override
+		{
+			auto oc_prop = static_cast<const object_collection_property*>(plan.props[prop_index].prop);
+			size_t child_count = collection->child_count();
+			_to->write_varint(prop_index);
+			_to->write_varint(child_count);
+
+			// Offsets are relative to the start of the body, and the body is in memory, so we can leave room
+			// for the table and fill it in as we write the children.
+			size_t offset_table = -1;
+			if (_write_child_offsets && !oc_prop->preallocated && dynamic_cast<const lazy_collection_i*>(collection))
+			{
+				auto& body = static_cast<vector_out_stream*>(_to)->buffer;
+				offset_table = body.size();
+				body.resize (offset_table + (child_count + 1) * sizeof(uint64_t));
+			}
+
+			_collections.push_back({ oc_prop->preallocated, offset_table, child_count });
+
+			if (_hooks)
+				_hooks->begin_object_collection (obj, collection, !oc_prop->preallocated && (offset_table == (size_t)-1));
+		}
+
+		virtual size_t skip_collection_children (size_t index) override
+		{
+			auto& c = _collections.back();
+			if (!_hooks || c.preallocated || (c.offset_table != (size_t)-1))
+				return 0;
+
+			return _hooks->skip_collection_children(index);
+		}
+
+		virtual void begin_collection_child (size_t index) override
+		{
+			auto& c = _collections.back();
+			if (c.offset_table != (size_t)-1)
+				write_child_offset (c.offset_table, index);
+			else if (c.preallocated)
+				_to->write_varint(index);
+
+			if (_hooks)
+				_hooks->begin_collection_child(index);
+		}
+
+		virtual void end_object_collection() override
+		{
+			auto& c = _collections.back();
+			if (c.offset_table != (size_t)-1)
+				write_child_offset (c.offset_table, c.child_count);
+			_collections.pop_back();
+
+			if (_hooks)
+				_hooks->end_object_collection();
+		}
+
+		void write_child_offset (size_t offset_table, size_t index)
+		{
+			auto& body = static_cast<vector_out_stream*>(_to)->buffer;
+			uint64_t offset = body.size();
+			memcpy (&body[offset_table + index * sizeof(uint64_t)], &offset, sizeof(offset));
+		}
+
+		virtual void write_value_collection (const object* obj, const serialization_plan& plan, size_t prop_index) override
+		{
+			auto vc_prop = static_cast<const value_collection_property*>(plan.props[prop_index].prop);
+			_to->write_varint(prop_index);
+			size_t size = vc_prop->size(obj);
+			_to->write_varint(size);
+			for (size_t i = 0; i < size; i++)
+				vc_prop->get_value(obj, i, _to);
+		}
+
+		virtual void begin_object_property (const object* obj, const serialization_plan& plan, size_t prop_index) override
+		{
+			_to->write_varint(prop_index);
+		}
+
+		virtual bool uses_generated_serializers() const override { return true; }
+
+		static void write_string (out_stream_i* to, std::string_view str)
+		{
+			backed_string_property_traits::serialize(str, to);
+		}
+
+		static void write_type_definition (out_stream_i* to, const concrete_type* type)
+		{
+			auto& props = type->serialization_plan().props;
+			write_string(to, type->name());
+			to->write_varint(props.size());
+			for (auto& pi : props)
+				write_string(to, pi.prop->_name);
+		}
+
+		void write_type_ref (const concrete_type* type)
+		{
+			auto [it, inserted] = _type_ids.try_emplace(type, _types_by_id.size());
+			_to->write_varint(it->second);
+			if (!inserted)
+				return;
+
+			_types_by_id.push_back(type);
+			if (_inline_type_definitions)
+				write_type_definition(_to, type);
+		}
+	};
+
+	static void write_header (out_stream_i* to)
+	{
+		to->write(magic, sizeof(magic));
+		to->write_varint(format_version);
+	}
+
+	void serialize (const object* obj, out_stream_i* to)
+	{
+		write_header(to);
+		to->write_varint(0); // no predefined types; they are defined where first used
+		binary_writer(to, true).write_object(obj);
+	}
+
+	// ========================================================================
+
+	class binary_object_reader
+	{
+		using prop_info = serialization_plan::prop_info;
+
+		struct type_entry
+		{
+			const concrete_type* type;
+			std::vector<const prop_info*> props; // null for properties in the file that the type doesn't have
+		};
+
+		binary_reader& _from;
+		std::span<const concrete_type* const> const _known_types;
+		std::deque<type_entry> _types; // deque cause we hold references to entries while adding new ones
+		paged_binary_reader* _paged = nullptr;
+		const uint8_t* _paged_body = nullptr;
+
+	public:
+		binary_object_reader (binary_reader& from, std::span<const concrete_type* const> known_types)
+			: _from(from), _known_types(known_types)
+		{ }
+
+		std::unique_ptr<object> read_new_object()
+		{
+			const type_entry& te = read_type_ref();
+			auto obj = te.type->create(_from);
+			read_object_body(te, obj.get());
+			return obj;
+		}
+
+		void read_to_existing_object (object* obj)
+		{
+			const type_entry& te = read_type_ref();
+			if (te.type != obj->type())
+				throw binary_read_exception("Type mismatch for existing object.");
+
+			// Factory values were used when the object was created; nothing to do with them here.
+			for (auto fp : te.type->factory_props())
+				fp->deserialize(_from, nullptr);
+
+			read_object_body(te, obj);
+		}
+
+		void read_type_table()
+		{
+			uint64_t count = _from.read_varint();
+			for (uint64_t i = 0; i < count; i++)
+				read_type_definition();
+		}
+
+		// Makes this reader pass offset tables to lazy collections instead of reading their children.
+		void set_paged (paged_binary_reader* paged, const uint8_t* body)
+		{
+			_paged = paged;
+			_paged_body = body;
+		}
+
+	private:
+		std::string_view read_string()
+		{
+			std::string_view str;
+			backed_string_property_traits::deserialize(_from, str);
+			return str;
+		}
+
+		const type_entry& read_type_ref()
+		{
+			uint64_t id = _from.read_varint();
+			if (id < _types.size())
+				return _types[id];
+
+			if (id != _types.size())
+				throw binary_read_exception("Invalid type reference.");
+
+			return read_type_definition();
+		}
+
+		const type_entry& read_type_definition()
+		{
+			auto name = read_string();
+			auto it = std::find_if (_known_types.begin(), _known_types.end(), [name](const concrete_type* t) { return name == t->name(); });
+			if (it == _known_types.end())
+				throw binary_read_exception("Unknown type.");
+
+			type_entry te;
+			te.type = *it;
+			uint64_t prop_count = _from.read_varint();
+			if (prop_count > _from.remaining())
+				throw binary_read_exception("Unexpected end of binary data.");
+			auto& plan = te.type->serialization_plan();
+			for (uint64_t i = 0; i < prop_count; i++)
+			{
+				size_t index = plan.find(read_string());
+				te.props.push_back((index != (size_t)-1) ? &plan.props[index] : nullptr);
+			}
+
+			_types.push_back(std::move(te));
+			return _types.back();
+		}
+
+		const prop_info& read_prop_ref (const type_entry& te)
+		{
+			uint64_t index = _from.read_varint();
+			if (index >= te.props.size())
+				throw binary_read_exception("Invalid property reference.");
+			auto pi = te.props[index];
+			if (pi == nullptr)
+				throw binary_read_exception("Unknown property.");
+			return *pi;
+		}
+
+		void read_object_body (const type_entry& te, object* obj)
+		{
+			auto deserializable = dynamic_cast<deserialize_i*>(obj);
+			if (deserializable != nullptr)
+				deserializable->on_deserializing();
+
+			auto& plan = te.type->serialization_plan();
+			auto bits = plan.generated ? obj->changed_from_default_bits() : nullptr;
+			uint64_t value_count = _from.read_varint();
+			for (uint64_t i = 0; i < value_count; i++)
+			{
+				auto& pi = read_prop_ref(te);
+				if (pi.kind != serialized_prop_kind::value)
+					throw binary_read_exception("Property kind mismatch.");
+
+				auto read_generated = plan.generated ? plan.generated->read_binary_value[&pi - plan.props.data()] : nullptr;
+				if (read_generated)
+					read_generated (_from, obj, bits);
+				else
+					static_cast<const value_property*>(pi.prop)->deserialize(_from, obj);
+			}
+
+			uint64_t child_prop_count = _from.read_varint();
+			for (uint64_t i = 0; i < child_prop_count; i++)
+			{
+				auto& pi = read_prop_ref(te);
+				if (pi.kind == serialized_prop_kind::object_collection)
+				{
+					auto oc_prop = static_cast<const object_collection_property*>(pi.prop);
+					auto collection = oc_prop->collection_cast(obj);
+					uint64_t count = _from.read_varint();
+					auto lazy = (_paged && !oc_prop->preallocated) ? dynamic_cast<lazy_collection_i*>(collection) : nullptr;
+					if (lazy)
+					{
+						if (count >= _from.remaining() / sizeof(uint64_t))
+							throw binary_read_exception("Unexpected end of binary data.");
+						auto offsets = _from.read_bytes((size_t)(count + 1) * sizeof(uint64_t));
+						uint64_t end;
+						memcpy (&end, offsets + count * sizeof(uint64_t), sizeof(end));
+						if ((end < (uint64_t)(_from.ptr - _paged_body)) || (end > (uint64_t)(_from.end - _paged_body)))
+							throw binary_read_exception("Invalid child offset.");
+						lazy->set_lazy_source (_paged, offsets, (size_t)count);
+						_from.ptr = _paged_body + end;
+						continue;
+					}
+
+					for (uint64_t ci = 0; ci < count; ci++)
+					{
+						if (!oc_prop->preallocated)
+						{
+							// Same order as the XML deserializer: create, append, then read the rest of the child.
+							const type_entry& child_te = read_type_ref();
+							auto child = child_te.type->create(_from);
+							auto child_raw = child.get();
+							collection->append(std::move(child));
+							read_object_body(child_te, child_raw);
+						}
+						else
+						{
+							uint64_t index = _from.read_varint();
+							if (index >= collection->child_count())
+								throw binary_read_exception("Collection index out of range.");
+							read_to_existing_object(collection->child_at((size_t)index));
+						}
+					}
+				}
+				else if (pi.kind == serialized_prop_kind::value_collection)
+				{
+					auto vc_prop = static_cast<const value_collection_property*>(pi.prop);
+					uint64_t size = _from.read_varint();
+					for (uint64_t vi = 0; vi < size; vi++)
+					{
+						if (vc_prop->can_insert_remove())
+							vc_prop->insert_value(_from, obj, (size_t)vi);
+						else
+							vc_prop->set_value(_from, obj, (size_t)vi);
+					}
+				}
+				else if (pi.kind == serialized_prop_kind::object)
+				{
+					auto value = static_cast<const object_property*>(pi.prop)->get(obj);
+					if (value == nullptr)
+						throw binary_read_exception("Object property is null."); // creating the object here is not implemented
+					read_to_existing_object(value);
+				}
+				else
+					throw binary_read_exception("Property kind mismatch.");
+			}
+
+			if (deserializable != nullptr)
+				deserializable->on_deserialized();
+		}
+	};
+
+	static void read_header (binary_reader& from, const uint8_t (&expected_magic)[4] = magic)
+	{
+		if (memcmp(from.read_bytes(sizeof(expected_magic)), expected_magic, sizeof(expected_magic)) != 0)
+			throw binary_read_exception("Not an edge binary document.");
+
+		if (from.read_varint() != format_version)
+			throw binary_read_exception("Unsupported binary format version.");
+	}
+
+	void deserialize_to (binary_reader& from, object* obj, std::span<const concrete_type* const> known_types)
+	{
+		read_header(from);
+		binary_object_reader reader (from, known_types);
+		reader.read_type_table();
+		reader.read_to_existing_object(obj);
+	}
+
+	std::unique_ptr<object> deserialize (binary_reader& from, std::span<const concrete_type* const> known_types)
+	{
+		read_header(from);
+		binary_object_reader reader (from, known_types);
+		reader.read_type_table();
+		return reader.read_new_object();
+	}
+
+	// ========================================================================
+
+	void serialize_paged (const object* obj, out_stream_i* to)
+	{
+		vector_out_stream body;
+		binary_writer writer (&body, false, nullptr, true);
+		writer.write_object(obj);
+
+		to->write(paged_magic, sizeof(paged_magic));
+		to->write_varint(format_version);
+		writer.write_type_table(to);
+		to->write (body.buffer.data(), body.buffer.size());
+	}
+
+	struct paged_binary_reader::impl
+	{
+		binary_reader from;
+		binary_object_reader reader;
+		const uint8_t* body;
+
+		impl (std::span<const uint8_t> data, std::span<const concrete_type* const> known_types)
+			: from({ data.data(), data.data() + data.size() })
+			, reader(from, known_types)
+		{ }
+	};
+
+	paged_binary_reader::paged_binary_reader (std::span<const uint8_t> data, std::span<const concrete_type* const> known_types)
+		: _impl(std::make_unique<impl>(data, known_types))
+	{
+		read_header (_impl->from, paged_magic);
+		_impl->reader.read_type_table();
+		_impl->body = _impl->from.ptr;
+		_impl->reader.set_paged (this, _impl->body);
+	}
+
+	paged_binary_reader::~paged_binary_reader() = default;
+
+	std::unique_ptr<object> paged_binary_reader::read_root()
+	{
+		return read_object_at(0);
+	}
+
+	std::unique_ptr<object> paged_binary_reader::read_object_at (uint64_t offset)
+	{
+		if (offset >= (uint64_t)(_impl->from.end - _impl->body))
+			throw binary_read_exception("Invalid child offset.");
+		_impl->from.ptr = _impl->body + offset;
+		return _impl->reader.read_new_object();
+	}
+
+	// ========================================================================
+
+	struct incremental_binary_serializer::collection_frame
+	{
+		const object_collection_i* collection;
+		size_t depth;                 // size of _stack at begin_object_collection; the children are begun at this depth
+		bool adjacent;                // if false, the children are handled like object properties, with cached_range
+		size_t new_start;             // of the first child, in the new body
+		cached_collection* cached;    // null if the collection wasn't written by the previous save
+		size_t previous_start;        // of the first child, in the previous save, or -1
+		size_t index;                 // of the child being written
+
+		// The collection kept its children since the previous save, so "cached->ends" is updated in place
+		// and only the changed children are looked at.
+		bool in_place;
+		std::vector<size_t> dirty;    // in place: indexes of the changed children, ascending
+		size_t next_dirty;            // in place: position in "dirty"
+		size_t previous_cursor;       // in place: end of the previous child in the previous save, relative to previous_start
+
+		std::vector<size_t> new_ends; // not in place: the "ends" for the next save
+	};
+
+	struct incremental_binary_serializer::hooks : binary_writer_hooks_i
+	{
+		incremental_binary_serializer* const _s;
+
+		hooks (incremental_binary_serializer* s)
+			: _s(s)
+		{ }
+
+		collection_frame* parent_collection()
+		{
+			auto& cstack = _s->_collection_stack;
+			if (cstack.empty() || (cstack.back().depth != _s->_stack.size()) || !cstack.back().adjacent)
+				return nullptr;
+			return &cstack.back();
+		}
+
+		void copy_previous (size_t previous_start, size_t previous_end)
+		{
+			auto begin = _s->_previous.begin();
+			_s->_body.buffer.insert (_s->_body.buffer.end(), begin + previous_start, begin + previous_end);
+		}
+
+		virtual bool begin_object (const object* obj) override
+		{
+			auto& body = _s->_body.buffer;
+			auto& stack = _s->_stack;
+
+			if (auto cf = parent_collection())
+			{
+				size_t previous_start = (size_t)-1;
+				size_t previous_end;
+				if (cf->in_place)
+				{
+					previous_start = cf->previous_start + cf->previous_cursor;
+					previous_end = cf->previous_start + cf->cached->ends[cf->index];
+				}
+				else if (cf->previous_start != (size_t)-1)
+				{
+					auto it = _s->_child_indexes.find(obj);
+					if ((it != _s->_child_indexes.end()) && (it->second < cf->cached->ends.size()))
+					{
+						size_t oi = it->second;
+						previous_start = cf->previous_start + (oi ? cf->cached->ends[oi - 1] : 0);
+						previous_end = cf->previous_start + cf->cached->ends[oi];
+					}
+				}
+
+				if ((previous_start != (size_t)-1) && !_s->is_dirty(obj))
+				{
+					copy_previous (previous_start, previous_end);
+					end_child (*cf, obj);
+					return true;
+				}
+
+				stack.push_back({ body.size(), previous_start });
+				return false;
+			}
+
+			size_t parent_new_start = stack.empty() ? 0 : stack.back().new_start;
+			size_t parent_previous_start = stack.empty() ? 0 : stack.back().previous_start;
+
+			size_t previous_start = (size_t)-1;
+			auto it = _s->_ranges.find(obj);
+			if ((it != _s->_ranges.end()) && (parent_previous_start != (size_t)-1))
+			{
+				previous_start = parent_previous_start + it->second.offset;
+
+				if (!_s->is_dirty(obj))
+				{
+					auto& range = it->second;
+					range.offset = body.size() - parent_new_start;
+					copy_previous (previous_start, previous_start + range.size);
+					return true;
+				}
+			}
+
+			stack.push_back({ body.size(), previous_start });
+			return false;
+		}
+
+		virtual void end_object (const object* obj) override
+		{
+			auto& stack = _s->_stack;
+			size_t new_start = stack.back().new_start;
+			stack.pop_back();
+
+			if (auto cf = parent_collection())
+			{
+				end_child (*cf, obj);
+				return;
+			}
+
+			size_t parent_new_start = stack.empty() ? 0 : stack.back().new_start;
+			_s->_ranges[obj] = { new_start - parent_new_start, _s->_body.buffer.size() - new_start };
+		}
+
+		void end_child (collection_frame& cf, const object* obj)
+		{
+			size_t end = _s->_body.buffer.size() - cf.new_start;
+			if (cf.in_place)
+			{
+				cf.previous_cursor = cf.cached->ends[cf.index];
+				cf.cached->ends[cf.index] = end;
+			}
+			else
+			{
+				cf.new_ends.push_back(end);
+				_s->_child_indexes[obj] = cf.index;
+			}
+		}
+
+		virtual void begin_object_collection (const object* obj, const object_collection_i* collection, bool adjacent_children) override
+		{
+			auto& owner = _s->_stack.back();
+			auto& cf = _s->_collection_stack.emplace_back();
+			cf.collection = collection;
+			cf.depth = _s->_stack.size();
+			cf.adjacent = adjacent_children;
+			cf.new_start = _s->_body.buffer.size();
+			cf.cached = nullptr;
+			cf.previous_start = (size_t)-1;
+			cf.index = 0;
+			cf.in_place = false;
+			if (!adjacent_children)
+				return;
+
+			size_t child_count = collection->child_count();
+			auto it = _s->_collections.find(collection);
+			if ((it != _s->_collections.end()) && (owner.previous_start != (size_t)-1))
+			{
+				cf.cached = &it->second;
+				cf.previous_start = owner.previous_start + it->second.offset;
+				cf.in_place = (it->second.ends.size() == child_count) && (_s->_reshaped.find(collection) == _s->_reshaped.end());
+			}
+
+			if (cf.in_place)
+			{
+				// With the children where they were, the changed ones are found from the dirty objects rather than by looking at each child.
+				if (auto dc = _s->_dirty_children.find(obj); dc != _s->_dirty_children.end())
+				{
+					for (auto child : dc->second)
+					{
+						auto ci = _s->_child_indexes.find(child);
+						if ((ci != _s->_child_indexes.end()) && (ci->second < child_count) && (collection->child_at(ci->second) == child))
+							cf.dirty.push_back(ci->second);
+					}
+
+					std::sort (cf.dirty.begin(), cf.dirty.end());
+				}
+
+				cf.next_dirty = 0;
+				cf.previous_cursor = 0;
+			}
+			else
+				cf.new_ends.reserve(child_count);
+		}
+
+		virtual size_t skip_collection_children (size_t index) override
+		{
+			auto& cf = _s->_collection_stack.back();
+			if (!cf.in_place)
+				return 0;
+
+			while ((cf.next_dirty < cf.dirty.size()) && (cf.dirty[cf.next_dirty] < index))
+				cf.next_dirty++;
+
+			auto& ends = cf.cached->ends;
+			size_t run_end = (cf.next_dirty < cf.dirty.size()) ? cf.dirty[cf.next_dirty] : ends.size();
+			if (run_end == index)
+				return 0;
+
+			// The children of the run move by the same amount, so their ends are updated with one addition each.
+			size_t previous_end = ends[run_end - 1];
+			size_t delta = (_s->_body.buffer.size() - cf.new_start) - cf.previous_cursor;
+			copy_previous (cf.previous_start + cf.previous_cursor, cf.previous_start + previous_end);
+			for (size_t i = index; i < run_end; i++)
+				ends[i] += delta;
+			cf.previous_cursor = previous_end;
+			return run_end - index;
+		}
+
+		virtual void begin_collection_child (size_t index) override
+		{
+			_s->_collection_stack.back().index = index;
+		}
+
+		virtual void end_object_collection() override
+		{
+			auto& cf = _s->_collection_stack.back();
+			if (cf.adjacent)
+			{
+				auto& cached = cf.cached ? *cf.cached : _s->_collections[cf.collection];
+				cached.offset = cf.new_start - _s->_stack.back().new_start;
+				if (!cf.in_place)
+					cached.ends.swap(cf.new_ends);
+			}
+
+			_s->_collection_stack.pop_back();
+		}
+	};
+
+	incremental_binary_serializer::incremental_binary_serializer (object* root)
+		: dirty_tree_tracker(root)
+		, _hooks(std::make_unique<hooks>(this))
+		, _writer(std::make_unique<binary_writer>(&_body, false, _hooks.get()))
+	{ }
+
+	incremental_binary_serializer::~incremental_binary_serializer() = default;
+
+	void incremental_binary_serializer::on_detaching (object* obj)
+	{
+		dirty_tree_tracker::on_detaching(obj);
+		_ranges.erase(obj);
+		_child_indexes.erase(obj);
+		for (auto prop : obj->type()->child_property_list())
+		{
+			if (auto oc_prop = dynamic_cast<const object_collection_property*>(prop))
+			{
+				_collections.erase(oc_prop->collection_cast(obj));
+				_reshaped.erase(oc_prop->collection_cast(obj));
+			}
+		}
+	}
+
+	void incremental_binary_serializer::on_property_changed (object* obj, const property_change_args& args)
+	{
+		if (auto oc_prop = dynamic_cast<const object_collection_property*>(args.property))
+			_reshaped.insert(oc_prop->collection_cast(obj));
+
+		dirty_tree_tracker::on_property_changed(obj, args);
+	}
+
+	void incremental_binary_serializer::serialize (out_stream_i* to)
+	{
+		for (auto obj : dirty_objects())
+		{
+			if (auto parent = parent_of(obj))
+				_dirty_children[parent].push_back(obj);
+		}
+
+		_body.buffer.clear();
+		_body.buffer.reserve(_previous.size());
+		_writer->write_object(this->root());
+		assert (_stack.empty() && _collection_stack.empty());
+		_dirty_children.clear();
+		_reshaped.clear();
+
+		write_header(to);
+		_writer->write_type_table(to);
+		to->write (_body.buffer.data(), _body.buffer.size());
+
+		std::swap (_previous, _body.buffer);
+		clear_dirty();
+	}
+}
@@ -0,0 +1,133 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "serializer.h"
+#include "tree_observer.h"
+#include <vector>
+
+namespace edge
+{
+	struct vector_out_stream : out_stream_i
+	{
+		std::vector<uint8_t> buffer;
+
+		using out_stream_i::write;
+
+		virtual void write (const void* data, size_t size) override
+		{
+			auto p = static_cast<const uint8_t*>(data);
+			buffer.insert (buffer.end(), p, p + size);
+		}
+	};
+
+	// Compact binary counterpart of the XML serializer. It visits the same properties in the same order
+	// (factory props, value properties changed from default, value collections, object collections, object properties),
+	// but values are encoded with property_traits::serialize instead of being formatted as strings.
+	//
+	// Types and property names are written once per document, the first time they're used,
+	// so a file remains readable after properties are added to or reordered within a type.
+	void serialize (const object* obj, out_stream_i* to);
+
+	// These throw binary_read_exception when the data is truncated or malformed, or refers to an unknown type or property.
+	void deserialize_to (binary_reader& from, object* obj, std::span<const concrete_type* const> known_types);
+	std::unique_ptr<object> deserialize (binary_reader& from, std::span<const concrete_type* const> known_types);
+
+	class paged_binary_reader;
+
+	// Implemented by object collections whose children can stay on disk until they're used (see lazy_collection.h).
+	// serialize_paged writes a table with the offsets of their children, and paged_binary_reader passes that table
+	// to the collection instead of reading the children. "offsets" has count + 1 entries (the last one is the end of the last child),
+	// each a little-endian uint64_t to be passed to paged_binary_reader::read_object_at.
+	struct lazy_collection_i
+	{
+		virtual void set_lazy_source (paged_binary_reader* reader, const uint8_t* offsets, size_t count) = 0;
+
+		// Called by tree_observer before it subscribes to the children, and after it unsubscribed from all of them.
+		// While observed, the collection keeps its loaded children in memory, since the observers hold pointers to them.
+		virtual void add_observer() = 0;
+		virtual void remove_observer() = 0;
+	};
+
+	// Variant of the binary format for documents that are opened with paged_binary_reader (usually through paged_document):
+	// all type definitions are in the header, and the collections that implement lazy_collection_i are preceded by an offset table.
+	// It is not readable by deserialize / deserialize_to.
+	void serialize_paged (const object* obj, out_stream_i* to);
+
+	// Reads a document written by serialize_paged from memory that must stay valid and unchanged for as long as the reader
+	// is alive (and so as long as any lazy collection loaded from it is alive). Throws binary_read_exception as deserialize does.
+	class paged_binary_reader
+	{
+		struct impl;
+		std::unique_ptr<impl> const _impl;
+
+	public:
+		paged_binary_reader (std::span<const uint8_t> data, std::span<const concrete_type* const> known_types);
+		~paged_binary_reader();
+
+		std::unique_ptr<object> read_root();
+
+		// Reads the object at an offset taken from a table passed to lazy_collection_i::set_lazy_source.
+		std::unique_ptr<object> read_object_at (uint64_t offset);
+	};
+
+	class binary_writer;
+
+	// Saves the same tree repeatedly, copying the bytes of subtrees that didn't change since the previous save
+	// instead of serializing them again. Changes are detected through property_changed notifications (see dirty_tree_tracker),
+	// so the object tree must raise them for every change that affects what gets saved.
+	//
+	// The output is an ordinary binary document readable by deserialize / deserialize_to, except that all
+	// type definitions are in the header, so that bytes copied from a previous save never contain any.
+	//
+	// Children of a variable-size collection are written back to back, so a run of unchanged children is copied
+	// with a single insert. While a collection keeps its children (no insert, remove or reorder since the previous save),
+	// a save looks only at the children that changed, and its cost is that of copying the bytes.
+	class incremental_binary_serializer : dirty_tree_tracker
+	{
+		struct cached_range
+		{
+			size_t offset; // relative to the start of the parent's range, so it stays valid when the parent's bytes are copied as a whole
+			size_t size;
+		};
+
+		// Children of variable-size collections have no cached_range; their ranges are kept here, by index.
+		struct cached_collection
+		{
+			size_t offset;            // of the first child, relative to the start of the owner's range
+			std::vector<size_t> ends; // of each child, relative to the start of the first child
+		};
+
+		struct frame
+		{
+			size_t new_start;
+			size_t previous_start; // -1 if the object wasn't written by the previous save
+		};
+
+		struct collection_frame;
+		struct hooks;
+
+		std::unordered_map<const object*, cached_range> _ranges;
+		std::unordered_map<const object_collection_i*, cached_collection> _collections;
+		std::unordered_map<const object*, size_t> _child_indexes;       // index of each collection child in the previous save
+		std::unordered_set<const object_collection_i*> _reshaped;       // collections with children inserted, removed or reordered since
+		std::unordered_map<const object*, std::vector<const object*>> _dirty_children; // by parent, during serialize()
+		std::vector<uint8_t> _previous;
+		vector_out_stream _body;
+		std::vector<frame> _stack;
+		std::vector<collection_frame> _collection_stack;
+		std::unique_ptr<hooks> const _hooks;
+		std::unique_ptr<binary_writer> const _writer;
+
+	public:
+		incremental_binary_serializer (object* root);
+		~incremental_binary_serializer();
+
+		void serialize (out_stream_i* to);
+
+	private:
+		virtual void on_detaching (object* obj) override;
+		virtual void on_property_changed (object* obj, const property_change_args& args) override;
+	};
+}
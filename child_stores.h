@@ -0,0 +1,457 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "collections.h"
+
+namespace edge
+{
+	// Child stores for typed_object_collection_i, for when std::vector isn't good enough: inserting or removing
+	// in the middle of a vector moves all the children after that point, and growing it copies all of them.
+	// Both stores below have the interface that child_store_ops expects.
+
+	// Children in segments of at most segment_capacity each. Inserting or removing moves at most one segment's worth
+	// of children, plus an update of the segment start indexes (one per segment_capacity children); finding a child
+	// by index is a binary search over the segment start indexes.
+	template<typename child_t, size_t segment_capacity = 512>
+	class segmented_child_store
+	{
+		static_assert (segment_capacity >= 2);
+
+	public:
+		using value_type = std::unique_ptr<child_t>;
+
+	private:
+		std::vector<std::vector<value_type>> _segments;
+		std::vector<size_t> _starts; // index of the first child of each segment
+		size_t _size = 0;
+
+		// Segment and position within the segment. For index == size(), returns the end of the last segment.
+		std::pair<size_t, size_t> locate (size_t index) const
+		{
+			assert (index <= _size);
+			if (index == _size)
+				return { _segments.size() - 1, _segments.back().size() };
+			size_t segment = std::upper_bound (_starts.begin(), _starts.end(), index) - _starts.begin() - 1;
+			return { segment, index - _starts[segment] };
+		}
+
+		void update_starts (size_t from_segment)
+		{
+			if (!_starts.empty())
+				_starts[0] = 0;
+			for (size_t s = std::max<size_t>(from_segment, 1); s < _segments.size(); s++)
+				_starts[s] = _starts[s - 1] + _segments[s - 1].size();
+		}
+
+		// Splits an over-full segment into segments that are half full, to leave room for more inserts.
+		void split (size_t segment)
+		{
+			auto& seg = _segments[segment];
+			if (seg.size() <= segment_capacity)
+				return;
+
+			size_t piece_size = segment_capacity / 2;
+			std::vector<std::vector<value_type>> pieces;
+			for (size_t i = piece_size; i < seg.size(); i += piece_size)
+			{
+				size_t end = std::min (i + piece_size, seg.size());
+				pieces.emplace_back (std::make_move_iterator(seg.begin() + i), std::make_move_iterator(seg.begin() + end));
+			}
+			seg.resize(piece_size);
+
+			_segments.insert (_segments.begin() + segment + 1, std::make_move_iterator(pieces.begin()), std::make_move_iterator(pieces.end()));
+			_starts.insert (_starts.begin() + segment + 1, pieces.size(), 0);
+		}
+
+	public:
+		size_t size() const { return _size; }
+		bool empty() const { return _size == 0; }
+
+		const value_type& operator[] (size_t index) const
+		{
+			auto [segment, pos] = locate(index);
+			return _segments[segment][pos];
+		}
+
+		value_type& operator[] (size_t index)
+		{
+			auto [segment, pos] = locate(index);
+			return _segments[segment][pos];
+		}
+
+		const value_type& back() const { return _segments.back().back(); }
+
+		void insert (size_t index, value_type&& p)
+		{
+			if (_segments.empty())
+			{
+				_segments.emplace_back();
+				_starts.push_back(0);
+			}
+
+			auto [segment, pos] = locate(index);
+			_segments[segment].insert (_segments[segment].begin() + pos, std::move(p));
+			_size++;
+			split(segment);
+			update_starts(segment + 1);
+		}
+
+		void insert (size_t index, std::vector<value_type>&& ps)
+		{
+			if (ps.empty())
+				return;
+
+			if (_segments.empty())
+			{
+				_segments.emplace_back();
+				_starts.push_back(0);
+			}
+
+			auto [segment, pos] = locate(index);
+			_segments[segment].insert (_segments[segment].begin() + pos, std::make_move_iterator(ps.begin()), std::make_move_iterator(ps.end()));
+			_size += ps.size();
+			split(segment);
+			update_starts(segment + 1);
+		}
+
+		value_type erase (size_t index)
+		{
+			assert (index < _size);
+			auto [segment, pos] = locate(index);
+			auto& seg = _segments[segment];
+			auto result = std::move(seg[pos]);
+			seg.erase (seg.begin() + pos);
+			_size--;
+			if (seg.empty())
+			{
+				_segments.erase (_segments.begin() + segment);
+				_starts.erase (_starts.begin() + segment);
+			}
+			update_starts(segment);
+			return result;
+		}
+
+		void erase (size_t index, size_t count, std::vector<value_type>& erased)
+		{
+			assert (index + count <= _size);
+			if (count == 0)
+				return;
+
+			auto [first_segment, pos] = locate(index);
+			size_t segment = first_segment;
+			while (count > 0)
+			{
+				auto& seg = _segments[segment];
+				size_t n = std::min (count, seg.size() - pos);
+				erased.insert (erased.end(), std::make_move_iterator(seg.begin() + pos), std::make_move_iterator(seg.begin() + pos + n));
+				seg.erase (seg.begin() + pos, seg.begin() + pos + n);
+				_size -= n;
+				count -= n;
+				segment++;
+				pos = 0;
+			}
+
+			auto empty_begin = std::remove_if (_segments.begin() + first_segment, _segments.begin() + segment, [](auto& seg) { return seg.empty(); });
+			size_t empty_count = (_segments.begin() + segment) - empty_begin;
+			_segments.erase (empty_begin, _segments.begin() + segment);
+			_starts.erase (_starts.begin() + first_segment, _starts.begin() + first_segment + empty_count);
+			update_starts(first_segment);
+		}
+
+		class const_iterator
+		{
+			const segmented_child_store* _store;
+			size_t _segment;
+			size_t _pos;
+
+		public:
+			const_iterator (const segmented_child_store* store, size_t segment, size_t pos)
+				: _store(store), _segment(segment), _pos(pos)
+			{ }
+
+			const value_type& operator*() const { return _store->_segments[_segment][_pos]; }
+			const value_type* operator->() const { return &**this; }
+
+			const_iterator& operator++()
+			{
+				if (++_pos == _store->_segments[_segment].size())
+				{
+					_segment++;
+					_pos = 0;
+				}
+				return *this;
+			}
+
+			bool operator== (const const_iterator& other) const { return (_segment == other._segment) && (_pos == other._pos); }
+			bool operator!= (const const_iterator& other) const { return !(*this == other); }
+		};
+
+		const_iterator begin() const { return { this, 0, 0 }; }
+		const_iterator end() const { return { this, _segments.size(), 0 }; }
+	};
+
+	// ========================================================================
+
+	// Children in the leaves of a B+ tree whose nodes know how many children are below them (an order-statistic tree),
+	// so that finding, inserting and removing a child by index are all O(log n).
+	template<typename child_t>
+	class btree_child_store
+	{
+	public:
+		using value_type = std::unique_ptr<child_t>;
+
+	private:
+		static constexpr size_t max_leaf_size = 128;
+		static constexpr size_t max_inner_size = 64;
+
+		struct node
+		{
+			bool const is_leaf;
+			size_t count = 0; // number of children in this subtree
+
+			node (bool is_leaf) : is_leaf(is_leaf) { }
+			virtual ~node() = default;
+		};
+
+		struct leaf_node : node
+		{
+			std::vector<value_type> items;
+			leaf_node() : node(true) { }
+		};
+
+		struct inner_node : node
+		{
+			std::vector<std::unique_ptr<node>> nodes;
+			inner_node() : node(false) { }
+		};
+
+		std::unique_ptr<node> _root = std::make_unique<leaf_node>();
+
+		static size_t node_size (const node* n)
+		{
+			return n->is_leaf ? static_cast<const leaf_node*>(n)->items.size() : static_cast<const inner_node*>(n)->nodes.size();
+		}
+
+		// Leaf that holds the child at "index", and the child's position within the leaf.
+		std::pair<leaf_node*, size_t> find_leaf (size_t index) const
+		{
+			node* n = _root.get();
+			while (!n->is_leaf)
+			{
+				for (auto& child : static_cast<inner_node*>(n)->nodes)
+				{
+					if (index < child->count)
+					{
+						n = child.get();
+						break;
+					}
+
+					index -= child->count;
+				}
+			}
+
+			return { static_cast<leaf_node*>(n), index };
+		}
+
+		// Returns the new right sibling if "n" had to be split.
+		static std::unique_ptr<node> insert_into (node* n, size_t index, value_type&& p)
+		{
+			n->count++;
+			if (n->is_leaf)
+			{
+				auto leaf = static_cast<leaf_node*>(n);
+				leaf->items.insert (leaf->items.begin() + index, std::move(p));
+				if (leaf->items.size() <= max_leaf_size)
+					return nullptr;
+
+				auto right = std::make_unique<leaf_node>();
+				size_t half = leaf->items.size() / 2;
+				right->items.assign (std::make_move_iterator(leaf->items.begin() + half), std::make_move_iterator(leaf->items.end()));
+				leaf->items.resize(half);
+				right->count = right->items.size();
+				leaf->count = half;
+				return right;
+			}
+
+			auto inner = static_cast<inner_node*>(n);
+			size_t i = 0;
+			while ((i < inner->nodes.size() - 1) && (index > inner->nodes[i]->count))
+				index -= inner->nodes[i++]->count;
+
+			auto new_node = insert_into (inner->nodes[i].get(), index, std::move(p));
+			if (new_node == nullptr)
+				return nullptr;
+
+			inner->nodes.insert (inner->nodes.begin() + i + 1, std::move(new_node));
+			if (inner->nodes.size() <= max_inner_size)
+				return nullptr;
+
+			auto right = std::make_unique<inner_node>();
+			size_t half = inner->nodes.size() / 2;
+			right->nodes.assign (std::make_move_iterator(inner->nodes.begin() + half), std::make_move_iterator(inner->nodes.end()));
+			inner->nodes.resize(half);
+			for (auto& child : right->nodes)
+				right->count += child->count;
+			inner->count -= right->count;
+			return right;
+		}
+
+		static value_type erase_from (node* n, size_t index)
+		{
+			n->count--;
+			if (n->is_leaf)
+			{
+				auto leaf = static_cast<leaf_node*>(n);
+				auto result = std::move(leaf->items[index]);
+				leaf->items.erase (leaf->items.begin() + index);
+				return result;
+			}
+
+			auto inner = static_cast<inner_node*>(n);
+			size_t i = 0;
+			while (index >= inner->nodes[i]->count)
+				index -= inner->nodes[i++]->count;
+
+			auto result = erase_from (inner->nodes[i].get(), index);
+
+			auto child = inner->nodes[i].get();
+			if (child->count == 0)
+				inner->nodes.erase (inner->nodes.begin() + i);
+			else
+			{
+				// Merge an under-full child with a sibling when both fit in one node, to keep the tree dense.
+				size_t max_size = child->is_leaf ? max_leaf_size : max_inner_size;
+				if ((node_size(child) < max_size / 4) && (inner->nodes.size() >= 2))
+				{
+					size_t left = (i + 1 < inner->nodes.size()) ? i : i - 1;
+					if (node_size(inner->nodes[left].get()) + node_size(inner->nodes[left + 1].get()) <= max_size)
+					{
+						merge (inner->nodes[left].get(), inner->nodes[left + 1].get());
+						inner->nodes.erase (inner->nodes.begin() + left + 1);
+					}
+				}
+			}
+
+			return result;
+		}
+
+		static void merge (node* left, node* right)
+		{
+			if (left->is_leaf)
+			{
+				auto& from = static_cast<leaf_node*>(right)->items;
+				auto& to = static_cast<leaf_node*>(left)->items;
+				to.insert (to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+			}
+			else
+			{
+				auto& from = static_cast<inner_node*>(right)->nodes;
+				auto& to = static_cast<inner_node*>(left)->nodes;
+				to.insert (to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+			}
+
+			left->count += right->count;
+		}
+
+	public:
+		size_t size() const { return _root->count; }
+		bool empty() const { return _root->count == 0; }
+
+		const value_type& operator[] (size_t index) const
+		{
+			assert (index < size());
+			auto [leaf, pos] = find_leaf(index);
+			return leaf->items[pos];
+		}
+
+		value_type& operator[] (size_t index)
+		{
+			assert (index < size());
+			auto [leaf, pos] = find_leaf(index);
+			return leaf->items[pos];
+		}
+
+		const value_type& back() const { return (*this)[size() - 1]; }
+
+		void insert (size_t index, value_type&& p)
+		{
+			assert (index <= size());
+			auto right = insert_into (_root.get(), index, std::move(p));
+			if (right != nullptr)
+			{
+				auto new_root = std::make_unique<inner_node>();
+				new_root->count = _root->count + right->count;
+				new_root->nodes.push_back(std::move(_root));
+				new_root->nodes.push_back(std::move(right));
+				_root = std::move(new_root);
+			}
+		}
+
+		void insert (size_t index, std::vector<value_type>&& ps)
+		{
+			for (auto& p : ps)
+				insert (index++, std::move(p));
+		}
+
+		value_type erase (size_t index)
+		{
+			assert (index < size());
+			auto result = erase_from (_root.get(), index);
+
+			// Shrink the tree when the root is left with a single child.
+			while (!_root->is_leaf && (static_cast<inner_node*>(_root.get())->nodes.size() <= 1))
+			{
+				auto& nodes = static_cast<inner_node*>(_root.get())->nodes;
+				std::unique_ptr<node> new_root = nodes.empty() ? std::make_unique<leaf_node>() : std::move(nodes[0]);
+				_root = std::move(new_root);
+			}
+
+			return result;
+		}
+
+		void erase (size_t index, size_t count, std::vector<value_type>& erased)
+		{
+			for (size_t i = 0; i < count; i++)
+				erased.push_back(erase(index));
+		}
+
+		class const_iterator
+		{
+			const btree_child_store* _store;
+			size_t _index;
+			const leaf_node* _leaf = nullptr;
+			size_t _pos = 0;
+
+		public:
+			const_iterator (const btree_child_store* store, size_t index)
+				: _store(store), _index(index)
+			{
+				if (index < store->size())
+					std::tie(_leaf, _pos) = store->find_leaf(index);
+			}
+
+			const value_type& operator*() const { return _leaf->items[_pos]; }
+			const value_type* operator->() const { return &**this; }
+
+			const_iterator& operator++()
+			{
+				_index++;
+				if (++_pos == _leaf->items.size())
+				{
+					// Next leaf; finding it from the root costs O(log n) once per leaf, not per child.
+					if (_index < _store->size())
+						std::tie(_leaf, _pos) = _store->find_leaf(_index);
+				}
+				return *this;
+			}
+
+			bool operator== (const const_iterator& other) const { return _index == other._index; }
+			bool operator!= (const const_iterator& other) const { return _index != other._index; }
+		};
+
+		const_iterator begin() const { return { this, 0 }; }
+		const_iterator end() const { return { this, size() }; }
+	};
+}
@@ -0,0 +1,91 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "clone.h"
+#include "serializer.h"
+
+namespace edge
+{
+	static void clone_body (const object* from, object* to)
+	{
+		auto deserializable = dynamic_cast<deserialize_i*>(to);
+		if (deserializable != nullptr)
+			deserializable->on_deserializing();
+
+		// The serialization plan has the kind of each property worked out already, so there's no dynamic_cast per property here.
+		auto& plan = from->type()->serialization_plan();
+		auto bits = from->changed_from_default_bits();
+		for (size_t i = 0; i < plan.props.size(); i++)
+		{
+			auto& pi = plan.props[i];
+			auto prop = pi.prop;
+			if (pi.kind == serialized_prop_kind::value)
+			{
+				if (pi.is_factory_prop)
+					continue;
+
+				auto value_prop = static_cast<const value_property*>(prop);
+				if (value_prop->can_set(from)
+					&& ((bits && pi.tracks_changed_from_default) ? bits->test(i) : value_prop->changed_from_default(from)))
+					value_prop->copy(from, to);
+			}
+			else if (pi.kind == serialized_prop_kind::value_collection)
+			{
+				static_cast<const value_collection_property*>(prop)->copy_values(from, to);
+			}
+			else if (pi.kind == serialized_prop_kind::object_collection)
+			{
+				auto oc_prop = static_cast<const object_collection_property*>(prop);
+				auto from_collection = oc_prop->collection_cast(from);
+				auto to_collection = oc_prop->collection_cast(to);
+				for (size_t ci = 0, count = from_collection->child_count(); ci < count; ci++)
+				{
+					auto from_child = from_collection->child_at(ci);
+					if (!oc_prop->preallocated)
+					{
+						// Same order as the deserializers: create, append, then copy the rest of the child.
+						auto child = from_child->type()->create_like(from_child);
+						auto child_raw = child.get();
+						to_collection->append(std::move(child));
+						clone_body (from_child, child_raw);
+					}
+					else
+						clone_body (from_child, to_collection->child_at(ci));
+				}
+			}
+			else if (pi.kind == serialized_prop_kind::object)
+			{
+				auto obj_prop = static_cast<const object_property*>(prop);
+				if (auto from_value = obj_prop->get(from))
+				{
+					auto to_value = obj_prop->get(to);
+					assert (to_value != nullptr); // creating the object here is not implemented, same as in the deserializers
+					clone_body (from_value, to_value);
+				}
+			}
+		}
+
+		if (deserializable != nullptr)
+			deserializable->on_deserialized();
+	}
+
+	std::unique_ptr<object> clone (const object* obj)
+	{
+		auto result = obj->type()->create_like(obj);
+		clone_body (obj, result.get());
+		return result;
+	}
+
+	std::unique_ptr<object> clone (const object* obj, object_allocator_i* allocator)
+	{
+		object_allocation_scope scope (allocator);
+		return clone(obj);
+	}
+
+	void clone_to (const object* from, object* to)
+	{
+		assert (from->type() == to->type());
+		clone_body (from, to);
+	}
+}
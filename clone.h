@@ -0,0 +1,24 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "collections.h"
+
+namespace edge
+{
+	// Deep copy of an object and its descendants, driven by reflection. It visits the same properties as the serializers
+	// and follows the same rules as the deserializers: new objects are created with concrete_type::create_like
+	// (i.e. through the type's factory, from the factory property values), value properties changed from default are copied,
+	// value collections are appended or overwritten, children of preallocated object collections and of object properties
+	// are copied into the objects the clone already has, and deserialize_i::on_deserializing / on_deserialized are called.
+	// Values are copied as values, never formatted as strings.
+	//
+	// New objects come from the allocator of the object_allocation_scope active on the calling thread, if any,
+	// or from the global heap; the second overload opens a scope for "allocator" for the duration of the call.
+	std::unique_ptr<object> clone (const object* obj);
+	std::unique_ptr<object> clone (const object* obj, object_allocator_i* allocator);
+
+	// Copies into "to" (which must be of the same type as "from") everything clone() would.
+	void clone_to (const object* from, object* to);
+}
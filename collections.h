@@ -1,6 +1,9 @@
 
 #pragma once
 #include "object.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
 
 namespace edge
 {
@@ -12,22 +15,93 @@ namespace edge
 		virtual object* child_at(size_t index) const = 0;
 		virtual void insert (size_t index, std::unique_ptr<object>&& child) = 0;
 		void append (std::unique_ptr<object>&& child) { insert(child_count(), std::move(child)); }
+		// Same as typed_object_collection_i::insert_range, for callers that only know the children as objects.
+		virtual void insert_objects (size_t index, std::vector<std::unique_ptr<object>>&& children) = 0;
+		virtual std::unique_ptr<object> remove_object (size_t index) = 0;
+		virtual void reorder (size_t index, std::span<const size_t> order) = 0;
+		// Returns -1 if "child" is not in the collection.
+		virtual size_t index_of_object (const object* child) const = 0;
 		virtual const object_collection_property* collection_property() const = 0;
 		virtual void call_property_changing (const property_change_args& args) = 0;
 		virtual void call_property_changed  (const property_change_args& args) = 0;
 	};
 
-	template<typename child_t>
+	// How typed_object_collection_i changes its child store. The store must also have size(), back(), operator[] and begin() / end().
+	// This primary template is for stores that implement the operations as member functions (see child_stores.h);
+	// std::vector has its own specialization below.
+	template<typename store_t>
+	struct child_store_ops
+	{
+		using ptr_t = typename store_t::value_type;
+
+		// Whether erasing moves all the children after the erased ones, as std::vector does.
+		static constexpr bool erase_moves_tail = false;
+
+		static void insert (store_t& store, size_t index, ptr_t&& p) { store.insert (index, std::move(p)); }
+		static void insert (store_t& store, size_t index, std::vector<ptr_t>&& ps) { store.insert (index, std::move(ps)); }
+		static ptr_t erase (store_t& store, size_t index) { return store.erase(index); }
+		static void erase (store_t& store, size_t index, size_t count, std::vector<ptr_t>& erased) { store.erase (index, count, erased); }
+
+		static void move (store_t& store, size_t from, size_t to)
+		{
+			auto p = store.erase(from);
+			store.insert (to, std::move(p));
+		}
+	};
+
+	template<typename ptr_t>
+	struct child_store_ops<std::vector<ptr_t>>
+	{
+		using store_t = std::vector<ptr_t>;
+
+		static constexpr bool erase_moves_tail = true;
+
+		static void insert (store_t& store, size_t index, ptr_t&& p) { store.insert (store.begin() + index, std::move(p)); }
+
+		static void insert (store_t& store, size_t index, std::vector<ptr_t>&& ps)
+		{
+			store.insert (store.begin() + index, std::make_move_iterator(ps.begin()), std::make_move_iterator(ps.end()));
+		}
+
+		static ptr_t erase (store_t& store, size_t index)
+		{
+			auto result = std::move (store[index]);
+			store.erase (store.begin() + index);
+			return result;
+		}
+
+		static void erase (store_t& store, size_t index, size_t count, std::vector<ptr_t>& erased)
+		{
+			erased.insert (erased.end(), std::make_move_iterator(store.begin() + index), std::make_move_iterator(store.begin() + index + count));
+			store.erase (store.begin() + index, store.begin() + index + count);
+		}
+
+		static void move (store_t& store, size_t from, size_t to)
+		{
+			if (from < to)
+				std::rotate (store.begin() + from, store.begin() + from + 1, store.begin() + to + 1);
+			else
+				std::rotate (store.begin() + to, store.begin() + from, store.begin() + from + 1);
+		}
+	};
+
+	template<typename child_t, typename store_t = std::vector<std::unique_ptr<child_t>>>
 	struct typed_object_collection_property;
 
-	template<typename child_t>
+	// store_t holds the children; it is a std::vector by default, and can be one of the stores in child_stores.h
+	// for collections that are huge or often changed in the middle.
+	template<typename child_t, typename store_t = std::vector<std::unique_ptr<child_t>>>
 	struct typed_object_collection_i : object_collection_i
 	{
+		static_assert (std::is_same_v<typename store_t::value_type, std::unique_ptr<child_t>>);
+
 	private:
-		virtual std::vector<std::unique_ptr<child_t>>& children_store() = 0;
-		const std::vector<std::unique_ptr<child_t>>& children_store() const { return const_cast<typed_object_collection_i*>(this)->children_store(); }
+		using ops = child_store_ops<store_t>;
 
-		virtual const typed_object_collection_property<child_t>* collection_property() const = 0;
+		virtual store_t& children_store() = 0;
+		const store_t& children_store() const { return const_cast<typed_object_collection_i*>(this)->children_store(); }
+
+		virtual const typed_object_collection_property<child_t, store_t>* collection_property() const = 0;
 
 		void call_inserting_into_parent(object* child) = delete;
 		void set_parent(object* child) = delete;
@@ -43,8 +117,43 @@ namespace edge
 		virtual void on_child_removing (size_t index, child_t* child) { }
 		virtual void on_child_removed (size_t index, child_t* child) { }
 
+		// Called instead of on_child_inserted / on_child_removed when several children are inserted or removed in one go
+		// (insert_range, remove_range, and so also remove of several children), after property_changed. "indexes" are those the removed
+		// children had, ascending. The default implementations call the single-child functions, from the first inserted child
+		// to the last, and from the last removed child to the first; derived classes override these when a range
+		// can be handled faster than one child at a time.
+		virtual void on_children_inserted (size_t index, size_t count)
+		{
+			auto& children = children_store();
+			for (size_t i = index; i < index + count; i++)
+				this->on_child_inserted (i, children[i].get());
+		}
+
+		virtual void on_children_removed (std::span<const size_t> indexes, std::span<const std::unique_ptr<child_t>> removed)
+		{
+			for (size_t i = removed.size(); i-- > 0; )
+				this->on_child_removed (indexes[i], removed[i].get());
+		}
+
+		// Called after the children in the range were reordered, before property_changed.
+		virtual void on_children_reordered (size_t index, size_t count) { }
+
+		// Called by index_of. Derived classes that can find a child faster than by scanning the store override this.
+		virtual size_t find_index (const child_t* child) const
+		{
+			size_t i = 0;
+			for (auto& c : this->children())
+			{
+				if (c.get() == child)
+					return i;
+				i++;
+			}
+
+			return -1;
+		}
+
 	public:
-		const std::vector<std::unique_ptr<child_t>>& children() const { return children_store(); }
+		const store_t& children() const { return children_store(); }
 
 		virtual size_t child_count() const override final { return children_store().size(); }
 
@@ -71,7 +180,7 @@ namespace edge
 			this->parent_i::call_inserting_into_parent(raw);
 			this->on_child_inserting(index, raw);
 			this->call_property_changing(args);
-			children.insert (children.begin() + index, std::move(o));
+			ops::insert (children, index, std::move(o));
 			this->parent_i::set_parent(raw);
 			this->call_property_changed(args);
 			this->on_child_inserted (index, raw);
@@ -83,14 +192,23 @@ namespace edge
 			insert (children_store().size(), std::move(o));
 		}
 
+		virtual void insert_objects (size_t index, std::vector<std::unique_ptr<object>>&& children) override final
+		{
+			std::vector<std::unique_ptr<child_t>> typed_children;
+			typed_children.reserve(children.size());
+			for (auto& child : children)
+				typed_children.push_back(std::unique_ptr<child_t>(static_cast<child_t*>(child.release())));
+			children.clear();
+			insert_range (index, std::move(typed_children));
+		}
+
 		std::unique_ptr<child_t> remove(size_t index)
 		{
 			static_assert (std::is_base_of<object, child_t>::value);
 
 			auto& children = children_store();
 			assert (index < children.size());
-			auto it = children.begin() + index;
-			child_t* raw = (*it).get();
+			child_t* raw = children[index].get();
 
 			property_change_args args = { this->collection_property(), index, collection_property_change_type::remove };
 
@@ -98,8 +216,7 @@ namespace edge
 			this->on_child_removing (index, raw);
 			this->call_property_changing(args);
 			this->parent_i::clear_parent(raw);
-			auto result = std::move (children[index]);
-			children.erase (children.begin() + index);
+			auto result = ops::erase (children, index);
 			this->call_property_changed (args);
 			this->on_child_removed (index, raw);
 			this->parent_i::call_removed_from_parent(raw);
@@ -107,6 +224,137 @@ namespace edge
 			return result;
 		}
 
+		virtual std::unique_ptr<object> remove_object (size_t index) override final
+		{
+			return remove(index);
+		}
+
+		virtual size_t index_of_object (const object* child) const override final
+		{
+			auto typed_child = dynamic_cast<const child_t*>(child);
+			return (typed_child != nullptr) ? find_index(typed_child) : (size_t)-1;
+		}
+
+		// Inserts the children at consecutive indexes starting at "index", raising a single property_changing / property_changed
+		// pair whose args cover the whole range. The per-child functions (inserting_into_parent, on_child_inserting etc.)
+		// are still called for each child, in order; the "inserting" ones before the children are put in the store,
+		// and the "inserted" ones after, with a single on_children_inserted call standing for the on_child_inserted ones.
+		void insert_range (size_t index, std::vector<std::unique_ptr<child_t>>&& new_children)
+		{
+			auto& children = children_store();
+			assert (index <= children.size());
+			if (new_children.empty())
+				return;
+
+			property_change_args args = { this->collection_property(), index, new_children.size(), collection_property_change_type::insert };
+
+			for (size_t i = 0; i < new_children.size(); i++)
+			{
+				this->parent_i::call_inserting_into_parent(new_children[i].get());
+				this->on_child_inserting(index + i, new_children[i].get());
+			}
+
+			this->call_property_changing(args);
+			ops::insert (children, index, std::move(new_children));
+			for (size_t i = index; i < index + args.count; i++)
+				this->parent_i::set_parent(children[i].get());
+			this->call_property_changed(args);
+
+			this->on_children_inserted (index, args.count);
+			for (size_t i = index; i < index + args.count; i++)
+				this->parent_i::call_inserted_into_parent(children[i].get());
+
+			new_children.clear();
+		}
+
+		// Removes "count" children starting at "index", raising a single property_changing / property_changed pair
+		// whose args cover the whole range. The per-child functions are still called for each child, from the last one to the first
+		// (so that each index is right for a removal done child by child); the "removing" ones before the children
+		// are taken out of the store, and the "removed" ones after, with a single on_children_removed call standing
+		// for the on_child_removed ones.
+		std::vector<std::unique_ptr<child_t>> remove_range (size_t index, size_t count)
+		{
+			auto& children = children_store();
+			assert (index + count <= children.size());
+			std::vector<std::unique_ptr<child_t>> result;
+			if (count == 0)
+				return result;
+
+			property_change_args args = { this->collection_property(), index, count, collection_property_change_type::remove };
+
+			for (size_t i = index + count; i-- > index; )
+			{
+				this->parent_i::call_removing_from_parent(children[i].get());
+				this->on_child_removing (i, children[i].get());
+			}
+
+			this->call_property_changing(args);
+			for (size_t i = index; i < index + count; i++)
+				this->parent_i::clear_parent(children[i].get());
+			result.reserve(count);
+			ops::erase (children, index, count, result);
+			this->call_property_changed(args);
+
+			std::vector<size_t> indexes (count);
+			std::iota (indexes.begin(), indexes.end(), index);
+			this->on_children_removed (indexes, result);
+			for (size_t i = count; i-- > 0; )
+				this->parent_i::call_removed_from_parent(result[i].get());
+
+			return result;
+		}
+
+		void clear()
+		{
+			remove_range (0, children_store().size());
+		}
+
+		// Moves the child at index "from" so that it ends up at index "to", shifting the children in between by one.
+		// Raises property_changing / property_changed with collection_property_change_type::move, for the range between the two indexes.
+		void move (size_t from, size_t to)
+		{
+			auto& children = children_store();
+			assert ((from < children.size()) && (to < children.size()));
+			if (from == to)
+				return;
+
+			size_t index = std::min(from, to);
+			size_t count = std::max(from, to) - index + 1;
+			property_change_args args = { this->collection_property(), index, count, collection_property_change_type::move };
+
+			this->call_property_changing(args);
+			ops::move (children, from, to);
+			this->on_children_reordered (index, count);
+			this->call_property_changed(args);
+		}
+
+		// Rearranges the order.size() children starting at "index", so that the child at index + i
+		// is the one that was at index + order[i]. "order" must be a permutation of 0 .. order.size() - 1.
+		// Raises a single pair of property_changing / property_changed with collection_property_change_type::move.
+		virtual void reorder (size_t index, std::span<const size_t> order) override final
+		{
+			auto& children = children_store();
+			size_t count = order.size();
+			assert (index + count <= children.size());
+			if (count == 0)
+				return;
+
+			property_change_args args = { this->collection_property(), index, count, collection_property_change_type::move };
+
+			this->call_property_changing(args);
+			std::vector<std::unique_ptr<child_t>> reordered;
+			reordered.reserve(count);
+			for (size_t i : order)
+			{
+				assert ((i < count) && children[index + i]);
+				reordered.push_back(std::move(children[index + i]));
+			}
+			for (size_t i = 0; i < count; i++)
+				children[index + i] = std::move(reordered[i]);
+			this->on_children_reordered (index, count);
+			this->call_property_changed(args);
+		}
+
 		std::unique_ptr<child_t> remove_last()
 		{
 			return remove(children_store().size() - 1);
@@ -114,27 +362,138 @@ namespace edge
 
 		std::unique_ptr<child_t> remove(child_t* child)
 		{
-			auto& children = this->children();
-			for (size_t i = 0; i < children.size(); i++)
+			return remove(index_of(child));
+		}
+
+		// Removes several children at once, returning them in the order they had in the collection.
+		//
+		// Each contiguous run of children to remove is taken out with remove_range, so observers see
+		// only range removals, each with its own property_changing / property_changed pair. The runs are removed
+		// from the last one to the first, which keeps the indexes of the ones not yet removed valid.
+		// When the store moves the children after each removed run (std::vector) and there are many short runs that would
+		// move the same children over and over, the children between the first and the last removed one are first reordered
+		// (one "move" notification) so that those to remove come last, and then all are removed with a single remove_range;
+		// this moves every child at most a few times.
+		std::vector<std::unique_ptr<child_t>> remove (std::span<child_t* const> children_to_remove)
+		{
+			auto& children = children_store();
+
+			std::vector<size_t> indexes;
+			indexes.reserve(children_to_remove.size());
+			for (auto child : children_to_remove)
+				indexes.push_back(index_of(child));
+			std::sort (indexes.begin(), indexes.end());
+			assert (std::adjacent_find(indexes.begin(), indexes.end()) == indexes.end());
+
+			std::vector<std::unique_ptr<child_t>> result;
+			if (indexes.empty())
+				return result;
+
+			// Runs as (first index in "indexes", length), and the number of children each approach would move.
+			std::vector<std::pair<size_t, size_t>> runs;
+			for (size_t i = 0; i < indexes.size(); )
 			{
-				if (children[i].get() == child)
-					return remove(i);
+				size_t length = 1;
+				while ((i + length < indexes.size()) && (indexes[i + length] == indexes[i] + length))
+					length++;
+				runs.push_back ({ i, length });
+				i += length;
 			}
 
-			assert(false); return nullptr;
+			size_t size = children.size();
+			size_t run_moves = 0;
+			for (auto& run : runs)
+				run_moves += size - indexes[run.first] - run.second - (indexes.size() - run.first - run.second);
+			size_t span = indexes.back() + 1 - indexes.front();
+			size_t reorder_moves = 2 * span + (size - indexes.back() - 1);
+
+			if (!ops::erase_moves_tail || (run_moves <= reorder_moves))
+			{
+				result.resize(indexes.size());
+				for (size_t r = runs.size(); r-- > 0; )
+				{
+					auto removed = remove_range (indexes[runs[r].first], runs[r].second);
+					std::move (removed.begin(), removed.end(), result.begin() + runs[r].first);
+				}
+
+				return result;
+			}
+
+			size_t first = indexes.front();
+			std::vector<size_t> order;
+			order.reserve(span);
+			size_t next = 0;
+			for (size_t i = 0; i < span; i++)
+			{
+				if ((next < indexes.size()) && (indexes[next] == first + i))
+					next++;
+				else
+					order.push_back(i);
+			}
+			for (size_t i : indexes)
+				order.push_back(i - first);
+
+			reorder (first, order);
+			return remove_range (first + span - indexes.size(), indexes.size());
+		}
+
+		size_t index_of (const child_t* child) const
+		{
+			size_t index = find_index(child);
+			assert (index != (size_t)-1);
+			return index;
+		}
+	};
+
+	// Object collection that remembers the index of each child, so that index_of and remove(child_t*) don't scan the children.
+	// Indexes are renumbered lazily: an insertion or removal only marks the indexes after it as stale, and the next lookup
+	// of a child with a stale index renumbers the stale part once. Appending keeps all indexes valid.
+	//
+	// A class that derives from this and overrides on_child_inserted, on_child_removed or on_children_reordered must call the base class functions.
+	template<typename child_t, typename store_t = std::vector<std::unique_ptr<child_t>>>
+	struct indexed_object_collection_i : typed_object_collection_i<child_t, store_t>
+	{
+	private:
+		mutable std::unordered_map<const child_t*, size_t> _indexes;
+		mutable size_t _valid_count = 0; // children at indexes below this one have their index in _indexes up to date
+
+	protected:
+		virtual void on_child_inserted (size_t index, child_t* child) override
+		{
+			_indexes.insert({ child, index });
+			// Children before the new one didn't move, so if they were up to date, they still are, and so is the new one.
+			if (_valid_count >= index)
+				_valid_count = index + 1;
 		}
 
-		size_t index_of (child_t* child) const
+		virtual void on_child_removed (size_t index, child_t* child) override
 		{
+			_indexes.erase(child);
+			_valid_count = std::min (_valid_count, index);
+		}
+
+		virtual void on_children_reordered (size_t index, size_t count) override
+		{
+			_valid_count = std::min (_valid_count, index);
+		}
+
+		virtual size_t find_index (const child_t* child) const override
+		{
+			auto it = _indexes.find(child);
+			if (it == _indexes.end())
+				return -1;
+
+			// A stale index can be anything, below _valid_count included, so an index below it is trusted
+			// only if it leads back to the child.
 			auto& children = this->children();
-			for (size_t i = 0; i < children.size(); i++)
+			if ((it->second >= _valid_count) || (children[it->second].get() != child))
 			{
-				if (children[i].get() == child)
-					return i;
+				for (size_t i = _valid_count; i < children.size(); i++)
+					_indexes.find(children[i].get())->second = i;
+				_valid_count = children.size();
 			}
 
-			assert(false);
-			return -1;
+			return it->second;
 		}
 	};
 
@@ -158,12 +517,12 @@ namespace edge
 		const object_collection_i* collection_cast (const object* obj) const { return collection_cast(const_cast<object*>(obj)); }
 	};
 
-	template<typename child_t>
+	template<typename child_t, typename store_t>
 	struct typed_object_collection_property : object_collection_property
 	{
 		using base = object_collection_property;
 
-		using collection_getter_t = typed_object_collection_i<child_t>*(*)(object* obj);
+		using collection_getter_t = typed_object_collection_i<child_t, store_t>*(*)(object* obj);
 
 		collection_getter_t const _collection_getter;
 
@@ -175,12 +534,12 @@ namespace edge
 			static_assert (std::is_base_of<object, child_t>::value);
 		}
 
-		virtual typed_object_collection_i<child_t>* collection_cast(object* obj) const override
+		virtual typed_object_collection_i<child_t, store_t>* collection_cast(object* obj) const override
 		{
 			return _collection_getter(obj);
 		}
 
-		const typed_object_collection_i<child_t>* collection_cast(const object* obj) const
+		const typed_object_collection_i<child_t, store_t>* collection_cast(const object* obj) const
 		{
 			return _collection_getter(const_cast<object*>(obj));
 		}
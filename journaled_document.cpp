@@ -0,0 +1,493 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "journaled_document.h"
+#include <fstream>
+#include <cstring>
+
+namespace edge
+{
+	// File layout: magic, format version (varint), snapshot size (varint), snapshot, then the batches.
+	// A batch is: size of the records (uint32), FNV-1a hash of the records (uint32), records.
+	// Each record is: kind, object id, property index in the object's type::property_list(), then what's listed below.
+	static constexpr uint8_t journal_magic[4] = { 'E', 'D', 'G', 'J' };
+	static constexpr uint64_t journal_format_version = 1;
+	static constexpr size_t batch_header_size = 8;
+
+	enum class journal_record_kind : uint8_t
+	{
+		value_set,                // value
+		value_collection_set,     // index, value
+		value_collection_insert,  // index, value
+		value_collection_remove,  // index
+		object_collection_insert, // index, count, then "count" length-prefixed subtrees
+		object_collection_remove, // index, count
+		object_collection_move,   // index, count, then for each new position the old position relative to the index (see object_collection_i::reorder)
+		object_set,               // length-prefixed subtree, empty for null
+	};
+
+	static uint32_t fnv1a (const uint8_t* data, size_t size)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ data[i]) * 16777619u;
+		return hash;
+	}
+
+	static void write_uint32 (out_stream_i* to, uint32_t value)
+	{
+		uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+		to->write (bytes, sizeof(bytes));
+	}
+
+	static uint32_t read_uint32 (const uint8_t* p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	struct ofstream_out_stream : out_stream_i
+	{
+		std::ofstream& file;
+
+		using out_stream_i::write;
+
+		ofstream_out_stream (std::ofstream& file)
+			: file(file)
+		{ }
+
+		virtual void write (const void* data, size_t size) override
+		{
+			file.write (static_cast<const char*>(data), (std::streamsize)size);
+		}
+	};
+
+	// ========================================================================
+
+	struct journaled_document::impl : tree_observer
+	{
+		std::filesystem::path const _path;
+		size_t const _batch_size;
+		std::ofstream _file;
+		uint64_t _snapshot_size = 0;
+		uint64_t _journal_size = 0;
+		vector_out_stream _batch;
+		bool _replaying = false;
+		bool _must_compact = false; // set by changes that the journal can't replay correctly
+
+		std::unordered_map<const object*, uint64_t> _ids;
+		std::vector<object*> _objects; // indexed by id; null for objects that left the tree
+
+		std::vector<const object*> _moved_children; // stack of children orders captured in property_changing, for moves
+		std::vector<size_t> _moved_children_starts;
+
+		impl (const std::filesystem::path& path, object* root, size_t batch_size)
+			: tree_observer(root), _path(path), _batch_size(batch_size)
+		{
+			start();
+		}
+
+		~impl()
+		{
+			_file.exceptions (std::ios::goodbit); // not from a destructor
+			write_batch();
+		}
+
+		void open_for_append()
+		{
+			_file.open (_path, std::ios::binary | std::ios::app);
+			_file.exceptions (std::ios::failbit | std::ios::badbit);
+		}
+
+		// "from" is just past the snapshot.
+		void replay (binary_reader& from, std::span<const concrete_type* const> known_types)
+		{
+			_replaying = true;
+			try
+			{
+				while (from.remaining() >= batch_header_size)
+				{
+					uint32_t size = read_uint32(from.ptr);
+					uint32_t hash = read_uint32(from.ptr + 4);
+					if ((size > from.remaining() - batch_header_size) || (fnv1a(from.ptr + batch_header_size, size) != hash))
+						break;
+
+					from.ptr += batch_header_size;
+					binary_reader records = { from.ptr, from.ptr + size };
+					while (records.remaining())
+						apply (records, known_types);
+					from.ptr += size;
+					_journal_size += batch_header_size + size;
+				}
+			}
+			catch (...)
+			{
+				_replaying = false;
+				throw;
+			}
+
+			_replaying = false;
+
+			// Whatever follows the last good batch was being written when the process ended; we'll append after that.
+			if (from.remaining())
+				std::filesystem::resize_file (_path, std::filesystem::file_size(_path) - from.remaining());
+
+			open_for_append();
+		}
+
+		void write_batch()
+		{
+			auto& records = _batch.buffer;
+			if (records.empty() || !_file.is_open())
+				return;
+
+			ofstream_out_stream s (_file);
+			write_uint32 (&s, (uint32_t)records.size());
+			write_uint32 (&s, fnv1a(records.data(), records.size()));
+			s.write (records.data(), records.size());
+			_journal_size += batch_header_size + records.size();
+			records.clear();
+		}
+
+		void save()
+		{
+			if (_must_compact || (_journal_size + _batch.buffer.size() > _snapshot_size))
+			{
+				compact();
+				return;
+			}
+
+			write_batch();
+			_file.flush();
+		}
+
+		void compact()
+		{
+			vector_out_stream snapshot;
+			serialize (root(), &snapshot);
+
+			auto temp_path = _path;
+			temp_path += ".tmp";
+			{
+				std::ofstream temp;
+				temp.exceptions (std::ios::failbit | std::ios::badbit);
+				temp.open (temp_path, std::ios::binary | std::ios::trunc);
+				ofstream_out_stream s (temp);
+				s.write (journal_magic, sizeof(journal_magic));
+				s.write_varint (journal_format_version);
+				s.write_varint (snapshot.buffer.size());
+				s.write (snapshot.buffer.data(), snapshot.buffer.size());
+			}
+
+			if (_file.is_open())
+				_file.close();
+			std::filesystem::rename (temp_path, _path);
+			open_for_append();
+
+			_snapshot_size = snapshot.buffer.size();
+			_journal_size = 0;
+			_batch.buffer.clear();
+			_must_compact = false;
+
+			// Number the objects again, the way they'll be numbered when the new snapshot is loaded.
+			_ids.clear();
+			_objects.clear();
+			assign_ids (root());
+		}
+
+		void assign_ids (object* obj)
+		{
+			add_id (obj);
+			for_each_child (obj, [this](object* child) { assign_ids(child); });
+		}
+
+		void add_id (object* obj)
+		{
+			_ids.insert({ obj, _objects.size() });
+			_objects.push_back(obj);
+		}
+
+		virtual void on_attached (object* obj) override
+		{
+			add_id (obj);
+		}
+
+		virtual void on_detaching (object* obj) override
+		{
+			auto it = _ids.find(obj);
+			_objects[it->second] = nullptr;
+			_ids.erase(it);
+		}
+
+		void write_record_header (journal_record_kind kind, const object* obj, const property* prop)
+		{
+			_batch.write ((uint8_t)kind);
+			_batch.write_varint (_ids.at(obj));
+			_batch.write_varint (obj->type()->property_index(prop));
+		}
+
+		void write_subtree (const object* obj)
+		{
+			vector_out_stream subtree;
+			if (obj != nullptr)
+				serialize (obj, &subtree);
+			_batch.write_varint (subtree.buffer.size());
+			_batch.write (subtree.buffer.data(), subtree.buffer.size());
+		}
+
+		void end_record()
+		{
+			if (_batch.buffer.size() >= _batch_size)
+				write_batch();
+		}
+
+		virtual void on_property_changing (object* obj, const property_change_args& args) override
+		{
+			if (_replaying)
+				return;
+
+			if (dynamic_cast<const object_collection_property*>(args.property) && (args.type == collection_property_change_type::move))
+			{
+				auto collection = static_cast<const object_collection_property*>(args.property)->collection_cast(obj);
+				_moved_children_starts.push_back(_moved_children.size());
+				for (size_t i = args.index; i < args.index + args.count; i++)
+					_moved_children.push_back(collection->child_at(i));
+			}
+		}
+
+		virtual void on_property_changed (object* obj, const property_change_args& args) override
+		{
+			if (_replaying)
+				return;
+
+			if (auto vp = dynamic_cast<const value_property*>(args.property))
+			{
+				write_record_header (journal_record_kind::value_set, obj, vp);
+				vp->serialize (obj, &_batch);
+			}
+			else if (auto vc_prop = dynamic_cast<const value_collection_property*>(args.property))
+			{
+				auto kind = (args.type == collection_property_change_type::set) ? journal_record_kind::value_collection_set
+					: (args.type == collection_property_change_type::insert) ? journal_record_kind::value_collection_insert
+					: journal_record_kind::value_collection_remove;
+				write_record_header (kind, obj, vc_prop);
+				_batch.write_varint (args.index);
+				if (kind != journal_record_kind::value_collection_remove)
+					vc_prop->get_value (obj, args.index, &_batch);
+			}
+			else if (auto oc_prop = dynamic_cast<const object_collection_property*>(args.property))
+			{
+				auto collection = oc_prop->collection_cast(obj);
+				if (args.type == collection_property_change_type::insert)
+				{
+					write_record_header (journal_record_kind::object_collection_insert, obj, oc_prop);
+					_batch.write_varint (args.index);
+					_batch.write_varint (args.count);
+					for (size_t i = args.index; i < args.index + args.count; i++)
+						write_subtree (collection->child_at(i));
+				}
+				else if (args.type == collection_property_change_type::move)
+				{
+					size_t start = _moved_children_starts.back();
+					_moved_children_starts.pop_back();
+					assert (_moved_children.size() - start == args.count);
+					std::unordered_map<const object*, size_t> old_indexes;
+					for (size_t i = 0; i < args.count; i++)
+						old_indexes.insert({ _moved_children[start + i], i });
+					_moved_children.resize(start);
+
+					write_record_header (journal_record_kind::object_collection_move, obj, oc_prop);
+					_batch.write_varint (args.index);
+					_batch.write_varint (args.count);
+					for (size_t i = args.index; i < args.index + args.count; i++)
+						_batch.write_varint (old_indexes.at(collection->child_at(i)));
+				}
+				else
+				{
+					write_record_header (journal_record_kind::object_collection_remove, obj, oc_prop);
+					_batch.write_varint (args.index);
+					_batch.write_varint (args.count);
+				}
+			}
+			else if (auto obj_prop = dynamic_cast<const object_property*>(args.property))
+			{
+				write_record_header (journal_record_kind::object_set, obj, obj_prop);
+				write_subtree (obj_prop->get(obj));
+			}
+			else
+			{
+				// Not something we know how to replay; the next save writes a snapshot instead.
+				_must_compact = true;
+				return;
+			}
+
+			end_record();
+		}
+
+		static binary_reader read_blob (binary_reader& from)
+		{
+			size_t size = (size_t)from.read_varint();
+			auto data = from.read_bytes(size);
+			return { data, data + size };
+		}
+
+		void apply (binary_reader& from, std::span<const concrete_type* const> known_types)
+		{
+			auto kind = (journal_record_kind)from.read_uint8();
+			uint64_t id = from.read_varint();
+			if ((id >= _objects.size()) || (_objects[id] == nullptr))
+				throw binary_read_exception("Invalid object id in journal.");
+			object* obj = _objects[(size_t)id];
+
+			auto props = obj->type()->property_list();
+			uint64_t prop_index = from.read_varint();
+			if (prop_index >= props.size())
+				throw binary_read_exception("Invalid property reference.");
+			auto prop = props[(size_t)prop_index];
+
+			auto check_kind = [](bool ok)
+			{
+				if (!ok)
+					throw binary_read_exception("Property kind mismatch.");
+			};
+
+			switch (kind)
+			{
+				case journal_record_kind::value_set:
+				{
+					auto vp = dynamic_cast<const value_property*>(prop);
+					check_kind (vp != nullptr);
+					vp->deserialize (from, obj);
+					break;
+				}
+
+				case journal_record_kind::value_collection_set:
+				case journal_record_kind::value_collection_insert:
+				case journal_record_kind::value_collection_remove:
+				{
+					auto vc_prop = dynamic_cast<const value_collection_property*>(prop);
+					check_kind (vc_prop != nullptr);
+					size_t index = (size_t)from.read_varint();
+					if (kind == journal_record_kind::value_collection_set)
+						vc_prop->set_value (from, obj, index);
+					else if (kind == journal_record_kind::value_collection_insert)
+						vc_prop->insert_value (from, obj, index);
+					else
+						vc_prop->remove_value (obj, index);
+					break;
+				}
+
+				case journal_record_kind::object_collection_insert:
+				case journal_record_kind::object_collection_remove:
+				case journal_record_kind::object_collection_move:
+				{
+					auto oc_prop = dynamic_cast<const object_collection_property*>(prop);
+					check_kind (oc_prop != nullptr);
+					auto collection = oc_prop->collection_cast(obj);
+					size_t index = (size_t)from.read_varint();
+					size_t count = (size_t)from.read_varint();
+					if ((kind != journal_record_kind::object_collection_insert) && ((index > collection->child_count()) || (count > collection->child_count() - index)))
+						throw binary_read_exception("Collection index out of range.");
+
+					if (kind == journal_record_kind::object_collection_insert)
+					{
+						for (size_t i = 0; i < count; i++)
+						{
+							auto subtree = read_blob(from);
+							collection->insert (index + i, deserialize(subtree, known_types));
+						}
+					}
+					else if (kind == journal_record_kind::object_collection_remove)
+					{
+						for (size_t i = index + count; i-- > index; )
+							collection->remove_object(i);
+					}
+					else
+					{
+						if (count > from.remaining())
+							throw binary_read_exception("Unexpected end of binary data.");
+						std::vector<size_t> order (count);
+						for (size_t i = 0; i < count; i++)
+							order[i] = (size_t)from.read_varint();
+						collection->reorder (index, order);
+					}
+					break;
+				}
+
+				case journal_record_kind::object_set:
+				{
+					auto obj_prop = dynamic_cast<const object_property*>(prop);
+					check_kind (obj_prop != nullptr);
+					auto subtree = read_blob(from);
+					obj_prop->set (obj, subtree.remaining() ? deserialize(subtree, known_types) : nullptr);
+					break;
+				}
+
+				default:
+					throw binary_read_exception("Unknown journal record.");
+			}
+		}
+	};
+
+	// ========================================================================
+
+	static std::vector<uint8_t> read_file (const std::filesystem::path& path)
+	{
+		std::ifstream file;
+		file.exceptions (std::ios::failbit | std::ios::badbit);
+		file.open (path, std::ios::binary);
+		std::vector<uint8_t> data ((size_t)std::filesystem::file_size(path));
+		file.read (reinterpret_cast<char*>(data.data()), (std::streamsize)data.size());
+		return data;
+	}
+
+	journaled_document::journaled_document (const std::filesystem::path& path, std::span<const concrete_type* const> known_types, size_t batch_size)
+		: _loaded(read_file(path))
+	{
+		binary_reader from = { _loaded.data(), _loaded.data() + _loaded.size() };
+		if (memcmp(from.read_bytes(sizeof(journal_magic)), journal_magic, sizeof(journal_magic)) != 0)
+			throw binary_read_exception("Not an edge journaled document.");
+		if (from.read_varint() != journal_format_version)
+			throw binary_read_exception("Unsupported journaled document version.");
+
+		uint64_t snapshot_size = from.read_varint();
+		if (snapshot_size > from.remaining())
+			throw binary_read_exception("Unexpected end of binary data.");
+		binary_reader snapshot = { from.ptr, from.ptr + snapshot_size };
+		from.ptr += snapshot_size;
+		_root = deserialize (snapshot, known_types);
+
+		_impl = std::make_unique<impl>(path, _root.get(), batch_size);
+		_impl->_snapshot_size = snapshot_size;
+		_impl->replay (from, known_types);
+	}
+
+	journaled_document::journaled_document (const std::filesystem::path& path, std::unique_ptr<object>&& root, size_t batch_size)
+		: _root(std::move(root))
+		, _impl(std::make_unique<impl>(path, _root.get(), batch_size))
+	{
+		_impl->compact();
+	}
+
+	journaled_document::~journaled_document() = default;
+
+	void journaled_document::save()
+	{
+		_impl->save();
+	}
+
+	void journaled_document::compact()
+	{
+		_impl->compact();
+	}
+
+	uint64_t journaled_document::snapshot_size() const
+	{
+		return _impl->_snapshot_size;
+	}
+
+	uint64_t journaled_document::journal_size() const
+	{
+		return _impl->_journal_size;
+	}
+}
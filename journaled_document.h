@@ -0,0 +1,63 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "binary_serializer.h"
+#include <filesystem>
+
+namespace edge
+{
+	// Document file made of a snapshot of an object tree (a binary document, see binary_serializer.h) followed by a journal
+	// of the changes made to the tree since the snapshot. Saving appends the changes made since the previous save, so it costs
+	// in proportion to how much changed rather than to the size of the document; opening loads the snapshot and replays the journal.
+	//
+	// Changes are recorded by observing the tree's notifications, like undo_history does: value property sets,
+	// value collection sets, inserts and removes, object collection inserts, removes and moves, and object property sets.
+	// A record holds the id of the object, the index of the property in the object's type::property_list(), and the new value,
+	// the collection index, or the binary image of the inserted subtree. Objects get ids in the order they join the tree:
+	// the snapshot's objects in preorder, then inserted objects as they are inserted. Replaying the records inserts objects
+	// in the same order, so it gives them the same ids. For this to work every change to the tree must be recorded,
+	// that is, made through setters that raise property change notifications.
+	//
+	// Records are collected in memory and appended to the file in batches: when batch_size bytes have accumulated, and on save().
+	// Each batch is written with its size and a checksum. When opening, a batch found incomplete or damaged (because the process
+	// ended while writing it, say) is discarded together with what follows it, and the file is cut back to the last good batch.
+	//
+	// The file is only ever appended to, except by compact(), which writes a snapshot of the whole tree with an empty journal
+	// to a temporary file and renames it over the document. save() compacts by itself when the journal has grown bigger
+	// than the snapshot, at which point replaying the journal would take longer than loading a new snapshot.
+	//
+	// Saved data is handed to the operating system but not flushed to the disk, so a save survives the process ending,
+	// but not necessarily a power loss.
+	class journaled_document
+	{
+		struct impl;
+		std::vector<uint8_t> _loaded;  // the file as it was when opened; backed_string_p values loaded from it point into it
+		std::unique_ptr<object> _root;
+		std::unique_ptr<impl> _impl;   // declared last so that it stops observing the tree before the tree is destroyed
+
+	public:
+		// Opens an existing document. Throws binary_read_exception if the file is not such a document,
+		// or std::ios_base::failure if it can't be read or written.
+		journaled_document (const std::filesystem::path& path, std::span<const concrete_type* const> known_types, size_t batch_size = 1024 * 1024);
+
+		// Creates a document with a snapshot of "root", replacing the file at "path" if there is one.
+		journaled_document (const std::filesystem::path& path, std::unique_ptr<object>&& root, size_t batch_size = 1024 * 1024);
+
+		// Writes the records not written yet, without compacting.
+		~journaled_document();
+
+		journaled_document (const journaled_document&) = delete;
+		journaled_document& operator= (const journaled_document&) = delete;
+
+		object* root() const { return _root.get(); }
+
+		void save();
+		void compact();
+
+		// Sizes in the file, in bytes. The journal size doesn't include the records not written yet.
+		uint64_t snapshot_size() const;
+		uint64_t journal_size() const;
+	};
+}
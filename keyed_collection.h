@@ -0,0 +1,229 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "collections.h"
+
+namespace edge
+{
+	// What a keyed_object_collection_i does when two of its children would have the same key.
+	enum class duplicate_key_policy
+	{
+		// Inserting a child whose key is already in the collection throws duplicate_key_exception from on_child_inserting,
+		// before the collection changes; so does keyed_object_collection_i::set_key, before the key changes.
+		// A key changed by calling the key property's setter directly can't be rejected, since the collection only learns
+		// of the new key after it was set and other observers were told about it; such duplicates are reported
+		// as with the "report" policy. So are duplicates among the children inserted with a single insert_range,
+		// which are checked against the collection but not against each other.
+		reject,
+
+		// Duplicates are allowed; each one is reported by calling on_duplicate_key, and find returns any one of the children with that key.
+		report,
+	};
+
+	class duplicate_key_exception : public std::exception
+	{
+	public:
+		virtual const char* what() const noexcept override { return "Duplicate key in keyed collection."; }
+	};
+
+	// Key of the index of a collection with string keys. Keys in the index own their characters; keys made for
+	// a lookup only refer to the caller's, so that finding a child allocates nothing. (std::unordered_multimap
+	// can look up by std::string_view directly only from C++20 on, with a transparent hash.)
+	class string_index_key
+	{
+		std::string _owned;
+		std::string_view _view; // into _owned, or into the caller's characters for lookup keys
+
+		string_index_key() = default;
+
+	public:
+		explicit string_index_key (std::string&& owned)
+			: _owned(std::move(owned)), _view(_owned)
+		{ }
+
+		static string_index_key lookup (std::string_view view)
+		{
+			string_index_key key;
+			key._view = view;
+			return key;
+		}
+
+		string_index_key (string_index_key&& other) noexcept
+		{
+			bool owning = (other._view.data() == other._owned.data());
+			_owned = std::move(other._owned);
+			_view = owning ? std::string_view(_owned) : other._view;
+		}
+
+		string_index_key (const string_index_key&) = delete;
+		string_index_key& operator= (const string_index_key&) = delete;
+
+		bool operator== (const string_index_key& other) const { return _view == other._view; }
+
+		struct hash
+		{
+			size_t operator() (const string_index_key& key) const { return std::hash<std::string_view>()(key._view); }
+		};
+	};
+
+	template<typename child_t, typename key_traits, typename store_t = std::vector<std::unique_ptr<child_t>>>
+	struct keyed_object_collection_property : typed_object_collection_property<child_t, store_t>
+	{
+		using base = typed_object_collection_property<child_t, store_t>;
+
+		const typed_value_property<key_traits>* const key_property;
+		duplicate_key_policy const duplicates;
+
+		constexpr keyed_object_collection_property (const char* name, const property_group* group, const char* description,
+			bool preallocated, typename base::collection_getter_t collection_getter,
+			const typed_value_property<key_traits>* key_property, duplicate_key_policy duplicates = duplicate_key_policy::reject)
+			: base (name, group, description, preallocated, collection_getter)
+			, key_property(key_property)
+			, duplicates(duplicates)
+		{ }
+	};
+
+	// Object collection that finds children by the value of a key property (a name, an ID) in constant time, using a hash index.
+	// The key property and the duplicate policy come from the collection property, which must be a keyed_object_collection_property.
+	// The index follows key changes through the property_changing / property_changed events of the children,
+	// so the key property's setter must raise them, as setters usually do. The collection holds the child store itself,
+	// so that it can unsubscribe from the children before they are destroyed.
+	//
+	// A class that derives from this and overrides on_child_inserting, on_child_inserted or on_child_removing must call the base class functions.
+	template<typename child_t, typename key_traits, typename store_t = std::vector<std::unique_ptr<child_t>>>
+	struct keyed_object_collection_i : typed_object_collection_i<child_t, store_t>
+	{
+		using key_value_t = typename key_traits::value_t;
+
+	private:
+		static constexpr bool string_keys = std::is_same_v<key_value_t, std::string_view> || std::is_same_v<key_value_t, std::string>;
+
+		// Index keys own their characters, since a std::string_view key (backed_string_property_traits) points into the child.
+		using key_t = std::conditional_t<string_keys, string_index_key, key_value_t>;
+		using key_hash_t = std::conditional_t<string_keys, string_index_key::hash, std::hash<key_t>>;
+
+	public:
+		// Keys that find() and contains() take; std::string_view for string keys.
+		using lookup_t = std::conditional_t<string_keys, std::string_view, key_value_t>;
+
+	private:
+		store_t _children;
+		std::unordered_multimap<key_t, child_t*, key_hash_t> _index;
+
+		virtual store_t& children_store() override final { return _children; }
+
+		virtual const keyed_object_collection_property<child_t, key_traits, store_t>* collection_property() const override = 0;
+
+		const typed_value_property<key_traits>* key_property() const { return this->collection_property()->key_property; }
+
+		key_t key_of (const child_t* child) const
+		{
+			if constexpr (string_keys)
+				return key_t(std::string(key_property()->get(child)));
+			else
+				return key_property()->get(child);
+		}
+
+		// Key for looking up "key" in the index; for string keys it refers to the characters of "key".
+		static key_t lookup_key (lookup_t key)
+		{
+			if constexpr (string_keys)
+				return string_index_key::lookup(key);
+			else
+				return key;
+		}
+
+		// Index entry of "child", which is currently in the index under "key".
+		typename std::unordered_multimap<key_t, child_t*, key_hash_t>::iterator entry_of (lookup_t key, const child_t* child)
+		{
+			auto [begin, end] = _index.equal_range(lookup_key(key));
+			auto it = std::find_if (begin, end, [child](auto& entry) { return entry.second == child; });
+			assert (it != end);
+			return it;
+		}
+
+		void add_to_index (key_t&& key, child_t* child)
+		{
+			auto it = _index.find(key);
+			child_t* existing = (it != _index.end()) ? it->second : nullptr;
+			_index.emplace (std::move(key), child);
+			if (existing)
+				this->on_duplicate_key (child, existing);
+		}
+
+		void on_child_property_changing (object* obj, const property_change_args& args)
+		{
+			if (args.property != key_property())
+				return;
+
+			auto child = static_cast<child_t*>(obj);
+			key_value_t key = key_property()->get(child);
+			_index.erase (entry_of(key, child));
+		}
+
+		void on_child_property_changed (object* obj, const property_change_args& args)
+		{
+			if (args.property != key_property())
+				return;
+
+			add_to_index (key_of(static_cast<child_t*>(obj)), static_cast<child_t*>(obj));
+		}
+
+	protected:
+		// Called when "child" gets the same key as "existing", with the "report" policy, and with the "reject" policy
+		// for duplicates that can't be rejected (see duplicate_key_policy::reject).
+		virtual void on_duplicate_key (child_t* child, child_t* existing) { }
+
+		virtual void on_child_inserting (size_t index, child_t* child) override
+		{
+			if ((this->collection_property()->duplicates == duplicate_key_policy::reject) && contains(key_property()->get(child)))
+				throw duplicate_key_exception();
+		}
+
+		virtual void on_child_inserted (size_t index, child_t* child) override
+		{
+			add_to_index (key_of(child), child);
+			child->property_changing().template add_handler<&keyed_object_collection_i::on_child_property_changing>(this);
+			child->property_changed().template add_handler<&keyed_object_collection_i::on_child_property_changed>(this);
+		}
+
+		virtual void on_child_removing (size_t index, child_t* child) override
+		{
+			child->property_changed().template remove_handler<&keyed_object_collection_i::on_child_property_changed>(this);
+			child->property_changing().template remove_handler<&keyed_object_collection_i::on_child_property_changing>(this);
+			key_value_t key = key_property()->get(child);
+			_index.erase (entry_of(key, child));
+		}
+
+	public:
+		~keyed_object_collection_i()
+		{
+			for (auto& c : _children)
+			{
+				c->property_changed().template remove_handler<&keyed_object_collection_i::on_child_property_changed>(this);
+				c->property_changing().template remove_handler<&keyed_object_collection_i::on_child_property_changing>(this);
+			}
+		}
+
+		// Returns a child with the given key, or nullptr if there's none.
+		child_t* find (lookup_t key) const
+		{
+			auto it = _index.find(lookup_key(key));
+			return (it != _index.end()) ? it->second : nullptr;
+		}
+
+		bool contains (lookup_t key) const { return _index.find(lookup_key(key)) != _index.end(); }
+
+		// Sets the key of "child", which must be in this collection, through the key property.
+		// With the "reject" policy, throws duplicate_key_exception if another child has "key", before anything changes.
+		void set_key (child_t* child, key_value_t key)
+		{
+			if ((this->collection_property()->duplicates == duplicate_key_policy::reject) && (key_property()->get(child) != key) && contains(key))
+				throw duplicate_key_exception();
+
+			key_property()->set (std::move(key), child);
+		}
+	};
+}
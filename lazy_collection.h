@@ -0,0 +1,452 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "binary_serializer.h"
+#include <list>
+#include <cstring>
+
+namespace edge
+{
+	template<typename child_t>
+	struct lazy_object_collection_i;
+
+	// Child store of lazy_object_collection_i. Children are kept in pages, as in segmented_child_store; a page read from
+	// a paged document starts out unloaded, knowing only how many children it has, and its children are read the first time
+	// any of them is accessed. Loaded pages that are unmodified are evicted, least recently used first, to keep
+	// the number of their children within the budget.
+	//
+	// A page becomes modified (and stays in memory until the collection is destroyed) when children are inserted into
+	// or removed from it, when one of its children raises property_changing, when the collection calls mark_modified,
+	// or when it's accessed through the non-const operator[], which typed_object_collection_i uses only while changing the collection.
+	// Nothing is evicted while the collection is observed by a tree_observer.
+	template<typename child_t>
+	class lazy_child_store
+	{
+		template<typename> friend struct lazy_object_collection_i;
+
+	public:
+		using value_type = std::unique_ptr<child_t>;
+
+		static constexpr size_t page_size = 256;
+
+	private:
+		struct page
+		{
+			size_t count = 0;
+			size_t file_index = 0; // index in the offset table of the first child; used only while the page is unmodified
+			std::vector<value_type> children; // empty while the page is not loaded
+			bool loaded = false;
+			bool modified = false;
+			typename std::list<page*>::iterator lru_position; // valid while loaded and unmodified
+		};
+
+		lazy_object_collection_i<child_t>* _owner = nullptr;
+		std::vector<std::unique_ptr<page>> _pages;
+		std::vector<size_t> _starts; // index of the first child of each page
+		size_t _size = 0;
+		size_t _budget = (size_t)-1;
+		size_t _observer_count = 0;
+		mutable std::list<page*> _lru; // loaded and unmodified pages, least recently used first
+		mutable size_t _lru_child_count = 0;
+		mutable std::unordered_map<const child_t*, page*> _page_of; // for loaded children
+
+		std::pair<size_t, size_t> locate (size_t index) const
+		{
+			assert (index <= _size);
+			if (index == _size)
+				return { _pages.size() - 1, _pages.back()->count };
+			size_t p = std::upper_bound (_starts.begin(), _starts.end(), index) - _starts.begin() - 1;
+			return { p, index - _starts[p] };
+		}
+
+		void update_starts (size_t from_page)
+		{
+			if (!_starts.empty())
+				_starts[0] = 0;
+			for (size_t p = std::max<size_t>(from_page, 1); p < _pages.size(); p++)
+				_starts[p] = _starts[p - 1] + _pages[p - 1]->count;
+		}
+
+		page* load (page* p) const
+		{
+			if (p->loaded)
+			{
+				if (!p->modified && (p != _lru.back()))
+					_lru.splice (_lru.end(), _lru, p->lru_position);
+				return p;
+			}
+
+			// Read all children before touching the page, so that it stays unloaded if reading throws.
+			std::vector<value_type> children;
+			children.reserve(p->count);
+			for (size_t i = 0; i < p->count; i++)
+				children.push_back(_owner->load_child(p->file_index + i));
+
+			p->children = std::move(children);
+			p->loaded = true;
+			for (auto& c : p->children)
+			{
+				_page_of.insert({ c.get(), p });
+				_owner->on_child_loaded(c.get());
+			}
+
+			p->lru_position = _lru.insert (_lru.end(), p);
+			_lru_child_count += p->count;
+			evict_over_budget();
+			return p;
+		}
+
+		void evict (page* p) const
+		{
+			assert (p->loaded && !p->modified);
+			_lru.erase (p->lru_position);
+			_lru_child_count -= p->count;
+			for (auto& c : p->children)
+			{
+				_owner->on_child_evicting(c.get());
+				_page_of.erase(c.get());
+			}
+
+			p->children.clear();
+			p->children.shrink_to_fit();
+			p->loaded = false;
+		}
+
+		// Never evicts the most recently used page, which is the one the caller is about to access.
+		void evict_over_budget() const
+		{
+			if (_observer_count > 0)
+				return;
+
+			while ((_lru_child_count > _budget) && (_lru.size() > 1))
+				evict(_lru.front());
+		}
+
+		void set_modified (page* p) const
+		{
+			if (!p->modified)
+			{
+				p->modified = true;
+				_lru.erase (p->lru_position);
+				_lru_child_count -= p->count;
+			}
+		}
+
+		page* modify (page* p)
+		{
+			load(p);
+			set_modified(p);
+			return p;
+		}
+
+		static std::unique_ptr<page> new_page()
+		{
+			auto p = std::make_unique<page>();
+			p->loaded = true;
+			p->modified = true;
+			return p;
+		}
+
+		// Splits an over-full page into pages of page_size children.
+		void split (size_t page_index)
+		{
+			page* p = _pages[page_index].get();
+			if (p->count <= 2 * page_size)
+				return;
+
+			std::vector<std::unique_ptr<page>> pieces;
+			for (size_t i = page_size; i < p->count; i += page_size)
+			{
+				size_t end = std::min (i + page_size, p->count);
+				auto piece = new_page();
+				piece->children.assign (std::make_move_iterator(p->children.begin() + i), std::make_move_iterator(p->children.begin() + end));
+				piece->count = piece->children.size();
+				for (auto& c : piece->children)
+					_page_of[c.get()] = piece.get();
+				pieces.push_back(std::move(piece));
+			}
+
+			p->children.resize(page_size);
+			p->count = page_size;
+
+			_pages.insert (_pages.begin() + page_index + 1, std::make_move_iterator(pieces.begin()), std::make_move_iterator(pieces.end()));
+			_starts.insert (_starts.begin() + page_index + 1, pieces.size(), 0);
+		}
+
+		void remove_page_if_empty (size_t page_index)
+		{
+			if (_pages[page_index]->count == 0)
+			{
+				_pages.erase (_pages.begin() + page_index);
+				_starts.erase (_starts.begin() + page_index);
+			}
+		}
+
+		void set_unloaded (lazy_object_collection_i<child_t>* owner, size_t count)
+		{
+			assert (_size == 0);
+			_owner = owner;
+			for (size_t i = 0; i < count; i += page_size)
+			{
+				auto p = std::make_unique<page>();
+				p->count = std::min (page_size, count - i);
+				p->file_index = i;
+				_starts.push_back(i);
+				_pages.push_back(std::move(p));
+			}
+
+			_size = count;
+		}
+
+		void set_budget (size_t budget)
+		{
+			_budget = budget;
+			evict_over_budget();
+		}
+
+		void add_observer() { _observer_count++; }
+
+		void remove_observer()
+		{
+			assert (_observer_count > 0);
+			if (--_observer_count == 0)
+				evict_over_budget();
+		}
+
+		void mark_modified (const child_t* child)
+		{
+			auto it = _page_of.find(child);
+			if (it != _page_of.end())
+				set_modified(it->second);
+		}
+
+	public:
+		size_t size() const { return _size; }
+		bool empty() const { return _size == 0; }
+
+		// Number of children currently in memory.
+		size_t loaded_count() const { return _page_of.size(); }
+
+		const value_type& operator[] (size_t index) const
+		{
+			auto [p, pos] = locate(index);
+			return load(_pages[p].get())->children[pos];
+		}
+
+		value_type& operator[] (size_t index)
+		{
+			auto [p, pos] = locate(index);
+			return modify(_pages[p].get())->children[pos];
+		}
+
+		const value_type& back() const { return (*this)[_size - 1]; }
+
+		void insert (size_t index, value_type&& child)
+		{
+			if (_pages.empty())
+			{
+				_pages.push_back(new_page());
+				_starts.push_back(0);
+			}
+
+			auto [p, pos] = locate(index);
+			page* pg = modify(_pages[p].get());
+			_page_of.insert({ child.get(), pg });
+			pg->children.insert (pg->children.begin() + pos, std::move(child));
+			pg->count++;
+			_size++;
+			split(p);
+			update_starts(p + 1);
+		}
+
+		void insert (size_t index, std::vector<value_type>&& children)
+		{
+			if (children.empty())
+				return;
+
+			if (_pages.empty())
+			{
+				_pages.push_back(new_page());
+				_starts.push_back(0);
+			}
+
+			auto [p, pos] = locate(index);
+			page* pg = modify(_pages[p].get());
+			for (auto& c : children)
+				_page_of.insert({ c.get(), pg });
+			pg->children.insert (pg->children.begin() + pos, std::make_move_iterator(children.begin()), std::make_move_iterator(children.end()));
+			pg->count += children.size();
+			_size += children.size();
+			split(p);
+			update_starts(p + 1);
+		}
+
+		value_type erase (size_t index)
+		{
+			assert (index < _size);
+			auto [p, pos] = locate(index);
+			page* pg = modify(_pages[p].get());
+			auto result = std::move(pg->children[pos]);
+			pg->children.erase (pg->children.begin() + pos);
+			pg->count--;
+			_page_of.erase(result.get());
+			_size--;
+			remove_page_if_empty(p);
+			update_starts(p);
+			return result;
+		}
+
+		void erase (size_t index, size_t count, std::vector<value_type>& erased)
+		{
+			assert (index + count <= _size);
+			if (count == 0)
+				return;
+
+			auto [first_page, pos] = locate(index);
+			size_t p = first_page;
+			while (count > 0)
+			{
+				page* pg = modify(_pages[p].get());
+				size_t n = std::min (count, pg->count - pos);
+				for (size_t i = pos; i < pos + n; i++)
+					_page_of.erase(pg->children[i].get());
+				erased.insert (erased.end(), std::make_move_iterator(pg->children.begin() + pos), std::make_move_iterator(pg->children.begin() + pos + n));
+				pg->children.erase (pg->children.begin() + pos, pg->children.begin() + pos + n);
+				pg->count -= n;
+				_size -= n;
+				count -= n;
+				if (pg->count == 0)
+					remove_page_if_empty(p);
+				else
+					p++;
+				pos = 0;
+			}
+
+			update_starts(first_page);
+		}
+
+		class const_iterator
+		{
+			const lazy_child_store* _store;
+			size_t _page;
+			size_t _pos;
+
+		public:
+			const_iterator (const lazy_child_store* store, size_t page, size_t pos)
+				: _store(store), _page(page), _pos(pos)
+			{ }
+
+			const value_type& operator*() const { return _store->load(_store->_pages[_page].get())->children[_pos]; }
+			const value_type* operator->() const { return &**this; }
+
+			const_iterator& operator++()
+			{
+				if (++_pos == _store->_pages[_page]->count)
+				{
+					_page++;
+					_pos = 0;
+				}
+				return *this;
+			}
+
+			bool operator== (const const_iterator& other) const { return (_page == other._page) && (_pos == other._pos); }
+			bool operator!= (const const_iterator& other) const { return !(*this == other); }
+		};
+
+		const_iterator begin() const { return { this, 0, 0 }; }
+		const_iterator end() const { return { this, _pages.size(), 0 }; }
+	};
+
+	// Object collection whose children, when loaded from a paged document (see paged_document in mapped_document.h),
+	// are read from the file only when accessed, and dropped again from memory when unmodified and over the budget.
+	// child_count() is known without reading any child. Collections not loaded from a paged document behave as any other.
+	//
+	// Pointers to children are valid as long as the child stays loaded: for an unmodified child, until the next access
+	// to some other child of the collection (which may load a page and evict the child's page). Code that keeps
+	// a pointer for longer, or that changes something below a child (a grandchild, say), must call mark_modified first.
+	// Serializing the tree reads all children, within the budget. A tree_observer (an undo_history, say) also reads
+	// all of them, and since it subscribes to each child, nothing is evicted for as long as it observes the collection,
+	// whatever the budget; eviction resumes when the last observer goes away.
+	//
+	// Evicted children are destroyed without any notification, so code other than a tree_observer must not subscribe
+	// to the events of unmodified children (or must call mark_modified before it does).
+	//
+	// A class that derives from this and overrides on_child_inserted or on_child_removing must call the base class functions.
+	template<typename child_t>
+	struct lazy_object_collection_i : typed_object_collection_i<child_t, lazy_child_store<child_t>>, lazy_collection_i
+	{
+		friend class lazy_child_store<child_t>;
+
+	private:
+		lazy_child_store<child_t> _children;
+		paged_binary_reader* _reader = nullptr;
+		const uint8_t* _offsets = nullptr;
+
+		virtual lazy_child_store<child_t>& children_store() override final { return _children; }
+
+		std::unique_ptr<child_t> load_child (size_t file_index)
+		{
+			uint64_t offset;
+			memcpy (&offset, _offsets + file_index * sizeof(uint64_t), sizeof(offset));
+			auto obj = _reader->read_object_at(offset);
+			return std::unique_ptr<child_t>(static_cast<child_t*>(obj.release()));
+		}
+
+		void on_child_loaded (child_t* child)
+		{
+			this->parent_i::set_parent(child);
+			child->property_changing().template add_handler<&lazy_object_collection_i::on_child_property_changing>(this);
+		}
+
+		// Only called while there are no tree_observers, so the collection's handler is the only one the child has.
+		void on_child_evicting (child_t* child)
+		{
+			child->property_changing().template remove_handler<&lazy_object_collection_i::on_child_property_changing>(this);
+			this->parent_i::clear_parent(child);
+		}
+
+		void on_child_property_changing (object* obj, const property_change_args& args)
+		{
+			_children.mark_modified(static_cast<child_t*>(obj));
+		}
+
+		virtual void set_lazy_source (paged_binary_reader* reader, const uint8_t* offsets, size_t count) override final
+		{
+			assert (_children.empty() && (_reader == nullptr));
+			_reader = reader;
+			_offsets = offsets;
+			_children.set_unloaded (this, count);
+		}
+
+		virtual void add_observer() override final { _children.add_observer(); }
+		virtual void remove_observer() override final { _children.remove_observer(); }
+
+	protected:
+		virtual void on_child_inserted (size_t index, child_t* child) override
+		{
+			child->property_changing().template add_handler<&lazy_object_collection_i::on_child_property_changing>(this);
+		}
+
+		virtual void on_child_removing (size_t index, child_t* child) override
+		{
+			child->property_changing().template remove_handler<&lazy_object_collection_i::on_child_property_changing>(this);
+		}
+
+	public:
+		~lazy_object_collection_i()
+		{
+			for (auto [child, page] : _children._page_of)
+				const_cast<child_t*>(child)->property_changing().template remove_handler<&lazy_object_collection_i::on_child_property_changing>(this);
+		}
+
+		// Maximum number of children of unmodified pages to keep in memory; -1 (the default) means no limit.
+		void set_memory_budget (size_t child_count) { _children.set_budget(child_count); }
+
+		// Keeps the child (and the other children of its page) in memory, and so "child" valid, until the collection is destroyed.
+		void mark_modified (const child_t* child) { _children.mark_modified(child); }
+
+		size_t loaded_child_count() const { return _children.loaded_count(); }
+	};
+}
@@ -0,0 +1,129 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "mapped_document.h"
+#include <system_error>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <cerrno>
+#endif
+
+namespace edge
+{
+	#ifdef _WIN32
+	mapped_file::mapped_file (const std::filesystem::path& path, bool sequential)
+	{
+		DWORD flags = sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+		HANDLE file = ::CreateFileW (path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::system_error(::GetLastError(), std::system_category());
+		_file_handle = file;
+
+		LARGE_INTEGER size;
+		if (!::GetFileSizeEx(file, &size))
+		{
+			auto error = ::GetLastError();
+			::CloseHandle(file);
+			throw std::system_error(error, std::system_category());
+		}
+
+		_size = (size_t)size.QuadPart;
+		if (_size == 0)
+			return; // CreateFileMapping fails for empty files
+
+		HANDLE mapping = ::CreateFileMappingW (file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			auto error = ::GetLastError();
+			::CloseHandle(file);
+			throw std::system_error(error, std::system_category());
+		}
+		_mapping_handle = mapping;
+
+		_data = static_cast<const uint8_t*>(::MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0));
+		if (_data == nullptr)
+		{
+			auto error = ::GetLastError();
+			::CloseHandle(mapping);
+			::CloseHandle(file);
+			throw std::system_error(error, std::system_category());
+		}
+	}
+
+	mapped_file::~mapped_file()
+	{
+		if (_data)
+			::UnmapViewOfFile(_data);
+		if (_mapping_handle)
+			::CloseHandle(_mapping_handle);
+		::CloseHandle(_file_handle);
+	}
+	#else
+	mapped_file::mapped_file (const std::filesystem::path& path, bool sequential)
+	{
+		int fd = ::open (path.c_str(), O_RDONLY);
+		if (fd == -1)
+			throw std::system_error(errno, std::generic_category());
+
+		struct stat st;
+		if (::fstat(fd, &st) == -1)
+		{
+			int error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category());
+		}
+
+		_size = (size_t)st.st_size;
+		if (_size > 0)
+		{
+			void* data = ::mmap (nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED)
+			{
+				int error = errno;
+				::close(fd);
+				throw std::system_error(error, std::generic_category());
+			}
+
+			::madvise (data, _size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+			_data = static_cast<const uint8_t*>(data);
+		}
+
+		// The mapping stays valid after the descriptor is closed.
+		::close(fd);
+	}
+
+	mapped_file::~mapped_file()
+	{
+		if (_data)
+			::munmap (const_cast<uint8_t*>(_data), _size);
+	}
+	#endif
+
+	// ========================================================================
+
+	mapped_document::mapped_document (const std::filesystem::path& path, std::span<const concrete_type* const> known_types)
+		: _file(path)
+	{
+		binary_reader reader = { _file.data(), _file.data() + _file.size() };
+		object_allocation_scope scope (&_arena);
+		_root = deserialize (reader, known_types);
+	}
+
+	// ========================================================================
+
+	paged_document::paged_document (const std::filesystem::path& path, std::span<const concrete_type* const> known_types)
+		: _file(path, false)
+		, _reader({ _file.data(), _file.size() }, known_types)
+	{
+		_root = _reader.read_root();
+	}
+}
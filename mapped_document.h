@@ -0,0 +1,80 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "binary_serializer.h"
+#include "object_allocators.h"
+#include <filesystem>
+
+namespace edge
+{
+	// Read-only memory mapping of a whole file. Throws std::system_error if the file can't be opened or mapped.
+	// "sequential" tells the OS whether the file will be read front to back, or in random places.
+	class mapped_file
+	{
+		const uint8_t* _data = nullptr;
+		size_t _size = 0;
+		#ifdef _WIN32
+		void* _file_handle = nullptr;
+		void* _mapping_handle = nullptr;
+		#endif
+
+	public:
+		mapped_file (const std::filesystem::path& path, bool sequential = true);
+		~mapped_file();
+
+		mapped_file (const mapped_file&) = delete;
+		mapped_file& operator= (const mapped_file&) = delete;
+
+		const uint8_t* data() const { return _data; }
+		size_t size() const { return _size; }
+	};
+
+	// Object tree loaded straight from a memory-mapped binary document (see binary_serializer.h).
+	// No copy of the file is made: backed_string_p values are deserialized as string_views that point
+	// into the mapping, which is why the mapping lives exactly as long as the document does.
+	// For the same reason, objects loaded from the file are allocated in an arena that is freed in bulk with the document;
+	// they must not be moved to another tree that outlives the document.
+	class mapped_document
+	{
+		mapped_file const _file;
+		object_arena _arena;
+		std::unique_ptr<object> _root; // declared after _file and _arena so that it is destroyed first
+
+	public:
+		mapped_document (const std::filesystem::path& path, std::span<const concrete_type* const> known_types);
+
+		mapped_document (const mapped_document&) = delete;
+		mapped_document& operator= (const mapped_document&) = delete;
+
+		object* root() const { return _root.get(); }
+
+		// True if "str" points into this document's mapping, i.e. it is only valid while the document is alive.
+		bool backs (std::string_view str) const
+		{
+			auto p = reinterpret_cast<const uint8_t*>(str.data());
+			return (p >= _file.data()) && (p + str.size() <= _file.data() + _file.size());
+		}
+	};
+
+	// Object tree opened from a document written by serialize_paged. Only the objects outside lazy collections
+	// (see lazy_collection.h) are read when opening; the children of lazy collections are read from the mapping when accessed.
+	// As with mapped_document, backed_string_p values point into the mapping, and the lazy collections read from it,
+	// so none of the objects may outlive the document. Objects are not allocated in an arena here, so that evicting
+	// the children of a lazy collection gives back their memory.
+	class paged_document
+	{
+		mapped_file const _file;
+		paged_binary_reader _reader;
+		std::unique_ptr<object> _root; // declared last so that it is destroyed first
+
+	public:
+		paged_document (const std::filesystem::path& path, std::span<const concrete_type* const> known_types);
+
+		paged_document (const paged_document&) = delete;
+		paged_document& operator= (const paged_document&) = delete;
+
+		object* root() const { return _root.get(); }
+	};
+}
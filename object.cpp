@@ -3,6 +3,10 @@
 // Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
 
 #include "object.h"
+#include <cstring>
+#include "collections.h"
+#include <unordered_map>
+#include <cstddef>
 
 namespace edge
 {
@@ -22,6 +26,58 @@ namespace edge
 		return props;
 	}
 
+	struct type::property_list_cache
+	{
+		std::vector<const property*> list;
+		std::unordered_map<const property*, size_t> indexes;
+		std::vector<const property*> child_props;
+	};
+
+	const type::property_list_cache* type::cache() const
+	{
+		auto cache = _cache.load(std::memory_order_acquire);
+		if (cache != nullptr)
+			return cache;
+
+		auto new_cache = new property_list_cache();
+		this->add_properties(new_cache->list);
+		for (size_t i = 0; i < new_cache->list.size(); i++)
+		{
+			auto p = new_cache->list[i];
+			new_cache->indexes.insert({ p, i });
+			if (dynamic_cast<const object_collection_property*>(p) || dynamic_cast<const object_property*>(p))
+				new_cache->child_props.push_back(p);
+		}
+
+		// Another thread may have raced us here; in that case keep its cache and discard ours.
+		if (!_cache.compare_exchange_strong(cache, new_cache, std::memory_order_acq_rel))
+		{
+			delete new_cache;
+			return cache;
+		}
+
+		return new_cache;
+	}
+
+	std::span<const property* const> type::property_list() const
+	{
+		auto& list = cache()->list;
+		return { list.data(), list.size() };
+	}
+
+	std::span<const property* const> type::child_property_list() const
+	{
+		auto& list = cache()->child_props;
+		return { list.data(), list.size() };
+	}
+
+	size_t type::property_index (const property* p) const
+	{
+		auto& indexes = cache()->indexes;
+		auto it = indexes.find(p);
+		return (it != indexes.end()) ? it->second : (size_t)-1;
+	}
+
 	const property* type::find_property (const char* name) const
 	{
 		for (auto p : props)
@@ -72,6 +128,56 @@ namespace edge
 
 	const type object::_type = { "object", nullptr, { } };
 
+	static thread_local object_allocator_i* current_allocator = nullptr;
+
+	object_allocation_scope::object_allocation_scope (object_allocator_i* allocator)
+		: _previous(current_allocator)
+	{
+		current_allocator = allocator;
+	}
+
+	object_allocation_scope::~object_allocation_scope()
+	{
+		current_allocator = _previous;
+	}
+
+	// Every allocation is preceded by a header that holds the allocator (or nullptr for the global heap).
+	// The header keeps the object aligned as strictly as ::operator new would.
+	static constexpr size_t allocation_header_size = alignof(std::max_align_t);
+	static_assert (allocation_header_size >= sizeof(object_allocator_i*));
+
+	void* object::operator new (size_t size)
+	{
+		auto allocator = current_allocator;
+		auto p = static_cast<uint8_t*>(allocator ? allocator->allocate(allocation_header_size + size) : ::operator new(allocation_header_size + size));
+		*reinterpret_cast<object_allocator_i**>(p) = allocator;
+		return p + allocation_header_size;
+	}
+
+	void object::operator delete (void* p, size_t size)
+	{
+		if (p == nullptr)
+			return;
+		auto header = static_cast<uint8_t*>(p) - allocation_header_size;
+		auto allocator = *reinterpret_cast<object_allocator_i**>(header);
+		if (allocator)
+			allocator->deallocate (header, allocation_header_size + size);
+		else
+			::operator delete (header);
+	}
+
+	property_bitset* changed_from_default_bits (object* obj)
+	{
+		return obj->changed_from_default_bits();
+	}
+
+	size_t property_index (const object* obj, const property* prop)
+	{
+		size_t index = obj->type()->property_index(prop);
+		assert (index != (size_t)-1);
+		return index;
+	}
+
 	// ========================================================================
 	// parent_i
 
@@ -8,6 +8,7 @@
 #include <vector>
 #include <array>
 #include <tuple>
+#include <atomic>
 
 namespace edge
 {
@@ -17,6 +18,12 @@ namespace edge
 		const type* const base_type;
 		std::span<const property* const> const props;
 
+		// Built on first use and never freed, like the type itself (types are expected to be static variables).
+		struct property_list_cache;
+		mutable std::atomic<const property_list_cache*> _cache = nullptr;
+
+		const property_list_cache* cache() const;
+
 	public:
 		constexpr type(const char* name, const type* base_type, std::span<const property* const> props) noexcept
 			: _name(name), base_type(base_type), props(props)
@@ -24,6 +31,16 @@ namespace edge
 
 		const char* name() const { return _name; }
 		std::vector<const property*> make_property_list() const;
+
+		// Same properties in the same order as make_property_list(), but computed only once per type.
+		std::span<const property* const> property_list() const;
+
+		// Index of "p" within property_list(), or -1 if "p" is not a property of this type. Constant time.
+		size_t property_index (const property* p) const;
+
+		// The object collection properties and object properties among property_list(), in the same order. Computed only once per type.
+		std::span<const property* const> child_property_list() const;
+
 		const property* find_property (const char* name) const;
 		bool has_property (const property* p) const;
 		bool is_derived_from (const type* t) const;
@@ -33,11 +50,27 @@ namespace edge
 		void add_properties (std::vector<const property*>& properties) const;
 	};
 
+	struct serialization_plan;
+	struct generated_serializer;
+
 	struct concrete_type : type
 	{
 		using type::type;
 		virtual std::span<const value_property* const> factory_props() const = 0;
 		virtual std::unique_ptr<object> create (std::span<std::string_view> string_values) const = 0;
+		virtual std::unique_ptr<object> create (binary_reader& from) const = 0;
+
+		// Creates an object passing to the factory the values that the factory_props() have in "from", which must be of this type.
+		virtual std::unique_ptr<object> create_like (const object* from) const = 0;
+
+		// How serializers are to handle each property of this type (see serializer.h). Built on first use, like property_list().
+		const edge::serialization_plan& serialization_plan() const;
+
+		// Overridden by generated_xtype (see static_serializer.h).
+		virtual const generated_serializer* get_generated_serializer() const { return nullptr; }
+
+	private:
+		mutable std::atomic<const edge::serialization_plan*> _serialization_plan = nullptr;
 	};
 
 	template<typename... factory_arg_property_traits>
@@ -83,20 +116,57 @@ namespace edge
 			std::tuple<typename factory_arg_property_traits::value_t...> values;
 			return create_internal(string_values, values, std::make_index_sequence<parameter_count>());
 		}
+
+	private:
+		template<size_t... I>
+		std::unique_ptr<object> create_internal (binary_reader& from, std::tuple<typename factory_arg_property_traits::value_t...>& values, std::index_sequence<I...>) const
+		{
+			(factory_arg_property_traits::deserialize(from, std::get<I>(values)), ...);
+			return std::unique_ptr<object>(_factory(std::get<I>(values)...));
+		}
+
+	public:
+		// Reads the factory arguments in the order of factory_props(), each encoded with property_traits::serialize.
+		virtual std::unique_ptr<object> create (binary_reader& from) const override
+		{
+			assert (_factory);
+			std::tuple<typename factory_arg_property_traits::value_t...> values;
+			return create_internal(from, values, std::make_index_sequence<parameter_count>());
+		}
+
+	private:
+		template<size_t... I>
+		std::unique_ptr<object> create_like_internal (const object* from, std::index_sequence<I...>) const
+		{
+			return std::unique_ptr<object>(_factory(static_cast<const static_value_property<factory_arg_property_traits>*>(_factory_props[I])->get(from)...));
+		}
+
+	public:
+		virtual std::unique_ptr<object> create_like (const object* from) const override
+		{
+			assert (_factory);
+			return create_like_internal(from, std::make_index_sequence<parameter_count>());
+		}
 	};
 
-	enum class collection_property_change_type { set, insert, remove };
+	// For move, the elements in the range given by index and count were reordered among themselves.
+	enum class collection_property_change_type { set, insert, remove, move };
 
 	struct property_change_args
 	{
 		const edge::property* property;
 		size_t index;
 		collection_property_change_type type;
+		size_t count = 1; // for insert, remove and move, the notification is about the "count" elements starting at "index"
 
 		property_change_args (const edge::property* property, size_t index, collection_property_change_type type)
 			: property(property), index(index), type(type)
 		{ }
 
+		property_change_args (const edge::property* property, size_t index, size_t count, collection_property_change_type type)
+			: property(property), index(index), type(type), count(count)
+		{ }
+
 		property_change_args (const value_property* property)
 			: property(property)
 		{ }
@@ -110,6 +180,27 @@ namespace edge
 		{ }
 	};
 
+	// Memory for objects allocated with "new" (see object::operator new). Implementations are in object_allocators.h.
+	struct object_allocator_i
+	{
+		virtual void* allocate (size_t size) = 0;
+		virtual void deallocate (void* p, size_t size) = 0;
+	};
+
+	// While an instance is alive, objects created with "new" on the same thread (by factories, deserializers, clone etc.)
+	// get their memory from "allocator". Scopes can be nested; the innermost one wins.
+	class object_allocation_scope
+	{
+		object_allocator_i* const _previous;
+
+	public:
+		object_allocation_scope (object_allocator_i* allocator);
+		~object_allocation_scope();
+
+		object_allocation_scope (const object_allocation_scope&) = delete;
+		object_allocation_scope& operator= (const object_allocation_scope&) = delete;
+	};
+
 	struct parent_i;
 	// TODO: make event_manager a member var, possibly a pointer
 	class object : public event_manager
@@ -131,8 +222,23 @@ namespace edge
 
 		virtual ~object() = default;
 
+		// Objects allocated while an object_allocation_scope is active come from the scope's allocator.
+		// Each allocation remembers its allocator, so objects can be deleted the usual way (std::unique_ptr
+		// included) from anywhere; the allocator must outlive the objects it allocated.
+		static void* operator new (size_t size);
+		static void operator delete (void* p, size_t size);
+
 		parent_i* parent() const { return _parent; }
 
+		// Optional tracking of which value properties differ from their default values.
+		// An object that wants it overrides this function to return a bitset member variable; static_value_property
+		// then keeps the bit at the index type()->property_index(prop) up to date in set() and reset_to_default(),
+		// and changed_from_default() (and thus saving) reads the bit instead of calling the getter.
+		// The bitset starts out clear, so the constructor must leave tracked properties at their default values.
+		// Changes that don't go through the property (say, calling the object's setter directly) must update the bit explicitly.
+		virtual property_bitset* changed_from_default_bits() { return nullptr; }
+		const property_bitset* changed_from_default_bits() const { return const_cast<object*>(this)->changed_from_default_bits(); }
+
 		struct property_changing_e : event<property_changing_e, object*, const property_change_args&> { };
 		struct property_changed_e  : event<property_changed_e , object*, const property_change_args&> { };
 		struct inserting_into_parent_e : public event<inserting_into_parent_e> { };
@@ -0,0 +1,112 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "object_allocators.h"
+#include <cstddef>
+
+namespace edge
+{
+	static_assert (alignof(std::max_align_t) <= 16);
+
+	object_pool::object_pool()
+		: _free_lists(max_pooled_size / granularity + 1, nullptr)
+	{ }
+
+	object_pool::~object_pool()
+	{
+		assert (_live_count == 0);
+		for (auto chunk : _chunks)
+			::operator delete(chunk);
+	}
+
+	void* object_pool::allocate (size_t size)
+	{
+		if (size > max_pooled_size)
+		{
+			_live_count++;
+			return ::operator new(size);
+		}
+
+		size_t index = (size + granularity - 1) / granularity;
+		if (auto node = _free_lists[index])
+		{
+			_free_lists[index] = node->next;
+			_live_count++;
+			return node;
+		}
+
+		size_t rounded = index * granularity;
+		if ((size_t)(_chunk_end - _chunk_ptr) < rounded)
+		{
+			// The tail of the old chunk is wasted; it's less than max_pooled_size bytes.
+			_chunks.reserve(_chunks.size() + 1);
+			_chunk_ptr = static_cast<uint8_t*>(::operator new(chunk_size));
+			_chunk_end = _chunk_ptr + chunk_size;
+			_chunks.push_back(_chunk_ptr);
+		}
+
+		auto p = _chunk_ptr;
+		_chunk_ptr += rounded;
+		_live_count++;
+		return p;
+	}
+
+	void object_pool::deallocate (void* p, size_t size)
+	{
+		assert (_live_count > 0);
+		_live_count--;
+
+		if (size > max_pooled_size)
+		{
+			::operator delete(p);
+			return;
+		}
+
+		size_t index = (size + granularity - 1) / granularity;
+		auto node = static_cast<free_node*>(p);
+		node->next = _free_lists[index];
+		_free_lists[index] = node;
+	}
+
+	// ========================================================================
+
+	object_arena::~object_arena()
+	{
+		assert (_live_count == 0);
+		for (auto chunk : _chunks)
+			::operator delete(chunk);
+	}
+
+	void* object_arena::allocate (size_t size)
+	{
+		size_t rounded = (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+		if ((size_t)(_chunk_end - _chunk_ptr) < rounded)
+		{
+			_chunks.reserve(_chunks.size() + 1);
+			if (rounded > chunk_size / 4)
+			{
+				// Large allocation: give it a chunk of its own and keep bumping in the current one.
+				auto p = ::operator new(rounded);
+				_chunks.push_back(p);
+				_live_count++;
+				return p;
+			}
+
+			_chunk_ptr = static_cast<uint8_t*>(::operator new(chunk_size));
+			_chunk_end = _chunk_ptr + chunk_size;
+			_chunks.push_back(_chunk_ptr);
+		}
+
+		auto p = _chunk_ptr;
+		_chunk_ptr += rounded;
+		_live_count++;
+		return p;
+	}
+
+	void object_arena::deallocate (void*, size_t)
+	{
+		assert (_live_count > 0);
+		_live_count--;
+	}
+}
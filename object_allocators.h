@@ -0,0 +1,64 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "object.h"
+
+namespace edge
+{
+	// Free-list pools, one per allocation size (rounded up to 16 bytes), so all objects of a type share a pool
+	// and freed memory is reused for the next object of the same size. Memory is taken from the heap in large chunks,
+	// which keeps objects created one after the other next to each other. Not thread-safe.
+	class object_pool : public object_allocator_i
+	{
+		static constexpr size_t granularity = 16;
+		static constexpr size_t max_pooled_size = 1024; // larger allocations go straight to the heap
+		static constexpr size_t chunk_size = 64 * 1024;
+
+		struct free_node { free_node* next; };
+
+		std::vector<free_node*> _free_lists; // indexed by size / granularity
+		std::vector<void*> _chunks;
+		uint8_t* _chunk_ptr = nullptr;
+		uint8_t* _chunk_end = nullptr;
+		size_t _live_count = 0;
+
+	public:
+		object_pool();
+		~object_pool();
+
+		object_pool (const object_pool&) = delete;
+		object_pool& operator= (const object_pool&) = delete;
+
+		virtual void* allocate (size_t size) override;
+		virtual void deallocate (void* p, size_t size) override;
+
+		size_t live_count() const { return _live_count; }
+	};
+
+	// Bump allocator for objects that are all destroyed together, such as those of a document.
+	// Deleting an object runs its destructor but doesn't make its memory reusable; all memory is returned
+	// to the heap at once when the arena is destroyed, which must happen after all its objects were deleted. Not thread-safe.
+	class object_arena : public object_allocator_i
+	{
+		static constexpr size_t chunk_size = 1024 * 1024;
+
+		std::vector<void*> _chunks;
+		uint8_t* _chunk_ptr = nullptr;
+		uint8_t* _chunk_end = nullptr;
+		size_t _live_count = 0;
+
+	public:
+		object_arena() = default;
+		~object_arena();
+
+		object_arena (const object_arena&) = delete;
+		object_arena& operator= (const object_arena&) = delete;
+
+		virtual void* allocate (size_t size) override;
+		virtual void deallocate (void* p, size_t size) override;
+
+		size_t live_count() const { return _live_count; }
+	};
+}
@@ -0,0 +1,55 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "object_handles.h"
+
+namespace edge
+{
+	handle_table::handle_table (object* root)
+		: tree_observer(root)
+	{
+		start();
+	}
+
+	object_handle handle_table::handle_of (const object* obj) const
+	{
+		auto it = _slot_indexes.find(obj);
+		assert (it != _slot_indexes.end());
+		return { it->second, _slots[it->second].generation };
+	}
+
+	void handle_table::on_attached (object* obj)
+	{
+		uint32_t index;
+		if (!_free_slots.empty())
+		{
+			index = _free_slots.back();
+			_free_slots.pop_back();
+			_slots[index].obj = obj;
+		}
+		else
+		{
+			assert (_slots.size() < UINT32_MAX);
+			index = (uint32_t)_slots.size();
+			_slots.push_back({ obj, 1 });
+		}
+
+		_slot_indexes.insert({ obj, index });
+	}
+
+	void handle_table::on_detaching (object* obj)
+	{
+		auto it = _slot_indexes.find(obj);
+		assert (it != _slot_indexes.end());
+		auto& s = _slots[it->second];
+		s.obj = nullptr;
+
+		// Skip zero on wrap-around, as it marks null handles.
+		if (++s.generation == 0)
+			s.generation = 1;
+
+		_free_slots.push_back(it->second);
+		_slot_indexes.erase(it);
+	}
+}
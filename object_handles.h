@@ -0,0 +1,62 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "tree_observer.h"
+
+namespace edge
+{
+	// Identifies an object of a tree observed by a handle_table. Unlike an object pointer, a handle can be kept
+	// after the object is removed from the tree or destroyed; resolving it then returns nullptr instead of dangling.
+	struct object_handle
+	{
+		uint32_t index = 0;
+		uint32_t generation = 0; // never zero for a valid handle, so a default-constructed handle is a null handle
+
+		bool operator== (const object_handle& other) const { return (index == other.index) && (generation == other.generation); }
+		bool operator!= (const object_handle& other) const { return !(*this == other); }
+		explicit operator bool() const { return generation != 0; }
+	};
+
+	// Gives a handle to every object in a tree and keeps the handles up to date as objects are inserted and removed.
+	// Handles index into a slot table; each slot has a generation counter that is incremented when the slot's object
+	// leaves the tree, which invalidates all handles to it. Slots are then reused for new objects.
+	//
+	// An object that is removed from the tree and inserted again (for example by undo) gets a new handle.
+	class handle_table : tree_observer
+	{
+		struct slot
+		{
+			object* obj;
+			uint32_t generation;
+		};
+
+		std::vector<slot> _slots;
+		std::vector<uint32_t> _free_slots;
+		std::unordered_map<const object*, uint32_t> _slot_indexes;
+
+	public:
+		handle_table (object* root);
+
+		using tree_observer::root;
+
+		// Returns nullptr if the object that "h" refers to is no longer in the tree.
+		object* resolve (object_handle h) const
+		{
+			if ((h.index < _slots.size()) && (_slots[h.index].generation == h.generation))
+				return _slots[h.index].obj;
+			return nullptr;
+		}
+
+		template<typename object_t>
+		object_t* resolve_as (object_handle h) const { return static_cast<object_t*>(resolve(h)); }
+
+		// The object must be in the tree.
+		object_handle handle_of (const object* obj) const;
+
+	private:
+		virtual void on_attached (object* obj) override;
+		virtual void on_detaching (object* obj) override;
+	};
+}
@@ -4,6 +4,7 @@
 
 #include "reflection.h"
 #include <ctype.h>
+#include <cstring>
 
 namespace edge
 {
@@ -30,6 +31,30 @@ namespace edge
 
 	// ========================================================================
 
+	uint64_t binary_reader::read_varint()
+	{
+		uint64_t value = 0;
+		for (unsigned shift = 0; shift < 64; shift += 7)
+		{
+			uint8_t b = read_uint8();
+			value |= (uint64_t)(b & 0x7F) << shift;
+			if ((b & 0x80) == 0)
+				return value;
+		}
+
+		throw binary_read_exception("Malformed variable-length integer.");
+	}
+
+	static uint32_t read_varint32 (binary_reader& from)
+	{
+		uint64_t value = from.read_varint();
+		if (value > UINT32_MAX)
+			throw binary_read_exception("Variable-length integer out of range.");
+		return (uint32_t)value;
+	}
+
+	// ========================================================================
+
 	const char bool_property_traits::type_name[] = "bool";
 
 	void bool_property_traits::to_string (value_t from, std::string& to)
@@ -54,6 +79,19 @@ namespace edge
 		throw string_convert_exception(from, type_name);
 	}
 
+	void bool_property_traits::serialize (value_t from, out_stream_i* to)
+	{
+		to->write ((uint8_t)(from ? 1 : 0));
+	}
+
+	void bool_property_traits::deserialize (binary_reader& from, value_t& to)
+	{
+		uint8_t b = from.read_uint8();
+		if (b > 1)
+			throw binary_read_exception("Invalid bool value.");
+		to = (b != 0);
+	}
+
 	// ========================================================================
 
 	extern const char int32_type_name[] = "int32";
@@ -83,14 +121,16 @@ namespace edge
 		to = value;
 	}
 
+	// Zigzag encoding, so that small negative values also take few bytes.
 	template<> void int32_property_traits::serialize (value_t from, out_stream_i* to)
 	{
-		assert(false); // not implemented
+		to->write_varint (((uint32_t)from << 1) ^ (uint32_t)(from >> 31));
 	}
 
 	template<> void int32_property_traits::deserialize (binary_reader& from, value_t& to)
 	{
-		assert(false); // not implemented
+		uint32_t zz = read_varint32(from);
+		to = (int32_t)((zz >> 1) ^ (0u - (zz & 1)));
 	}
 
 	// ========================================================================
@@ -124,12 +164,12 @@ namespace edge
 
 	template<> void uint32_property_traits::serialize (value_t from, out_stream_i* to)
 	{
-		assert(false); // not implemented
+		to->write_varint(from);
 	}
 
 	template<> void uint32_property_traits::deserialize (binary_reader& from, value_t& to)
 	{
-		assert(false); // not implemented
+		to = read_varint32(from);
 	}
 
 	// ========================================================================
@@ -163,12 +203,12 @@ namespace edge
 
 	template<> void uint64_property_traits::serialize (value_t from, out_stream_i* to)
 	{
-		assert(false); // not implemented
+		to->write_varint(from);
 	}
 
 	template<> void uint64_property_traits::deserialize (binary_reader& from, value_t& to)
 	{
-		assert(false); // not implemented
+		to = from.read_varint();
 	}
 
 	// ========================================================================
@@ -189,12 +229,15 @@ namespace edge
 
 	template<> void size_t_property_traits::serialize (value_t from, out_stream_i* to)
 	{
-		assert(false); // not implemented
+		to->write_varint(from);
 	}
 
 	template<> void size_t_property_traits::deserialize (binary_reader& from, value_t& to)
 	{
-		assert(false); // not implemented
+		uint64_t value = from.read_varint();
+		if (value > SIZE_MAX)
+			throw binary_read_exception("Variable-length integer out of range.");
+		to = (size_t)value;
 	}
 
 	// ========================================================================
@@ -226,14 +269,21 @@ namespace edge
 		to = value;
 	}
 
+	// Raw IEEE 754 bits, little endian.
 	template<> void float_property_traits::serialize (value_t from, out_stream_i* to)
 	{
-		assert(false); // not implemented
+		static_assert (sizeof(float) == 4);
+		uint32_t bits;
+		memcpy (&bits, &from, 4);
+		uint8_t buffer[4] = { (uint8_t)bits, (uint8_t)(bits >> 8), (uint8_t)(bits >> 16), (uint8_t)(bits >> 24) };
+		to->write (buffer, 4);
 	}
 
 	template<> void float_property_traits::deserialize (binary_reader& from, value_t& to)
 	{
-		assert(false); // not implemented
+		auto p = from.read_bytes(4);
+		uint32_t bits = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		memcpy (&to, &bits, 4);
 	}
 
 	// ========================================================================
@@ -266,39 +316,35 @@ namespace edge
 
 	void backed_string_property_traits::deserialize (binary_reader& from, value_t& to)
 	{
-		assert (from.ptr + 1 <= from.end);
-		size_t len = *from.ptr++;
+		size_t len = from.read_uint8();
 
 		if (len == 254)
 		{
-			assert (from.ptr + 2 <= from.end);
-			len = *from.ptr++;
-			len |= (*from.ptr++ << 8);
+			auto p = from.read_bytes(2);
+			len = (size_t)p[0] | ((size_t)p[1] << 8);
 		}
 		else if (len == 255)
 		{
-			assert (from.ptr + 4 <= from.end);
-			len = *from.ptr++;
-			len |= (*from.ptr++ << 8);
-			len |= (*from.ptr++ << 16);
-			len |= (*from.ptr++ << 24);
+			auto p = from.read_bytes(4);
+			len = (size_t)p[0] | ((size_t)p[1] << 8) | ((size_t)p[2] << 16) | ((size_t)p[3] << 24);
 		}
 
-		assert (from.ptr + len <= from.end);
-		to = std::string_view((const char*)from.ptr, len);
-		from.ptr += len;
+		to = std::string_view((const char*)from.read_bytes(len), len);
 	}
 
 	// ========================================================================
 
+	// Same encoding as backed_string, so the two can be switched without breaking existing files.
 	void temp_string_property_traits::serialize (value_t from, out_stream_i* to)
 	{
-		assert(false); // not implemented
+		backed_string_property_traits::serialize(from, to);
 	}
 
 	void temp_string_property_traits::deserialize (binary_reader& from, value_t& to)
 	{
-		assert(false); // not implemented
+		std::string_view str;
+		backed_string_property_traits::deserialize(from, str);
+		to = str;
 	}
 
 	// ========================================================================
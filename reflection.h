@@ -10,6 +10,8 @@
 #include <cstdint>
 #include <cstdio>
 #include <optional>
+#include <vector>
+#include <atomic>
 
 #define TCB_SPAN_NAMESPACE_NAME std
 #define TCB_SPAN_NO_CONTRACT_CHECKING
@@ -49,6 +51,15 @@ namespace edge
 		virtual const char* what() const noexcept override { return "Not implemented"; }
 	};
 
+	class binary_read_exception : public std::exception
+	{
+		const char* const _message;
+
+	public:
+		binary_read_exception (const char* message) : _message(message) { }
+		virtual const char* what() const noexcept override { return _message; }
+	};
+
 	// Note that we want this type to be polymorphic so we can dynamic_cast<> on it.
 	// It should contain at least one virtual function (in C++20 that could be the destructor).
 	struct property
@@ -78,14 +89,117 @@ namespace edge
 		virtual void write (const void* data, size_t size) = 0;
 
 		void write (uint8_t data) { write(&data, sizeof(data)); }
+
+		// LEB128: seven bits per byte, least significant group first, high bit set on all bytes but the last.
+		void write_varint (uint64_t value)
+		{
+			uint8_t buffer[10];
+			size_t size = 0;
+			while (value >= 0x80)
+			{
+				buffer[size++] = (uint8_t)(value | 0x80);
+				value >>= 7;
+			}
+			buffer[size++] = (uint8_t)value;
+			write (buffer, size);
+		}
 	};
 
+	// All read functions throw binary_read_exception rather than read past "end".
 	struct binary_reader
 	{
 		const uint8_t* ptr;
 		const uint8_t* const end;
+
+		size_t remaining() const { return end - ptr; }
+
+		uint8_t read_uint8()
+		{
+			if (ptr == end)
+				throw binary_read_exception("Unexpected end of binary data.");
+			return *ptr++;
+		}
+
+		const uint8_t* read_bytes (size_t size)
+		{
+			if (size > remaining())
+				throw binary_read_exception("Unexpected end of binary data.");
+			auto result = ptr;
+			ptr += size;
+			return result;
+		}
+
+		uint64_t read_varint();
+	};
+
+	// Set of properties of an object, indexed by their position in the type's flattened property list (type::property_list).
+	class property_bitset
+	{
+		uint64_t _first = 0;
+		std::vector<uint64_t> _rest;
+
+	public:
+		bool test (size_t index) const
+		{
+			if (index < 64)
+				return (_first >> index) & 1;
+			size_t word = index / 64 - 1;
+			return (word < _rest.size()) && ((_rest[word] >> (index % 64)) & 1);
+		}
+
+		void set (size_t index, bool value)
+		{
+			uint64_t* word;
+			if (index < 64)
+				word = &_first;
+			else
+			{
+				if (index / 64 - 1 >= _rest.size())
+				{
+					if (!value)
+						return;
+					_rest.resize(index / 64);
+				}
+				word = &_rest[index / 64 - 1];
+			}
+
+			if (value)
+				*word |= (1ull << (index % 64));
+			else
+				*word &= ~(1ull << (index % 64));
+		}
+
+		bool any() const
+		{
+			if (_first)
+				return true;
+			for (auto w : _rest)
+				if (w)
+					return true;
+			return false;
+		}
+
+		// Calls callback(index) for each set bit, in increasing order.
+		template<typename callback_t>
+		void for_each (callback_t callback) const
+		{
+			auto scan = [&callback](uint64_t w, size_t base)
+			{
+				for (size_t i = 0; w; i++, w >>= 1)
+					if (w & 1)
+						callback(base + i);
+			};
+
+			scan (_first, 0);
+			for (size_t wi = 0; wi < _rest.size(); wi++)
+				scan (_rest[wi], (wi + 1) * 64);
+		}
 	};
 
+	// Defined in object.cpp, cause object is incomplete here. See object::changed_from_default_bits.
+	property_bitset* changed_from_default_bits (object* obj);
+	size_t property_index (const object* obj, const property* prop);
+
 	struct value_property : property
 	{
 		using property::property;
@@ -101,6 +215,13 @@ namespace edge
 		virtual bool changed_from_default(const object* obj) const = 0;
 		virtual void reset_to_default(object* obj) const = 0;
 
+		// Sets the value of "to" to the value of "from", without converting it to a string or binary form on the way.
+		virtual void copy (const object* from, object* to) const = 0;
+
+		// True if this property keeps the object's changed_from_default_bits() up to date, in which case
+		// that bit can be read instead of calling changed_from_default(). Only static_value_property does that.
+		virtual bool tracks_changed_from_default() const { return false; }
+
 		std::string get_to_string (const object* from) const
 		{
 			std::string to;
@@ -171,6 +292,11 @@ namespace edge
 		{
 			return this->get(obj1) == this->get(obj2);
 		}
+
+		virtual void copy (const object* from, object* to) const override final
+		{
+			this->set (this->get(from), to);
+		}
 	};
 
 	// ========================================================================
@@ -277,6 +403,26 @@ namespace edge
 		setter_t const _setter;
 		std::optional<value_t> const default_value;
 
+	private:
+		// Index of this property in type::property_list(), looked up the first time an object with changed_from_default_bits
+		// uses it. Base type properties come first in property_list(), so the index is the same for the declaring type
+		// and all types derived from it; a property must not be listed in the props of more than one type.
+		mutable std::atomic<size_t> _index = (size_t)-1;
+
+		size_t index_in (const object* obj) const
+		{
+			size_t index = _index.load(std::memory_order_relaxed);
+			if (index == (size_t)-1)
+			{
+				index = property_index(obj, this);
+				_index.store (index, std::memory_order_relaxed);
+			}
+
+			assert (index == property_index(obj, this));
+			return index;
+		}
+
+	public:
 		constexpr static_value_property (const char* name, const property_group* group, const char* description, getter_t getter, setter_t setter, std::optional<value_t>&& default_value = std::nullopt)
 			: base(name, group, description), _getter(getter), _setter(setter), default_value(std::move(default_value))
 		{ }
@@ -285,17 +431,39 @@ namespace edge
 
 		virtual value_t get (const object* from) const override final { return _getter.get(from); }
 
-		virtual void set (value_t from, object* to) const override final { _setter.set(from, to); }
+		// The changed-from-default bit is set from the value passed to the setter, not read back with the getter,
+		// so a setter that stores something else than it's given (say, a clamped value) must update the bit itself.
+		virtual void set (value_t from, object* to) const override final
+		{
+			_setter.set(from, to);
+
+			if (default_value)
+			{
+				if (auto bits = changed_from_default_bits(to))
+					bits->set (index_in(to), from != default_value.value());
+			}
+		}
 
 		virtual bool changed_from_default (const object* obj) const override
 		{
-			return !default_value || (_getter.get(obj) != default_value.value());
+			if (!default_value)
+				return true;
+
+			if (auto bits = changed_from_default_bits(const_cast<object*>(obj)))
+				return bits->test(index_in(obj));
+
+			return _getter.get(obj) != default_value.value();
 		}
 
 		virtual void reset_to_default(object* obj) const override
 		{
 			_setter.set(default_value.value(), obj);
+
+			if (auto bits = changed_from_default_bits(obj))
+				bits->set (index_in(obj), false);
 		}
+
+		virtual bool tracks_changed_from_default() const override { return default_value.has_value(); }
 	};
 
 	// ===========================================
@@ -307,8 +475,8 @@ namespace edge
 		static constexpr nvp nvps[] = { { "False", 0 }, { "True", 1 }, { nullptr, -1 }, };
 		static void to_string (value_t from, std::string& to);
 		static void from_string (std::string_view from, value_t& to);
-		static void serialize (value_t from, out_stream_i* to) { assert(false); } // not implemented
-		static void deserialize (binary_reader& from, value_t& to) { assert(false); } // not implemented
+		static void serialize (value_t from, out_stream_i* to);
+		static void deserialize (binary_reader& from, value_t& to);
 	};
 	using bool_p = static_value_property<bool_property_traits>;
 
@@ -424,8 +592,17 @@ namespace edge
 			throw string_convert_exception(from, type_name);
 		}
 
-		static void serialize (value_t from, out_stream_i* to) { assert(false); }
-		static void deserialize (binary_reader& from, value_t& to) { assert(false); }
+		static void serialize (value_t from, out_stream_i* to)
+		{
+			int32_property_traits::serialize((int32_t)from, to);
+		}
+
+		static void deserialize (binary_reader& from, value_t& to)
+		{
+			int32_t val;
+			int32_property_traits::deserialize(from, val);
+			to = (enum_t)val;
+		}
 	};
 
 	extern const char unknown_enum_value_str[];
@@ -475,10 +652,10 @@ namespace edge
 			static_assert (std::is_base_of<object, object_t>::value);
 		}
 
+		// Returns the previous value.
 		std::unique_ptr<object_t> set (object* obj, std::unique_ptr<object_t>&& value) const
 		{
-			(obj->*_setter)(std::move(value));
-			assert(false); return nullptr; // TODO: return old value
+			return (obj->*_setter)(std::move(value));
 		}
 
 		virtual object_t* get (const object* obj) const override final { return (obj->*_getter)(); }
@@ -499,8 +676,15 @@ namespace edge
 		virtual void get_value (const object* from_obj, size_t from_index, std::string& to) const = 0;
 		virtual void set_value (std::string_view from, object* to_obj, size_t to_index) const = 0;
 		virtual void insert_value (std::string_view from, object* to_obj, size_t to_index) const = 0;
+		virtual void get_value (const object* from_obj, size_t from_index, out_stream_i* to) const = 0;
+		virtual void set_value (binary_reader& from, object* to_obj, size_t to_index) const = 0;
+		virtual void insert_value (binary_reader& from, object* to_obj, size_t to_index) const = 0;
 		virtual void remove_value (object* obj, size_t index) const = 0;
 		virtual bool changed (const object* obj) const = 0;
+
+		// Copies all values of "from" to "to" (appending them if can_insert_remove(), otherwise overwriting
+		// the values that "to" pre-allocated), the same way a deserializer would.
+		virtual void copy_values (const object* from, object* to) const = 0;
 	};
 
 	// TODO: try to get rid of object_t
@@ -597,9 +781,30 @@ namespace edge
 			(static_cast<object_t*>(to_obj)->*_insert_value) (to_index, value);
 		}
 
+		virtual void get_value (const object* from_obj, size_t from_index, out_stream_i* to) const override
+		{
+			auto value = (static_cast<const object_t*>(from_obj)->*_get_value)(from_index);
+			property_traits::serialize(value, to);
+		}
+
+		virtual void set_value (binary_reader& from, object* to_obj, size_t to_index) const override
+		{
+			typename property_traits::value_t value;
+			property_traits::deserialize(from, value);
+			(static_cast<object_t*>(to_obj)->*_set_value) (to_index, value);
+		}
+
+		virtual void insert_value (binary_reader& from, object* to_obj, size_t to_index) const override
+		{
+			typename property_traits::value_t value;
+			property_traits::deserialize(from, value);
+			(static_cast<object_t*>(to_obj)->*_insert_value) (to_index, value);
+		}
+
 		virtual void remove_value (object* obj, size_t index) const override
 		{
-			assert(false); // not implemented
+			assert (_remove_value);
+			(static_cast<object_t*>(obj)->*_remove_value) (index);
 		}
 
 		virtual bool can_insert_remove() const override { return _insert_value != nullptr; }
@@ -609,5 +814,18 @@ namespace edge
 			const object_t* ot = static_cast<const object_t*>(obj);
 			return (ot->*_changed)();
 		}
+
+		virtual void copy_values (const object* from, object* to) const override
+		{
+			auto from_ot = static_cast<const object_t*>(from);
+			auto to_ot = static_cast<object_t*>(to);
+			for (size_t i = 0, size = this->size(from); i < size; i++)
+			{
+				if (_insert_value)
+					(to_ot->*_insert_value) (i, (from_ot->*_get_value)(i));
+				else
+					(to_ot->*_set_value) (i, (from_ot->*_get_value)(i));
+			}
+		}
 	};
 }
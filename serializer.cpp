@@ -0,0 +1,192 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "serializer.h"
+#include "collections.h"
+#include <algorithm>
+
+namespace edge
+{
+	static serialized_prop_kind kind_of (const property* prop)
+	{
+		if (dynamic_cast<const value_property*>(prop))
+			return serialized_prop_kind::value;
+		if (dynamic_cast<const value_collection_property*>(prop))
+			return serialized_prop_kind::value_collection;
+		if (dynamic_cast<const object_collection_property*>(prop))
+			return serialized_prop_kind::object_collection;
+		if (dynamic_cast<const object_property*>(prop))
+			return serialized_prop_kind::object;
+		return serialized_prop_kind::other;
+	}
+
+	const serialization_plan& concrete_type::serialization_plan() const
+	{
+		auto plan = _serialization_plan.load(std::memory_order_acquire);
+		if (plan != nullptr)
+			return *plan;
+
+		auto new_plan = new edge::serialization_plan();
+		auto factory_props = this->factory_props();
+		for (auto prop : this->property_list())
+		{
+			auto kind = kind_of(prop);
+			bool is_factory_prop = std::find(factory_props.begin(), factory_props.end(), prop) != factory_props.end();
+			bool tracks = (kind == serialized_prop_kind::value) && static_cast<const value_property*>(prop)->tracks_changed_from_default();
+			size_t index = new_plan->props.size();
+			new_plan->props.push_back({ prop, kind, dynamic_cast<const custom_serialize_property_i*>(prop), is_factory_prop, tracks });
+			(kind == serialized_prop_kind::value ? new_plan->values : new_plan->content).push_back(index);
+		}
+
+		new_plan->generated = this->get_generated_serializer();
+		if (new_plan->generated != nullptr)
+		{
+			// Generated for a different property list (the base type's props changed, say); use the virtual path.
+			auto props = this->property_list();
+			bool same_props = std::equal (props.begin(), props.end(), new_plan->generated->props.begin(), new_plan->generated->props.end());
+			assert (same_props);
+			if (!same_props)
+				new_plan->generated = nullptr;
+		}
+
+		// Same as in type::cache().
+		if (!_serialization_plan.compare_exchange_strong(plan, new_plan, std::memory_order_acq_rel))
+		{
+			delete new_plan;
+			return *plan;
+		}
+
+		return *new_plan;
+	}
+
+	size_t serialization_plan::find (std::string_view name) const
+	{
+		for (size_t i = 0; i < props.size(); i++)
+		{
+			if (name == props[i].prop->_name)
+				return i;
+		}
+
+		return -1;
+	}
+
+	// ========================================================================
+
+	class plan_walker
+	{
+		object_writer_i& _writer;
+		bool const _use_generated;
+		std::vector<size_t> _values; // no recursion happens while it's in use, so one vector does for the whole tree
+
+	public:
+		plan_walker (object_writer_i& writer)
+			: _writer(writer), _use_generated(writer.uses_generated_serializers())
+		{ }
+
+		void walk (const object* obj, size_t index, bool force)
+		{
+			auto& plan = obj->type()->serialization_plan();
+
+			_values.clear();
+			if (!_use_generated || (plan.generated == nullptr))
+			{
+				// Our indexes are those of type::property_list, so we can read the changed-from-default bits directly.
+				auto bits = obj->changed_from_default_bits();
+				for (size_t i : plan.values)
+				{
+					auto& pi = plan.props[i];
+					if (!pi.need_serialize(obj))
+						continue;
+
+					auto value_prop = static_cast<const value_property*>(pi.prop);
+					if (pi.is_factory_prop || (value_prop->can_set(obj) && ((bits && pi.tracks_changed_from_default) ? bits->test(i) : value_prop->changed_from_default(obj))))
+						_values.push_back(i);
+				}
+			}
+
+			// Evaluating whether collections and object properties have content is cheap,
+			// so we do it twice rather than keep a list of indexes across the recursive calls.
+			size_t content_count = std::count_if (plan.content.begin(), plan.content.end(), [obj, &plan](size_t i) { return has_content(obj, plan.props[i]); });
+
+			if (!_writer.begin_object(obj, plan, _values, content_count, index, force))
+				return;
+
+			for (size_t i : plan.content)
+			{
+				auto& pi = plan.props[i];
+				if (!has_content(obj, pi))
+					continue;
+
+				if (pi.kind == serialized_prop_kind::object_collection)
+				{
+					// Variable-size collections: always write all children. Fixed-size collections, allocated by the object
+					// in its constructor: the backend may write only the children that changed, with their index.
+					auto oc_prop = static_cast<const object_collection_property*>(pi.prop);
+					auto collection = oc_prop->collection_cast(obj);
+					_writer.begin_object_collection (obj, plan, i, collection);
+					size_t child_count = collection->child_count();
+					for (size_t ci = 0; ci < child_count; )
+					{
+						if (size_t skipped = _writer.skip_collection_children(ci))
+						{
+							assert (ci + skipped <= child_count);
+							ci += skipped;
+							continue;
+						}
+
+						_writer.begin_collection_child(ci);
+						walk (collection->child_at(ci), oc_prop->preallocated ? ci : -1, !oc_prop->preallocated);
+						ci++;
+					}
+					_writer.end_object_collection();
+				}
+				else if (pi.kind == serialized_prop_kind::value_collection)
+				{
+					_writer.write_value_collection (obj, plan, i);
+				}
+				else // if (pi.kind == serialized_prop_kind::object)
+				{
+					_writer.begin_object_property (obj, plan, i);
+					walk (static_cast<const object_property*>(pi.prop)->get(obj), -1, false);
+				}
+			}
+
+			_writer.end_object(obj);
+		}
+
+	private:
+		static bool has_content (const object* obj, const serialization_plan::prop_info& pi)
+		{
+			if (!pi.need_serialize(obj))
+				return false;
+
+			switch (pi.kind)
+			{
+				case serialized_prop_kind::object_collection:
+					return static_cast<const object_collection_property*>(pi.prop)->collection_cast(obj)->child_count() > 0;
+
+				case serialized_prop_kind::value_collection:
+				{
+					auto vc_prop = static_cast<const value_collection_property*>(pi.prop);
+					return (vc_prop->size(obj) > 0) && vc_prop->changed(obj);
+				}
+
+				case serialized_prop_kind::object:
+					return static_cast<const object_property*>(pi.prop)->get(obj) != nullptr;
+
+				case serialized_prop_kind::other:
+					assert(false); // not implemented
+					return false;
+
+				default:
+					return false;
+			}
+		}
+	};
+
+	void write_object (object_writer_i& writer, const object* obj, bool force_serialize_unchanged)
+	{
+		plan_walker(writer).walk (obj, -1, force_serialize_unchanged);
+	}
+}
@@ -0,0 +1,121 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "object.h"
+
+namespace edge
+{
+	struct object_collection_i;
+	class xml_writer;
+	struct serialization_plan;
+
+	// Interfaces shared by all serializers (XML, binary).
+
+	struct custom_serialize_property_i
+	{
+		virtual bool need_serialize (const object* obj) const = 0;
+	};
+
+	struct deserialize_i
+	{
+		virtual void on_deserializing() = 0;
+		virtual void on_deserialized() = 0;
+	};
+
+	enum class serialized_prop_kind : uint8_t { value, value_collection, object_collection, object, other };
+
+	// Value serialization routines generated at compile time for one type, with no virtual calls per property
+	// (see static_serializer.h). Same output, and same choice of values to write, as the virtual path.
+	struct generated_serializer
+	{
+		// The properties the routines were generated for; they must be exactly the type's property_list().
+		std::span<const property* const> props;
+
+		// Whether write_xml_values would write anything.
+		bool (*has_values) (const object* obj, const serialization_plan& plan);
+
+		// The value section of a binary object: the count of values that are not factory values, then (index, value) pairs.
+		void (*write_binary_values) (const object* obj, const serialization_plan& plan, out_stream_i* to);
+
+		// The values as XML attributes, factory values included. "buffer" is for the string forms of the values.
+		void (*write_xml_values) (const object* obj, const serialization_plan& plan, xml_writer& to, std::string& buffer);
+
+		// Indexed like "props". "bits" are the object's changed_from_default_bits().
+		std::span<void (* const)(binary_reader& from, object* to, property_bitset* bits)> read_binary_value;
+		std::span<void (* const)(std::string_view from, object* to, property_bitset* bits)> read_xml_value;
+	};
+
+	// What serializers need to know about the properties of a type, worked out once per type (see concrete_type::serialization_plan)
+	// so that writing or reading an object doesn't need any dynamic_cast or search through the factory props.
+	struct serialization_plan
+	{
+		struct prop_info
+		{
+			const property* prop;
+			serialized_prop_kind kind;
+			const custom_serialize_property_i* cs; // nullptr for properties that are always serialized
+			bool is_factory_prop;
+			bool tracks_changed_from_default;      // see value_property::tracks_changed_from_default
+
+			bool need_serialize (const object* obj) const { return (cs == nullptr) || cs->need_serialize(obj); }
+		};
+
+		// All properties of the type, in the order of type::property_list(). The indexes below, and the indexes
+		// that binary documents use for properties, are indexes in this vector.
+		std::vector<prop_info> props;
+
+		// Value properties, factory props included, in order.
+		std::vector<size_t> values;
+
+		// Value collections, object collections, object properties, and properties of other kinds, in order.
+		std::vector<size_t> content;
+
+		// The type's concrete_type::get_generated_serializer(), or nullptr for types that use the virtual path.
+		const generated_serializer* generated;
+
+		// Index of the property with this name, or -1.
+		size_t find (std::string_view name) const;
+	};
+
+	// Encoding half of a serialization backend (XML, binary...). write_object() walks the object tree together with
+	// the serialization plans of the objects' types, works out what needs to be written, and calls these in document order.
+	struct object_writer_i
+	{
+		// "values" are the value properties to write, as indexes in plan.props: the factory props, and the properties
+		// that can be set and changed from default. It is valid only during the call. "content_count" is the number of
+		// begin_object_collection, write_value_collection and begin_object_property calls that follow for this object.
+		// "index" is the object's index within a preallocated collection, or -1. When "force" is false, backends that can
+		// may omit the object if it turns out to have nothing to write (the XML serializers omit its element).
+		//
+		// Returns false if the writer took care of the object some other way (incremental serializers copy objects
+		// that didn't change since the previous save), in which case neither its content nor end_object() follow.
+		virtual bool begin_object (const object* obj, const serialization_plan& plan, std::span<const size_t> values, size_t content_count, size_t index, bool force) = 0;
+		virtual void end_object (const object* obj) = 0;
+
+		// Followed by begin_collection_child() and the child object for each child, then by end_object_collection().
+		virtual void begin_object_collection (const object* obj, const serialization_plan& plan, size_t prop_index, const object_collection_i* collection) = 0;
+		virtual void begin_collection_child (size_t index) { }
+
+		// Called before each child; returns how many children, starting with the one at "index", the writer took care of
+		// some other way (incremental serializers copy runs of children that didn't change). Those are skipped, with no
+		// begin_collection_child() call for them.
+		virtual size_t skip_collection_children (size_t index) { return 0; }
+		virtual void end_object_collection() = 0;
+
+		virtual void write_value_collection (const object* obj, const serialization_plan& plan, size_t prop_index) = 0;
+
+		// Followed by the object, which is not null.
+		virtual void begin_object_property (const object* obj, const serialization_plan& plan, size_t prop_index) = 0;
+
+		// Writers that return true here write the values of types with a generated serializer by calling it;
+		// for such objects the "values" passed to begin_object are empty and the values are not looked at by write_object().
+		virtual bool uses_generated_serializers() const { return false; }
+	};
+
+	// Same order as the original XML serializer: value properties (as attributes), then value collections, object collections
+	// and object properties in the order of the type's properties. The children of variable-size collections are forced,
+	// those of preallocated collections and object properties are not.
+	void write_object (object_writer_i& writer, const object* obj, bool force_serialize_unchanged);
+}
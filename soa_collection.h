@@ -0,0 +1,252 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "collections.h"
+#include <tuple>
+
+namespace edge
+{
+	// Structure-of-arrays storage: one contiguous vector per column, all of the same length.
+	template<typename... column_ts>
+	class soa_table
+	{
+		std::tuple<std::vector<column_ts>...> _columns;
+
+	public:
+		using row_t = std::tuple<column_ts...>;
+
+		size_t size() const { return std::get<0>(_columns).size(); }
+
+		template<size_t column_index>
+		std::span<const std::tuple_element_t<column_index, row_t>> column() const { return std::get<column_index>(_columns); }
+
+		template<size_t column_index>
+		std::span<std::tuple_element_t<column_index, row_t>> column() { return std::get<column_index>(_columns); }
+
+		void reserve (size_t capacity)
+		{
+			std::apply ([capacity](auto&... columns) { (columns.reserve(capacity), ...); }, _columns);
+		}
+
+		void insert_row (size_t index, const row_t& values)
+		{
+			insert_row_internal (index, values, std::index_sequence_for<column_ts...>());
+		}
+
+		row_t erase_row (size_t index)
+		{
+			return erase_row_internal (index, std::index_sequence_for<column_ts...>());
+		}
+
+		// Inserts "count" rows at "index", moving the rows after them once. Row i of them gets the values get_values(i).
+		template<typename get_values_t>
+		void insert_rows (size_t index, size_t count, get_values_t get_values)
+		{
+			insert_rows_internal (index, count, get_values, std::index_sequence_for<column_ts...>());
+		}
+
+		// Erases the rows at "indexes" (ascending, no duplicates) in a single pass over each column,
+		// calling erased(i, values) for each of them first.
+		template<typename erased_t>
+		void erase_rows (std::span<const size_t> indexes, erased_t erased)
+		{
+			for (size_t i = 0; i < indexes.size(); i++)
+				erased (i, get_row(indexes[i]));
+			if (!indexes.empty())
+				std::apply ([indexes](auto&... columns) { (compact_column(columns, indexes), ...); }, _columns);
+		}
+
+		row_t get_row (size_t index) const
+		{
+			return std::apply ([index](auto&... columns) { return row_t { columns[index]... }; }, _columns);
+		}
+
+		void set_row (size_t index, const row_t& values)
+		{
+			set_row_internal (index, values, std::index_sequence_for<column_ts...>());
+		}
+
+	private:
+		template<size_t... I>
+		void insert_row_internal (size_t index, const row_t& values, std::index_sequence<I...>)
+		{
+			(std::get<I>(_columns).insert(std::get<I>(_columns).begin() + index, std::get<I>(values)), ...);
+		}
+
+		template<size_t... I>
+		void set_row_internal (size_t index, const row_t& values, std::index_sequence<I...>)
+		{
+			((std::get<I>(_columns)[index] = std::get<I>(values)), ...);
+		}
+
+		template<size_t... I>
+		row_t erase_row_internal (size_t index, std::index_sequence<I...>)
+		{
+			row_t values = { std::get<I>(_columns)[index]... };
+			(std::get<I>(_columns).erase(std::get<I>(_columns).begin() + index), ...);
+			return values;
+		}
+
+		template<typename get_values_t, size_t... I>
+		void insert_rows_internal (size_t index, size_t count, get_values_t& get_values, std::index_sequence<I...>)
+		{
+			(std::get<I>(_columns).insert(std::get<I>(_columns).begin() + index, count, { }), ...);
+			for (size_t i = 0; i < count; i++)
+			{
+				const row_t& values = get_values(i);
+				((std::get<I>(_columns)[index + i] = std::get<I>(values)), ...);
+			}
+		}
+
+		template<typename column_t>
+		static void compact_column (column_t& column, std::span<const size_t> indexes)
+		{
+			size_t to = indexes.front();
+			size_t next = 0;
+			for (size_t from = indexes.front(); from < column.size(); from++)
+			{
+				if ((next < indexes.size()) && (indexes[next] == from))
+					next++;
+				else
+					column[to++] = column[from];
+			}
+			column.resize(to);
+		}
+	};
+
+	template<typename child_t, typename store_t = std::vector<std::unique_ptr<child_t>>>
+	struct soa_object_collection_i;
+
+	// Base class for objects whose numeric values live in the soa_table of the soa_object_collection_i that holds them.
+	// The object itself is then only a lightweight proxy: its getters and setters (and so the reflection properties
+	// built on them) read and write its row of the table. While the object is not in such a collection, the values
+	// are kept in the object itself, and they're moved in and out of the table as the object is inserted and removed.
+	//
+	// A derived class exposes a column through reflection by giving the property a getter that returns column_value<I>()
+	// and a setter that calls set_column_value<I>() (raising property_changing / property_changed as any other setter would).
+	template<typename... column_ts>
+	class soa_row_object : public object
+	{
+		template<typename child_t, typename store_t>
+		friend struct soa_object_collection_i;
+
+	public:
+		using table_t = soa_table<column_ts...>;
+
+	private:
+		table_t* _table = nullptr;
+		size_t _row = 0;
+		typename table_t::row_t _detached_values = { };
+
+	protected:
+		template<size_t column_index>
+		auto column_value() const
+		{
+			return _table ? _table->template column<column_index>()[_row] : std::get<column_index>(_detached_values);
+		}
+
+		template<size_t column_index>
+		void set_column_value (std::tuple_element_t<column_index, typename table_t::row_t> value)
+		{
+			if (_table)
+				_table->template column<column_index>()[_row] = value;
+			else
+				std::get<column_index>(_detached_values) = value;
+		}
+	};
+
+	// Object collection whose children (of type child_t, derived from soa_row_object) keep their numeric values
+	// in a soa_table, in the same order as the children, so that column scans ("sum all X", "find all with Y > k")
+	// go through contiguous arrays instead of chasing a pointer per child.
+	//
+	// Ranges of children (insert_range, remove_range, remove of several children) are handled in on_children_inserted and
+	// on_children_removed, which move the rows and renumber the children once for the whole range, without calling
+	// on_child_inserted / on_child_removed for each child.
+	//
+	// A class that derives from this and overrides on_child_inserted, on_child_removed, on_children_inserted, on_children_removed
+	// or on_children_reordered must call the base class functions.
+	template<typename child_t, typename store_t>
+	struct soa_object_collection_i : typed_object_collection_i<child_t, store_t>
+	{
+		using table_t = typename child_t::table_t;
+
+	private:
+		table_t _table;
+
+	public:
+		const table_t& table() const { return _table; }
+
+	protected:
+		// Children are bound to rows after they're in the store, and unbound after they're out of it.
+		virtual void on_child_inserted (size_t index, child_t* child) override
+		{
+			assert (child->_table == nullptr);
+			_table.insert_row (index, child->_detached_values);
+			child->_table = &_table;
+			renumber (index);
+		}
+
+		virtual void on_children_inserted (size_t index, size_t count) override
+		{
+			auto& children = this->children();
+			_table.insert_rows (index, count, [&children, index](size_t i) -> auto& { return children[index + i]->_detached_values; });
+			for (size_t i = index; i < index + count; i++)
+			{
+				assert (children[i]->_table == nullptr);
+				children[i]->_table = &_table;
+			}
+			renumber (index);
+		}
+
+		virtual void on_children_removed (std::span<const size_t> indexes, std::span<const std::unique_ptr<child_t>> removed) override
+		{
+			_table.erase_rows (indexes, [this, removed](size_t i, typename table_t::row_t&& values)
+			{
+				assert (removed[i]->_table == &_table);
+				removed[i]->_detached_values = std::move(values);
+				removed[i]->_table = nullptr;
+			});
+			if (!indexes.empty())
+				renumber (indexes.front());
+		}
+
+		// Each child knows its row, which is also its index.
+		virtual size_t find_index (const child_t* child) const override
+		{
+			return (child->_table == &_table) ? child->_row : (size_t)-1;
+		}
+
+		virtual void on_children_reordered (size_t index, size_t count) override
+		{
+			// Each child still points to its old row; gather the rows in the new order, then write them back.
+			auto& children = this->children();
+			std::vector<typename table_t::row_t> rows;
+			rows.reserve(count);
+			for (size_t i = index; i < index + count; i++)
+				rows.push_back(_table.get_row(children[i]->_row));
+			for (size_t i = 0; i < count; i++)
+			{
+				_table.set_row (index + i, rows[i]);
+				children[index + i]->_row = index + i;
+			}
+		}
+
+		virtual void on_child_removed (size_t index, child_t* child) override
+		{
+			assert (child->_table == &_table);
+			child->_detached_values = _table.erase_row(index);
+			child->_table = nullptr;
+			renumber (index);
+		}
+
+	private:
+		void renumber (size_t from)
+		{
+			auto& children = this->children();
+			for (size_t i = from; i < children.size(); i++)
+				children[i]->_row = i;
+		}
+	};
+}
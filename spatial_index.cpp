@@ -0,0 +1,420 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "spatial_index.h"
+#include <cmath>
+#include <queue>
+
+namespace edge
+{
+	static spatial_rect union_of (const spatial_rect& a, const spatial_rect& b)
+	{
+		return { std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right), std::max(a.bottom, b.bottom) };
+	}
+
+	static float area_of (const spatial_rect& r)
+	{
+		return (r.right - r.left) * (r.bottom - r.top);
+	}
+
+	static spatial_point center_of (const spatial_rect& r)
+	{
+		return { (r.left + r.right) / 2, (r.top + r.bottom) / 2 };
+	}
+
+	static float distance (spatial_point p, const spatial_rect& r)
+	{
+		float dx = std::max ({ r.left - p.x, 0.0f, p.x - r.right });
+		float dy = std::max ({ r.top - p.y, 0.0f, p.y - r.bottom });
+		return std::sqrt (dx * dx + dy * dy);
+	}
+
+	// Sort-Tile-Recursive packing: sorts the items into vertical slices by x, sorts each slice by y,
+	// and cuts each slice into runs of node_size items, calling make_node for each run.
+	template<typename item_t, typename bounds_of_t, typename make_node_t>
+	static void str_pack (std::vector<item_t>& items, size_t node_size, bounds_of_t bounds_of, make_node_t make_node)
+	{
+		size_t node_count = (items.size() + node_size - 1) / node_size;
+		size_t slice_size = (size_t)std::ceil(std::sqrt((double)node_count)) * node_size;
+
+		std::sort (items.begin(), items.end(), [&](auto& a, auto& b) { return center_of(bounds_of(a)).x < center_of(bounds_of(b)).x; });
+		for (size_t slice = 0; slice < items.size(); slice += slice_size)
+		{
+			size_t slice_end = std::min (slice + slice_size, items.size());
+			std::sort (items.begin() + slice, items.begin() + slice_end, [&](auto& a, auto& b) { return center_of(bounds_of(a)).y < center_of(bounds_of(b)).y; });
+			for (size_t i = slice; i < slice_end; i += node_size)
+				make_node (i, std::min(i + node_size, slice_end));
+		}
+	}
+
+	spatial_index::spatial_index (object* root, bounds_getter_t bounds_getter)
+		: tree_observer(root), _bounds_getter(bounds_getter)
+	{
+		// The objects already in the tree are loaded all at once, which is much faster
+		// than inserting them one by one, and gives a tree with less overlap between nodes.
+		start();
+		_bulk_loading = false;
+		bulk_load (std::move(_bulk_entries));
+	}
+
+	void spatial_index::on_attached (object* obj)
+	{
+		spatial_rect bounds;
+		if (!_bounds_getter(obj, bounds))
+			return;
+
+		if (_bulk_loading)
+			_bulk_entries.push_back({ bounds, obj });
+		else
+			insert({ bounds, obj });
+	}
+
+	void spatial_index::on_detaching (object* obj)
+	{
+		if (_leaves.find(obj) != _leaves.end())
+			remove(obj);
+	}
+
+	void spatial_index::on_property_changed (object* obj, const property_change_args& args)
+	{
+		invalidate(obj);
+	}
+
+	void spatial_index::invalidate (object* obj)
+	{
+		spatial_rect bounds;
+		bool has_bounds = _bounds_getter(obj, bounds);
+
+		auto it = _leaves.find(obj);
+		if (it == _leaves.end())
+		{
+			if (has_bounds)
+				insert({ bounds, obj });
+			return;
+		}
+
+		if (!has_bounds)
+		{
+			remove(obj);
+			return;
+		}
+
+		// An object that stays within the bounds of its leaf (say, one moved by a small amount) stays in that leaf.
+		// The bounds of the leaf and of its ancestors may then be larger than needed, which is harmless for queries.
+		node* leaf = it->second;
+		if (leaf->bounds.contains(bounds))
+		{
+			std::find_if (leaf->entries.begin(), leaf->entries.end(), [obj](const entry& e) { return e.obj == obj; })->bounds = bounds;
+			return;
+		}
+
+		remove(obj);
+		insert({ bounds, obj });
+	}
+
+	void spatial_index::recompute_bounds (node* n)
+	{
+		assert (n->size() > 0);
+		if (n->is_leaf)
+		{
+			n->bounds = n->entries[0].bounds;
+			for (auto& e : n->entries)
+				n->bounds = union_of (n->bounds, e.bounds);
+		}
+		else
+		{
+			n->bounds = n->children[0]->bounds;
+			for (auto& c : n->children)
+				n->bounds = union_of (n->bounds, c->bounds);
+		}
+	}
+
+	spatial_index::node* spatial_index::choose_leaf (const spatial_rect& bounds) const
+	{
+		// Descend into the child whose bounds grow the least, and of those the smallest.
+		node* n = _root.get();
+		while (!n->is_leaf)
+		{
+			node* best = nullptr;
+			float best_enlargement = 0;
+			float best_area = 0;
+			for (auto& c : n->children)
+			{
+				float area = area_of(c->bounds);
+				float enlargement = area_of(union_of(c->bounds, bounds)) - area;
+				if (!best || (enlargement < best_enlargement) || ((enlargement == best_enlargement) && (area < best_area)))
+				{
+					best = c.get();
+					best_enlargement = enlargement;
+					best_area = area;
+				}
+			}
+
+			n = best;
+		}
+
+		return n;
+	}
+
+	void spatial_index::add_child (node* parent, std::unique_ptr<node>&& child)
+	{
+		child->parent = parent;
+		parent->bounds = parent->children.empty() ? child->bounds : union_of(parent->bounds, child->bounds);
+		parent->children.push_back(std::move(child));
+	}
+
+	void spatial_index::insert (const entry& e)
+	{
+		node* leaf = choose_leaf(e.bounds);
+		leaf->entries.push_back(e);
+		_leaves[e.obj] = leaf;
+
+		leaf->bounds = (leaf->entries.size() == 1) ? e.bounds : union_of(leaf->bounds, e.bounds);
+		for (node* n = leaf->parent; n != nullptr; n = n->parent)
+			n->bounds = union_of (n->bounds, e.bounds);
+
+		// Split the nodes that became too big, from the leaf up, growing a new root if the old one is split.
+		for (node* n = leaf; n->size() > max_node_size; n = n->parent)
+		{
+			auto sibling = split(n);
+			if (n == _root.get())
+			{
+				auto old_root = std::move(_root);
+				_root = std::make_unique<node>(false);
+				add_child (_root.get(), std::move(old_root));
+				add_child (_root.get(), std::move(sibling));
+				break;
+			}
+
+			add_child (n->parent, std::move(sibling));
+		}
+	}
+
+	std::unique_ptr<spatial_index::node> spatial_index::split (node* n)
+	{
+		// Cuts the node in two halves along its longer side.
+		bool by_x = (n->bounds.right - n->bounds.left) >= (n->bounds.bottom - n->bounds.top);
+		auto less = [by_x](const spatial_rect& a, const spatial_rect& b)
+		{
+			auto ca = center_of(a);
+			auto cb = center_of(b);
+			return by_x ? (ca.x < cb.x) : (ca.y < cb.y);
+		};
+
+		auto sibling = std::make_unique<node>(n->is_leaf);
+		size_t half = n->size() / 2;
+		if (n->is_leaf)
+		{
+			auto& entries = n->entries;
+			std::nth_element (entries.begin(), entries.begin() + half, entries.end(), [&less](const entry& a, const entry& b) { return less(a.bounds, b.bounds); });
+			sibling->entries.assign (entries.begin() + half, entries.end());
+			entries.resize(half);
+			for (auto& e : sibling->entries)
+				_leaves[e.obj] = sibling.get();
+		}
+		else
+		{
+			auto& children = n->children;
+			std::nth_element (children.begin(), children.begin() + half, children.end(), [&less](auto& a, auto& b) { return less(a->bounds, b->bounds); });
+			sibling->children.assign (std::make_move_iterator(children.begin() + half), std::make_move_iterator(children.end()));
+			children.resize(half);
+			for (auto& c : sibling->children)
+				c->parent = sibling.get();
+		}
+
+		recompute_bounds(n);
+		recompute_bounds(sibling.get());
+		return sibling;
+	}
+
+	void spatial_index::remove (object* obj)
+	{
+		auto it = _leaves.find(obj);
+		assert (it != _leaves.end());
+		node* leaf = it->second;
+		_leaves.erase(it);
+
+		auto& entries = leaf->entries;
+		auto e = std::find_if (entries.begin(), entries.end(), [obj](const entry& e) { return e.obj == obj; });
+		*e = entries.back();
+		entries.pop_back();
+
+		condense(leaf);
+	}
+
+	void spatial_index::collect_entries (const node* n, std::vector<entry>& to)
+	{
+		if (n->is_leaf)
+			to.insert (to.end(), n->entries.begin(), n->entries.end());
+		else
+		{
+			for (auto& c : n->children)
+				collect_entries (c.get(), to);
+		}
+	}
+
+	void spatial_index::collect_objects (const node* n, std::vector<object*>& to)
+	{
+		if (n->is_leaf)
+		{
+			for (auto& e : n->entries)
+				to.push_back(e.obj);
+		}
+		else
+		{
+			for (auto& c : n->children)
+				collect_objects (c.get(), to);
+		}
+	}
+
+	void spatial_index::condense (node* n)
+	{
+		// Nodes left with too few children are taken out of the tree, and their entries inserted again from the root.
+		std::vector<entry> orphans;
+		while (n != _root.get())
+		{
+			node* parent = n->parent;
+			if (n->size() < min_node_size)
+			{
+				collect_entries (n, orphans);
+				auto it = std::find_if (parent->children.begin(), parent->children.end(), [n](auto& c) { return c.get() == n; });
+				parent->children.erase(it);
+			}
+			else
+				recompute_bounds(n);
+
+			n = parent;
+		}
+
+		while (!_root->is_leaf && (_root->children.size() == 1))
+		{
+			auto child = std::move(_root->children[0]);
+			child->parent = nullptr;
+			_root = std::move(child);
+		}
+
+		if (_root->size() > 0)
+			recompute_bounds(_root.get());
+		else if (!_root->is_leaf)
+			_root = std::make_unique<node>(true);
+
+		for (auto& e : orphans)
+			insert(e);
+	}
+
+	void spatial_index::bulk_load (std::vector<entry>&& entries)
+	{
+		assert (_leaves.empty());
+		if (entries.empty())
+			return;
+
+		_leaves.reserve(entries.size());
+
+		std::vector<std::unique_ptr<node>> level;
+		str_pack (entries, max_node_size, [](const entry& e) -> const spatial_rect& { return e.bounds; }, [this, &entries, &level](size_t begin, size_t end)
+		{
+			auto leaf = std::make_unique<node>(true);
+			leaf->entries.assign (entries.begin() + begin, entries.begin() + end);
+			for (auto& e : leaf->entries)
+				_leaves.insert({ e.obj, leaf.get() });
+			recompute_bounds(leaf.get());
+			level.push_back(std::move(leaf));
+		});
+
+		while (level.size() > 1)
+		{
+			std::vector<std::unique_ptr<node>> upper_level;
+			str_pack (level, max_node_size, [](const std::unique_ptr<node>& n) -> const spatial_rect& { return n->bounds; }, [&level, &upper_level](size_t begin, size_t end)
+			{
+				auto inner = std::make_unique<node>(false);
+				for (size_t i = begin; i < end; i++)
+				{
+					level[i]->parent = inner.get();
+					inner->children.push_back(std::move(level[i]));
+				}
+				recompute_bounds(inner.get());
+				upper_level.push_back(std::move(inner));
+			});
+
+			level = std::move(upper_level);
+		}
+
+		_root = std::move(level[0]);
+	}
+
+	void spatial_index::query_rect (const spatial_rect& rect, std::vector<object*>& result) const
+	{
+		std::vector<const node*> stack = { _root.get() };
+		while (!stack.empty())
+		{
+			const node* n = stack.back();
+			stack.pop_back();
+			if (n->is_leaf)
+			{
+				for (auto& e : n->entries)
+				{
+					if (rect.intersects(e.bounds))
+						result.push_back(e.obj);
+				}
+			}
+			else
+			{
+				for (auto& c : n->children)
+				{
+					if (rect.contains(c->bounds))
+						collect_objects (c.get(), result);
+					else if (rect.intersects(c->bounds))
+						stack.push_back(c.get());
+				}
+			}
+		}
+	}
+
+	void spatial_index::query_point (spatial_point p, float tolerance, std::vector<object*>& result) const
+	{
+		query_rect ({ p.x - tolerance, p.y - tolerance, p.x + tolerance, p.y + tolerance }, result);
+	}
+
+	object* spatial_index::nearest (spatial_point p, float max_distance) const
+	{
+		// Best-first search: nodes and entries are visited in the order of their distance from "p",
+		// so the first entry taken from the queue is the nearest one.
+		struct candidate
+		{
+			float distance;
+			const node* n;
+			object* obj;
+
+			bool operator> (const candidate& other) const { return distance > other.distance; }
+		};
+
+		std::priority_queue<candidate, std::vector<candidate>, std::greater<candidate>> queue;
+		if (_root->size() > 0)
+			queue.push({ distance(p, _root->bounds), _root.get(), nullptr });
+
+		while (!queue.empty())
+		{
+			candidate c = queue.top();
+			queue.pop();
+			if (c.distance > max_distance)
+				break;
+
+			if (c.obj)
+				return c.obj;
+
+			if (c.n->is_leaf)
+			{
+				for (auto& e : c.n->entries)
+					queue.push({ distance(p, e.bounds), nullptr, e.obj });
+			}
+			else
+			{
+				for (auto& child : c.n->children)
+					queue.push({ distance(p, child->bounds), child.get(), nullptr });
+			}
+		}
+
+		return nullptr;
+	}
+}
@@ -0,0 +1,107 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "tree_observer.h"
+#include <limits>
+
+namespace edge
+{
+	// Same layout as D2D1_POINT_2F and D2D1_RECT_F, without depending on Direct2D.
+	struct spatial_point
+	{
+		float x;
+		float y;
+	};
+
+	struct spatial_rect
+	{
+		float left;
+		float top;
+		float right;
+		float bottom;
+
+		bool contains (spatial_point p) const { return (p.x >= left) && (p.x <= right) && (p.y >= top) && (p.y <= bottom); }
+		bool contains (const spatial_rect& r) const { return (r.left >= left) && (r.right <= right) && (r.top >= top) && (r.bottom <= bottom); }
+		bool intersects (const spatial_rect& r) const { return (r.left <= right) && (r.right >= left) && (r.top <= bottom) && (r.bottom >= top); }
+	};
+
+	// R-tree over the objects of a tree that have bounds, for hit-testing and culling without looking at every object.
+	//
+	// Which objects have bounds, and what they are, is up to the bounds function; it is called when an object is attached
+	// (at construction, or when inserted into a collection somewhere in the tree), and again whenever one of the object's
+	// properties changes. Bounds that depend on something else (the properties of other objects, say) must be
+	// brought up to date by calling invalidate().
+	//
+	// The queries return candidates by their bounds; exact hit-testing (against a line's width, for example) is left to the caller.
+	// Results come in no particular order. (A query rect that covers most of the drawing is no faster than looking at every object.)
+	class spatial_index : public tree_observer
+	{
+	public:
+		// Returns false for objects that are not to be indexed.
+		using bounds_getter_t = bool(*)(const object* obj, spatial_rect& bounds);
+
+	private:
+		static constexpr size_t max_node_size = 16;
+		static constexpr size_t min_node_size = max_node_size * 2 / 5;
+
+		struct entry
+		{
+			spatial_rect bounds;
+			object* obj;
+		};
+
+		struct node
+		{
+			node* parent = nullptr;
+			spatial_rect bounds = { };
+			bool is_leaf;
+			std::vector<entry> entries;                 // for leaves
+			std::vector<std::unique_ptr<node>> children; // for inner nodes
+
+			node (bool is_leaf) : is_leaf(is_leaf) { }
+			size_t size() const { return is_leaf ? entries.size() : children.size(); }
+		};
+
+		bounds_getter_t const _bounds_getter;
+		std::unique_ptr<node> _root = std::make_unique<node>(true);
+		std::unordered_map<const object*, node*> _leaves;
+		bool _bulk_loading = true;
+		std::vector<entry> _bulk_entries;
+
+	public:
+		spatial_index (object* root, bounds_getter_t bounds_getter);
+
+		size_t size() const { return _leaves.size(); }
+
+		// Objects whose bounds intersect "rect" (culling).
+		void query_rect (const spatial_rect& rect, std::vector<object*>& result) const;
+
+		// Objects whose bounds, inflated by "tolerance", contain "p" (hit-testing).
+		void query_point (spatial_point p, float tolerance, std::vector<object*>& result) const;
+
+		// Object whose bounds are closest to "p" (distance zero if "p" is inside them), or nullptr if none is closer than max_distance.
+		object* nearest (spatial_point p, float max_distance = std::numeric_limits<float>::infinity()) const;
+
+		// Calls the bounds function for "obj" again, and moves it in the index if its bounds changed.
+		void invalidate (object* obj);
+
+	protected:
+		virtual void on_attached (object* obj) override;
+		virtual void on_detaching (object* obj) override;
+		virtual void on_property_changed (object* obj, const property_change_args& args) override;
+
+	private:
+		void insert (const entry& e);
+		void remove (object* obj);
+		node* choose_leaf (const spatial_rect& bounds) const;
+		void add_child (node* parent, std::unique_ptr<node>&& child);
+		std::unique_ptr<node> split (node* n);
+		void condense (node* leaf);
+		static void recompute_bounds (node* n);
+		static void collect_entries (const node* n, std::vector<entry>& to);
+		static void collect_objects (const node* n, std::vector<object*>& to);
+		void bulk_load (std::vector<entry>&& entries);
+	};
+}
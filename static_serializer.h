@@ -0,0 +1,137 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "serializer.h"
+#include "xml_writer.h"
+#include <utility>
+
+namespace edge
+{
+	template<typename T>
+	struct static_value_property_traits { };
+
+	template<typename property_traits>
+	struct static_value_property_traits<static_value_property<property_traits>>
+	{
+		using type = property_traits;
+	};
+
+	// Generates the value serialization routines of a type whose properties are all static variables of type
+	// static_value_property, as a generated_serializer. "props" must be the type's whole property_list(), in the same
+	// order (base type properties first); this is checked when the type's serialization plan is built.
+	// The getters and setters are called directly rather than through value_property, so the compiler can inline them
+	// when the definitions of the properties are visible where static_serializer is instantiated.
+	//
+	// Types with collection or object properties, or with properties of classes derived from static_value_property
+	// (which can override changed_from_default, for example), are not supported; they use the virtual path.
+	//
+	//   const generated_xtype<static_serializer<node::x_p, node::y_p>> node::_type = { "Node", nullptr, node::_props, ... };
+	template<const auto&... props>
+	class static_serializer
+	{
+		template<const auto& prop>
+		using traits_of = typename static_value_property_traits<std::remove_cv_t<std::remove_reference_t<decltype(prop)>>>::type;
+
+		static_assert (sizeof...(props) > 0);
+
+		// Same choice as the one in write_object(): the property can be set and its value changed from default.
+		template<size_t index, const auto& prop>
+		static bool changed (const object* obj, const property_bitset* bits)
+		{
+			if (prop._setter.is_null())
+				return false;
+
+			if (!prop.default_value)
+				return true;
+
+			return bits ? bits->test(index) : (prop._getter.get(obj) != prop.default_value.value());
+		}
+
+		// Same as static_value_property::set, with the property index known.
+		template<size_t index, const auto& prop>
+		static void set (typename traits_of<prop>::value_t value, object* obj, property_bitset* bits)
+		{
+			prop._setter.set (value, obj);
+			if (prop.default_value && bits)
+				bits->set (index, value != prop.default_value.value());
+		}
+
+		template<size_t index, const auto& prop>
+		static void read_binary (binary_reader& from, object* obj, property_bitset* bits)
+		{
+			typename traits_of<prop>::value_t value;
+			traits_of<prop>::deserialize (from, value);
+			set<index, prop>(value, obj, bits);
+		}
+
+		template<size_t index, const auto& prop>
+		static void read_string (std::string_view from, object* obj, property_bitset* bits)
+		{
+			typename traits_of<prop>::value_t value;
+			traits_of<prop>::from_string (from, value);
+			set<index, prop>(value, obj, bits);
+		}
+
+		template<const auto& prop>
+		static void write_attribute (const object* obj, xml_writer& to, std::string& buffer)
+		{
+			traits_of<prop>::to_string (prop._getter.get(obj), buffer);
+			to.attribute (prop._name, buffer);
+		}
+
+		template<size_t... I>
+		struct impl
+		{
+			static bool has_values (const object* obj, const serialization_plan& plan)
+			{
+				auto bits = obj->changed_from_default_bits();
+				return ((plan.props[I].is_factory_prop || changed<I, props>(obj, bits)) || ...);
+			}
+
+			static void write_binary_values (const object* obj, const serialization_plan& plan, out_stream_i* to)
+			{
+				auto bits = obj->changed_from_default_bits();
+				bool const write[] = { (!plan.props[I].is_factory_prop && changed<I, props>(obj, bits))... };
+				to->write_varint ((write[I] + ...));
+				((write[I] ? (to->write_varint(I), traits_of<props>::serialize(props._getter.get(obj), to)) : void()), ...);
+			}
+
+			static void write_xml_values (const object* obj, const serialization_plan& plan, xml_writer& to, std::string& buffer)
+			{
+				auto bits = obj->changed_from_default_bits();
+				(((plan.props[I].is_factory_prop || changed<I, props>(obj, bits)) ? write_attribute<props>(obj, to, buffer) : void()), ...);
+			}
+
+			static constexpr void (*read_binary_table[])(binary_reader&, object*, property_bitset*) = { &read_binary<I, props>... };
+			static constexpr void (*read_string_table[])(std::string_view, object*, property_bitset*) = { &read_string<I, props>... };
+		};
+
+		template<size_t... I>
+		static constexpr auto make_impl (std::index_sequence<I...>) -> impl<I...>;
+
+		using impl_t = decltype(make_impl(std::make_index_sequence<sizeof...(props)>()));
+
+		static constexpr const property* property_list[] = { &props... };
+
+	public:
+		static constexpr generated_serializer table = {
+			property_list,
+			&impl_t::has_values,
+			&impl_t::write_binary_values,
+			&impl_t::write_xml_values,
+			impl_t::read_binary_table,
+			impl_t::read_string_table,
+		};
+	};
+
+	// An xtype whose values are serialized by "serializer_t", an instantiation of static_serializer for the type's properties.
+	template<typename serializer_t, typename... factory_arg_property_traits>
+	struct generated_xtype : xtype<factory_arg_property_traits...>
+	{
+		using xtype<factory_arg_property_traits...>::xtype;
+
+		virtual const generated_serializer* get_generated_serializer() const override { return &serializer_t::table; }
+	};
+}
@@ -0,0 +1,100 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "background_saver.h"
+#include "xml_reader.h"
+#include <fstream>
+#include <iterator>
+
+using namespace test;
+
+struct listener
+{
+	std::vector<std::pair<std::filesystem::path, std::exception_ptr>> completed;
+	uint64_t last_written = 0;
+	uint64_t last_expected = 0;
+
+	void on_progress (background_saver*, uint64_t written, uint64_t expected)
+	{
+		CHECK(written >= last_written);
+		last_written = written;
+		last_expected = expected;
+	}
+
+	void on_completed (background_saver*, const std::filesystem::path& path, std::exception_ptr exception)
+	{
+		completed.push_back({ path, exception });
+	}
+};
+
+static std::vector<uint8_t> read_file (const std::filesystem::path& path)
+{
+	std::ifstream file (path, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+int main()
+{
+	auto r = make_tree(20'000);
+	auto expected = make_tree(20'000);
+	listener l;
+	{
+		background_saver saver (r.get(), known_types);
+		saver.save_progress().add_handler<&listener::on_progress>(&l);
+		saver.save_completed().add_handler<&listener::on_completed>(&l);
+
+		// The file has the tree as it was when save_async was called, whatever is changed afterwards.
+		saver.save_async ("background_saver_test.bin");
+		r->child_at(7)->set_x(777);
+		saver.save_async ("background_saver_test_2.bin");
+		saver.save_async ("background_saver_test.xml", save_format::xml);
+		r->child_at(8)->set_x(888);
+		saver.wait();
+		CHECK(!saver.busy());
+		CHECK((l.completed.size() == 3) && (l.completed[0].first == "background_saver_test.bin") && (l.completed[2].first == "background_saver_test.xml"));
+		for (auto& c : l.completed)
+			CHECK(c.second == nullptr);
+
+		auto first = from_binary(read_file("background_saver_test.bin"));
+		CHECK(same_tree(static_cast<root*>(first.get()), expected.get()));
+
+		expected->child_at(7)->set_x(777);
+		auto second = from_binary(read_file("background_saver_test_2.bin"));
+		CHECK(same_tree(static_cast<root*>(second.get()), expected.get()));
+
+		auto xml = read_file("background_saver_test.xml");
+		xml_reader reader (std::string_view(reinterpret_cast<const char*>(xml.data()), xml.size()));
+		reader.read();
+		auto third = deserialize (reader, known_types);
+		CHECK(same_tree(static_cast<root*>(third.get()), expected.get()));
+
+		// A save that fails is reported with its exception and leaves the destination as it was.
+		l.completed.clear();
+		auto before = read_file("background_saver_test.bin");
+		saver.save_async ("no_such_directory/background_saver_test.bin");
+		saver.save_async ("background_saver_test.bin");
+		saver.wait();
+		CHECK((l.completed.size() == 2) && (l.completed[0].second != nullptr) && (l.completed[1].second == nullptr));
+		CHECK(!std::filesystem::exists("no_such_directory"));
+		expected->child_at(8)->set_x(888);
+		auto fourth = from_binary(read_file("background_saver_test.bin"));
+		CHECK(same_tree(static_cast<root*>(fourth.get()), expected.get()) && (read_file("background_saver_test.bin") != before));
+		CHECK(!std::filesystem::exists("background_saver_test.bin.tmp"));
+
+		saver.save_completed().remove_handler<&listener::on_completed>(&l);
+		saver.save_progress().remove_handler<&listener::on_progress>(&l);
+	}
+
+	// Saves still queued when the saver is destroyed are finished.
+	{
+		background_saver saver (r.get(), known_types);
+		r->child_at(9)->set_x(999);
+		saver.save_async ("background_saver_test_2.bin");
+	}
+	expected->child_at(9)->set_x(999);
+	auto fifth = from_binary(read_file("background_saver_test_2.bin"));
+	CHECK(same_tree(static_cast<root*>(fifth.get()), expected.get()));
+
+	return 0;
+}
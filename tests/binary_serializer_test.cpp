@@ -0,0 +1,93 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include <cmath>
+#include <limits>
+
+using namespace test;
+
+template<typename traits>
+static void check_value_round_trip (typename traits::value_t value)
+{
+	vector_out_stream s;
+	traits::serialize (value, &s);
+	binary_reader reader = { s.buffer.data(), s.buffer.data() + s.buffer.size() };
+	typename traits::value_t read;
+	traits::deserialize (reader, read);
+	CHECK(reader.remaining() == 0);
+	if constexpr (std::is_floating_point_v<typename traits::value_t>)
+		CHECK((std::isnan(read) && std::isnan(value)) || (read == value));
+	else
+		CHECK(read == value);
+
+	// Every strict prefix of the encoding must be rejected rather than read past.
+	for (size_t size = 0; size < s.buffer.size(); size++)
+	{
+		binary_reader truncated = { s.buffer.data(), s.buffer.data() + size };
+		CHECK_THROWS(binary_read_exception, traits::deserialize(truncated, read));
+	}
+}
+
+static void test_value_encodings()
+{
+	for (bool v : { false, true })
+		check_value_round_trip<bool_property_traits>(v);
+	for (int32_t v : { std::numeric_limits<int32_t>::min(), -65, -64, -1, 0, 1, 63, 64, std::numeric_limits<int32_t>::max() })
+		check_value_round_trip<int32_property_traits>(v);
+	for (uint32_t v : { 0u, 127u, 128u, 16383u, 16384u, std::numeric_limits<uint32_t>::max() })
+		check_value_round_trip<uint32_property_traits>(v);
+	for (uint64_t v : { (uint64_t)0, (uint64_t)127, (uint64_t)128, (uint64_t)1 << 35, std::numeric_limits<uint64_t>::max() })
+		check_value_round_trip<uint64_property_traits>(v);
+	for (size_t v : { (size_t)0, (size_t)300, std::numeric_limits<size_t>::max() })
+		check_value_round_trip<size_t_property_traits>(v);
+	for (float v : { 0.0f, -0.0f, 1.5f, -3.25e30f, std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() })
+		check_value_round_trip<float_property_traits>(v);
+	for (side v : { side::left, side::top, side::right, side::bottom })
+		check_value_round_trip<enum_property_traits<side, side_type_name, side_nvps, false, unknown_enum_value_str>>(v);
+	for (const char* v : { "", "a", "a longer string, with spaces", "\xC3\xA9t\xC3\xA9" })
+		check_value_round_trip<temp_string_property_traits>(v);
+	for (std::string_view v : { std::string_view(), std::string_view("backed") })
+		check_value_round_trip<backed_string_property_traits>(v);
+
+	// Integers are varints: small values take one byte.
+	vector_out_stream s;
+	int32_property_traits::serialize (-1, &s);
+	uint64_property_traits::serialize (5, &s);
+	CHECK(s.buffer.size() == 2);
+}
+
+static void test_tree_round_trip()
+{
+	auto tree = make_tree(1000);
+	tree->child_at(1)->_name = std::string("embedded\0nul", 12);
+	auto data = to_binary(tree.get());
+	auto loaded = from_binary(data);
+	CHECK(same_tree(tree.get(), static_cast<root*>(loaded.get())));
+
+	// Loading into an existing object.
+	root existing;
+	binary_reader reader = { data.data(), data.data() + data.size() };
+	deserialize_to (reader, &existing, known_types);
+	CHECK(same_tree(tree.get(), &existing));
+
+	// Truncated or corrupted documents throw instead of reading past the end.
+	for (size_t size : { (size_t)0, (size_t)3, (size_t)10, (size_t)50, data.size() / 2, data.size() - 1 })
+	{
+		binary_reader truncated = { data.data(), data.data() + size };
+		CHECK_THROWS(binary_read_exception, deserialize(truncated, known_types));
+	}
+
+	// A document that uses a type the reader doesn't know.
+	const concrete_type* const only_root[] = { &root::_type };
+	binary_reader unknown = { data.data(), data.data() + data.size() };
+	CHECK_THROWS(binary_read_exception, deserialize(unknown, only_root));
+}
+
+int main()
+{
+	test_value_encodings();
+	test_tree_round_trip();
+	return 0;
+}
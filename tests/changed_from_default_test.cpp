@@ -0,0 +1,82 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "wide_item.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+
+using namespace test;
+
+using tracked_item = wide_item<true>;
+
+template<typename item_t>
+static std::string to_xml (const object* obj)
+{
+	vector_out_stream s;
+	{
+		xml_writer writer (&s);
+		serialize (writer, obj, true);
+	}
+	return std::string(s.buffer.begin(), s.buffer.end());
+}
+
+int main()
+{
+	auto& p3 = tracked_item::props[3];
+	auto& p17 = tracked_item::props[17];
+
+	tracked_item item;
+	CHECK(!item._bits.any());
+	CHECK(!p3.changed_from_default(&item));
+
+	p3.set (5, &item);
+	CHECK(item._values[3] == 5);
+	CHECK(item._bits.test(3) && p3.changed_from_default(&item));
+
+	p17.set (-1, &item);
+	CHECK(item._bits.test(17) && p17.changed_from_default(&item));
+
+	p3.set (0, &item);
+	CHECK(!item._bits.test(3) && !p3.changed_from_default(&item));
+
+	p17.reset_to_default (&item);
+	CHECK((item._values[17] == 0) && !item._bits.any());
+
+	// Saving writes exactly the values whose bit is set, and loading sets the bits again.
+	item_list<tracked_item> list;
+	for (int i = 0; i < 100; i++)
+	{
+		auto it = std::make_unique<tracked_item>();
+		tracked_item::props[i % 20].set (i + 1, it.get());
+		list.append(std::move(it));
+	}
+
+	const concrete_type* const types[] = { &tracked_item::_type, &item_list<tracked_item>::_type };
+	auto data = to_binary(&list);
+	binary_reader reader = { data.data(), data.data() + data.size() };
+	auto loaded = deserialize(reader, types);
+	auto& loaded_list = *static_cast<item_list<tracked_item>*>(loaded.get());
+	CHECK(loaded_list.child_count() == 100);
+	for (int i = 0; i < 100; i++)
+	{
+		auto it = loaded_list.child_at(i);
+		CHECK(it->_values == list.child_at(i)->_values);
+		for (int p = 0; p < 20; p++)
+			CHECK(it->_bits.test(p) == (p == i % 20));
+	}
+
+	auto xml = to_xml<tracked_item>(&list);
+	xml_reader xr (xml);
+	xr.read();
+	auto xml_loaded = deserialize(xr, types);
+	CHECK(to_binary(xml_loaded.get()) == data);
+
+	// A value changed without going through the property isn't seen until the bit is updated.
+	list.child_at(0)->_values[5] = 9;
+	CHECK(to_binary(&list) == data);
+	list.child_at(0)->_bits.set(5, true);
+	CHECK(to_binary(&list) != data);
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Random inserts and erases on the child stores, single and in ranges, checked against a std::vector.
+
+#include "test_support.h"
+#include "child_stores.h"
+#include <random>
+
+using namespace test;
+
+template<typename store_t>
+static void check_same (const store_t& store, const std::vector<int*>& model)
+{
+	CHECK(store.size() == model.size());
+	CHECK(store.empty() == model.empty());
+	for (size_t i = 0; i < model.size(); i++)
+		CHECK(store[i].get() == model[i]);
+
+	size_t i = 0;
+	for (auto& p : store)
+		CHECK(p.get() == model[i++]);
+	CHECK(i == model.size());
+
+	if (!model.empty())
+		CHECK(store.back().get() == model.back());
+}
+
+// "max_size" keeps the size going up and down around it, so that nodes / segments are split and merged many times.
+template<typename store_t>
+static void random_operations (uint32_t seed, size_t operation_count, size_t max_size)
+{
+	std::mt19937 rng (seed);
+	store_t store;
+	std::vector<int*> model;
+	int next_value = 0;
+
+	for (size_t op = 0; op < operation_count; op++)
+	{
+		size_t size = model.size();
+		bool grow = (size < max_size / 2) || ((size < max_size) && (rng() % 2 == 0));
+		switch (rng() % 4)
+		{
+			case 0:
+				if (grow)
+				{
+					size_t index = rng() % (size + 1);
+					auto p = std::make_unique<int>(next_value++);
+					model.insert (model.begin() + index, p.get());
+					store.insert (index, std::move(p));
+				}
+				break;
+
+			case 1:
+				if (grow)
+				{
+					size_t index = rng() % (size + 1);
+					std::vector<std::unique_ptr<int>> ps;
+					for (size_t i = 0, count = rng() % 300; i < count; i++)
+					{
+						ps.push_back(std::make_unique<int>(next_value++));
+						model.insert (model.begin() + index + i, ps.back().get());
+					}
+					store.insert (index, std::move(ps));
+				}
+				break;
+
+			case 2:
+				if (size)
+				{
+					size_t index = rng() % size;
+					auto p = store.erase(index);
+					CHECK(p.get() == model[index]);
+					model.erase (model.begin() + index);
+				}
+				break;
+
+			default:
+				if (size)
+				{
+					size_t index = rng() % size;
+					size_t count = std::min<size_t>(size - index, rng() % 200);
+					std::vector<std::unique_ptr<int>> erased;
+					erased.push_back(nullptr); // erase appends
+					store.erase (index, count, erased);
+					CHECK((erased.size() == count + 1) && (erased[0] == nullptr));
+					for (size_t i = 0; i < count; i++)
+						CHECK(erased[i + 1].get() == model[index + i]);
+					model.erase (model.begin() + index, model.begin() + index + count);
+				}
+				break;
+		}
+
+		if (op % 100 == 0)
+			check_same (store, model);
+	}
+
+	check_same (store, model);
+
+	// Down to empty and back.
+	std::vector<std::unique_ptr<int>> erased;
+	store.erase (0, store.size(), erased);
+	model.clear();
+	check_same (store, model);
+	store.insert (0, std::make_unique<int>(0));
+	CHECK(store.size() == 1);
+}
+
+int main()
+{
+	for (uint32_t seed = 1; seed <= 10; seed++)
+	{
+		random_operations<segmented_child_store<int, 4>> (seed, 3000, 500);
+		random_operations<segmented_child_store<int, 512>> (seed, 3000, 5000);
+		random_operations<btree_child_store<int>> (seed, 3000, 500);
+		random_operations<btree_child_store<int>> (seed, 5000, 30000);
+	}
+
+	return 0;
+}
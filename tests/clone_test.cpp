@@ -0,0 +1,57 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "wide_item.h"
+#include "clone.h"
+#include "object_allocators.h"
+
+using namespace test;
+
+int main()
+{
+	auto r = make_tree(1000);
+
+	auto copy = clone(r.get());
+	CHECK(same_tree(r.get(), static_cast<root*>(copy.get())));
+	CHECK(static_cast<root*>(copy.get())->child_at(0) != r->child_at(0));
+
+	root into;
+	clone_to (r.get(), &into);
+	CHECK(same_tree(r.get(), &into));
+
+	// All objects of the clone come from the allocator passed in, and none of them once the call returns.
+	{
+		object_pool pool;
+		auto pooled = clone(r.get(), &pool);
+		CHECK(pool.live_count() == 1001);
+		CHECK(same_tree(r.get(), static_cast<root*>(pooled.get())));
+
+		auto heap = clone(r.get());
+		CHECK(pool.live_count() == 1001);
+
+		pooled = nullptr;
+		CHECK(pool.live_count() == 0);
+	}
+
+	// The changed-from-default bits are copied with the values.
+	using item_t = wide_item<true>;
+	item_list<item_t> list;
+	for (int i = 0; i < 20; i++)
+	{
+		auto item = std::make_unique<item_t>();
+		item_t::props[i].set (i + 1, item.get());
+		list.append(std::move(item));
+	}
+
+	auto list_copy = clone(&list);
+	auto& copied = *static_cast<item_list<item_t>*>(list_copy.get());
+	CHECK(copied.child_count() == 20);
+	for (size_t i = 0; i < 20; i++)
+	{
+		auto item = copied.child_at(i);
+		CHECK((item->_values[i] == (int32_t)i + 1) && item->_bits.test(i) && !item->_bits.test((i + 1) % 20));
+	}
+
+	return 0;
+}
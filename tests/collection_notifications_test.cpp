@@ -0,0 +1,261 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Notifications of the range operations and moves of object collections, and their replay by undo_history
+// and incremental_binary_serializer.
+
+#include "test_support.h"
+#include "clone.h"
+#include "undo_history.h"
+
+using namespace test;
+
+struct notification
+{
+	bool changed; // false for property_changing
+	size_t index;
+	size_t count;
+	collection_property_change_type type;
+	size_t child_count; // when the notification was raised
+
+	bool operator== (const notification& other) const
+	{
+		return (changed == other.changed) && (index == other.index) && (count == other.count) && (type == other.type) && (child_count == other.child_count);
+	}
+};
+
+struct recorder
+{
+	root* const _root;
+	std::vector<notification> log;
+
+	recorder (root* r)
+		: _root(r)
+	{
+		_root->property_changing().add_handler<&recorder::on_changing>(this);
+		_root->property_changed().add_handler<&recorder::on_changed>(this);
+	}
+
+	~recorder()
+	{
+		_root->property_changing().remove_handler<&recorder::on_changing>(this);
+		_root->property_changed().remove_handler<&recorder::on_changed>(this);
+	}
+
+	void on_changing (object* obj, const property_change_args& args)
+	{
+		if (args.property == &root::children_p)
+			log.push_back({ false, args.index, args.count, args.type, _root->child_count() });
+	}
+
+	void on_changed (object* obj, const property_change_args& args)
+	{
+		if (args.property == &root::children_p)
+			log.push_back({ true, args.index, args.count, args.type, _root->child_count() });
+	}
+
+	// One property_changing / property_changed pair, for the given range and type.
+	bool single_pair (size_t index, size_t count, collection_property_change_type type, size_t count_before, size_t count_after) const
+	{
+		return (log.size() == 2)
+			&& (log[0] == notification{ false, index, count, type, count_before })
+			&& (log[1] == notification{ true, index, count, type, count_after });
+	}
+};
+
+static std::vector<std::unique_ptr<child>> new_children (size_t count, int32_t first_x)
+{
+	std::vector<std::unique_ptr<child>> children;
+	for (size_t i = 0; i < count; i++)
+	{
+		children.push_back(std::make_unique<child>());
+		children.back()->_x = first_x + (int32_t)i;
+	}
+	return children;
+}
+
+static std::unique_ptr<root> copy_of (const root* r)
+{
+	return std::unique_ptr<root>(static_cast<root*>(clone(r).release()));
+}
+
+static std::unique_ptr<root> save_and_load (incremental_binary_serializer& s)
+{
+	vector_out_stream out;
+	s.serialize(&out);
+	binary_reader reader = { out.buffer.data(), out.buffer.data() + out.buffer.size() };
+	return std::unique_ptr<root>(static_cast<root*>(deserialize(reader, known_types).release()));
+}
+
+int main()
+{
+	// A single pair of notifications, covering the whole range.
+	{
+		auto r = make_tree(20);
+		{
+			recorder rec (r.get());
+			r->insert_range (5, new_children(10, 1000));
+			CHECK(rec.single_pair(5, 10, collection_property_change_type::insert, 20, 30));
+		}
+		CHECK((r->child_count() == 30) && (r->child_at(5)->x() == 1000) && (r->child_at(14)->x() == 1009));
+		{
+			recorder rec (r.get());
+			auto removed = r->remove_range (3, 7);
+			CHECK(rec.single_pair(3, 7, collection_property_change_type::remove, 30, 23));
+			CHECK(removed.size() == 7);
+		}
+		{
+			recorder rec (r.get());
+			r->insert_range (23, new_children(2, 0));
+			CHECK(rec.single_pair(23, 2, collection_property_change_type::insert, 23, 25));
+		}
+		{
+			recorder rec (r.get());
+			r->clear();
+			CHECK(rec.single_pair(0, 25, collection_property_change_type::remove, 25, 0));
+		}
+
+		// Empty ranges raise nothing.
+		{
+			recorder rec (r.get());
+			r->clear();
+			r->insert_range (0, { });
+			r->remove_range (0, 0);
+			CHECK(rec.log.empty());
+		}
+	}
+
+	// Each range operation is one undo step, and undo / redo restore the tree exactly.
+	{
+		auto r = make_tree(100);
+		undo_history h (r.get(), known_types);
+		std::vector<std::unique_ptr<root>> states;
+		states.push_back(copy_of(r.get()));
+
+		r->insert_range (10, new_children(20, 5000));
+		states.push_back(copy_of(r.get()));
+		r->remove_range (50, 30);
+		states.push_back(copy_of(r.get()));
+		r->insert_range (r->child_count(), new_children(5, 7000));
+		states.push_back(copy_of(r.get()));
+		r->remove_range (0, 1);
+		states.push_back(copy_of(r.get()));
+		r->clear();
+		states.push_back(copy_of(r.get()));
+
+		for (size_t i = states.size() - 1; i-- > 0; )
+		{
+			h.undo();
+			CHECK(same_tree(r.get(), states[i].get()));
+		}
+		CHECK(!h.can_undo());
+
+		for (size_t i = 1; i < states.size(); i++)
+		{
+			h.redo();
+			CHECK(same_tree(r.get(), states[i].get()));
+		}
+		CHECK(!h.can_redo());
+	}
+
+	// Moves and reorders raise a single "move" pair covering the children that change places.
+	{
+		auto r = make_tree(20);
+		{
+			recorder rec (r.get());
+			auto c = r->child_at(3);
+			r->move (3, 12);
+			CHECK(rec.single_pair(3, 10, collection_property_change_type::move, 20, 20));
+			CHECK(r->child_at(12) == c);
+		}
+		{
+			recorder rec (r.get());
+			auto c = r->child_at(15);
+			r->move (15, 0);
+			CHECK(rec.single_pair(0, 16, collection_property_change_type::move, 20, 20));
+			CHECK(r->child_at(0) == c);
+		}
+		{
+			recorder rec (r.get());
+			r->move (7, 7);
+			r->reorder (4, { });
+			CHECK(rec.log.empty());
+		}
+		{
+			recorder rec (r.get());
+			std::vector<child*> before;
+			for (size_t i = 0; i < 20; i++)
+				before.push_back(r->child_at(i));
+			const size_t order[] = { 2, 0, 3, 1 };
+			r->reorder (5, order);
+			CHECK(rec.single_pair(5, 4, collection_property_change_type::move, 20, 20));
+			for (size_t i = 0; i < 4; i++)
+				CHECK(r->child_at(5 + i) == before[5 + order[i]]);
+		}
+	}
+
+	// Undo / redo of moves and reorders, with children that all have different values so that order shows in same_tree.
+	{
+		auto r = make_tree(50);
+		for (size_t i = 0; i < 50; i++)
+			r->child_at(i)->_x = (int32_t)i;
+		undo_history h (r.get(), known_types);
+		std::vector<std::unique_ptr<root>> states;
+		states.push_back(copy_of(r.get()));
+
+		r->move (0, 49);
+		states.push_back(copy_of(r.get()));
+		std::vector<size_t> reversed (30);
+		for (size_t i = 0; i < reversed.size(); i++)
+			reversed[i] = reversed.size() - 1 - i;
+		r->reorder (10, reversed);
+		states.push_back(copy_of(r.get()));
+		r->move (40, 5);
+		states.push_back(copy_of(r.get()));
+
+		for (size_t i = states.size() - 1; i-- > 0; )
+		{
+			h.undo();
+			CHECK(same_tree(r.get(), states[i].get()));
+		}
+
+		for (size_t i = 1; i < states.size(); i++)
+		{
+			h.redo();
+			CHECK(same_tree(r.get(), states[i].get()));
+		}
+
+		// A round trip of a reorder alone.
+		h.undo();
+		h.undo();
+		CHECK(same_tree(r.get(), states[1].get()));
+		h.redo();
+		CHECK(same_tree(r.get(), states[2].get()));
+	}
+
+	// The incremental serializer follows range operations, alone and several between saves.
+	{
+		auto r = make_tree(1000);
+		incremental_binary_serializer s (r.get());
+		CHECK(same_tree(r.get(), save_and_load(s).get()));
+
+		r->insert_range (100, new_children(50, 9000));
+		CHECK(same_tree(r.get(), save_and_load(s).get()));
+
+		r->remove_range (500, 200);
+		CHECK(same_tree(r.get(), save_and_load(s).get()));
+
+		r->insert_range (0, new_children(3, -5));
+		r->remove_range (10, 10);
+		r->child_at(20)->set_x(123);
+		r->insert_range (r->child_count(), new_children(10, 77));
+		CHECK(same_tree(r.get(), save_and_load(s).get()));
+
+		r->clear();
+		CHECK(same_tree(r.get(), save_and_load(s).get()));
+		r->insert_range (0, new_children(10, 1));
+		CHECK(same_tree(r.get(), save_and_load(s).get()));
+	}
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Random inserts, removes and moves on indexed collections with each child store, checked against a std::vector.
+
+#include "test_support.h"
+#include "child_stores.h"
+#include <random>
+
+using namespace test;
+
+template<typename store_t>
+struct indexed_list : object, indexed_object_collection_i<child, store_t>
+{
+	store_t _children;
+
+	virtual store_t& children_store() override { return _children; }
+	virtual const typed_object_collection_property<child, store_t>* collection_property() const override { return &children_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<child, store_t>* get_children (object* obj) { return static_cast<indexed_list*>(obj); }
+
+	static inline const typed_object_collection_property<child, store_t> children_p { "Children", nullptr, nullptr, false, &get_children };
+	static inline const property* const _props[] = { &children_p };
+	static inline const xtype<> _type = { "IndexedList", nullptr, _props };
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+template<typename store_t>
+static void check_same (const indexed_list<store_t>& list, const std::vector<child*>& model)
+{
+	CHECK(list.child_count() == model.size());
+	for (size_t i = 0; i < model.size(); i++)
+		CHECK(list.child_at(i) == model[i]);
+}
+
+template<typename store_t>
+static void random_operations (uint32_t seed, size_t operation_count, size_t max_size)
+{
+	std::mt19937 rng (seed);
+	indexed_list<store_t> list;
+	std::vector<child*> model;
+
+	auto new_child = [](std::vector<child*>& model, size_t index)
+	{
+		auto c = std::make_unique<child>();
+		model.insert (model.begin() + index, c.get());
+		return c;
+	};
+
+	for (size_t op = 0; op < operation_count; op++)
+	{
+		size_t size = model.size();
+		switch (rng() % 8)
+		{
+			case 0:
+			case 1:
+				if (size < max_size)
+				{
+					size_t index = rng() % (size + 1);
+					list.insert (index, new_child(model, index));
+				}
+				break;
+
+			case 2:
+				if (size)
+				{
+					size_t index = rng() % size;
+					CHECK(list.remove(index).get() == model[index]);
+					model.erase (model.begin() + index);
+				}
+				break;
+
+			case 3:
+			{
+				size_t index = rng() % (size + 1);
+				std::vector<std::unique_ptr<child>> range;
+				for (size_t i = 0, count = rng() % 20; i < count; i++)
+					range.push_back (new_child(model, index + i));
+				list.insert_range (index, std::move(range));
+				break;
+			}
+
+			case 4:
+				if (size)
+				{
+					size_t index = rng() % size;
+					size_t count = std::min<size_t>(size - index, rng() % 20);
+					auto removed = list.remove_range (index, count);
+					CHECK(removed.size() == count);
+					for (size_t i = 0; i < count; i++)
+						CHECK(removed[i].get() == model[index + i]);
+					model.erase (model.begin() + index, model.begin() + index + count);
+				}
+				break;
+
+			case 5:
+				if (size)
+				{
+					size_t from = rng() % size;
+					size_t to = rng() % size;
+					list.move (from, to);
+					auto c = model[from];
+					model.erase (model.begin() + from);
+					model.insert (model.begin() + to, c);
+				}
+				break;
+
+			case 6:
+				if (size)
+				{
+					size_t index = rng() % size;
+					std::vector<size_t> order (std::min<size_t>(size - index, rng() % 30));
+					std::iota (order.begin(), order.end(), 0);
+					std::shuffle (order.begin(), order.end(), rng);
+					list.reorder (index, order);
+					std::vector<child*> reordered;
+					for (size_t i : order)
+						reordered.push_back(model[index + i]);
+					std::copy (reordered.begin(), reordered.end(), model.begin() + index);
+				}
+				break;
+
+			default:
+				if (size)
+				{
+					// Batch remove of random children, given in random order.
+					std::vector<child*> to_remove;
+					for (auto c : model)
+					{
+						if (rng() % 8 == 0)
+							to_remove.push_back(c);
+					}
+					std::shuffle (to_remove.begin(), to_remove.end(), rng);
+					auto removed = list.remove(std::span<child* const>(to_remove));
+					CHECK(removed.size() == to_remove.size());
+					size_t next = 0;
+					for (auto c : model)
+					{
+						if (std::find(to_remove.begin(), to_remove.end(), c) != to_remove.end())
+							CHECK(removed[next++].get() == c);
+					}
+					model.erase (std::remove_if(model.begin(), model.end(), [&](child* c)
+						{ return std::find(to_remove.begin(), to_remove.end(), c) != to_remove.end(); }), model.end());
+				}
+				break;
+		}
+
+		// A few lookups after each operation, so that stale indexes pile up between renumberings.
+		for (int i = 0; !model.empty() && (i < 2); i++)
+		{
+			size_t index = rng() % model.size();
+			CHECK(list.index_of(model[index]) == index);
+		}
+
+		if (op % 50 == 0)
+		{
+			check_same (list, model);
+			for (size_t i = 0; i < model.size(); i++)
+				CHECK(list.index_of(model[i]) == i);
+		}
+	}
+
+	check_same (list, model);
+}
+
+int main()
+{
+	// Inserts in the middle that leave a child with a stale index below the renumbered part.
+	{
+		indexed_list<std::vector<std::unique_ptr<child>>> list;
+		std::vector<child*> model;
+		for (size_t index : { 0, 0, 2, 0, 3 })
+		{
+			auto c = std::make_unique<child>();
+			model.insert (model.begin() + index, c.get());
+			list.insert (index, std::move(c));
+		}
+		list.remove((size_t)4);
+		model.erase (model.begin() + 4);
+		auto c = std::make_unique<child>();
+		model.insert (model.begin() + 4, c.get());
+		list.insert (4, std::move(c));
+
+		check_same (list, model);
+		for (size_t i = 0; i < model.size(); i++)
+			CHECK(list.index_of(model[i]) == i);
+	}
+
+	for (uint32_t seed = 1; seed <= 20; seed++)
+	{
+		random_operations<std::vector<std::unique_ptr<child>>> (seed, 2000, 300);
+		random_operations<segmented_child_store<child, 8>> (seed, 2000, 300);
+		random_operations<btree_child_store<child>> (seed, 2000, 1000);
+	}
+
+	return 0;
+}
@@ -0,0 +1,71 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Edits a tree at random (values, inserts, removes, moves, at several levels) and checks after each
+// incremental save that the saved document loads back as the tree.
+
+#include "random_tree.h"
+
+using namespace test;
+
+static std::vector<uint8_t> save (incremental_binary_serializer& s)
+{
+	vector_out_stream out;
+	s.serialize(&out);
+	return std::move(out.buffer);
+}
+
+static std::unique_ptr<object> load (const std::vector<uint8_t>& data, std::span<const concrete_type* const> types)
+{
+	binary_reader reader = { data.data(), data.data() + data.size() };
+	return deserialize(reader, types);
+}
+
+int main()
+{
+	// A flat collection: one edit, several edits, nothing changed, an insert and a remove.
+	{
+		auto r = make_tree(1000);
+		incremental_binary_serializer s (r.get());
+		auto first = save(s);
+		CHECK(same_tree(r.get(), static_cast<root*>(load(first, known_types).get())));
+		CHECK(save(s) == first);
+
+		r->child_at(0)->set_x(1'000'000);
+		r->child_at(500)->set_x(-7);
+		r->child_at(999)->set_x(123456789);
+		CHECK(same_tree(r.get(), static_cast<root*>(load(save(s), known_types).get())));
+
+		r->child_at(1)->set_x(2);
+		CHECK(same_tree(r.get(), static_cast<root*>(load(save(s), known_types).get())));
+
+		auto c = std::make_unique<child>();
+		c->_x = 4242;
+		r->insert(10, std::move(c));
+		r->remove(700);
+		r->child_at(11)->set_x(3);
+		auto after_reshape = save(s);
+		CHECK(same_tree(r.get(), static_cast<root*>(load(after_reshape, known_types).get())));
+		CHECK(save(s) == after_reshape);
+
+		r->child_at(998)->set_x(0);
+		CHECK(same_tree(r.get(), static_cast<root*>(load(save(s), known_types).get())));
+	}
+
+	// Random edits in a tree of nodes, some rounds with several edits before the save.
+	{
+		std::mt19937 rng (1);
+		auto root = make_node<tree>(rng);
+		incremental_binary_serializer s (root.get());
+		for (int round = 0; round < 3000; round++)
+		{
+			for (size_t i = 0, count = rng() % 4; i < count; i++)
+				random_edit(rng, root.get());
+
+			auto loaded = load(save(s), node_types);
+			CHECK(same_nodes(root.get(), static_cast<node*>(loaded.get())));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Edits trees at random and checks that each incremental XML save produces the same text as a full save.
+
+#include "random_tree.h"
+#include "xml_writer.h"
+
+using namespace test;
+
+struct string_out_stream : out_stream_i
+{
+	std::string text;
+
+	using out_stream_i::write;
+
+	virtual void write (const void* data, size_t size) override
+	{
+		text.append (static_cast<const char*>(data), size);
+	}
+};
+
+static std::string save (incremental_xml_text_serializer& s)
+{
+	string_out_stream out;
+	s.serialize(&out);
+	return std::move(out.text);
+}
+
+static std::string full_save (const object* obj, bool indent, bool force_serialize_unchanged)
+{
+	string_out_stream out;
+	{
+		xml_writer writer (&out, indent);
+		writer.write_declaration();
+		serialize (writer, obj, force_serialize_unchanged);
+	}
+	return std::move(out.text);
+}
+
+int main()
+{
+	// A flat collection: edits, nothing changed, an insert, a remove, a move.
+	for (bool indent : { true, false })
+	{
+		auto r = make_tree(1000);
+		incremental_xml_text_serializer s (r.get(), indent);
+		auto first = save(s);
+		CHECK(first == full_save(r.get(), indent, true));
+		CHECK(save(s) == first);
+
+		// A change made without notification doesn't show, which tells us the elements are copied.
+		float y = r->child_at(5)->_y;
+		r->child_at(5)->_y = y + 1000;
+		CHECK(save(s) == first);
+		r->child_at(5)->_y = y;
+
+		r->child_at(0)->set_x(1'000'000);
+		r->child_at(500)->set_x(-7);
+		r->child_at(999)->set_x(123456789);
+		CHECK(save(s) == full_save(r.get(), indent, true));
+
+		auto c = std::make_unique<child>();
+		c->_x = 4242;
+		r->insert(10, std::move(c));
+		r->remove(700);
+		r->move(3, 900);
+		r->child_at(11)->set_x(3);
+		r->insert_val(0, 17);
+		CHECK(save(s) == full_save(r.get(), indent, true));
+		CHECK(save(s) == full_save(r.get(), indent, true));
+	}
+
+	// Random edits in a tree of nodes, some rounds with several edits before the save, with and without
+	// the elements of objects that didn't change from default.
+	for (bool force : { true, false })
+	{
+		std::mt19937 rng (1);
+		auto root = make_node<tree>(rng);
+		incremental_xml_text_serializer s (root.get(), true, force);
+		for (int round = 0; round < 2000; round++)
+		{
+			for (size_t i = 0, count = rng() % 4; i < count; i++)
+			{
+				random_edit(rng, root.get());
+				if (!force && (rng() % 4 == 0))
+					random_node(rng, root.get())->set_value(0);
+			}
+
+			CHECK(save(s) == full_save(root.get(), true, force));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "journaled_document.h"
+#include <filesystem>
+
+using namespace test;
+
+static const char path[] = "journaled_document_test.bin";
+
+// Opens the document again, replaying its journal, and compares the tree with "expected".
+static void check_reopened (const root* expected)
+{
+	journaled_document doc (path, known_types);
+	CHECK(same_tree(static_cast<root*>(doc.root()), expected));
+}
+
+int main()
+{
+	// Removals of several children at once, both as a few runs and as many scattered children.
+	{
+		auto expected = make_tree(1000);
+		{
+			journaled_document doc (path, make_tree(1000));
+			auto r = static_cast<root*>(doc.root());
+
+			for (auto tree : { r, expected.get() })
+			{
+				std::vector<child*> to_remove;
+				for (size_t i : { 3, 4, 5, 500, 998 })
+					to_remove.push_back(tree->child_at(i));
+				tree->remove(to_remove);
+
+				to_remove.clear();
+				for (size_t i = 10; i < 900; i += 3)
+					to_remove.push_back(tree->child_at(i));
+				tree->remove(to_remove);
+			}
+
+			r->child_at(7)->set_x(77);
+			expected->child_at(7)->set_x(77);
+			doc.save();
+			CHECK(doc.journal_size() > 0);
+		}
+
+		check_reopened (expected.get());
+	}
+
+	// Each kind of record, over several saves, then the same edits made on a copy, as they are replayed.
+	auto edit = [](root* r, int round)
+	{
+		r->child_at(round)->set_x(1000 + round);
+		auto c = std::make_unique<child>();
+		c->_name = "inserted" + std::to_string(round);
+		c->_x = round;
+		r->insert(10 + round, std::move(c));
+		r->move(10 + round, 200 + round);
+		r->remove(50 + round);
+		std::vector<std::unique_ptr<child>> range;
+		for (int i = 0; i < 3; i++)
+			range.push_back(std::make_unique<child>());
+		r->insert_range(r->child_count(), std::move(range));
+		r->remove_range(100, 2);
+		r->insert_val(0, round);
+		r->remove_val(1);
+	};
+
+	{
+		auto expected = make_tree(1000);
+		uint64_t journal_size;
+		{
+			journaled_document doc (path, make_tree(1000), 64);
+			for (int round = 0; round < 5; round++)
+			{
+				edit (static_cast<root*>(doc.root()), round);
+				edit (expected.get(), round);
+				doc.save();
+			}
+			journal_size = doc.journal_size();
+			CHECK(journal_size > 0);
+		}
+
+		check_reopened (expected.get());
+
+		// Records not saved are written when the document is destroyed.
+		{
+			journaled_document doc (path, known_types);
+			CHECK(doc.journal_size() == journal_size);
+			static_cast<root*>(doc.root())->child_at(500)->set_x(-500);
+		}
+		int32_t old_x = expected->child_at(500)->x();
+		expected->child_at(500)->set_x(-500);
+		check_reopened (expected.get());
+
+		// A damaged last batch is dropped with what follows, and the file cut back to the batches before it.
+		auto size = std::filesystem::file_size(path);
+		std::filesystem::resize_file (path, size - 1);
+		{
+			journaled_document doc (path, known_types);
+			CHECK(doc.journal_size() == journal_size);
+		}
+		expected->child_at(500)->set_x(old_x);
+		check_reopened (expected.get());
+
+		// Compacting leaves an empty journal and the same tree.
+		{
+			journaled_document doc (path, known_types);
+			doc.compact();
+			CHECK(doc.journal_size() == 0);
+		}
+		check_reopened (expected.get());
+	}
+
+	// save() compacts by itself once the journal would be bigger than the snapshot.
+	{
+		journaled_document doc (path, make_tree(100));
+		auto r = static_cast<root*>(doc.root());
+		for (int i = 0; i < 10'000; i++)
+			r->child_at(i % 100)->set_x(i);
+		doc.save();
+		CHECK(doc.journal_size() == 0);
+	}
+
+	return 0;
+}
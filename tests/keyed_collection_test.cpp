@@ -0,0 +1,129 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "keyed_collection.h"
+#include "undo_history.h"
+
+using namespace test;
+
+// Children keyed by X, with the policy given as a template argument.
+template<duplicate_key_policy policy>
+struct keyed_list : object, keyed_object_collection_i<child, int32_property_traits>
+{
+	using base = object;
+
+	size_t duplicates = 0;
+
+	virtual const keyed_object_collection_property<child, int32_property_traits>* collection_property() const override { return &children_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+	virtual void on_duplicate_key (child* c, child* existing) override { duplicates++; }
+
+	static typed_object_collection_i<child>* get_children (object* obj) { return static_cast<keyed_list*>(obj); }
+
+	static inline const keyed_object_collection_property<child, int32_property_traits> children_p { "Children", nullptr, nullptr, false, &get_children, &child::x_p, policy };
+	static inline const property* const _props[] = { &children_p };
+	static inline const xtype<> _type = { "KeyedList", nullptr, _props, []() { return std::unique_ptr<object>(new keyed_list()); } };
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+// Children keyed by name, a std::string key.
+struct named_list : object, keyed_object_collection_i<child, temp_string_property_traits>
+{
+	using base = object;
+
+	virtual const keyed_object_collection_property<child, temp_string_property_traits>* collection_property() const override { return &children_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<child>* get_children (object* obj) { return static_cast<named_list*>(obj); }
+
+	static const keyed_object_collection_property<child, temp_string_property_traits> children_p;
+	static const property* const _props[];
+	static const xtype<> _type;
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+const keyed_object_collection_property<child, temp_string_property_traits> named_list::children_p { "Children", nullptr, nullptr, false, &named_list::get_children, &child::name_p };
+const property* const named_list::_props[] = { &children_p };
+const xtype<> named_list::_type = { "NamedList", nullptr, named_list::_props, []() { return std::unique_ptr<object>(new named_list()); } };
+
+static std::unique_ptr<child> make_child (int32_t x)
+{
+	auto c = std::make_unique<child>();
+	c->_x = x;
+	return c;
+}
+
+int main()
+{
+	const concrete_type* const types[] = { &child::_type, &keyed_list<duplicate_key_policy::reject>::_type };
+
+	{
+		keyed_list<duplicate_key_policy::reject> list;
+		undo_history h (&list, types);
+		for (int32_t x = 0; x < 100; x++)
+			list.append(make_child(x * 10));
+		CHECK((list.find(500) == list.child_at(50)) && !list.contains(5));
+
+		// Rejected before the collection or the key change.
+		CHECK_THROWS(duplicate_key_exception, list.append(make_child(30)));
+		CHECK(list.child_count() == 100);
+		CHECK_THROWS(duplicate_key_exception, list.set_key(list.child_at(1), 20));
+		CHECK((list.child_at(1)->x() == 10) && (list.find(10) == list.child_at(1)) && (list.find(20) == list.child_at(2)));
+
+		list.set_key(list.child_at(1), 15);
+		list.set_key(list.child_at(2), 20);
+		CHECK(!list.contains(10) && (list.find(15) == list.child_at(1)));
+
+		// A duplicate set through the setter is reported, and the change is recorded like any other.
+		list.child_at(3)->set_x(40);
+		CHECK((list.duplicates == 1) && (list.find(40) != nullptr));
+		h.undo();
+		CHECK((list.child_at(3)->x() == 30) && (list.find(30) == list.child_at(3)) && (list.find(40) == list.child_at(4)));
+		h.undo();
+		CHECK((list.child_at(1)->x() == 10) && (list.find(10) == list.child_at(1)) && !list.contains(15));
+
+		auto removed = list.remove(50);
+		CHECK(!list.contains(500));
+		list.append(make_child(500));
+		CHECK(list.find(500) == list.child_at(99));
+	}
+
+	{
+		keyed_list<duplicate_key_policy::report> list;
+		for (int32_t x = 0; x < 10; x++)
+			list.append(make_child(x));
+		list.append(make_child(3));
+		list.set_key(list.child_at(0), 5);
+		CHECK((list.child_count() == 11) && (list.duplicates == 2));
+	}
+
+	// String keys, short and long (so that both small-string and heap characters get moved into the index),
+	// found by std::string_view, string literal and std::string.
+	{
+		named_list list;
+		for (int i = 0; i < 1000; i++)
+		{
+			auto c = std::make_unique<child>();
+			c->_name = ((i % 2) ? "n" : "a name long enough to be on the heap ") + std::to_string(i);
+			list.append(std::move(c));
+		}
+
+		CHECK(list.find(std::string_view("n7")) == list.child_at(7));
+		CHECK(list.find("a name long enough to be on the heap 500") == list.child_at(500));
+		CHECK(list.contains(std::string("n999")) && !list.contains("n998") && !list.contains(""));
+
+		auto c = std::make_unique<child>();
+		c->_name = "n7";
+		CHECK_THROWS(duplicate_key_exception, list.append(std::move(c)));
+
+		auto removed = list.remove((size_t)7);
+		CHECK(!list.contains("n7") && (list.find("n9") == list.child_at(8)));
+		list.insert(0, std::move(removed));
+		CHECK(list.find("n7") == list.child_at(0));
+	}
+
+	return 0;
+}
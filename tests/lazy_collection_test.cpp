@@ -0,0 +1,88 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "lazy_collection.h"
+#include "mapped_document.h"
+#include "undo_history.h"
+#include <fstream>
+
+using namespace test;
+
+struct lazy_root : object, lazy_object_collection_i<child>
+{
+	using base = object;
+
+	virtual const typed_object_collection_property<child, lazy_child_store<child>>* collection_property() const override { return &children_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<child, lazy_child_store<child>>* get_children (object* obj) { return static_cast<lazy_root*>(obj); }
+
+	static const typed_object_collection_property<child, lazy_child_store<child>> children_p;
+	static const property* const _props[];
+	static const xtype<> _type;
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+const typed_object_collection_property<child, lazy_child_store<child>> lazy_root::children_p { "Children", nullptr, nullptr, false, &lazy_root::get_children };
+const property* const lazy_root::_props[] = { &children_p };
+const xtype<> lazy_root::_type = { "LazyRoot", nullptr, lazy_root::_props, []() { return std::unique_ptr<object>(new lazy_root()); } };
+
+static const concrete_type* const types[] = { &child::_type, &lazy_root::_type };
+
+int main()
+{
+	static constexpr size_t count = 10'000;
+	static constexpr size_t budget = 1'000;
+
+	{
+		lazy_root r;
+		for (size_t i = 0; i < count; i++)
+		{
+			auto c = std::make_unique<child>();
+			c->_x = (int32_t)i;
+			r.append(std::move(c));
+		}
+
+		vector_out_stream s;
+		serialize_paged (&r, &s);
+		std::ofstream file ("lazy_collection_test.bin", std::ios::binary | std::ios::trunc);
+		file.write (reinterpret_cast<const char*>(s.buffer.data()), s.buffer.size());
+		CHECK(file.good());
+	}
+
+	paged_document doc ("lazy_collection_test.bin", types);
+	auto r = static_cast<lazy_root*>(doc.root());
+	r->set_memory_budget(budget);
+	CHECK((r->child_count() == count) && (r->loaded_child_count() == 0));
+
+	int64_t sum = 0;
+	for (size_t i = 0; i < count; i++)
+		sum += r->child_at(i)->x();
+	CHECK((sum == (int64_t)count * (count - 1) / 2) && (r->loaded_child_count() <= budget + lazy_child_store<child>::page_size));
+
+	// An observer subscribes to every child, so nothing may be evicted while it exists, whatever is accessed.
+	{
+		undo_history h (r, types);
+		CHECK(r->loaded_child_count() == count);
+		for (size_t i = 0; i < count; i += 7)
+			r->child_at(i)->x();
+		CHECK(r->loaded_child_count() == count);
+
+		r->child_at(5000)->set_x(-1);
+		r->remove(20);
+		h.undo();
+		h.undo();
+		CHECK((r->child_count() == count) && (r->child_at(20)->x() == 20) && (r->child_at(5000)->x() == 5000));
+	}
+
+	// Only the pages changed while observed stay; the others are evicted again.
+	CHECK(r->loaded_child_count() <= budget + 3 * lazy_child_store<child>::page_size);
+	sum = 0;
+	for (size_t i = 0; i < count; i++)
+		sum += r->child_at(i)->x();
+	CHECK(sum == (int64_t)count * (count - 1) / 2);
+
+	return 0;
+}
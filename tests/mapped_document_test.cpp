@@ -0,0 +1,59 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "mapped_document.h"
+#include <fstream>
+#include <system_error>
+
+using namespace test;
+
+static void write_file (const char* path, const std::vector<uint8_t>& data)
+{
+	std::ofstream file (path, std::ios::binary | std::ios::trunc);
+	file.write (reinterpret_cast<const char*>(data.data()), data.size());
+	CHECK(file.good());
+}
+
+int main()
+{
+	{
+		auto tree = make_tree(10000);
+		write_file ("mapped_document_test.bin", to_binary(tree.get()));
+		mapped_document doc ("mapped_document_test.bin", known_types);
+		CHECK(same_tree(tree.get(), static_cast<root*>(doc.root())));
+	}
+
+	{
+		// Backed strings must point into the mapping rather than be copied.
+		std::string text (100'000, 'x');
+		blob_list list;
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			auto b = std::make_unique<blob>();
+			b->_number = i;
+			b->_data = std::string_view(text).substr(i * 1000, 1000 + i * 5000);
+			list.append(std::move(b));
+		}
+
+		write_file ("mapped_document_test.bin", to_binary(&list));
+		mapped_document doc ("mapped_document_test.bin", known_types);
+		auto loaded = static_cast<blob_list*>(doc.root());
+		CHECK(loaded->child_count() == 10);
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			CHECK(loaded->child_at(i)->_number == i);
+			CHECK(loaded->child_at(i)->_data == list.child_at(i)->_data);
+			CHECK(doc.backs(loaded->child_at(i)->_data));
+		}
+	}
+
+	CHECK_THROWS(std::system_error, mapped_document("mapped_document_test_nonexistent.bin", known_types));
+
+	write_file ("mapped_document_test.bin", { 1, 2, 3 });
+	CHECK_THROWS(binary_read_exception, mapped_document("mapped_document_test.bin", known_types));
+
+	std::remove ("mapped_document_test.bin");
+	return 0;
+}
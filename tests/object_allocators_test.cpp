@@ -0,0 +1,116 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "object_allocators.h"
+#include <cstddef>
+
+using namespace test;
+
+// Objects of a given size; "tag" makes types that are distinct but of the same size.
+template<size_t size, int tag = 0>
+struct sized : object
+{
+	uint8_t _payload[size];
+
+	static inline const xtype<> _type = { "Sized", nullptr, { } };
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+static bool aligned (const void* p)
+{
+	return (reinterpret_cast<uintptr_t>(p) % alignof(std::max_align_t)) == 0;
+}
+
+int main()
+{
+	// Objects created with no scope active come from the heap.
+	{
+		object_pool pool;
+		auto obj = std::make_unique<sized<40>>();
+		CHECK(aligned(obj.get()));
+		CHECK(pool.live_count() == 0);
+	}
+
+	// Freed memory is reused for the next object of the same size class, whatever its type (per-size-class pooling),
+	// but not for objects of another size class.
+	{
+		object_pool pool;
+		object_allocation_scope scope (&pool);
+		auto a = std::make_unique<sized<40, 0>>();
+		const void* address = a.get();
+		a = nullptr;
+		auto b = std::make_unique<sized<40, 1>>();
+		CHECK(b.get() == address);
+		b = nullptr;
+
+		auto c = std::make_unique<sized<400>>();
+		CHECK(c.get() != address);
+		auto d = std::make_unique<sized<40>>();
+		CHECK(d.get() == address);
+		CHECK(pool.live_count() == 2);
+	}
+
+	// Each object goes back to its own allocator, wherever it's deleted; the innermost scope wins.
+	{
+		object_pool outer_pool;
+		object_pool inner_pool;
+		std::unique_ptr<object> from_outer, from_inner, from_outer_again;
+		{
+			object_allocation_scope outer (&outer_pool);
+			from_outer = std::make_unique<sized<24>>();
+			{
+				object_allocation_scope inner (&inner_pool);
+				from_inner = std::make_unique<sized<24>>();
+			}
+			from_outer_again = std::make_unique<sized<24>>();
+		}
+
+		auto from_heap = std::make_unique<sized<24>>();
+		CHECK(outer_pool.live_count() == 2);
+		CHECK(inner_pool.live_count() == 1);
+		from_inner = nullptr;
+		from_outer = nullptr;
+		CHECK(outer_pool.live_count() == 1);
+		CHECK(inner_pool.live_count() == 0);
+		from_outer_again = nullptr;
+		CHECK(outer_pool.live_count() == 0);
+	}
+
+	// Alignment, and allocations larger than the pooled sizes.
+	{
+		object_pool pool;
+		object_allocation_scope scope (&pool);
+		std::vector<std::unique_ptr<object>> objects;
+		for (int i = 0; i < 1000; i++)
+		{
+			objects.push_back(std::make_unique<sized<8>>());
+			objects.push_back(std::make_unique<sized<72>>());
+			objects.push_back(std::make_unique<sized<4000>>());
+		}
+		for (auto& o : objects)
+			CHECK(aligned(o.get()));
+		CHECK(pool.live_count() == 3000);
+		objects.clear();
+		CHECK(pool.live_count() == 0);
+	}
+
+	// The arena hands out memory one object after the other, and doesn't reuse it.
+	{
+		object_arena arena;
+		object_allocation_scope scope (&arena);
+		auto a = std::make_unique<sized<40>>();
+		auto b = std::make_unique<sized<40>>();
+		CHECK(aligned(a.get()) && aligned(b.get()));
+		CHECK(b.get() > a.get());
+		auto big = std::make_unique<sized<600'000>>();
+		CHECK(aligned(big.get()));
+		const void* address = a.get();
+		a = nullptr;
+		auto c = std::make_unique<sized<40>>();
+		CHECK(c.get() != address);
+		CHECK(arena.live_count() == 3);
+	}
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "random_tree.h"
+#include "object_handles.h"
+#include "undo_history.h"
+
+using namespace test;
+
+int main()
+{
+	// Handles stop resolving when their object leaves the tree, descendants included.
+	{
+		std::mt19937 rng (1);
+		auto t = make_node<tree>(rng);
+		auto b2 = std::make_unique<branch<branch<leaf, 1>, 2>>();
+		auto b1 = std::make_unique<branch<leaf, 1>>();
+		auto l = std::make_unique<leaf>();
+		auto b2_ptr = b2.get();
+		auto b1_ptr = b1.get();
+		auto l_ptr = l.get();
+		b1->append(std::move(l));
+		b2->append(std::move(b1));
+		t->nodes()->append(std::move(b2));
+
+		handle_table handles (t.get());
+		auto hb2 = handles.handle_of(b2_ptr);
+		auto hb1 = handles.handle_of(b1_ptr);
+		auto hl = handles.handle_of(l_ptr);
+		CHECK(hb2 && hb1 && hl && (hb2 != hb1));
+		CHECK(handles.resolve(hb2) == b2_ptr);
+		CHECK(handles.resolve_as<leaf>(hl) == l_ptr);
+		CHECK(handles.resolve(object_handle()) == nullptr);
+		CHECK(handles.resolve(handles.handle_of(t.get())) == t.get());
+
+		auto removed = t->nodes()->remove_object(t->nodes()->child_count() - 1);
+		CHECK(handles.resolve(hb2) == nullptr);
+		CHECK(handles.resolve(hb1) == nullptr);
+		CHECK(handles.resolve(hl) == nullptr);
+
+		// Inserted again, the objects get new handles.
+		t->nodes()->insert(0, std::move(removed));
+		CHECK(handles.resolve(hb2) == nullptr);
+		auto new_hb2 = handles.handle_of(b2_ptr);
+		CHECK(new_hb2 != hb2);
+		CHECK(handles.resolve(new_hb2) == b2_ptr);
+		CHECK(handles.resolve(handles.handle_of(l_ptr)) == l_ptr);
+	}
+
+	// Slots are reused with a new generation; handles to the previous object of the slot don't resolve to the new one.
+	{
+		auto r = make_tree(10);
+		handle_table handles (r.get());
+		auto h = handles.handle_of(r->child_at(3));
+		r->remove(3);
+		r->insert(0, std::make_unique<child>());
+		auto h_new = handles.handle_of(r->child_at(0));
+		CHECK(h_new.index == h.index);
+		CHECK(h_new.generation == h.generation + 1);
+		CHECK(handles.resolve(h) == nullptr);
+		CHECK(handles.resolve(h_new) == r->child_at(0));
+
+		// Many removes and inserts through one slot.
+		for (int i = 0; i < 1000; i++)
+		{
+			auto before = handles.handle_of(r->child_at(0));
+			r->remove((size_t)0);
+			r->insert(0, std::make_unique<child>());
+			CHECK(handles.resolve(before) == nullptr);
+			CHECK(handles.handle_of(r->child_at(0)).index == before.index);
+		}
+		CHECK(handles.resolve(h_new) == nullptr);
+	}
+
+	// Undo and redo remove and recreate objects, so handles taken before have to be taken again, from the object
+	// at the same place in the tree.
+	{
+		auto r = make_tree(100);
+		undo_history history (r.get(), known_types);
+		handle_table handles (r.get());
+
+		r->child_at(42)->set_x(4242);
+		auto h = handles.handle_of(r->child_at(42));
+		r->remove(42);
+		CHECK(handles.resolve(h) == nullptr);
+
+		history.undo();
+		CHECK(handles.resolve(h) == nullptr);
+		auto restored = handles.handle_of(r->child_at(42));
+		CHECK(handles.resolve_as<child>(restored)->x() == 4242);
+
+		history.redo();
+		CHECK(handles.resolve(restored) == nullptr);
+		CHECK(r->child_count() == 99);
+
+		history.undo();
+		auto restored_again = handles.handle_of(r->child_at(42));
+		CHECK(restored_again != restored);
+		CHECK(handles.resolve_as<child>(restored_again)->x() == 4242);
+
+		// Undoing a value change keeps the object, and its handle.
+		history.undo();
+		CHECK(handles.resolve(restored_again) == r->child_at(42));
+		CHECK(r->child_at(42)->x() != 4242);
+	}
+
+	return 0;
+}
@@ -0,0 +1,150 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Random trees and random edits for the tests of the incremental serializers.
+
+#pragma once
+#include "test_support.h"
+#include <random>
+
+namespace test
+{
+	// A tree three levels deep, with one value in each node, for edits below the top level.
+	struct node : object
+	{
+		using base = object;
+
+		int32_t _value = 0;
+
+		int32_t value() const { return _value; }
+		void set_value (int32_t value)
+		{
+			if (_value != value)
+			{
+				this->on_property_changing(&value_p);
+				_value = value;
+				this->on_property_changed(&value_p);
+			}
+		}
+
+		virtual object_collection_i* nodes() { return nullptr; }
+		virtual std::unique_ptr<node> make_child (std::mt19937& rng) const { return nullptr; }
+
+		static const int32_p value_p;
+	};
+
+	inline const int32_p node::value_p { "Value", nullptr, nullptr, &node::value, &node::set_value, 0 };
+
+	struct leaf : node
+	{
+		static const property* const _props[];
+		static const xtype<> _type;
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	inline const property* const leaf::_props[] = { &value_p };
+	inline const xtype<> leaf::_type = { "Leaf", nullptr, leaf::_props, []() { return std::unique_ptr<object>(new leaf()); } };
+
+	template<typename child_t>
+	std::unique_ptr<node> make_node (std::mt19937& rng)
+	{
+		auto n = std::make_unique<child_t>();
+		n->_value = (int32_t)(rng() % 1000);
+		if (auto c = n->nodes())
+		{
+			for (size_t i = 0, count = rng() % 6; i < count; i++)
+				c->append(n->make_child(rng));
+		}
+		return n;
+	}
+
+	template<typename child_t, int depth>
+	struct branch : node, typed_object_collection_i<child_t>
+	{
+		std::vector<std::unique_ptr<child_t>> _children;
+
+		virtual std::vector<std::unique_ptr<child_t>>& children_store() override { return _children; }
+		virtual const typed_object_collection_property<child_t>* collection_property() const override { return &children_p; }
+		virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+		virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+		virtual object_collection_i* nodes() override { return this; }
+		virtual std::unique_ptr<node> make_child (std::mt19937& rng) const override { return make_node<child_t>(rng); }
+
+		static typed_object_collection_i<child_t>* get_children (object* obj) { return static_cast<branch*>(obj); }
+
+		static inline const typed_object_collection_property<child_t> children_p { "Children", nullptr, nullptr, false, &get_children };
+		static inline const property* const _props[] = { &value_p, &children_p };
+		static inline const char* const type_names[] = { "", "Branch1", "Branch2", "Branch3" };
+		static inline const xtype<> _type = { type_names[depth], nullptr, _props, []() { return std::unique_ptr<object>(new branch()); } };
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	using tree = branch<branch<branch<leaf, 1>, 2>, 3>;
+
+	inline const concrete_type* const node_types[] = { &leaf::_type, &branch<leaf, 1>::_type, &branch<branch<leaf, 1>, 2>::_type, &tree::_type };
+
+	inline bool same_nodes (node* a, node* b)
+	{
+		if ((a->type() != b->type()) || (a->_value != b->_value))
+			return false;
+
+		auto ac = a->nodes();
+		auto bc = b->nodes();
+		if (!ac)
+			return true;
+
+		if (ac->child_count() != bc->child_count())
+			return false;
+
+		for (size_t i = 0; i < ac->child_count(); i++)
+		{
+			if (!same_nodes(static_cast<node*>(ac->child_at(i)), static_cast<node*>(bc->child_at(i))))
+				return false;
+		}
+
+		return true;
+	}
+
+	inline node* random_node (std::mt19937& rng, node* n)
+	{
+		while (n->nodes() && (n->nodes()->child_count() > 0) && (rng() % 3 != 0))
+			n = static_cast<node*>(n->nodes()->child_at(rng() % n->nodes()->child_count()));
+		return n;
+	}
+
+	inline void random_edit (std::mt19937& rng, node* root)
+	{
+		node* n = random_node(rng, root);
+		auto c = n->nodes();
+		size_t count = c ? c->child_count() : 0;
+		switch (c ? rng() % 6 : 3)
+		{
+			case 0:
+				c->insert (rng() % (count + 1), n->make_child(rng));
+				break;
+
+			case 1:
+				if (count)
+					c->remove_object (rng() % count);
+				break;
+
+			case 2:
+				if (count > 1)
+				{
+					// Reverses a range of children.
+					size_t index = rng() % (count - 1);
+					std::vector<size_t> order (std::min<size_t>(count - index, 2 + rng() % 3));
+					for (size_t i = 0; i < order.size(); i++)
+						order[i] = order.size() - 1 - i;
+					c->reorder (index, order);
+				}
+				break;
+
+			default:
+				// Values far apart, so that the size of the node changes too.
+				n->set_value ((rng() & 1) ? (int32_t)(rng() % 10) : (int32_t)rng());
+				break;
+		}
+	}
+}
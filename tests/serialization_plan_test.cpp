@@ -0,0 +1,276 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+#include <utility>
+
+using namespace test;
+
+// A label is created by its factory from its text. Weight has a custom_serialize_property_i that writes it only when it's odd.
+struct label : object
+{
+	using base = object;
+
+	std::string _text;
+	int32_t _size = 10;
+	int32_t _weight = 0;
+
+	label (std::string text) : _text(std::move(text)) { }
+
+	std::string text() const { return _text; }
+	int32_t size() const { return _size; }
+	void set_size (int32_t size) { _size = size; }
+	int32_t weight() const { return _weight; }
+	void set_weight (int32_t weight) { _weight = weight; }
+
+	struct weight_p_t : int32_p, custom_serialize_property_i
+	{
+		using int32_p::int32_p;
+		virtual bool need_serialize (const object* obj) const override { return (static_cast<const label*>(obj)->_weight & 1) != 0; }
+	};
+
+	static const temp_string_p text_p;
+	static const int32_p size_p;
+	static const weight_p_t weight_p;
+	static const property* const _props[];
+	static const xtype<temp_string_property_traits> _type;
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+const temp_string_p label::text_p { "Text", nullptr, nullptr, &label::text, nullptr };
+const int32_p label::size_p { "Size", nullptr, nullptr, &label::size, &label::set_size, 10 };
+const label::weight_p_t label::weight_p { "Weight", nullptr, nullptr, &label::weight, &label::set_weight };
+const property* const label::_props[] = { &text_p, &size_p, &weight_p };
+const xtype<temp_string_property_traits> label::_type = { "Label", nullptr, label::_props,
+	[](std::string text) { return std::unique_ptr<object>(new label(std::move(text))); }, &label::text_p };
+
+// A preallocated collection of three children.
+struct slot_list : object, typed_object_collection_i<child>
+{
+	using base = object;
+
+	std::vector<std::unique_ptr<child>> _slots;
+
+	slot_list()
+	{
+		for (int i = 0; i < 3; i++)
+			_slots.push_back(std::make_unique<child>());
+	}
+
+	virtual std::vector<std::unique_ptr<child>>& children_store() override { return _slots; }
+	virtual const typed_object_collection_property<child>* collection_property() const override { return &slots_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<child>* get_slots (object* obj) { return static_cast<slot_list*>(obj); }
+
+	static const typed_object_collection_property<child> slots_p;
+	static const property* const _props[];
+	static const xtype<> _type;
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+const typed_object_collection_property<child> slot_list::slots_p { "Slots", nullptr, nullptr, true, &slot_list::get_slots };
+const property* const slot_list::_props[] = { &slots_p };
+const xtype<> slot_list::_type = { "SlotList", nullptr, slot_list::_props, []() { return std::unique_ptr<object>(new slot_list()); } };
+
+// One property of each kind: values with and without defaults, a value collection, a collection, and object properties.
+struct panel : object, typed_object_collection_i<label>
+{
+	using base = object;
+
+	std::string _title;
+	float _width = 1;
+	std::vector<int32_t> _values;
+	std::vector<std::unique_ptr<label>> _labels;
+	std::unique_ptr<slot_list> _slots = std::make_unique<slot_list>();
+	std::unique_ptr<label> _footer;
+
+	std::string title() const { return _title; }
+	void set_title (std::string title) { _title = std::move(title); }
+	float width() const { return _width; }
+	void set_width (float width) { _width = width; }
+
+	size_t value_count() const { return _values.size(); }
+	int32_t value (size_t i) const { return _values[i]; }
+	void insert_value (size_t i, int32_t v) { _values.insert (_values.begin() + i, v); }
+	void remove_value (size_t i) { _values.erase (_values.begin() + i); }
+	bool values_changed() const { return !_values.empty(); }
+
+	slot_list* slots() const { return _slots.get(); }
+	std::unique_ptr<slot_list> set_slots (std::unique_ptr<slot_list>&& value) { return std::exchange(_slots, std::move(value)); }
+	label* footer() const { return _footer.get(); }
+	std::unique_ptr<label> set_footer (std::unique_ptr<label>&& value) { return std::exchange(_footer, std::move(value)); }
+
+	virtual std::vector<std::unique_ptr<label>>& children_store() override { return _labels; }
+	virtual const typed_object_collection_property<label>* collection_property() const override { return &labels_p; }
+	virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+	virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+	static typed_object_collection_i<label>* get_labels (object* obj) { return static_cast<panel*>(obj); }
+
+	using values_p_t = typed_value_collection_property<panel, int32_property_traits>;
+	static const temp_string_p title_p;
+	static const float_p width_p;
+	static const values_p_t values_p;
+	static const typed_object_collection_property<label> labels_p;
+	static const typed_object_property<slot_list> slots_p;
+	static const typed_object_property<label> footer_p;
+	static const property* const _props[];
+	static const xtype<> _type;
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+const temp_string_p panel::title_p { "Title", nullptr, nullptr, &panel::title, &panel::set_title, std::string() };
+const float_p panel::width_p { "Width", nullptr, nullptr, &panel::width, &panel::set_width, 1.0f };
+const panel::values_p_t panel::values_p { "Values", nullptr, nullptr, &panel::value_count, &panel::value, nullptr, &panel::insert_value, &panel::remove_value, &panel::values_changed };
+const typed_object_collection_property<label> panel::labels_p { "Labels", nullptr, nullptr, false, &panel::get_labels };
+const typed_object_property<slot_list> panel::slots_p { "SlotList", nullptr, nullptr,
+	static_cast<typed_object_property<slot_list>::getter_t>(&panel::slots), static_cast<typed_object_property<slot_list>::setter_t>(&panel::set_slots) };
+const typed_object_property<label> panel::footer_p { "Footer", nullptr, nullptr,
+	static_cast<typed_object_property<label>::getter_t>(&panel::footer), static_cast<typed_object_property<label>::setter_t>(&panel::set_footer) };
+const property* const panel::_props[] = { &title_p, &width_p, &values_p, &labels_p, &slots_p, &footer_p };
+const xtype<> panel::_type = { "Panel", nullptr, panel::_props, []() { return std::unique_ptr<object>(new panel()); } };
+
+// With "changed" false, everything is left at default.
+static std::unique_ptr<panel> make_panel (bool changed)
+{
+	auto p = std::make_unique<panel>();
+	if (!changed)
+		return p;
+
+	p->_title = "Q&A <1>";
+	p->_values = { 3, -1 };
+
+	auto a = std::make_unique<label>("a");
+	auto b = std::make_unique<label>("\"b\"");
+	b->_size = 12;
+	b->_weight = 3;
+	auto c = std::make_unique<label>("c");
+	c->_weight = 4;
+	p->append(std::move(a));
+	p->append(std::move(b));
+	p->append(std::move(c));
+
+	p->_slots->_slots[1]->_x = 7;
+	p->_slots->_slots[2]->_name = "third";
+	p->_slots->_slots[2]->_side = side::bottom;
+
+	p->_footer = std::make_unique<label>("foot");
+	return p;
+}
+
+static const concrete_type* const panel_types[] = { &panel::_type, &label::_type, &slot_list::_type, &child::_type };
+
+// What the serializers wrote for make_panel() before they were rewritten over serialization_plan.
+static const char expected_xml[] = R"(
+<Panel Title="Q&amp;A &lt;1&gt;">
+	<Values>
+		<Entry index="0" Value="3"/>
+		<Entry index="1" Value="-1"/>
+	</Values>
+	<Labels>
+		<Label Text="a"/>
+		<Label Text="&quot;b&quot;" Size="12" Weight="3"/>
+		<Label Text="c"/>
+	</Labels>
+	<SlotList>
+		<Slots>
+			<Child index="1" X="7"/>
+			<Child index="2" Name="third" Side="Bottom"/>
+		</Slots>
+	</SlotList>
+	<Label Text="foot"/>
+</Panel>)";
+
+static const char expected_binary[] =
+	"454447420100000550616e656c06055469746c650557696474680656616c756573064c6162656c7308536c6f744c6973"
+	"7406466f6f746572010007512641203c313e0402020601030301054c6162656c0304546578740453697a650657656967"
+	"68740161000001032262220201180206000101630000040208536c6f744c6973740105536c6f74730001000300030543"
+	"68696c640601580159044e616d65024964014204536964650000010301000e0002030202057468697264050600050104"
+	"666f6f740000";
+
+static const char expected_unchanged_binary[] =
+	"454447420100000550616e656c06055469746c650557696474680656616c756573064c6162656c7308536c6f744c6973"
+	"7406466f6f7465720001040108536c6f744c6973740105536c6f7473000100030002054368696c640601580159044e61"
+	"6d650249640142045369646500000102000002020000";
+
+static std::string to_xml (const object* obj, bool force_serialize_unchanged)
+{
+	vector_out_stream s;
+	{
+		xml_writer writer (&s);
+		serialize (writer, obj, force_serialize_unchanged);
+	}
+	return std::string(s.buffer.begin(), s.buffer.end());
+}
+
+static std::string to_hex (const std::vector<uint8_t>& data)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string hex;
+	for (uint8_t b : data)
+	{
+		hex.push_back(digits[b >> 4]);
+		hex.push_back(digits[b & 15]);
+	}
+	return hex;
+}
+
+int main()
+{
+	// The plan lists the properties in order, with their kinds and flags, and is built only once.
+	{
+		auto& plan = label::_type.serialization_plan();
+		CHECK(&plan == &label::_type.serialization_plan());
+		CHECK(plan.props.size() == 3);
+		CHECK((plan.values == std::vector<size_t>{ 0, 1, 2 }) && plan.content.empty());
+		CHECK(plan.props[0].is_factory_prop && !plan.props[1].is_factory_prop && !plan.props[2].is_factory_prop);
+		CHECK(!plan.props[0].tracks_changed_from_default && plan.props[1].tracks_changed_from_default && !plan.props[2].tracks_changed_from_default);
+		CHECK((plan.props[0].cs == nullptr) && (plan.props[1].cs == nullptr) && (plan.props[2].cs == &label::weight_p));
+		CHECK((plan.find("Weight") == 2) && (plan.find("Missing") == (size_t)-1));
+		CHECK(plan.generated == nullptr);
+
+		auto& panel_plan = panel::_type.serialization_plan();
+		CHECK((panel_plan.values == std::vector<size_t>{ 0, 1 }) && (panel_plan.content == std::vector<size_t>{ 2, 3, 4, 5 }));
+		CHECK(panel_plan.props[2].kind == serialized_prop_kind::value_collection);
+		CHECK(panel_plan.props[3].kind == serialized_prop_kind::object_collection);
+		CHECK((panel_plan.props[4].kind == serialized_prop_kind::object) && (panel_plan.props[5].kind == serialized_prop_kind::object));
+	}
+
+	// Same output as before, byte for byte.
+	{
+		auto p = make_panel(true);
+		CHECK(to_xml(p.get(), true) == expected_xml);
+		CHECK(to_xml(p.get(), false) == expected_xml);
+		CHECK(to_hex(to_binary(p.get())) == expected_binary);
+
+		auto unchanged = make_panel(false);
+		CHECK(to_xml(unchanged.get(), true) == "\n<Panel/>");
+		CHECK(to_xml(unchanged.get(), false).empty());
+		CHECK(to_hex(to_binary(unchanged.get())) == expected_unchanged_binary);
+	}
+
+	// And the readers, which also look properties up through the plan, read it back. Both only read into object properties
+	// that are already set, and xml_reader doesn't read object properties at all, so the tree read back has fewer of them.
+	{
+		auto p = make_panel(true);
+		p->_footer = nullptr;
+		auto binary = to_binary(p.get());
+		binary_reader from = { binary.data(), binary.data() + binary.size() };
+		auto from_binary = deserialize (from, panel_types);
+		CHECK(to_binary(from_binary.get()) == binary);
+
+		p->_slots = std::make_unique<slot_list>();
+		auto xml = to_xml(p.get(), true);
+		CHECK(xml.find("<Label Text=\"c\"/>\n\t</Labels>\n</Panel>") != std::string::npos);
+		xml_reader reader (xml);
+		reader.read();
+		auto from_xml = deserialize (reader, panel_types);
+		CHECK(to_xml(from_xml.get(), true) == xml);
+	}
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Checks after each kind of change that every child of a soa_object_collection_i reads its own row,
+// and that the table holds the rows in the order of the children.
+
+#include "soa_points.h"
+#include <random>
+
+using namespace test;
+
+static void check_rows (const point_list& list, const std::vector<int32_t>& expected_ids)
+{
+	CHECK(list.child_count() == expected_ids.size());
+	CHECK(list.table().size() == expected_ids.size());
+	for (size_t i = 0; i < expected_ids.size(); i++)
+	{
+		auto p = list.child_at(i);
+		CHECK(p->id() == expected_ids[i]);
+		CHECK(list.table().column<1>()[i] == expected_ids[i]);
+		CHECK(p->x() == expected_ids[i] * 0.5f);
+	}
+}
+
+static std::unique_ptr<point> make_point (int32_t id)
+{
+	auto p = std::make_unique<point>();
+	p->set_x(id * 0.5f);
+	p->set_id(id);
+	return p;
+}
+
+int main()
+{
+	point_list list;
+	std::vector<int32_t> ids;
+	for (int32_t i = 0; i < 100; i++)
+	{
+		list.append(make_point(i));
+		ids.push_back(i);
+	}
+	check_rows (list, ids);
+
+	auto single = list.remove(3);
+	ids.erase(ids.begin() + 3);
+	check_rows (list, ids);
+	CHECK((single->id() == 3) && (single->x() == 1.5f));
+	list.insert(0, std::move(single));
+	ids.insert(ids.begin(), 3);
+	check_rows (list, ids);
+
+	std::vector<std::unique_ptr<point>> range;
+	for (int32_t i = 1000; i < 1010; i++)
+	{
+		range.push_back(make_point(i));
+		ids.insert(ids.begin() + 50 + (i - 1000), i);
+	}
+	list.insert_range(50, std::move(range));
+	check_rows (list, ids);
+
+	auto removed = list.remove_range(20, 15);
+	ids.erase(ids.begin() + 20, ids.begin() + 35);
+	check_rows (list, ids);
+	for (auto& p : removed)
+		CHECK(p->x() == p->id() * 0.5f);
+
+	// Several scattered children, some at the ends.
+	std::mt19937 rng (1);
+	std::vector<point*> to_remove = { list.child_at(0), list.child_at(list.child_count() - 1) };
+	for (int i = 0; i < 20; i++)
+	{
+		auto p = list.child_at(1 + rng() % (list.child_count() - 2));
+		if (std::find(to_remove.begin(), to_remove.end(), p) == to_remove.end())
+			to_remove.push_back(p);
+	}
+	for (auto p : to_remove)
+		ids.erase(std::find(ids.begin(), ids.end(), p->id()));
+	auto batch = list.remove(to_remove);
+	check_rows (list, ids);
+	for (auto& p : batch)
+		CHECK(p->x() == p->id() * 0.5f);
+
+	// Removed children keep their values, and bring them back when inserted again.
+	list.insert_range(5, std::move(batch));
+	ids.clear();
+	for (size_t i = 0; i < list.child_count(); i++)
+		ids.push_back(list.child_at(i)->id());
+	check_rows (list, ids);
+
+	list.move(0, 30);
+	std::rotate(ids.begin(), ids.begin() + 1, ids.begin() + 31);
+	check_rows (list, ids);
+
+	list.clear();
+	check_rows (list, { });
+	return 0;
+}
@@ -0,0 +1,55 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// A soa_object_collection_i of points with two columns, shared by the soa_collection test and benchmark.
+
+#pragma once
+#include "test_support.h"
+#include "soa_collection.h"
+
+namespace test
+{
+	struct point : soa_row_object<float, int32_t>
+	{
+		using base = object;
+
+		float x() const { return column_value<0>(); }
+		void set_x (float x) { set_column_value<0>(x); }
+		int32_t id() const { return column_value<1>(); }
+		void set_id (int32_t id) { set_column_value<1>(id); }
+
+		static const float_p x_p;
+		static const int32_p id_p;
+		static const property* const _props[];
+		static const xtype<> _type;
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	inline const float_p point::x_p { "X", nullptr, nullptr, static_cast<float_p::member_getter_t>(&point::x), static_cast<float_p::member_setter_t>(&point::set_x), 0.0f };
+	inline const int32_p point::id_p { "Id", nullptr, nullptr, static_cast<int32_p::member_getter_t>(&point::id), static_cast<int32_p::member_setter_t>(&point::set_id), 0 };
+	inline const property* const point::_props[] = { &x_p, &id_p };
+	inline const xtype<> point::_type = { "Point", nullptr, point::_props, []() { return std::unique_ptr<object>(new point()); } };
+
+	struct point_list : object, soa_object_collection_i<point>
+	{
+		using base = object;
+
+		std::vector<std::unique_ptr<point>> _points;
+
+		virtual std::vector<std::unique_ptr<point>>& children_store() override { return _points; }
+		virtual const typed_object_collection_property<point>* collection_property() const override { return &points_p; }
+		virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+		virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+		static typed_object_collection_i<point>* get_points (object* obj) { return static_cast<point_list*>(obj); }
+
+		static const typed_object_collection_property<point> points_p;
+		static const property* const _props[];
+		static const xtype<> _type;
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	inline const typed_object_collection_property<point> point_list::points_p { "Points", nullptr, nullptr, false, &point_list::get_points };
+	inline const property* const point_list::_props[] = { &points_p };
+	inline const xtype<> point_list::_type = { "PointList", nullptr, point_list::_props, []() { return std::unique_ptr<object>(new point_list()); } };
+}
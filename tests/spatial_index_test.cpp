@@ -0,0 +1,160 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Queries of spatial_index checked against looking at every object, after bulk loading and after random
+// inserts, removes and moves.
+
+#include "test_support.h"
+#include "spatial_index.h"
+#include <cmath>
+#include <random>
+
+using namespace test;
+
+// A child's bounds: at (X, Y), with a size that comes from its ID. Children with B false have none.
+static bool bounds_of (const object* obj, spatial_rect& bounds)
+{
+	if (obj->type() != &child::_type)
+		return false;
+
+	auto c = static_cast<const child*>(obj);
+	if (!c->_b)
+		return false;
+
+	bounds = { (float)c->_x, c->_y, (float)c->_x + (float)(c->_id % 50), c->_y + (float)(c->_id % 30) };
+	return true;
+}
+
+static float distance (spatial_point p, const spatial_rect& r)
+{
+	float dx = std::max ({ r.left - p.x, 0.0f, p.x - r.right });
+	float dy = std::max ({ r.top - p.y, 0.0f, p.y - r.bottom });
+	return std::sqrt (dx * dx + dy * dy);
+}
+
+static std::unique_ptr<child> random_child (std::mt19937& rng)
+{
+	auto c = std::make_unique<child>();
+	c->_x = (int32_t)(rng() % 10000);
+	c->_y = (float)(rng() % 10000);
+	c->_id = rng();
+	c->_b = (rng() % 10 != 0);
+	return c;
+}
+
+static std::vector<object*> brute_force_rect (const root* r, const spatial_rect& rect)
+{
+	std::vector<object*> result;
+	for (size_t i = 0; i < r->child_count(); i++)
+	{
+		spatial_rect bounds;
+		if (bounds_of(r->child_at(i), bounds) && rect.intersects(bounds))
+			result.push_back(r->child_at(i));
+	}
+	return result;
+}
+
+static bool same_set (std::vector<object*> a, std::vector<object*> b)
+{
+	std::sort (a.begin(), a.end());
+	std::sort (b.begin(), b.end());
+	return a == b;
+}
+
+static void check_queries (std::mt19937& rng, const root* r, const spatial_index& index)
+{
+	size_t indexed = 0;
+	for (size_t i = 0; i < r->child_count(); i++)
+		indexed += r->child_at(i)->_b;
+	CHECK(index.size() == indexed);
+
+	std::vector<object*> result;
+	for (int q = 0; q < 50; q++)
+	{
+		float size = (float)(1 << (rng() % 14));
+		float left = (float)(rng() % 11000) - 500;
+		float top = (float)(rng() % 11000) - 500;
+		spatial_rect rect = { left, top, left + size, top + size };
+		result.clear();
+		index.query_rect (rect, result);
+		CHECK(same_set(result, brute_force_rect(r, rect)));
+
+		spatial_point p = { (float)(rng() % 10000), (float)(rng() % 10000) };
+		float tolerance = (float)(rng() % 20);
+		result.clear();
+		index.query_point (p, tolerance, result);
+		CHECK(same_set(result, brute_force_rect(r, { p.x - tolerance, p.y - tolerance, p.x + tolerance, p.y + tolerance })));
+
+		// Several objects can be equally near, so only the distance is compared.
+		float best = std::numeric_limits<float>::infinity();
+		for (size_t i = 0; i < r->child_count(); i++)
+		{
+			spatial_rect bounds;
+			if (bounds_of(r->child_at(i), bounds))
+				best = std::min (best, distance(p, bounds));
+		}
+
+		auto found = index.nearest(p);
+		CHECK((found == nullptr) == (indexed == 0));
+		if (found)
+		{
+			spatial_rect bounds;
+			CHECK(bounds_of(found, bounds) && (distance(p, bounds) == best));
+			CHECK(index.nearest(p, best * 0.99f - 0.01f) == nullptr);
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 rng (1);
+	auto r = std::make_unique<root>();
+	for (int i = 0; i < 5000; i++)
+		r->append(random_child(rng));
+
+	spatial_index index (r.get(), &bounds_of);
+	check_queries (rng, r.get(), index);
+
+	for (int round = 0; round < 20; round++)
+	{
+		for (int edit = 0; edit < 300; edit++)
+		{
+			switch (rng() % 4)
+			{
+				case 0:
+					r->insert (rng() % (r->child_count() + 1), random_child(rng));
+					break;
+
+				case 1:
+					if (r->child_count() > 0)
+						r->remove ((size_t)(rng() % r->child_count()));
+					break;
+
+				case 2:
+					// Moves through the setter, which the index follows by itself.
+					if (r->child_count() > 0)
+						r->child_at(rng() % r->child_count())->set_x((int32_t)(rng() % 10000));
+					break;
+
+				default:
+					// Changes the index isn't told about, followed by invalidate().
+					if (r->child_count() > 0)
+					{
+						auto c = r->child_at(rng() % r->child_count());
+						c->_y = (float)(rng() % 10000);
+						c->_b = (rng() % 10 != 0);
+						index.invalidate(c);
+					}
+					break;
+			}
+		}
+
+		check_queries (rng, r.get(), index);
+	}
+
+	// Down to empty.
+	r->clear();
+	CHECK(index.size() == 0);
+	check_queries (rng, r.get(), index);
+	return 0;
+}
@@ -0,0 +1,83 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "test_support.h"
+#include "static_serializer.h"
+#include <array>
+
+namespace test
+{
+	// Object with 40 numeric properties, "I0" to "I19" of type int32 and "F0" to "F19" of type float, all with default value 0
+	// and with changed_from_default_bits. When "generated" is true its values are serialized by a static_serializer,
+	// otherwise through the value_property virtuals. Both have the same type name, so each can read what the other wrote.
+	template<bool generated>
+	struct static_item : object
+	{
+		using base = object;
+
+		std::array<int32_t, 20> _ints = { };
+		std::array<float, 20> _floats = { };
+		property_bitset _bits;
+
+		virtual property_bitset* changed_from_default_bits() override { return &_bits; }
+
+		template<size_t i> int32_t int_value() const { return _ints[i]; }
+		template<size_t i> void set_int_value (int32_t v) { _ints[i] = v; }
+		template<size_t i> float float_value() const { return _floats[i]; }
+		template<size_t i> void set_float_value (float v) { _floats[i] = v; }
+		static inline const int32_p i0_p { "I0", nullptr, nullptr, &static_item::int_value<0>, &static_item::set_int_value<0>, 0 };
+		static inline const int32_p i1_p { "I1", nullptr, nullptr, &static_item::int_value<1>, &static_item::set_int_value<1>, 0 };
+		static inline const int32_p i2_p { "I2", nullptr, nullptr, &static_item::int_value<2>, &static_item::set_int_value<2>, 0 };
+		static inline const int32_p i3_p { "I3", nullptr, nullptr, &static_item::int_value<3>, &static_item::set_int_value<3>, 0 };
+		static inline const int32_p i4_p { "I4", nullptr, nullptr, &static_item::int_value<4>, &static_item::set_int_value<4>, 0 };
+		static inline const int32_p i5_p { "I5", nullptr, nullptr, &static_item::int_value<5>, &static_item::set_int_value<5>, 0 };
+		static inline const int32_p i6_p { "I6", nullptr, nullptr, &static_item::int_value<6>, &static_item::set_int_value<6>, 0 };
+		static inline const int32_p i7_p { "I7", nullptr, nullptr, &static_item::int_value<7>, &static_item::set_int_value<7>, 0 };
+		static inline const int32_p i8_p { "I8", nullptr, nullptr, &static_item::int_value<8>, &static_item::set_int_value<8>, 0 };
+		static inline const int32_p i9_p { "I9", nullptr, nullptr, &static_item::int_value<9>, &static_item::set_int_value<9>, 0 };
+		static inline const int32_p i10_p { "I10", nullptr, nullptr, &static_item::int_value<10>, &static_item::set_int_value<10>, 0 };
+		static inline const int32_p i11_p { "I11", nullptr, nullptr, &static_item::int_value<11>, &static_item::set_int_value<11>, 0 };
+		static inline const int32_p i12_p { "I12", nullptr, nullptr, &static_item::int_value<12>, &static_item::set_int_value<12>, 0 };
+		static inline const int32_p i13_p { "I13", nullptr, nullptr, &static_item::int_value<13>, &static_item::set_int_value<13>, 0 };
+		static inline const int32_p i14_p { "I14", nullptr, nullptr, &static_item::int_value<14>, &static_item::set_int_value<14>, 0 };
+		static inline const int32_p i15_p { "I15", nullptr, nullptr, &static_item::int_value<15>, &static_item::set_int_value<15>, 0 };
+		static inline const int32_p i16_p { "I16", nullptr, nullptr, &static_item::int_value<16>, &static_item::set_int_value<16>, 0 };
+		static inline const int32_p i17_p { "I17", nullptr, nullptr, &static_item::int_value<17>, &static_item::set_int_value<17>, 0 };
+		static inline const int32_p i18_p { "I18", nullptr, nullptr, &static_item::int_value<18>, &static_item::set_int_value<18>, 0 };
+		static inline const int32_p i19_p { "I19", nullptr, nullptr, &static_item::int_value<19>, &static_item::set_int_value<19>, 0 };
+		static inline const float_p f0_p { "F0", nullptr, nullptr, &static_item::float_value<0>, &static_item::set_float_value<0>, 0.0f };
+		static inline const float_p f1_p { "F1", nullptr, nullptr, &static_item::float_value<1>, &static_item::set_float_value<1>, 0.0f };
+		static inline const float_p f2_p { "F2", nullptr, nullptr, &static_item::float_value<2>, &static_item::set_float_value<2>, 0.0f };
+		static inline const float_p f3_p { "F3", nullptr, nullptr, &static_item::float_value<3>, &static_item::set_float_value<3>, 0.0f };
+		static inline const float_p f4_p { "F4", nullptr, nullptr, &static_item::float_value<4>, &static_item::set_float_value<4>, 0.0f };
+		static inline const float_p f5_p { "F5", nullptr, nullptr, &static_item::float_value<5>, &static_item::set_float_value<5>, 0.0f };
+		static inline const float_p f6_p { "F6", nullptr, nullptr, &static_item::float_value<6>, &static_item::set_float_value<6>, 0.0f };
+		static inline const float_p f7_p { "F7", nullptr, nullptr, &static_item::float_value<7>, &static_item::set_float_value<7>, 0.0f };
+		static inline const float_p f8_p { "F8", nullptr, nullptr, &static_item::float_value<8>, &static_item::set_float_value<8>, 0.0f };
+		static inline const float_p f9_p { "F9", nullptr, nullptr, &static_item::float_value<9>, &static_item::set_float_value<9>, 0.0f };
+		static inline const float_p f10_p { "F10", nullptr, nullptr, &static_item::float_value<10>, &static_item::set_float_value<10>, 0.0f };
+		static inline const float_p f11_p { "F11", nullptr, nullptr, &static_item::float_value<11>, &static_item::set_float_value<11>, 0.0f };
+		static inline const float_p f12_p { "F12", nullptr, nullptr, &static_item::float_value<12>, &static_item::set_float_value<12>, 0.0f };
+		static inline const float_p f13_p { "F13", nullptr, nullptr, &static_item::float_value<13>, &static_item::set_float_value<13>, 0.0f };
+		static inline const float_p f14_p { "F14", nullptr, nullptr, &static_item::float_value<14>, &static_item::set_float_value<14>, 0.0f };
+		static inline const float_p f15_p { "F15", nullptr, nullptr, &static_item::float_value<15>, &static_item::set_float_value<15>, 0.0f };
+		static inline const float_p f16_p { "F16", nullptr, nullptr, &static_item::float_value<16>, &static_item::set_float_value<16>, 0.0f };
+		static inline const float_p f17_p { "F17", nullptr, nullptr, &static_item::float_value<17>, &static_item::set_float_value<17>, 0.0f };
+		static inline const float_p f18_p { "F18", nullptr, nullptr, &static_item::float_value<18>, &static_item::set_float_value<18>, 0.0f };
+		static inline const float_p f19_p { "F19", nullptr, nullptr, &static_item::float_value<19>, &static_item::set_float_value<19>, 0.0f };
+
+		static inline const property* const _props[] = {
+			&i0_p, &i1_p, &i2_p, &i3_p, &i4_p, &i5_p, &i6_p, &i7_p, &i8_p, &i9_p, &i10_p, &i11_p, &i12_p, &i13_p, &i14_p, &i15_p, &i16_p, &i17_p, &i18_p, &i19_p,
+			&f0_p, &f1_p, &f2_p, &f3_p, &f4_p, &f5_p, &f6_p, &f7_p, &f8_p, &f9_p, &f10_p, &f11_p, &f12_p, &f13_p, &f14_p, &f15_p, &f16_p, &f17_p, &f18_p, &f19_p };
+
+		using serializer_t = static_serializer<
+			i0_p, i1_p, i2_p, i3_p, i4_p, i5_p, i6_p, i7_p, i8_p, i9_p, i10_p, i11_p, i12_p, i13_p, i14_p, i15_p, i16_p, i17_p, i18_p, i19_p,
+			f0_p, f1_p, f2_p, f3_p, f4_p, f5_p, f6_p, f7_p, f8_p, f9_p, f10_p, f11_p, f12_p, f13_p, f14_p, f15_p, f16_p, f17_p, f18_p, f19_p>;
+		using type_t = std::conditional_t<generated, generated_xtype<serializer_t>, xtype<>>;
+		static inline const type_t _type = { "StaticItem", nullptr, _props, []() { return std::unique_ptr<object>(new static_item()); } };
+
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+}
@@ -0,0 +1,118 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "static_item.h"
+#include "wide_item.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+
+using namespace test;
+
+using generated_item = static_item<true>;
+using virtual_item = static_item<false>;
+
+static std::string to_xml (const object* obj)
+{
+	vector_out_stream s;
+	{
+		xml_writer writer (&s);
+		serialize (writer, obj, true);
+	}
+	return std::string(s.buffer.begin(), s.buffer.end());
+}
+
+static std::unique_ptr<object> from_xml (const std::string& xml, std::span<const concrete_type* const> types)
+{
+	xml_reader reader (xml);
+	reader.read();
+	return deserialize (reader, types);
+}
+
+// A third of the values changed from default, some of them set back to default afterwards.
+template<typename item_t>
+static std::unique_ptr<item_list<item_t>> make_list (size_t n)
+{
+	auto list = std::make_unique<item_list<item_t>>();
+	for (size_t i = 0; i < n; i++)
+	{
+		auto item = std::make_unique<item_t>();
+		for (size_t p = 0; p < 40; p++)
+		{
+			auto vp = static_cast<const value_property*>(item_t::_props[p]);
+			if ((i + p) % 3 == 0)
+				vp->set_from_string ((p < 20) ? std::to_string((int)(i * 7 + p) - 50) : std::to_string(i * 0.25 + p), item.get());
+			if ((i + p) % 9 == 0)
+				vp->set_from_string ("0", item.get());
+		}
+		list->append(std::move(item));
+	}
+
+	return list;
+}
+
+template<typename a_t, typename b_t>
+static bool same_items (const item_list<a_t>& a, const item_list<b_t>& b)
+{
+	if (a.child_count() != b.child_count())
+		return false;
+
+	for (size_t i = 0; i < a.child_count(); i++)
+	{
+		auto x = a.child_at(i);
+		auto y = b.child_at(i);
+		if ((x->_ints != y->_ints) || (x->_floats != y->_floats))
+			return false;
+		for (size_t p = 0; p < 40; p++)
+		{
+			if (x->_bits.test(p) != y->_bits.test(p))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+int main()
+{
+	CHECK((generated_item::_type.serialization_plan().generated != nullptr) && (virtual_item::_type.serialization_plan().generated == nullptr));
+
+	const concrete_type* const generated_types[] = { &generated_item::_type, &item_list<generated_item>::_type };
+	const concrete_type* const virtual_types[] = { &virtual_item::_type, &item_list<virtual_item>::_type };
+
+	auto generated = make_list<generated_item>(1000);
+	auto virtual_ = make_list<virtual_item>(1000);
+	CHECK(same_items(*generated, *virtual_));
+
+	// Both paths write the same documents.
+	auto binary = to_binary(generated.get());
+	CHECK(binary == to_binary(virtual_.get()));
+	auto xml = to_xml(generated.get());
+	CHECK(xml == to_xml(virtual_.get()));
+
+	// And read them back the same, including the changed-from-default bits.
+	for (auto types : { std::span<const concrete_type* const>(generated_types), std::span<const concrete_type* const>(virtual_types) })
+	{
+		binary_reader reader = { binary.data(), binary.data() + binary.size() };
+		auto from_binary = deserialize (reader, types);
+		auto from_xml_ = from_xml (xml, types);
+		if (types[0] == &generated_item::_type)
+		{
+			CHECK(same_items(*generated, *static_cast<item_list<generated_item>*>(from_binary.get())));
+			CHECK(same_items(*generated, *static_cast<item_list<generated_item>*>(from_xml_.get())));
+		}
+		else
+		{
+			CHECK(same_items(*generated, *static_cast<item_list<virtual_item>*>(from_binary.get())));
+			CHECK(same_items(*generated, *static_cast<item_list<virtual_item>*>(from_xml_.get())));
+		}
+	}
+
+	// An object with all values at default writes an empty value section.
+	item_list<generated_item> defaults;
+	defaults.append(std::make_unique<generated_item>());
+	item_list<virtual_item> virtual_defaults;
+	virtual_defaults.append(std::make_unique<virtual_item>());
+	CHECK((to_binary(&defaults) == to_binary(&virtual_defaults)) && (to_xml(&defaults) == to_xml(&virtual_defaults)));
+
+	return 0;
+}
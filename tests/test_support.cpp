@@ -0,0 +1,44 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "assert.h"
+
+#ifdef _WIN32
+	#include <Windows.h>
+	#include <Psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+// The library's assert.h leaves the failure handler to the application (win32/assert.cpp on Windows).
+volatile unsigned int assert_function_running = 0;
+
+#ifndef _MSC_VER
+extern "C" void __assert (const char* filename, int line)
+{
+	std::fprintf (stderr, "%s(%d): assertion failed\n", filename, line);
+	std::fflush (stderr);
+	std::abort();
+}
+#endif
+
+size_t peak_rss()
+{
+	#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0;
+		return counters.PeakWorkingSetSize;
+	#else
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+		#ifdef __APPLE__
+			return (size_t)usage.ru_maxrss;
+		#else
+			return (size_t)usage.ru_maxrss * 1024;
+		#endif
+	#endif
+}
@@ -0,0 +1,252 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// Shared by the tests and the benchmarks: a check macro, timing, and a small object model
+// (a root with a collection of children that have one property of each common value type).
+
+#pragma once
+#include "collections.h"
+#include "binary_serializer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Unlike assert, active in all build types, and prints the failed expression.
+#define CHECK(e) ((e) ? (void)0 : ::test_failed(#e, __FILE__, __LINE__))
+
+[[noreturn]] inline void test_failed (const char* expression, const char* file, int line)
+{
+	std::fprintf (stderr, "%s(%d): check failed: %s\n", file, line, expression);
+	std::fflush (stderr);
+	std::abort();
+}
+
+// Expects "statement" to throw exception_t.
+#define CHECK_THROWS(exception_t, statement) \
+	do { bool thrown_ = false; try { statement; } catch (const exception_t&) { thrown_ = true; } CHECK(thrown_); } while (0)
+
+inline double now_ms()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Size argument of a benchmark: argv[index] if given, "default_value" otherwise.
+inline size_t size_arg (int argc, char** argv, int index, size_t default_value)
+{
+	return (argc > index) ? (size_t)std::strtoull(argv[index], nullptr, 10) : default_value;
+}
+
+// Peak resident set size of the process so far, in bytes, or 0 where not available.
+size_t peak_rss();
+
+namespace test
+{
+	using namespace edge;
+
+	// Only set_x raises property change notifications; the other setters are meant for building trees quickly.
+	struct child : object
+	{
+		using base = object;
+
+		int32_t _x = 0;
+		float _y = 0;
+		std::string _name;
+		uint64_t _id = 0;
+		bool _b = false;
+		side _side = side::left;
+
+		int32_t x() const { return _x; }
+		void set_x (int32_t x)
+		{
+			if (_x != x)
+			{
+				this->on_property_changing(&x_p);
+				_x = x;
+				this->on_property_changed(&x_p);
+			}
+		}
+
+		float y() const { return _y; }
+		void set_y (float y) { _y = y; }
+		std::string name() const { return _name; }
+		void set_name (std::string name) { _name = std::move(name); }
+		uint64_t id() const { return _id; }
+		void set_id (uint64_t id) { _id = id; }
+		bool b() const { return _b; }
+		void set_b (bool b) { _b = b; }
+		side get_side() const { return _side; }
+		void set_side (side s) { _side = s; }
+
+		static const int32_p x_p;
+		static const float_p y_p;
+		static const temp_string_p name_p;
+		static const uint64_p id_p;
+		static const bool_p b_p;
+		static const side_p side_p_;
+		static const property* const _props[];
+		static const xtype<> _type;
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	inline const int32_p child::x_p { "X", nullptr, nullptr, &child::x, &child::set_x, 0 };
+	inline const float_p child::y_p { "Y", nullptr, nullptr, &child::y, &child::set_y, 0.0f };
+	inline const temp_string_p child::name_p { "Name", nullptr, nullptr, &child::name, &child::set_name, std::string() };
+	inline const uint64_p child::id_p { "Id", nullptr, nullptr, &child::id, &child::set_id, 0 };
+	inline const bool_p child::b_p { "B", nullptr, nullptr, &child::b, &child::set_b, false };
+	inline const side_p child::side_p_ { "Side", nullptr, nullptr, &child::get_side, &child::set_side, side::left };
+	inline const property* const child::_props[] = { &x_p, &y_p, &name_p, &id_p, &b_p, &side_p_ };
+	inline const xtype<> child::_type = { "Child", nullptr, child::_props, []() { return std::unique_ptr<object>(new child()); } };
+
+	struct root : object, typed_object_collection_i<child>
+	{
+		using base = object;
+
+		std::vector<std::unique_ptr<child>> _children;
+		std::vector<int32_t> _vals;
+
+		virtual std::vector<std::unique_ptr<child>>& children_store() override { return _children; }
+		virtual const typed_object_collection_property<child>* collection_property() const override { return &children_p; }
+		virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+		virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+		size_t val_count() const { return _vals.size(); }
+		int32_t val (size_t i) const { return _vals[i]; }
+		void insert_val (size_t i, int32_t v)
+		{
+			property_change_args args = { &vals_p, i, collection_property_change_type::insert };
+			this->on_property_changing(args);
+			_vals.insert (_vals.begin() + i, v);
+			this->on_property_changed(args);
+		}
+		void remove_val (size_t i)
+		{
+			property_change_args args = { &vals_p, i, collection_property_change_type::remove };
+			this->on_property_changing(args);
+			_vals.erase (_vals.begin() + i);
+			this->on_property_changed(args);
+		}
+		bool vals_changed() const { return !_vals.empty(); }
+
+		static typed_object_collection_i<child>* get_children (object* obj) { return static_cast<root*>(obj); }
+
+		using vals_p_t = typed_value_collection_property<root, int32_property_traits>;
+		static const typed_object_collection_property<child> children_p;
+		static const vals_p_t vals_p;
+		static const property* const _props[];
+		static const xtype<> _type;
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	inline const typed_object_collection_property<child> root::children_p { "Children", nullptr, nullptr, false, &root::get_children };
+	inline const root::vals_p_t root::vals_p { "Vals", nullptr, nullptr, &root::val_count, &root::val, nullptr, &root::insert_val, &root::remove_val, &root::vals_changed };
+	inline const property* const root::_props[] = { &children_p, &vals_p };
+	inline const xtype<> root::_type = { "Root", nullptr, root::_props, []() { return std::unique_ptr<object>(new root()); } };
+
+	// Object with a string that is not copied when loaded from a binary document (see backed_string_property_traits).
+	struct blob : object
+	{
+		using base = object;
+
+		uint32_t _number = 0;
+		std::string_view _data;
+
+		uint32_t number() const { return _number; }
+		void set_number (uint32_t number) { _number = number; }
+		std::string_view data() const { return _data; }
+		void set_data (std::string_view data) { _data = data; }
+
+		static const uint32_p number_p;
+		static const backed_string_p data_p;
+		static const property* const _props[];
+		static const xtype<> _type;
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	inline const uint32_p blob::number_p { "Number", nullptr, nullptr, &blob::number, &blob::set_number, 0 };
+	inline const backed_string_p blob::data_p { "Data", nullptr, nullptr, &blob::data, &blob::set_data, std::nullopt };
+	inline const property* const blob::_props[] = { &number_p, &data_p };
+	inline const xtype<> blob::_type = { "Blob", nullptr, blob::_props, []() { return std::unique_ptr<object>(new blob()); } };
+
+	struct blob_list : object, typed_object_collection_i<blob>
+	{
+		using base = object;
+
+		std::vector<std::unique_ptr<blob>> _blobs;
+
+		virtual std::vector<std::unique_ptr<blob>>& children_store() override { return _blobs; }
+		virtual const typed_object_collection_property<blob>* collection_property() const override { return &blobs_p; }
+		virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+		virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+		static typed_object_collection_i<blob>* get_blobs (object* obj) { return static_cast<blob_list*>(obj); }
+
+		static const typed_object_collection_property<blob> blobs_p;
+		static const property* const _props[];
+		static const xtype<> _type;
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	inline const typed_object_collection_property<blob> blob_list::blobs_p { "Blobs", nullptr, nullptr, false, &blob_list::get_blobs };
+	inline const property* const blob_list::_props[] = { &blobs_p };
+	inline const xtype<> blob_list::_type = { "BlobList", nullptr, blob_list::_props, []() { return std::unique_ptr<object>(new blob_list()); } };
+
+	inline const concrete_type* const known_types[] = { &child::_type, &root::_type, &blob::_type, &blob_list::_type };
+
+	// "n" children with varied values (a third of them with a name), and a few values in the value collection.
+	inline std::unique_ptr<root> make_tree (size_t n)
+	{
+		auto r = std::make_unique<root>();
+		r->_children.reserve(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			auto c = std::make_unique<child>();
+			c->_x = (int32_t)i - 5;
+			c->_y = i * 0.5f;
+			if (i % 3 == 0)
+				c->_name = "name" + std::to_string(i);
+			c->_id = i * 1000003ull;
+			c->_b = (i & 1) != 0;
+			c->_side = (side)(i % 4);
+			r->append(std::move(c));
+		}
+
+		for (int i = 0; i < 5; i++)
+			r->_vals.push_back(-i * 100);
+
+		return r;
+	}
+
+	inline bool same_values (const child* a, const child* b)
+	{
+		return (a->_x == b->_x) && (a->_y == b->_y) && (a->_name == b->_name) && (a->_id == b->_id) && (a->_b == b->_b) && (a->_side == b->_side);
+	}
+
+	inline bool same_tree (const root* a, const root* b)
+	{
+		if ((a->child_count() != b->child_count()) || (a->_vals != b->_vals))
+			return false;
+
+		for (size_t i = 0; i < a->child_count(); i++)
+		{
+			if (!same_values(a->child_at(i), b->child_at(i)))
+				return false;
+		}
+
+		return true;
+	}
+
+	inline std::vector<uint8_t> to_binary (const object* obj)
+	{
+		vector_out_stream s;
+		serialize (obj, &s);
+		return std::move(s.buffer);
+	}
+
+	inline std::unique_ptr<object> from_binary (const std::vector<uint8_t>& data)
+	{
+		binary_reader reader = { data.data(), data.data() + data.size() };
+		return deserialize (reader, known_types);
+	}
+}
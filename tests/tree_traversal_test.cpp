@@ -0,0 +1,89 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+// parallel_visit visits every object exactly once, each after its parent, whatever the number of workers and the grain size.
+
+#include "random_tree.h"
+#include "tree_traversal.h"
+#include <unordered_map>
+
+using namespace test;
+
+static std::vector<const object*> all_objects (const object* root)
+{
+	std::vector<const object*> objects;
+	for (const object* obj : preorder(root))
+		objects.push_back(obj);
+	return objects;
+}
+
+static void check_visit (const object* root, size_t thread_count, size_t grain_size)
+{
+	auto objects = all_objects(root);
+	std::unordered_map<const object*, size_t> indexes;
+	for (size_t i = 0; i < objects.size(); i++)
+		indexes.insert({ objects[i], i });
+
+	// The parent of each object; the trees here have object collections only.
+	std::vector<const object*> parents (objects.size(), nullptr);
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		for (auto prop : objects[i]->type()->child_property_list())
+		{
+			auto collection = static_cast<const object_collection_property*>(prop)->collection_cast(objects[i]);
+			for (size_t c = 0; c < collection->child_count(); c++)
+				parents[indexes.at(collection->child_at(c))] = objects[i];
+		}
+	}
+
+	work_stealing_pool pool (thread_count);
+	std::vector<std::atomic<size_t>> visit_counts (objects.size());
+	std::vector<std::atomic<size_t>> sequence (objects.size());
+	std::atomic<size_t> next_sequence = 1;
+	std::atomic<bool> bad_worker = false;
+	parallel_visit (pool, root, [&](const object* obj, size_t worker_index)
+	{
+		if (worker_index >= pool.concurrency())
+			bad_worker = true;
+		size_t i = indexes.at(obj);
+		visit_counts[i]++;
+		sequence[i] = next_sequence++;
+	}, grain_size);
+
+	CHECK(!bad_worker);
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		CHECK(visit_counts[i] == 1);
+		if (parents[i])
+			CHECK(sequence[indexes.at(parents[i])] < sequence[i]);
+	}
+
+	size_t count = parallel_map_reduce (pool, root, (size_t)0, [](const object*) { return (size_t)1; }, std::plus<size_t>(), grain_size);
+	CHECK(count == objects.size());
+}
+
+int main()
+{
+	// A flat collection much bigger than the grain size.
+	auto flat = make_tree(20'000);
+
+	// Nested collections, some big, most small.
+	std::mt19937 rng (1);
+	auto nested = make_node<tree>(rng);
+	for (int i = 0; i < 2000; i++)
+		nested->nodes()->append(make_node<branch<branch<leaf, 1>, 2>>(rng));
+
+	auto single = std::make_unique<root>();
+
+	for (size_t thread_count : { 0, 1, 3, 7 })
+	{
+		for (size_t grain_size : { 1, 16, 1024 })
+		{
+			check_visit (flat.get(), thread_count, grain_size);
+			check_visit (nested.get(), thread_count, grain_size);
+			check_visit (single.get(), thread_count, grain_size);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,219 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "undo_history.h"
+#include <stdexcept>
+#include <utility>
+
+using namespace test;
+
+// An object property, and a value whose setter can be made to throw.
+struct holder : object
+{
+	using base = object;
+
+	std::unique_ptr<child> _inner;
+	int32_t _limit = 0;
+	static inline bool fail_sets = false;
+
+	child* inner() const { return _inner.get(); }
+	std::unique_ptr<child> set_inner (std::unique_ptr<child>&& value)
+	{
+		property_change_args args = { &inner_p, 0, collection_property_change_type::set };
+		this->on_property_changing(args);
+		auto old = std::exchange(_inner, std::move(value));
+		this->on_property_changed(args);
+		return old;
+	}
+
+	int32_t limit() const { return _limit; }
+	void set_limit (int32_t limit)
+	{
+		if (fail_sets)
+			throw std::runtime_error("set failed");
+
+		if (_limit != limit)
+		{
+			this->on_property_changing(&limit_p);
+			_limit = limit;
+			this->on_property_changed(&limit_p);
+		}
+	}
+
+	static const typed_object_property<child> inner_p;
+	static const int32_p limit_p;
+	static const property* const _props[];
+	static const xtype<> _type;
+	virtual const concrete_type* type() const override { return &_type; }
+};
+
+const typed_object_property<child> holder::inner_p { "Inner", nullptr, nullptr,
+	static_cast<typed_object_property<child>::getter_t>(&holder::inner), static_cast<typed_object_property<child>::setter_t>(&holder::set_inner) };
+const int32_p holder::limit_p { "Limit", nullptr, nullptr, &holder::limit, &holder::set_limit, 0 };
+const property* const holder::_props[] = { &inner_p, &limit_p };
+const xtype<> holder::_type = { "Holder", nullptr, holder::_props, []() { return std::unique_ptr<object>(new holder()); } };
+
+// Appends 1 for each property_changing and 2 for each property_changed of the collection.
+static void log_changing (void* log, object*, const property_change_args& args)
+{
+	if (args.property == &root::children_p)
+		static_cast<std::vector<int>*>(log)->push_back(1);
+}
+
+static void log_changed (void* log, object*, const property_change_args& args)
+{
+	if (args.property == &root::children_p)
+		static_cast<std::vector<int>*>(log)->push_back(2);
+}
+
+int main()
+{
+	// Single changes, transactions, and rollback on exception.
+	{
+		auto r = make_tree(100);
+		auto snapshot = make_tree(100);
+		undo_history h (r.get(), known_types);
+
+		r->child_at(3)->set_x(42);
+		CHECK(h.can_undo());
+		h.undo();
+		CHECK(r->child_at(3)->_x == -2);
+		h.redo();
+		CHECK(r->child_at(3)->_x == 42);
+		h.undo();
+		CHECK(same_tree(r.get(), snapshot.get()));
+
+		{
+			undo_history::transaction t (&h, "multi");
+			r->child_at(1)->set_x(7);
+			r->remove(5);
+			auto c = std::make_unique<child>();
+			c->_name = "new";
+			r->insert(0, std::move(c));
+			r->child_at(0)->set_x(100);
+			r->move(0, 50);
+			t.commit();
+		}
+		CHECK((r->child_count() == 100) && (r->child_at(50)->_x == 100));
+		h.undo();
+		CHECK(same_tree(r.get(), snapshot.get()));
+		h.redo();
+		CHECK((r->child_at(50)->_x == 100) && (r->child_at(50)->_name == "new") && (r->child_at(1)->_x == 7));
+		h.undo();
+
+		try
+		{
+			undo_history::transaction t (&h, "fail");
+			r->child_at(10)->set_x(1000);
+			r->remove(20);
+			throw 1;
+		}
+		catch (int)
+		{
+		}
+		CHECK(same_tree(r.get(), snapshot.get()));
+		CHECK(h.can_redo());
+	}
+
+	// Removing several children at once: a few runs (removed one run at a time) and many scattered children
+	// (reordered, then removed as one range). Each property_changing must be followed by its property_changed.
+	for (size_t step : { 0, 2 })
+	{
+		auto r = make_tree(100);
+		auto snapshot = make_tree(100);
+		undo_history h (r.get(), known_types);
+
+		std::vector<child*> to_remove;
+		if (step == 0)
+		{
+			for (size_t i : { 10, 11, 12, 13, 14, 50, 51, 97 })
+				to_remove.push_back(r->child_at(i));
+		}
+		else
+		{
+			for (size_t i = 5; i < 95; i += step)
+				to_remove.push_back(r->child_at(i));
+		}
+
+		std::vector<int> log;
+		r->property_changing().add_handler(&log_changing, &log);
+		r->property_changed().add_handler(&log_changed, &log);
+		std::vector<std::unique_ptr<child>> removed;
+		{
+			undo_history::transaction t (&h, "remove");
+			removed = r->remove(to_remove);
+			t.commit();
+		}
+		r->property_changing().remove_handler(&log_changing, &log);
+		r->property_changed().remove_handler(&log_changed, &log);
+
+		CHECK(!log.empty() && (log.size() % 2 == 0));
+		for (size_t i = 0; i < log.size(); i += 2)
+			CHECK((log[i] == 1) && (log[i + 1] == 2));
+		CHECK(r->child_count() == 100 - to_remove.size());
+		for (size_t i = 0; i < removed.size(); i++)
+			CHECK(removed[i].get() == to_remove[i]);
+
+		h.undo();
+		CHECK(same_tree(r.get(), snapshot.get()));
+		h.redo();
+		CHECK(r->child_count() == 100 - to_remove.size());
+		h.undo();
+		CHECK(same_tree(r.get(), snapshot.get()));
+	}
+
+	// Object property sets.
+	{
+		holder o;
+		undo_history h (&o, known_types);
+
+		auto c = std::make_unique<child>();
+		c->_x = 5;
+		o.set_inner(std::move(c));
+		o.inner()->set_x(6);
+		auto c2 = std::make_unique<child>();
+		c2->_name = "second";
+		o.set_inner(std::move(c2));
+		o.set_inner(nullptr);
+
+		h.undo();
+		CHECK(o.inner() && (o.inner()->_name == "second"));
+		h.undo();
+		CHECK(o.inner() && (o.inner()->_x == 6));
+		h.undo();
+		CHECK(o.inner() && (o.inner()->_x == 5));
+		h.undo();
+		CHECK(!o.inner() && !h.can_undo());
+		h.redo();
+		h.redo();
+		CHECK(o.inner() && (o.inner()->_x == 6));
+		h.redo();
+		h.redo();
+		CHECK(!o.inner() && !h.can_redo());
+	}
+
+	// A rollback that throws, from the destructor of a transaction: the exception is swallowed and the history cleared.
+	{
+		holder o;
+		undo_history h (&o, known_types);
+		o.set_limit(1);
+		CHECK(h.can_undo());
+
+		try
+		{
+			undo_history::transaction t (&h, "fail");
+			o.set_limit(2);
+			holder::fail_sets = true;
+			throw 1;
+		}
+		catch (int)
+		{
+		}
+
+		holder::fail_sets = false;
+		CHECK((o._limit == 2) && !h.can_undo() && !h.can_redo());
+	}
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "test_support.h"
+#include <array>
+#include <utility>
+
+namespace test
+{
+	// Object with "count" int32 properties "V0", "V1"... all with default value 0.
+	// When "tracked" is true it has changed_from_default_bits.
+	template<bool tracked, size_t count = 20>
+	struct wide_item : object
+	{
+		using base = object;
+
+		std::array<int32_t, count> _values = { };
+		property_bitset _bits;
+
+		virtual property_bitset* changed_from_default_bits() override { return tracked ? &_bits : nullptr; }
+
+		template<size_t i> int32_t value() const { return _values[i]; }
+		template<size_t i> void set_value (int32_t v) { _values[i] = v; }
+
+	private:
+		template<size_t i>
+		struct name
+		{
+			static constexpr char text[] = { 'V', (i >= 10) ? (char)('0' + i / 10) : (char)('0' + i), (i >= 10) ? (char)('0' + i % 10) : '\0', '\0' };
+		};
+
+		template<size_t... I>
+		static std::array<int32_p, count> make_props (std::index_sequence<I...>)
+		{
+			return { int32_p { name<I>::text, nullptr, nullptr, &wide_item::value<I>, &wide_item::set_value<I>, 0 }... };
+		}
+
+		template<size_t... I>
+		static std::array<const property*, count> make_prop_list (std::index_sequence<I...>)
+		{
+			return { &props[I]... };
+		}
+
+	public:
+		static_assert (count <= 100);
+		static inline const std::array<int32_p, count> props = make_props(std::make_index_sequence<count>());
+		static inline const std::array<const property*, count> prop_list = make_prop_list(std::make_index_sequence<count>());
+		static inline const xtype<> _type = { tracked ? "TrackedWideItem" : "WideItem", nullptr, prop_list, []() { return std::unique_ptr<object>(new wide_item()); } };
+
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+
+	template<typename item_t>
+	struct item_list : object, typed_object_collection_i<item_t>
+	{
+		using base = object;
+
+		std::vector<std::unique_ptr<item_t>> _items;
+
+		virtual std::vector<std::unique_ptr<item_t>>& children_store() override { return _items; }
+		virtual const typed_object_collection_property<item_t>* collection_property() const override { return &items_p; }
+		virtual void call_property_changing (const property_change_args& args) override { this->on_property_changing(args); }
+		virtual void call_property_changed  (const property_change_args& args) override { this->on_property_changed(args); }
+
+		static typed_object_collection_i<item_t>* get_items (object* obj) { return static_cast<item_list*>(obj); }
+
+		static inline const typed_object_collection_property<item_t> items_p { "Items", nullptr, nullptr, false, &item_list::get_items };
+		static inline const property* const _props[] = { &items_p };
+		static inline const xtype<> _type = { "ItemList", nullptr, _props, []() { return std::unique_ptr<object>(new item_list()); } };
+
+		virtual const concrete_type* type() const override { return &_type; }
+	};
+}
@@ -0,0 +1,99 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "xml_reader.h"
+
+using namespace test;
+
+using node_type = xml_reader::node_type;
+
+// Reads the whole document, expecting it to be malformed.
+static void check_malformed (std::string_view text, const xml_scanner* scanner)
+{
+	xml_reader reader (text, scanner);
+	CHECK_THROWS(xml_read_exception, while (reader.read() != node_type::end_of_document) { });
+}
+
+static std::string attribute_value (std::string_view text, const xml_scanner* scanner)
+{
+	xml_reader reader (text, scanner);
+	CHECK(reader.read() == node_type::start_element);
+	CHECK(reader.attributes().size() == 1);
+	return std::string(reader.attributes()[0].value);
+}
+
+static void test_scanner (const xml_scanner* scanner)
+{
+	// Entity and character references, and attribute value normalization.
+	CHECK(attribute_value("<a v=\"&amp;&lt;&gt;&quot;&apos;\"/>", scanner) == "&<>\"'");
+	CHECK(attribute_value("<a v=\"x&#65;&#x42;&#x6a;y\"/>", scanner) == "xABjy");
+	CHECK(attribute_value("<a v=\"&#233;&#x20AC;&#x1F600;\"/>", scanner) == "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+	CHECK(attribute_value("<a v=\"1\t2\n3\r\n4\r5\"/>", scanner) == "1 2 3 4 5");
+	CHECK(attribute_value("<a v=\"&#9;&#10;&#13;\"/>", scanner) == "\t\n\r");
+	CHECK(attribute_value("<a v='it\"s'/>", scanner) == "it\"s");
+	CHECK(attribute_value("<a  v = \"x\" />", scanner) == "x");
+	for (auto bad : { "<a v=\"&foo;\"/>", "<a v=\"&amp\"/>", "<a v=\"&#;\"/>", "<a v=\"&#x;\"/>", "<a v=\"&#12a;\"/>", "<a v=\"&#x110000;\"/>" })
+		check_malformed (bad, scanner);
+
+	// Several attributes with references, so that their unescaped values share the buffer.
+	{
+		xml_reader reader ("<a x=\"&lt;1\" y=\"2\" z=\"&gt;3\"/>", scanner);
+		reader.read();
+		CHECK((reader.attributes().size() == 3) && (reader.find_attribute("x")->value == "<1")
+			&& (reader.find_attribute("y")->value == "2") && (reader.find_attribute("z")->value == ">3") && !reader.find_attribute("w"));
+	}
+
+	// CDATA sections, comments, processing instructions and DOCTYPE are skipped, even when they contain what looks like tags.
+	{
+		std::string_view text = "<?xml version=\"1.0\"?><!DOCTYPE a><!-- <b> -->"
+			"<a><![CDATA[<b x=\"1\"></c> ]] ]>]]>text<?pi <d/>?><!-- -- <e/> --><f/></a><!-- end -->";
+		xml_reader reader (text, scanner);
+		CHECK((reader.read() == node_type::start_element) && (reader.name() == "a") && (reader.depth() == 0));
+		CHECK((reader.read() == node_type::start_element) && (reader.name() == "f") && (reader.depth() == 1));
+		CHECK(std::string_view(reader.node_begin(), reader.node_end() - reader.node_begin()) == "<f/>");
+		CHECK((reader.read() == node_type::end_element) && (reader.name() == "f"));
+		CHECK((reader.read() == node_type::end_element) && (reader.name() == "a"));
+		CHECK(reader.read() == node_type::end_of_document);
+	}
+
+	// skip_element stops on the matching end element, whatever is nested inside.
+	{
+		xml_reader reader ("<a><b><b/><c><b></b></c></b><d/></a>", scanner);
+		reader.read();
+		reader.read();
+		reader.skip_element();
+		CHECK((reader.current_node_type() == node_type::end_element) && (reader.name() == "b") && (reader.depth() == 1));
+		CHECK((reader.read() == node_type::start_element) && (reader.name() == "d"));
+	}
+
+	// Mismatched tags and documents that end too early.
+	for (auto bad : { "<a></b>", "<a><b></a></b>", "</a>", "<a></a></a>", "<a><b/>", "<a", "<a x=\"1", "<a x=\"1\"", "<a x>", "<a x=1/>",
+		"<a/ >", "<>", "<a><!-- x", "<a><![CDATA[ x ]]", "<a><?pi", "<a></a", "<a></a x>" })
+		check_malformed (bad, scanner);
+
+	// Tags long enough to take the block-wise fast path, and the same tags near the end of the document, where it can't.
+	for (size_t padding : { 0, 1, 31, 32, 33, 100 })
+	{
+		std::string text = "<Root><Child Name=\"" + std::string(padding, 'n') + "\" X=\"5\" Y='6'/><Child Name=\"a&amp;b\" X=\"-1\"></Child></Root>";
+		xml_reader reader (text, scanner);
+		reader.read();
+		CHECK((reader.read() == node_type::start_element) && (reader.attributes().size() == 3));
+		CHECK((reader.attributes()[0].value.size() == padding) && (reader.attributes()[2].value == "6"));
+		CHECK(reader.read() == node_type::end_element);
+		CHECK((reader.read() == node_type::start_element) && (reader.find_attribute("Name")->value == "a&b"));
+		CHECK((reader.read() == node_type::end_element) && (reader.read() == node_type::end_element));
+		CHECK(reader.read() == node_type::end_of_document);
+	}
+}
+
+int main()
+{
+	for (auto level : { simd_level::scalar, simd_level::sse2, simd_level::avx2 })
+	{
+		if (auto scanner = get_xml_scanner(level))
+			test_scanner (scanner);
+	}
+
+	return 0;
+}
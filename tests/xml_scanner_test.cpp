@@ -0,0 +1,90 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "xml_scanner.h"
+#include <cstring>
+#include <random>
+
+using namespace test;
+
+// Compares the searches of "simd" with the scalar ones, from every start offset of "text" to every end
+// within a few blocks of it, so that matches fall on both sides of the 16- and 32-byte block boundaries and in the tails.
+static void compare (const xml_scanner* simd, const xml_scanner* scalar, const std::string& text)
+{
+	for (size_t begin = 0; begin < text.size(); begin++)
+	{
+		for (size_t end = begin; (end <= text.size()) && (end <= begin + 100); end++)
+		{
+			const char* b = text.data() + begin;
+			const char* e = text.data() + end;
+			CHECK(simd->find_name_end(b, e) == scalar->find_name_end(b, e));
+
+			for (char quote : { '"', '\'' })
+			{
+				bool simd_unescaping = true;
+				bool scalar_unescaping = true;
+				auto simd_result = simd->find_value_end(b, e, quote, simd_unescaping);
+				auto scalar_result = scalar->find_value_end(b, e, quote, scalar_unescaping);
+				CHECK(simd_result == scalar_result);
+				if (scalar_result)
+					CHECK(simd_unescaping == scalar_unescaping);
+			}
+		}
+
+		if (text.size() - begin >= 32)
+			CHECK(simd->structural_mask(text.data() + begin) == scalar->structural_mask(text.data() + begin));
+	}
+}
+
+int main()
+{
+	auto scalar = get_xml_scanner(simd_level::scalar);
+	CHECK((scalar != nullptr) && (get_xml_scanner() != nullptr));
+
+	// Every byte value, where a signed comparison would go wrong for those above 0x7F.
+	std::string all;
+	for (int c = 0; c < 256; c++)
+		all.push_back((char)c);
+
+	// Random text mostly of characters that end nothing, so that matches are far apart and often in a later block,
+	// and text where they're dense.
+	std::mt19937 rng (1);
+	static constexpr char special[] = " \t\n\r\"'=/<>&\x01\x1F\x20\x80\xFF";
+	auto random_text = [&rng](size_t size, unsigned int special_per_256)
+	{
+		std::string text (size, 'a');
+		for (auto& c : text)
+		{
+			if (rng() % 256 < special_per_256)
+				c = special[rng() % (sizeof(special) - 1)];
+			else
+				c = 'a' + rng() % 26;
+		}
+		return text;
+	};
+
+	std::vector<std::string> texts = { all, random_text(300, 4), random_text(300, 64), random_text(300, 200) };
+
+	// A single special character at each position around the block boundaries, in otherwise plain text.
+	for (size_t pos : { 0, 1, 14, 15, 16, 17, 30, 31, 32, 33, 47, 48, 63, 64, 65 })
+	{
+		for (char c : { '"', '\'', '&', '\t', '>', '=', '/', '<', ' ' })
+		{
+			std::string text (80, 'x');
+			text[pos] = c;
+			texts.push_back(text);
+		}
+	}
+
+	for (auto level : { simd_level::sse2, simd_level::avx2 })
+	{
+		if (auto simd = get_xml_scanner(level))
+		{
+			for (auto& text : texts)
+				compare (simd, scalar, text);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "test_support.h"
+#include "xml_writer.h"
+#include "xml_reader.h"
+
+using namespace test;
+
+// Remembers the size of each write, to check that the writer passes its output on in buffer-sized pieces.
+struct recording_out_stream : out_stream_i
+{
+	std::string text;
+	size_t write_count = 0;
+	size_t largest_write = 0;
+
+	using out_stream_i::write;
+
+	virtual void write (const void* data, size_t size) override
+	{
+		text.append (static_cast<const char*>(data), size);
+		write_count++;
+		largest_write = std::max (largest_write, size);
+	}
+};
+
+static std::unique_ptr<root> round_trip (const root* r, bool indent)
+{
+	recording_out_stream s;
+	{
+		xml_writer writer (&s, indent);
+		writer.write_declaration();
+		serialize (writer, r, true);
+	}
+
+	xml_reader reader (s.text);
+	CHECK(reader.read() == xml_reader::node_type::start_element);
+	auto loaded = deserialize (reader, known_types);
+	CHECK(reader.read() == xml_reader::node_type::end_of_document);
+	return std::unique_ptr<root>(static_cast<root*>(loaded.release()));
+}
+
+int main()
+{
+	// Layout and escaping.
+	{
+		recording_out_stream s;
+		{
+			xml_writer writer (&s);
+			writer.write_declaration();
+			writer.start_element("A");
+			writer.attribute("x", "<&>\"'\t\n\r");
+			writer.attribute("n", (size_t)42);
+			writer.start_element("B");
+			writer.end_element();
+			writer.start_element("C");
+			writer.start_element("D");
+			writer.end_element();
+			writer.end_element();
+			writer.end_element();
+		}
+
+		CHECK(s.text == "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+			"<A x=\"&lt;&amp;&gt;&quot;'&#9;&#10;&#13;\" n=\"42\">\n\t<B/>\n\t<C>\n\t\t<D/>\n\t</C>\n</A>");
+
+		recording_out_stream flat;
+		{
+			xml_writer writer (&flat, false);
+			writer.start_element("A");
+			writer.start_element("B");
+			writer.end_element();
+			writer.end_element();
+		}
+		CHECK(flat.text == "<A><B/></A>");
+	}
+
+	// Names that need escaping, multi-byte UTF-8, and every non-zero byte value survive a round trip.
+	{
+		auto r = make_tree(300);
+		r->child_at(0)->_name = "<&>\"' \t\n\r";
+		r->child_at(1)->_name = "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80";
+		std::string all;
+		for (int c = 1; c < 256; c++)
+			all.push_back((char)c);
+		r->child_at(2)->_name = all;
+		r->child_at(3)->_name = "&amp;&#65;";
+
+		for (bool indent : { true, false })
+		{
+			auto loaded = round_trip (r.get(), indent);
+			CHECK(same_tree(r.get(), loaded.get()));
+		}
+	}
+
+	// A document many times the buffer size, and a value bigger than the buffer, which is passed on without copying.
+	{
+		auto r = make_tree(50'000);
+		r->child_at(100)->_name = std::string(200'000, 'v');
+
+		recording_out_stream s;
+		{
+			xml_writer writer (&s);
+			serialize (writer, r.get(), true);
+		}
+		CHECK((s.write_count > 10) && (s.largest_write == 200'000));
+
+		auto loaded = round_trip (r.get(), true);
+		CHECK(same_tree(r.get(), loaded.get()));
+	}
+
+	// Nothing is written for an object that didn't change from default, unless forced.
+	{
+		root r;
+		recording_out_stream s;
+		{
+			xml_writer writer (&s);
+			serialize (writer, &r, false);
+		}
+		CHECK(s.text.empty());
+
+		auto loaded = round_trip (&r, true);
+		CHECK(same_tree(&r, loaded.get()));
+	}
+
+	return 0;
+}
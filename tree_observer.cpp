@@ -0,0 +1,144 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "tree_observer.h"
+#include "binary_serializer.h"
+
+namespace edge
+{
+	tree_observer::tree_observer (object* root)
+		: _root(root)
+	{ }
+
+	tree_observer::~tree_observer()
+	{
+		if (_started)
+			detach(_root, false);
+	}
+
+	void tree_observer::start()
+	{
+		assert (!_started);
+		_started = true;
+		attach(_root, nullptr);
+	}
+
+	object* tree_observer::parent_of (const object* obj) const
+	{
+		auto it = _parents.find(obj);
+		assert (it != _parents.end());
+		return it->second;
+	}
+
+	void tree_observer::attach (object* obj, object* parent)
+	{
+		assert (!observes(obj));
+		_parents.insert({ obj, parent });
+		obj->property_changing().add_handler<&tree_observer::process_property_changing>(this);
+		obj->property_changed().add_handler<&tree_observer::process_property_changed>(this);
+		this->on_attached(obj);
+
+		// Before the children are read, so that a lazy collection doesn't evict children we subscribed to.
+		set_lazy_collections_observed (obj, true);
+		for_each_child (obj, [this, obj](object* child) { attach(child, obj); });
+	}
+
+	void tree_observer::detach (object* obj, bool call_hooks)
+	{
+		for_each_child (obj, [this, call_hooks](object* child) { detach(child, call_hooks); });
+		set_lazy_collections_observed (obj, false);
+
+		if (call_hooks)
+			this->on_detaching(obj);
+		obj->property_changed().remove_handler<&tree_observer::process_property_changed>(this);
+		obj->property_changing().remove_handler<&tree_observer::process_property_changing>(this);
+		_parents.erase(obj);
+	}
+
+	void tree_observer::set_lazy_collections_observed (object* obj, bool observed)
+	{
+		for (auto prop : obj->type()->child_property_list())
+		{
+			if (auto oc_prop = dynamic_cast<const object_collection_property*>(prop))
+			{
+				auto lc = dynamic_cast<lazy_collection_i*>(oc_prop->collection_cast(obj));
+				if (lc && observed)
+					lc->add_observer();
+				else if (lc)
+					lc->remove_observer();
+			}
+		}
+	}
+
+	void tree_observer::process_property_changing (object* obj, const property_change_args& args)
+	{
+		if (auto oc_prop = dynamic_cast<const object_collection_property*>(args.property))
+		{
+			if (args.type == collection_property_change_type::remove)
+			{
+				auto collection = oc_prop->collection_cast(obj);
+				for (size_t i = args.index; i < args.index + args.count; i++)
+					detach (collection->child_at(i), true);
+			}
+		}
+		else if (auto obj_prop = dynamic_cast<const object_property*>(args.property))
+		{
+			if (auto old_value = obj_prop->get(obj))
+				detach (old_value, true);
+		}
+
+		this->on_property_changing(obj, args);
+	}
+
+	void tree_observer::process_property_changed (object* obj, const property_change_args& args)
+	{
+		if (auto oc_prop = dynamic_cast<const object_collection_property*>(args.property))
+		{
+			if (args.type == collection_property_change_type::insert)
+			{
+				auto collection = oc_prop->collection_cast(obj);
+				for (size_t i = args.index; i < args.index + args.count; i++)
+					attach (collection->child_at(i), obj);
+			}
+		}
+		else if (auto obj_prop = dynamic_cast<const object_property*>(args.property))
+		{
+			if (auto new_value = obj_prop->get(obj))
+				attach (new_value, obj);
+		}
+
+		this->on_property_changed(obj, args);
+	}
+
+	// ========================================================================
+
+	dirty_tree_tracker::dirty_tree_tracker (object* root)
+		: tree_observer(root)
+	{
+		start();
+	}
+
+	void dirty_tree_tracker::mark_dirty (const object* obj)
+	{
+		// Ancestors of a dirty object are always dirty, so we can stop at the first one already marked.
+		while ((obj != nullptr) && _dirty.insert(obj).second)
+			obj = parent_of(obj);
+	}
+
+	void dirty_tree_tracker::on_attached (object* obj)
+	{
+		mark_dirty(obj);
+	}
+
+	void dirty_tree_tracker::on_detaching (object* obj)
+	{
+		// The object may be destroyed after this, and its address reused for a new object.
+		_dirty.erase(obj);
+	}
+
+	void dirty_tree_tracker::on_property_changed (object* obj, const property_change_args& args)
+	{
+		mark_dirty(obj);
+	}
+}
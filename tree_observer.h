@@ -0,0 +1,91 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "collections.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace edge
+{
+	// Subscribes to property_changing / property_changed of every object in a tree (following object collections
+	// and object properties), follows children as they are inserted and removed, and remembers the parent of each object.
+	//
+	// Derived classes call start() at the end of their constructor, so that the hooks are called for the initial tree too.
+	// The observer must be destroyed before the objects it observes.
+	class tree_observer
+	{
+		object* const _root;
+		std::unordered_map<const object*, object*> _parents;
+		bool _started = false;
+
+	public:
+		tree_observer (object* root);
+		virtual ~tree_observer();
+
+		tree_observer (const tree_observer&) = delete;
+		tree_observer& operator= (const tree_observer&) = delete;
+
+		object* root() const { return _root; }
+		bool observes (const object* obj) const { return _parents.find(obj) != _parents.end(); }
+
+		// Returns nullptr for the root.
+		object* parent_of (const object* obj) const;
+
+	protected:
+		void start();
+
+		virtual void on_attached (object* obj) { }
+		virtual void on_detaching (object* obj) { }
+		virtual void on_property_changing (object* obj, const property_change_args& args) { }
+		virtual void on_property_changed (object* obj, const property_change_args& args) { }
+
+		template<typename callback_t>
+		void for_each_child (object* obj, callback_t callback)
+		{
+			for (auto prop : obj->type()->child_property_list())
+			{
+				if (auto oc_prop = dynamic_cast<const object_collection_property*>(prop))
+				{
+					auto collection = oc_prop->collection_cast(obj);
+					for (size_t i = 0, count = collection->child_count(); i < count; i++)
+						callback(collection->child_at(i));
+				}
+				else if (auto child = static_cast<const object_property*>(prop)->get(obj))
+					callback(child);
+			}
+		}
+
+	private:
+		void attach (object* obj, object* parent);
+		void set_lazy_collections_observed (object* obj, bool observed);
+		void detach (object* obj, bool call_hooks);
+		void process_property_changing (object* obj, const property_change_args& args);
+		void process_property_changed (object* obj, const property_change_args& args);
+	};
+
+	// ========================================================================
+
+	// Tracks which objects changed since the last call to clear_dirty(), propagating up to the root,
+	// so that a saver can tell the subtrees whose previously serialized form is still valid.
+	// An object is dirty if it changed, or was inserted, or any of its descendants changed or were inserted or removed.
+	class dirty_tree_tracker : public tree_observer
+	{
+		std::unordered_set<const object*> _dirty;
+
+	public:
+		dirty_tree_tracker (object* root);
+
+		bool is_dirty (const object* obj) const { return _dirty.find(obj) != _dirty.end(); }
+		const std::unordered_set<const object*>& dirty_objects() const { return _dirty; }
+		void clear_dirty() { _dirty.clear(); }
+
+	protected:
+		void mark_dirty (const object* obj);
+
+		virtual void on_attached (object* obj) override;
+		virtual void on_detaching (object* obj) override;
+		virtual void on_property_changed (object* obj, const property_change_args& args) override;
+	};
+}
@@ -0,0 +1,112 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "tree_traversal.h"
+
+namespace edge
+{
+	void tree_iterator::enter_prop (frame& f)
+	{
+		auto oc_prop = dynamic_cast<const object_collection_property*>(f.child_props[f.prop_index]);
+		f.collection = oc_prop ? oc_prop->collection_cast(f.obj) : nullptr;
+		f.child_index = 0;
+	}
+
+	tree_iterator& tree_iterator::operator++()
+	{
+		assert (_current != nullptr);
+
+		auto child_props = _current->type()->child_property_list();
+		if (!child_props.empty())
+		{
+			_stack.push_back({ _current, child_props, 0, nullptr, 0 });
+			enter_prop(_stack.back());
+		}
+
+		while (!_stack.empty())
+		{
+			auto& f = _stack.back();
+			if (f.prop_index == f.child_props.size())
+			{
+				_stack.pop_back();
+				continue;
+			}
+
+			const object* next = nullptr;
+			if (f.collection != nullptr)
+			{
+				if (f.child_index < f.collection->child_count())
+					next = f.collection->child_at(f.child_index++);
+			}
+			else if (f.child_index == 0)
+			{
+				f.child_index = 1;
+				next = static_cast<const object_property*>(f.child_props[f.prop_index])->get(f.obj);
+			}
+
+			if (next != nullptr)
+			{
+				_current = next;
+				return *this;
+			}
+
+			// Done with this property; on to the next one.
+			if (++f.prop_index < f.child_props.size())
+				enter_prop(f);
+		}
+
+		_current = nullptr;
+		return *this;
+	}
+
+	// ========================================================================
+
+	namespace
+	{
+		struct parallel_walk
+		{
+			work_stealing_pool& pool;
+			const parallel_visitor_t& visitor;
+			size_t grain_size;
+
+			void visit_subtree (const object* obj, size_t worker_index) const
+			{
+				visitor(obj, worker_index);
+
+				for (auto prop : obj->type()->child_property_list())
+				{
+					if (auto oc_prop = dynamic_cast<const object_collection_property*>(prop))
+					{
+						auto collection = oc_prop->collection_cast(obj);
+						visit_range (collection, 0, collection->child_count(), worker_index);
+					}
+					else if (auto child = static_cast<const object_property*>(prop)->get(obj))
+						visit_subtree (child, worker_index);
+				}
+			}
+
+			void visit_range (const object_collection_i* collection, size_t begin, size_t end, size_t worker_index) const
+			{
+				// Give away the second half until what's left is small enough. The halves we give away are
+				// the first to be stolen, and a thief splits them further the same way.
+				while (end - begin > grain_size)
+				{
+					size_t mid = begin + (end - begin) / 2;
+					pool.spawn (worker_index, [this, collection, mid, end](size_t w) { visit_range(collection, mid, end, w); });
+					end = mid;
+				}
+
+				for (size_t i = begin; i < end; i++)
+					visit_subtree (collection->child_at(i), worker_index);
+			}
+		};
+	}
+
+	void parallel_visit (work_stealing_pool& pool, const object* root, const parallel_visitor_t& visitor, size_t grain_size)
+	{
+		assert (grain_size > 0);
+		parallel_walk walk = { pool, visitor, grain_size };
+		pool.run ([&walk, root](size_t worker_index) { walk.visit_subtree(root, worker_index); });
+	}
+}
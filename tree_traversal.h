@@ -0,0 +1,99 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "collections.h"
+#include "work_stealing_pool.h"
+
+namespace edge
+{
+	// Walks a tree in pre-order (an object, then the children of its first child property, then those of the second, and so on),
+	// keeping its position in an explicit stack rather than in recursive calls, so that deep trees don't overflow the thread's stack.
+	//
+	// The tree must not change while it's being walked.
+	class tree_iterator
+	{
+		struct frame
+		{
+			const object* obj;
+			std::span<const property* const> child_props;
+			size_t prop_index;
+			const object_collection_i* collection; // of child_props[prop_index], or nullptr if that's an object property
+			size_t child_index;
+		};
+
+		std::vector<frame> _stack;
+		const object* _current = nullptr;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = const object*;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const object* const*;
+		using reference         = const object*;
+
+		tree_iterator() = default;
+		explicit tree_iterator (const object* root) : _current(root) { }
+
+		const object* operator*() const { return _current; }
+		tree_iterator& operator++();
+		bool operator== (const tree_iterator& other) const { return _current == other._current; }
+		bool operator!= (const tree_iterator& other) const { return _current != other._current; }
+
+		// Number of ancestors of the current object, up to the root the iterator was created with.
+		size_t depth() const { return _stack.size(); }
+
+	private:
+		void enter_prop (frame& f);
+	};
+
+	struct preorder_range
+	{
+		const object* root;
+		tree_iterator begin() const { return tree_iterator(root); }
+		tree_iterator end() const { return tree_iterator(); }
+	};
+
+	// Example: for (const object* obj : preorder(root)) { ... }
+	inline preorder_range preorder (const object* root) { return { root }; }
+
+	// Calls "visitor" once for each object in the tree, on the threads of "pool". Collections with more than grain_size children
+	// are split into ranges that idle threads can steal; smaller ones are walked by the thread that reached them.
+	//
+	// An object is always visited before its children (they're not even looked at until the visitor returns for their parent),
+	// but objects in different subtrees are visited in no particular order. The visitor is given the index of the worker
+	// that calls it, for keeping per-thread state without locking.
+	//
+	// The visitor gets const objects and must treat them as such: nothing here raises events, and nothing may change the tree
+	// until this returns. Collections that do work on const access, like lazy_object_collection_i which loads pages as they're
+	// accessed, are not safe to walk from multiple threads; load them first or walk them with tree_iterator.
+	using parallel_visitor_t = std::function<void(const object* obj, size_t worker_index)>;
+	void parallel_visit (work_stealing_pool& pool, const object* root, const parallel_visitor_t& visitor, size_t grain_size = 1024);
+
+	// Computes reduce(reduce(identity, map(obj1)), map(obj2))... over all objects of the tree, on the threads of "pool".
+	// Each worker reduces into its own partial result, and the partials are reduced together at the end, so "reduce"
+	// must be associative and commutative, and "identity" must be neutral for it (zero for a sum, for example).
+	template<typename result_t, typename map_t, typename reduce_t>
+	result_t parallel_map_reduce (work_stealing_pool& pool, const object* root, result_t identity, map_t map, reduce_t reduce, size_t grain_size = 1024)
+	{
+		// On separate cache lines, or the workers would slow each other down writing to them.
+		struct alignas(64) partial
+		{
+			result_t value;
+		};
+
+		std::vector<partial> partials (pool.concurrency(), partial{ identity });
+
+		parallel_visit (pool, root, [&partials, &map, &reduce](const object* obj, size_t worker_index)
+		{
+			auto& p = partials[worker_index].value;
+			p = reduce(std::move(p), map(obj));
+		}, grain_size);
+
+		result_t result = std::move(identity);
+		for (auto& p : partials)
+			result = reduce(std::move(result), std::move(p.value));
+		return result;
+	}
+}
@@ -0,0 +1,535 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "undo_history.h"
+#include "binary_serializer.h"
+#include <utility>
+
+namespace edge
+{
+	// Each record is: kind, path of the object, property index in the object's type::property_list(),
+	// then for collections the index, then one or two length-prefixed binary values / subtrees.
+	enum class undo_history::record_kind : uint8_t
+	{
+		value_set,   // before value, after value
+		value_collection_set,    // before value, after value
+		value_collection_insert, // value
+		value_collection_remove, // value
+		object_collection_insert, // subtree
+		object_collection_remove, // subtree
+		object_collection_move,   // count, then for each new position the old position relative to the index (see object_collection_i::reorder)
+		object_property_set,      // before subtree, after subtree; empty for null
+	};
+
+	static void write_blob (out_stream_i* to, const uint8_t* data, size_t size)
+	{
+		to->write_varint(size);
+		to->write(data, size);
+	}
+
+	static binary_reader read_blob (binary_reader& from)
+	{
+		size_t size = (size_t)from.read_varint();
+		auto data = from.read_bytes(size);
+		return { data, data + size };
+	}
+
+	struct record_stream : out_stream_i
+	{
+		std::vector<uint8_t>& buffer;
+
+		using out_stream_i::write;
+
+		record_stream (std::vector<uint8_t>& buffer)
+			: buffer(buffer)
+		{ }
+
+		virtual void write (const void* data, size_t size) override
+		{
+			auto p = static_cast<const uint8_t*>(data);
+			buffer.insert (buffer.end(), p, p + size);
+		}
+	};
+
+	undo_history::undo_history (object* root, std::span<const concrete_type* const> known_types, size_t memory_cap)
+		: tree_observer(root), _known_types(known_types.begin(), known_types.end()), _memory_cap(memory_cap)
+	{
+		start();
+	}
+
+	undo_history::~undo_history()
+	{
+		assert (!_transaction_open);
+	}
+
+	void undo_history::begin_transaction (std::string_view name)
+	{
+		assert (!_transaction_open); // nested transactions are not supported
+		assert (!_applying);
+		_transaction_open = true;
+		_pending.name = name;
+	}
+
+	void undo_history::commit_transaction()
+	{
+		assert (_transaction_open);
+		_transaction_open = false;
+
+		if (_pending.record_offsets.empty())
+		{
+			_pending = { };
+			return;
+		}
+
+		for (auto& t : _redo)
+			_memory_usage -= t.memory_usage();
+		_redo.clear();
+
+		_pending.records.shrink_to_fit();
+		_pending.record_offsets.shrink_to_fit();
+		_memory_usage += _pending.memory_usage();
+		_undo.push_back(std::move(_pending));
+		_pending = { };
+
+		enforce_memory_cap();
+		this->event_invoker<changed_e>()(this);
+	}
+
+	void undo_history::rollback_transaction()
+	{
+		assert (_transaction_open);
+		_transaction_open = false;
+		auto pending = std::move(_pending);
+		_pending = { };
+
+		// An exception thrown between a property_changing and its property_changed leaves these behind.
+		_before_values.clear();
+		_before_value_starts.clear();
+		_moved_children.clear();
+		_moved_children_starts.clear();
+
+		try
+		{
+			apply_transaction (pending, true);
+		}
+		catch (...)
+		{
+			// The tree is partly rolled back, so the records of the older transactions no longer match it.
+			clear();
+			throw;
+		}
+	}
+
+	void undo_history::enforce_memory_cap()
+	{
+		while ((_memory_usage > _memory_cap) && (_undo.size() > 1))
+		{
+			_memory_usage -= _undo.front().memory_usage();
+			_undo.pop_front();
+		}
+	}
+
+	void undo_history::set_memory_cap (size_t memory_cap)
+	{
+		_memory_cap = memory_cap;
+		enforce_memory_cap();
+	}
+
+	void undo_history::clear()
+	{
+		assert (!_transaction_open);
+		_undo.clear();
+		_redo.clear();
+		_memory_usage = 0;
+		this->event_invoker<changed_e>()(this);
+	}
+
+	void undo_history::undo()
+	{
+		assert (!_transaction_open && can_undo());
+		auto t = std::move(_undo.back());
+		_undo.pop_back();
+		apply_transaction (t, true);
+		_redo.push_back(std::move(t));
+		this->event_invoker<changed_e>()(this);
+	}
+
+	void undo_history::redo()
+	{
+		assert (!_transaction_open && can_redo());
+		auto t = std::move(_redo.back());
+		_redo.pop_back();
+		apply_transaction (t, false);
+		_undo.push_back(std::move(t));
+		this->event_invoker<changed_e>()(this);
+	}
+
+	// Path of an object from the root: number of steps, then for each step from the root down,
+	// the index of the child property in the parent's property_list() and the index within the collection.
+	//
+	// Indexes come from object_collection_i::index_of_object, so collections that derive from indexed_object_collection_i
+	// find them without scanning their children; for the others the cost of recording grows with the size of the collection.
+	void undo_history::write_path (out_stream_i* to, const object* obj)
+	{
+		_path_steps.clear();
+		for (auto o = obj; o != root(); )
+		{
+			auto parent = parent_of(o);
+			[[maybe_unused]] bool found = false;
+			for (auto prop : parent->type()->child_property_list())
+			{
+				size_t child_index;
+				if (auto oc_prop = dynamic_cast<const object_collection_property*>(prop))
+					child_index = oc_prop->collection_cast(parent)->index_of_object(o);
+				else
+					child_index = (static_cast<const object_property*>(prop)->get(parent) == o) ? 0 : (size_t)-1;
+
+				if (child_index != (size_t)-1)
+				{
+					_path_steps.push_back({ parent->type()->property_index(prop), child_index });
+					found = true;
+					break;
+				}
+			}
+
+			assert (found);
+			o = parent;
+		}
+
+		to->write_varint(_path_steps.size());
+		for (auto it = _path_steps.rbegin(); it != _path_steps.rend(); it++)
+		{
+			to->write_varint(it->prop_index);
+			to->write_varint(it->child_index);
+		}
+	}
+
+	object* undo_history::read_path (binary_reader& from)
+	{
+		object* obj = root();
+		for (size_t steps = (size_t)from.read_varint(); steps; steps--)
+		{
+			auto prop = obj->type()->property_list()[(size_t)from.read_varint()];
+			size_t child_index = (size_t)from.read_varint();
+			if (auto oc_prop = dynamic_cast<const object_collection_property*>(prop))
+				obj = oc_prop->collection_cast(obj)->child_at(child_index);
+			else
+				obj = static_cast<const object_property*>(prop)->get(obj);
+		}
+
+		return obj;
+	}
+
+	void undo_history::write_before_value (const property_change_args& args, object* obj)
+	{
+		_before_value_starts.push_back(_before_values.size());
+		record_stream s (_before_values);
+
+		if (auto vp = dynamic_cast<const value_property*>(args.property))
+			vp->serialize (obj, &s);
+		else if (auto vc_prop = dynamic_cast<const value_collection_property*>(args.property))
+			vc_prop->get_value (obj, args.index, &s);
+		else if (auto value = static_cast<const object_property*>(args.property)->get(obj))
+			serialize (value, &s);
+	}
+
+	void undo_history::on_property_changing (object* obj, const property_change_args& args)
+	{
+		if (_applying)
+			return;
+
+		if (dynamic_cast<const value_property*>(args.property) || dynamic_cast<const object_property*>(args.property))
+			write_before_value (args, obj);
+		else if (dynamic_cast<const value_collection_property*>(args.property))
+		{
+			if (args.type != collection_property_change_type::insert)
+				write_before_value (args, obj);
+		}
+		else if (dynamic_cast<const object_collection_property*>(args.property))
+		{
+			// The removed subtrees are only reachable before the removal; property_changed records them,
+			// from the last one to the first, so they are kept in that order.
+			if (args.type == collection_property_change_type::remove)
+			{
+				auto collection = static_cast<const object_collection_property*>(args.property)->collection_cast(obj);
+				for (size_t i = args.index; i < args.index + args.count; i++)
+				{
+					_before_value_starts.push_back(_before_values.size());
+					record_stream s (_before_values);
+					serialize (collection->child_at(i), &s);
+				}
+			}
+			else if (args.type == collection_property_change_type::move)
+			{
+				// Remember the order before the move; property_changed will compare it with the order after.
+				auto collection = static_cast<const object_collection_property*>(args.property)->collection_cast(obj);
+				_moved_children_starts.push_back(_moved_children.size());
+				for (size_t i = args.index; i < args.index + args.count; i++)
+					_moved_children.push_back(collection->child_at(i));
+			}
+		}
+	}
+
+	void undo_history::on_property_changed (object* obj, const property_change_args& args)
+	{
+		if (_applying)
+			return;
+
+		record_kind kind;
+		if (dynamic_cast<const value_property*>(args.property))
+			kind = record_kind::value_set;
+		else if (dynamic_cast<const value_collection_property*>(args.property))
+			kind = (args.type == collection_property_change_type::set) ? record_kind::value_collection_set
+				: (args.type == collection_property_change_type::insert) ? record_kind::value_collection_insert
+				: record_kind::value_collection_remove;
+		else if (dynamic_cast<const object_collection_property*>(args.property) && (args.type == collection_property_change_type::insert))
+			kind = record_kind::object_collection_insert; // a range is recorded as insertions of single children, from the first one to the last
+		else if (dynamic_cast<const object_collection_property*>(args.property) && (args.type == collection_property_change_type::remove))
+			kind = record_kind::object_collection_remove; // a range is recorded as removals of single children, from the last one to the first
+		else if (dynamic_cast<const object_collection_property*>(args.property) && (args.type == collection_property_change_type::move))
+			kind = record_kind::object_collection_move;
+		else if (dynamic_cast<const object_property*>(args.property))
+			kind = record_kind::object_property_set;
+		else
+			return;
+
+		add_records (obj, args, kind);
+	}
+
+	void undo_history::add_records (object* obj, const property_change_args& args, record_kind kind)
+	{
+		bool implicit_transaction = !_transaction_open;
+		if (implicit_transaction)
+			begin_transaction(args.property->_name);
+
+		if (kind == record_kind::object_collection_remove)
+		{
+			for (size_t i = args.index + args.count; i-- > args.index; )
+				add_record (obj, args.property, i, kind);
+		}
+		else if (kind == record_kind::object_collection_move)
+		{
+			size_t start = _moved_children_starts.back();
+			_moved_children_starts.pop_back();
+			assert (_moved_children.size() - start == args.count);
+			std::unordered_map<const object*, size_t> old_indexes;
+			for (size_t i = 0; i < args.count; i++)
+				old_indexes.insert({ _moved_children[start + i], i });
+			_moved_children.resize(start);
+
+			add_record (obj, args.property, args.index, kind);
+			record_stream s (_pending.records);
+			s.write_varint(args.count);
+			auto collection = static_cast<const object_collection_property*>(args.property)->collection_cast(obj);
+			for (size_t i = args.index; i < args.index + args.count; i++)
+				s.write_varint(old_indexes.at(collection->child_at(i)));
+		}
+		else if (kind == record_kind::object_collection_insert)
+		{
+			for (size_t i = args.index; i < args.index + args.count; i++)
+				add_record (obj, args.property, i, kind);
+		}
+		else
+			add_record (obj, args.property, args.index, kind);
+
+		if (implicit_transaction)
+			commit_transaction();
+	}
+
+	void undo_history::add_record (object* obj, const property* prop, size_t index, record_kind kind)
+	{
+		auto vp = dynamic_cast<const value_property*>(prop);
+		auto vc_prop = dynamic_cast<const value_collection_property*>(prop);
+		auto oc_prop = dynamic_cast<const object_collection_property*>(prop);
+
+		_pending.record_offsets.push_back(_pending.records.size());
+		record_stream s (_pending.records);
+		s.write((uint8_t)kind);
+		write_path (&s, obj);
+		s.write_varint(obj->type()->property_index(prop));
+		if (vc_prop || oc_prop)
+			s.write_varint(index);
+
+		bool has_before_value = (kind == record_kind::value_set) || (kind == record_kind::value_collection_set)
+			|| (kind == record_kind::value_collection_remove) || (kind == record_kind::object_property_set)
+			|| (kind == record_kind::object_collection_remove);
+		if (has_before_value)
+		{
+			size_t start = _before_value_starts.back();
+			_before_value_starts.pop_back();
+			write_blob (&s, _before_values.data() + start, _before_values.size() - start);
+			_before_values.resize(start);
+		}
+
+		bool has_after_value = (kind == record_kind::value_set) || (kind == record_kind::value_collection_set)
+			|| (kind == record_kind::value_collection_insert) || (kind == record_kind::object_collection_insert)
+			|| (kind == record_kind::object_property_set);
+		if (has_after_value)
+		{
+			_after_value.clear();
+			record_stream after (_after_value);
+			if (vp)
+				vp->serialize (obj, &after);
+			else if (vc_prop)
+				vc_prop->get_value (obj, index, &after);
+			else if (oc_prop)
+				serialize (oc_prop->collection_cast(obj)->child_at(index), &after);
+			else if (auto value = static_cast<const object_property*>(prop)->get(obj))
+				serialize (value, &after);
+			write_blob (&s, _after_value.data(), _after_value.size());
+		}
+	}
+
+	void undo_history::apply (const uint8_t* record, const uint8_t* end, bool undo)
+	{
+		binary_reader from = { record, end };
+		auto kind = (record_kind)from.read_uint8();
+		object* obj = read_path(from);
+		auto prop = obj->type()->property_list()[(size_t)from.read_varint()];
+
+		if (kind == record_kind::value_set)
+		{
+			auto before = read_blob(from);
+			auto after = read_blob(from);
+			static_cast<const value_property*>(prop)->deserialize (undo ? before : after, obj);
+			return;
+		}
+
+		if (kind == record_kind::object_property_set)
+		{
+			auto before = read_blob(from);
+			auto after = read_blob(from);
+			auto& subtree = undo ? before : after;
+			static_cast<const object_property*>(prop)->set (obj, subtree.remaining() ? deserialize(subtree, _known_types) : nullptr);
+			return;
+		}
+
+		size_t index = (size_t)from.read_varint();
+		switch (kind)
+		{
+			case record_kind::value_collection_set:
+			{
+				auto before = read_blob(from);
+				auto after = read_blob(from);
+				static_cast<const value_collection_property*>(prop)->set_value (undo ? before : after, obj, index);
+				break;
+			}
+
+			case record_kind::value_collection_insert:
+			case record_kind::value_collection_remove:
+			{
+				auto vc_prop = static_cast<const value_collection_property*>(prop);
+				if ((kind == record_kind::value_collection_insert) == undo)
+					vc_prop->remove_value (obj, index);
+				else
+				{
+					auto value = read_blob(from);
+					vc_prop->insert_value (value, obj, index);
+				}
+				break;
+			}
+
+			case record_kind::object_collection_insert:
+			case record_kind::object_collection_remove:
+			{
+				auto collection = static_cast<const object_collection_property*>(prop)->collection_cast(obj);
+				if ((kind == record_kind::object_collection_insert) == undo)
+					collection->remove_object(index);
+				else
+				{
+					auto subtree = read_blob(from);
+					collection->insert (index, deserialize(subtree, _known_types));
+				}
+				break;
+			}
+
+			case record_kind::object_collection_move:
+			{
+				size_t count = (size_t)from.read_varint();
+				if (count > from.remaining())
+					throw binary_read_exception("Unexpected end of binary data.");
+				std::vector<size_t> order (count);
+				for (size_t i = 0; i < count; i++)
+				{
+					size_t old_index = (size_t)from.read_varint();
+					if (undo)
+						order[old_index] = i;
+					else
+						order[i] = old_index;
+				}
+
+				static_cast<const object_collection_property*>(prop)->collection_cast(obj)->reorder (index, order);
+				break;
+			}
+
+			default:
+				assert(false);
+		}
+	}
+
+	void undo_history::apply_transaction (const transaction_data& t, bool undo)
+	{
+		assert (!_applying);
+		_applying = true;
+		try
+		{
+			auto& offsets = t.record_offsets;
+			auto end_of = [&t, &offsets](size_t i) { return t.records.data() + ((i + 1 < offsets.size()) ? offsets[i + 1] : t.records.size()); };
+			if (undo)
+			{
+				for (size_t i = offsets.size(); i-- > 0; )
+					apply (t.records.data() + offsets[i], end_of(i), true);
+			}
+			else
+			{
+				for (size_t i = 0; i < offsets.size(); i++)
+					apply (t.records.data() + offsets[i], end_of(i), false);
+			}
+		}
+		catch (...)
+		{
+			_applying = false;
+			throw;
+		}
+
+		_applying = false;
+	}
+
+	// ========================================================================
+
+	undo_history::transaction::transaction (undo_history* history, std::string_view name)
+		: _history(history)
+	{
+		_history->begin_transaction(name);
+	}
+
+	undo_history::transaction::~transaction()
+	{
+		if (_history != nullptr)
+		{
+			// We may be running during stack unwinding, where a second exception would terminate the program.
+			try
+			{
+				_history->rollback_transaction();
+			}
+			catch (...)
+			{
+			}
+		}
+	}
+
+	void undo_history::transaction::commit()
+	{
+		assert (_history != nullptr);
+		auto history = std::exchange(_history, nullptr);
+		history->commit_transaction();
+	}
+
+	void undo_history::transaction::rollback()
+	{
+		assert (_history != nullptr);
+		auto history = std::exchange(_history, nullptr);
+		history->rollback_transaction();
+	}
+}
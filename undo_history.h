@@ -0,0 +1,104 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "tree_observer.h"
+#include <deque>
+
+namespace edge
+{
+	// Undo/redo history for a tree of objects. It records changes by observing the tree's notifications:
+	// value property sets (before and after values, binary-encoded), value collection sets/inserts/removes,
+	// object collection inserts/removes (binary image of the child subtree, from which it is recreated on undo/redo),
+	// object collection moves (the permutation), and object property sets (images of the old and new subtrees, if any).
+	//
+	// Objects are recorded by their path from the root rather than by pointer, so records remain valid
+	// when undo/redo destroys and recreates objects. This works because changes are always undone and redone in order.
+	// For the same reason, every change to the tree must be recorded; changes made while no transaction is open
+	// are recorded as a transaction of their own.
+	class undo_history : tree_observer, public event_manager
+	{
+		enum class record_kind : uint8_t;
+
+		struct transaction_data
+		{
+			std::string name;
+			std::vector<uint8_t> records;
+			std::vector<size_t> record_offsets;
+
+			size_t memory_usage() const { return records.capacity() + record_offsets.capacity() * sizeof(size_t) + name.capacity(); }
+		};
+
+		std::vector<concrete_type const*> const _known_types;
+		size_t _memory_cap;
+		std::deque<transaction_data> _undo;
+		std::deque<transaction_data> _redo;
+		size_t _memory_usage = 0;
+		bool _transaction_open = false;
+		transaction_data _pending;
+		bool _applying = false;
+		std::vector<uint8_t> _before_values; // stack of values captured in property_changing, consumed in property_changed
+		std::vector<size_t> _before_value_starts;
+		std::vector<const object*> _moved_children; // stack of children orders captured in property_changing, for moves
+		std::vector<size_t> _moved_children_starts;
+		struct path_step { size_t prop_index; size_t child_index; };
+		std::vector<path_step> _path_steps; // used by write_path, kept to avoid an allocation per record
+		std::vector<uint8_t> _after_value;  // same, for add_record
+
+	public:
+		undo_history (object* root, std::span<const concrete_type* const> known_types, size_t memory_cap = 64 * 1024 * 1024);
+		~undo_history();
+
+		// Groups changes into a single undo step. If it is destroyed before commit() is called
+		// (for example because an exception is thrown while changing several objects), all changes made so far are rolled back.
+		// If the rollback itself throws, the destructor swallows the exception and the history is cleared,
+		// since the tree is left partly rolled back; rollback() lets the exception through, after clearing the history.
+		class transaction
+		{
+			undo_history* _history;
+
+		public:
+			transaction (undo_history* history, std::string_view name);
+			~transaction();
+			transaction (const transaction&) = delete;
+			transaction& operator= (const transaction&) = delete;
+
+			void commit();
+			void rollback();
+		};
+
+		bool can_undo() const { return !_undo.empty(); }
+		bool can_redo() const { return !_redo.empty(); }
+		const std::string& undo_name() const { return _undo.back().name; }
+		const std::string& redo_name() const { return _redo.back().name; }
+		void undo();
+		void redo();
+		void clear();
+
+		// Oldest transactions are discarded when the memory used by the history exceeds the cap.
+		// The most recent transaction is always kept.
+		size_t memory_usage() const { return _memory_usage; }
+		size_t memory_cap() const { return _memory_cap; }
+		void set_memory_cap (size_t memory_cap);
+
+		struct changed_e : event<changed_e, undo_history*> { };
+		changed_e::subscriber changed() { return changed_e::subscriber(this); }
+
+	private:
+		void begin_transaction (std::string_view name);
+		void commit_transaction();
+		void rollback_transaction();
+		void enforce_memory_cap();
+		void write_path (out_stream_i* to, const object* obj);
+		object* read_path (binary_reader& from);
+		void apply (const uint8_t* record, const uint8_t* end, bool undo);
+		void apply_transaction (const transaction_data& t, bool undo);
+		void write_before_value (const property_change_args& args, object* obj);
+		void add_records (object* obj, const property_change_args& args, record_kind kind);
+		void add_record (object* obj, const property* prop, size_t index, record_kind kind);
+
+		virtual void on_property_changing (object* obj, const property_change_args& args) override;
+		virtual void on_property_changed (object* obj, const property_change_args& args) override;
+	};
+}
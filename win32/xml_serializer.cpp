@@ -15,160 +15,172 @@ namespace edge
 	static const _bstr_t index_attr_name = "index";
 	static const _bstr_t value_attr_name = "Value";
 
-	static com_ptr<IXMLDOMElement> serialize_internal (IXMLDOMDocument* doc, const object* obj, bool force_serialize_unchanged, size_t index_attribute);
 	static void deserialize_to_internal (IXMLDOMElement* element, object* obj, bool ignore_index_attribute, std::span<const concrete_type* const> known_types);
 
-	static com_ptr<IXMLDOMElement> serialize_object_collection (IXMLDOMDocument* doc, const object* obj, const object_collection_property* prop)
+	// The elements are created only when something is found to put in them (an attribute, a child element),
+	// so that objects and collections with nothing to write leave no empty elements behind. An element is appended
+	// to that of its parent as soon as it's created, which creates the parent's element too if needed.
+	class dom_object_writer : public object_writer_i
 	{
-		auto collection = prop->collection_cast(obj);
+		struct frame
+		{
+			const char* name;
+			size_t index_attribute; // -1 for none
+			com_ptr<IXMLDOMElement> element;
+		};
 
-		size_t child_count = collection->child_count();
-		if (child_count == 0)
-			return nullptr;
+		IXMLDOMDocument* const _doc;
+		xml_element_cache_i* const _cache;
+		std::vector<frame> _frames;
+		com_ptr<IXMLDOMElement> _root;
+		std::string _value;
 
-		HRESULT hr;
-		com_ptr<IXMLDOMElement> collection_element;
-		auto ensure_collection_element_created = [doc, prop, &collection_element]()
+	public:
+		dom_object_writer (IXMLDOMDocument* doc, xml_element_cache_i* cache)
+			: _doc(doc), _cache(cache)
+		{ }
+
+		com_ptr<IXMLDOMElement> serialize (const object* obj, bool force_serialize_unchanged)
 		{
-			if (collection_element == nullptr)
+			write_object (*this, obj, force_serialize_unchanged);
+			return std::move(_root);
+		}
+
+	private:
+		IXMLDOMElement* ensure_element_created (size_t frame_index)
+		{
+			auto& f = _frames[frame_index];
+			if (f.element == nullptr)
 			{
-				auto hr = doc->createElement(_bstr_t(prop->_name), &collection_element);
-				assert(SUCCEEDED(hr));
+				auto hr = _doc->createElement(_bstr_t(f.name), &f.element); assert(SUCCEEDED(hr));
+				if (f.index_attribute != (size_t)-1)
+				{
+					hr = f.element->setAttribute (index_attr_name, _variant_t(f.index_attribute));
+					assert(SUCCEEDED(hr));
+				}
+
+				if (frame_index > 0)
+					append_to (frame_index - 1, f.element);
 			}
-		};
 
-		bool force_serialize_unchanged;
-		bool add_index_attribute;
-		if (!prop->preallocated)
-		{
-			// variable-size collection - always serialize all children
-			force_serialize_unchanged = true;
-			add_index_attribute = false;
+			return f.element;
 		}
-		else
+
+		void append_to (size_t frame_index, IXMLDOMElement* child)
 		{
-			// fixed-size collection allocated by the object in its constructor - serialize only changed children
-			force_serialize_unchanged = false;
-			add_index_attribute = true;
+			auto hr = ensure_element_created(frame_index)->appendChild (child, nullptr); assert(SUCCEEDED(hr));
 		}
 
-		for (size_t i = 0; i < child_count; i++)
+		virtual bool begin_object (const object* obj, const serialization_plan& plan, std::span<const size_t> values, size_t content_count, size_t index, bool force) override
 		{
-			auto child = collection->child_at(i);
-			auto child_elem = serialize_internal(doc, child, force_serialize_unchanged, add_index_attribute ? i : -1);
-			if (child_elem != nullptr)
+			com_ptr<IXMLDOMElement> cached;
+			if (_cache && _cache->try_get_element(obj, cached))
 			{
-				ensure_collection_element_created();
-				hr = collection_element->appendChild (child_elem, nullptr);  assert(SUCCEEDED(hr));
+				if (_frames.empty())
+					_root = std::move(cached);
+				else if (cached != nullptr)
+					append_to (_frames.size() - 1, cached);
+				return false;
 			}
-		}
 
-		return collection_element;
-	}
+			_frames.push_back({ obj->type()->name(), index, nullptr });
+			if (force || !values.empty())
+				ensure_element_created(_frames.size() - 1);
 
-	static com_ptr<IXMLDOMElement> serialize_value_collection (IXMLDOMDocument* doc, const object* obj, const value_collection_property* prop)
-	{
-		size_t size = prop->size(obj);
-		if (size == 0)
-			return nullptr;
+			for (size_t i : values)
+			{
+				auto value_prop = static_cast<const value_property*>(plan.props[i].prop);
+				value_prop->get_to_string(obj, _value);
+				auto hr = _frames.back().element->setAttribute(_bstr_t(value_prop->_name), _variant_t(_value.c_str())); assert(SUCCEEDED(hr));
+			}
 
-		if (!prop->changed(obj))
-			return nullptr;
+			return true;
+		}
 
-		com_ptr<IXMLDOMElement> collection_element;
-		auto hr = doc->createElement (_bstr_t(prop->_name), &collection_element); assert(SUCCEEDED(hr));
-		std::string value;
-		for (size_t i = 0; i < size; i++)
+		virtual void end_object (const object* obj) override
 		{
-			prop->get_value(obj, i, value);
-			com_ptr<IXMLDOMElement> entry_element;
-			hr = doc->createElement (entry_elem_name, &entry_element); assert(SUCCEEDED(hr));
-			hr = entry_element->setAttribute (index_attr_name, _variant_t(i)); assert(SUCCEEDED(hr));
-			hr = entry_element->setAttribute (value_attr_name, _variant_t(value.c_str())); assert(SUCCEEDED(hr));
-			hr = collection_element->appendChild (entry_element, nullptr); assert(SUCCEEDED(hr));
+			auto element = std::move(_frames.back().element);
+			_frames.pop_back();
+			if (_cache)
+				_cache->store_element(obj, element);
+			if (_frames.empty())
+				_root = std::move(element);
 		}
 
-		return collection_element;
-	}
-
-	static com_ptr<IXMLDOMElement> serialize_internal (IXMLDOMDocument* doc, const object* obj, bool force_serialize_unchanged, size_t index_attribute)
-	{
-		com_ptr<IXMLDOMElement> object_element;
-		auto ensure_object_element_created = [doc, obj, index_attribute, &object_element]()
+		virtual void begin_object_collection (const object* obj, const serialization_plan& plan, size_t prop_index, const object_collection_i* collection) override
 		{
-			if (object_element == nullptr)
-			{
-				const char* name = obj->type()->name();
-				auto hr = doc->createElement(_bstr_t(name), &object_element);
-				assert(SUCCEEDED(hr));
-
-				if (index_attribute != (size_t)-1)
-				{
-					hr = object_element->setAttribute (index_attr_name, _variant_t(index_attribute));
-					assert(SUCCEEDED(hr));
-				}
-			}
-		};
-
-		if (force_serialize_unchanged)
-			ensure_object_element_created();
+			_frames.push_back({ plan.props[prop_index].prop->_name, (size_t)-1, nullptr });
+		}
 
-		auto props = obj->type()->make_property_list();
-		for (const property* prop : props)
+		virtual void end_object_collection() override
 		{
-			if (auto cs = dynamic_cast<const custom_serialize_property_i*>(prop); cs && !cs->need_serialize(obj))
-				continue;
+			_frames.pop_back();
+		}
 
-			if (auto value_prop = dynamic_cast<const value_property*>(prop))
+		virtual void write_value_collection (const object* obj, const serialization_plan& plan, size_t prop_index) override
+		{
+			auto prop = static_cast<const value_collection_property*>(plan.props[prop_index].prop);
+			com_ptr<IXMLDOMElement> collection_element;
+			auto hr = _doc->createElement (_bstr_t(prop->_name), &collection_element); assert(SUCCEEDED(hr));
+			size_t size = prop->size(obj);
+			for (size_t i = 0; i < size; i++)
 			{
-				bool is_factory_prop = std::any_of (obj->type()->factory_props().begin(), obj->type()->factory_props().end(), [value_prop](auto p) { return p == value_prop; });
-				if (is_factory_prop || (value_prop->can_set(obj) && value_prop->changed_from_default(obj)))
-				{
-					ensure_object_element_created();
-					auto value = value_prop->get_to_string(obj);
-					auto hr = object_element->setAttribute(_bstr_t(value_prop->_name), _variant_t(value.c_str())); assert(SUCCEEDED(hr));
-				}
+				prop->get_value(obj, i, _value);
+				com_ptr<IXMLDOMElement> entry_element;
+				hr = _doc->createElement (entry_elem_name, &entry_element); assert(SUCCEEDED(hr));
+				hr = entry_element->setAttribute (index_attr_name, _variant_t(i)); assert(SUCCEEDED(hr));
+				hr = entry_element->setAttribute (value_attr_name, _variant_t(_value.c_str())); assert(SUCCEEDED(hr));
+				hr = collection_element->appendChild (entry_element, nullptr); assert(SUCCEEDED(hr));
 			}
+
+			append_to (_frames.size() - 1, collection_element);
 		}
 
-		for (const property* prop : props)
+		virtual void begin_object_property (const object* obj, const serialization_plan& plan, size_t prop_index) override
 		{
-			if (auto cs = dynamic_cast<const custom_serialize_property_i*>(prop); cs && !cs->need_serialize(obj))
-				continue;
+		}
+	};
 
-			if (dynamic_cast<const value_property*>(prop))
-				continue;
+	com_ptr<IXMLDOMElement> serialize (IXMLDOMDocument* doc, const object* obj, bool force_serialize_unchanged)
+	{
+		return dom_object_writer(doc, nullptr).serialize (obj, force_serialize_unchanged);
+	}
 
-			com_ptr<IXMLDOMElement> prop_element;
-			if (auto oc_prop = dynamic_cast<const object_collection_property*>(prop))
-			{
-				prop_element = serialize_object_collection (doc, obj, oc_prop);
-			}
-			else if (auto vc_prop = dynamic_cast<const value_collection_property*>(prop))
-			{
-				prop_element = serialize_value_collection (doc, obj, vc_prop);
-			}
-			else if (auto obj_prop = dynamic_cast<const object_property*>(prop))
-			{
-				if (auto value = obj_prop->get(obj))
-					prop_element = serialize_internal (doc, value, false, -1);
-			}
-			else
-				assert(false); // not implemented
+	// ========================================================================
 
-			if (prop_element)
-			{
-				ensure_object_element_created();
-				auto hr = object_element->appendChild (prop_element, nullptr); assert(SUCCEEDED(hr));
-			}
-		}
+	incremental_xml_serializer::incremental_xml_serializer (IXMLDOMDocument* doc, object* root, bool force_serialize_unchanged)
+		: dirty_tree_tracker(root), _doc(doc), _force_serialize_unchanged(force_serialize_unchanged)
+	{ }
 
-		return object_element;
+	com_ptr<IXMLDOMElement> incremental_xml_serializer::serialize()
+	{
+		auto element = dom_object_writer(_doc, this).serialize (root(), _force_serialize_unchanged);
+		clear_dirty();
+		return element;
 	}
 
-	com_ptr<IXMLDOMElement> serialize (IXMLDOMDocument* doc, const object* obj, bool force_serialize_unchanged)
+	void incremental_xml_serializer::on_detaching (object* obj)
+	{
+		dirty_tree_tracker::on_detaching(obj);
+		_elements.erase(obj);
+	}
+
+	bool incremental_xml_serializer::try_get_element (const object* obj, com_ptr<IXMLDOMElement>& element)
+	{
+		if (is_dirty(obj))
+			return false;
+
+		auto it = _elements.find(obj);
+		if (it == _elements.end())
+			return false;
+
+		element = it->second;
+		return true;
+	}
+
+	void incremental_xml_serializer::store_element (const object* obj, IXMLDOMElement* element)
 	{
-		return serialize_internal (doc, obj, force_serialize_unchanged, -1);
+		_elements[obj] = element;
 	}
 
 	// ========================================================================
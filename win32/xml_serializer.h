@@ -4,23 +4,40 @@
 
 #pragma once
 #include "com_ptr.h"
-#include "../object.h"
+#include "../serializer.h"
+#include "../tree_observer.h"
 
 namespace edge
 {
 	com_ptr<IXMLDOMElement> serialize (IXMLDOMDocument* doc, const object* o, bool force_serialize_unchanged);
 	void deserialize_to (IXMLDOMElement* element, object* o, std::span<const concrete_type* const> known_types);
 
-	struct custom_serialize_property_i
+	HRESULT format_and_save_to_file (IXMLDOMDocument3* doc, const wchar_t* file_path);
+
+	struct xml_element_cache_i
 	{
-		virtual bool need_serialize (const object* obj) const = 0;
+		virtual bool try_get_element (const object* obj, com_ptr<IXMLDOMElement>& element) = 0;
+		virtual void store_element (const object* obj, IXMLDOMElement* element) = 0;
 	};
 
-	struct deserialize_i
+	// DOM counterpart of incremental_binary_serializer: keeps the elements created by the previous call to serialize(),
+	// and for objects that didn't change since (see dirty_tree_tracker) it moves those elements into the new element tree
+	// instead of creating them again. All elements belong to "doc". The caller is expected to replace the previous
+	// root element with the new one (say, with IXMLDOMDocument::putref_documentElement) before saving.
+	class incremental_xml_serializer : dirty_tree_tracker, xml_element_cache_i
 	{
-		virtual void on_deserializing() = 0;
-		virtual void on_deserialized() = 0;
-	};
+		com_ptr<IXMLDOMDocument> const _doc;
+		bool const _force_serialize_unchanged;
+		std::unordered_map<const object*, com_ptr<IXMLDOMElement>> _elements; // null element if the object serialized to nothing
 
-	HRESULT format_and_save_to_file (IXMLDOMDocument3* doc, const wchar_t* file_path);
+	public:
+		incremental_xml_serializer (IXMLDOMDocument* doc, object* root, bool force_serialize_unchanged);
+
+		com_ptr<IXMLDOMElement> serialize();
+
+	private:
+		virtual void on_detaching (object* obj) override;
+		virtual bool try_get_element (const object* obj, com_ptr<IXMLDOMElement>& element) override;
+		virtual void store_element (const object* obj, IXMLDOMElement* element) override;
+	};
 }
@@ -0,0 +1,126 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "work_stealing_pool.h"
+#include <cassert>
+
+namespace edge
+{
+	work_stealing_pool::work_stealing_pool (size_t thread_count)
+	{
+		for (size_t i = 0; i <= thread_count; i++)
+			_queues.push_back(std::make_unique<queue>());
+
+		for (size_t i = 1; i <= thread_count; i++)
+			_threads.emplace_back (&work_stealing_pool::thread_proc, this, i);
+	}
+
+	work_stealing_pool::~work_stealing_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+
+		_job_started.notify_all();
+		for (auto& t : _threads)
+			t.join();
+	}
+
+	void work_stealing_pool::run (task_t&& task)
+	{
+		assert (_pending == 0);
+		_exception = nullptr;
+		spawn (0, std::move(task));
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_job++;
+		}
+
+		_job_started.notify_all();
+		work_until_done(0);
+
+		if (_exception)
+			std::rethrow_exception(_exception);
+	}
+
+	void work_stealing_pool::spawn (size_t worker_index, task_t&& task)
+	{
+		_pending.fetch_add (1, std::memory_order_relaxed);
+		auto& q = *_queues[worker_index];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		q.tasks.push_back(std::move(task));
+	}
+
+	bool work_stealing_pool::try_run_one (size_t worker_index)
+	{
+		task_t task;
+
+		{
+			auto& own = *_queues[worker_index];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty())
+			{
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+			}
+		}
+
+		for (size_t i = 1; !task && (i < _queues.size()); i++)
+		{
+			auto& victim = *_queues[(worker_index + i) % _queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty())
+			{
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+			}
+		}
+
+		if (!task)
+			return false;
+
+		try
+		{
+			task(worker_index);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (!_exception)
+				_exception = std::current_exception();
+		}
+
+		// Decremented only after the task has spawned its subtasks, so the count can't reach zero while work remains.
+		_pending.fetch_sub (1, std::memory_order_acq_rel);
+		return true;
+	}
+
+	void work_stealing_pool::work_until_done (size_t worker_index)
+	{
+		while (_pending.load(std::memory_order_acquire) != 0)
+		{
+			if (!try_run_one(worker_index))
+				std::this_thread::yield();
+		}
+	}
+
+	void work_stealing_pool::thread_proc (size_t worker_index)
+	{
+		uint64_t last_job = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_job_started.wait (lock, [this, last_job] { return _stop || (_job != last_job); });
+				if (_stop)
+					return;
+				last_job = _job;
+			}
+
+			work_until_done(worker_index);
+		}
+	}
+}
@@ -0,0 +1,68 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+namespace edge
+{
+	// Thread pool for fork-join work: run() executes a task that spawns more tasks, which spawn more, and so on,
+	// and returns when all of them are done. Each worker keeps its own queue; it takes the newest task from it,
+	// and when it's empty, steals the oldest task of another worker (the oldest tasks are usually the biggest ones).
+	//
+	// The thread that calls run() works too, as worker 0, so a pool with no threads runs everything serially.
+	class work_stealing_pool
+	{
+	public:
+		using task_t = std::function<void(size_t worker_index)>;
+
+	private:
+		struct queue
+		{
+			std::mutex mutex;
+			std::deque<task_t> tasks;
+		};
+
+		std::vector<std::unique_ptr<queue>> _queues; // one per worker
+		std::vector<std::thread> _threads;
+		std::atomic<size_t> _pending = 0; // tasks spawned and not yet finished
+		std::mutex _mutex;
+		std::condition_variable _job_started;
+		uint64_t _job = 0;
+		bool _stop = false;
+		std::exception_ptr _exception;
+
+	public:
+		// By default, one thread less than the number of cores, since the caller of run() works too.
+		explicit work_stealing_pool (size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+		~work_stealing_pool();
+
+		work_stealing_pool (const work_stealing_pool&) = delete;
+		work_stealing_pool& operator= (const work_stealing_pool&) = delete;
+
+		// Number of workers, counting the thread that calls run(). Worker indexes passed to tasks are below this.
+		size_t concurrency() const { return _queues.size(); }
+
+		// Runs "task" and every task spawned while it runs, and returns when they're all done. If tasks throw,
+		// the other tasks still run, and the first exception is rethrown from here. Only one thread may call run() at a time,
+		// and tasks must not call it; they give work to the pool with spawn().
+		void run (task_t&& task);
+
+		// Called by a task running on worker "worker_index". The new task runs on the same worker, unless another worker steals it first.
+		void spawn (size_t worker_index, task_t&& task);
+
+	private:
+		bool try_run_one (size_t worker_index);
+		void work_until_done (size_t worker_index);
+		void thread_proc (size_t worker_index);
+	};
+}
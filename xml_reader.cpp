@@ -0,0 +1,670 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "xml_reader.h"
+#include "collections.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace edge
+{
+	static bool is_whitespace (char c)
+	{
+		return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+	}
+
+	xml_reader::xml_reader (std::string_view data, const xml_scanner* scanner)
+		: _ptr(data.data()), _end(data.data() + data.size()), _scanner(scanner)
+	{ }
+
+	xml_reader::node_type xml_reader::read()
+	{
+		_attributes.clear();
+
+		if (_empty_element)
+		{
+			_empty_element = false;
+			_open_elements.pop_back();
+			_node_type = node_type::end_element;
+			return _node_type;
+		}
+
+		while (true)
+		{
+			// Anything before the next tag is text, which we skip.
+			auto lt = static_cast<const char*>(memchr (_ptr, '<', _end - _ptr));
+			if (lt == nullptr)
+			{
+				if (!_open_elements.empty())
+					throw xml_read_exception("Unexpected end of XML document.");
+				_ptr = _end;
+				_node_type = node_type::end_of_document;
+				return _node_type;
+			}
+
+			_node_begin = lt;
+			_ptr = lt + 1;
+			if (_ptr == _end)
+				throw xml_read_exception("Unexpected end of XML document.");
+
+			if (*_ptr == '?')
+				skip_past("?>");
+			else if (*_ptr == '!')
+			{
+				std::string_view rest (_ptr, _end - _ptr);
+				if (rest.substr(0, 3) == "!--")
+					skip_past("-->");
+				else if (rest.substr(0, 8) == "![CDATA[")
+					skip_past("]]>");
+				else
+					skip_past(">"); // DOCTYPE; internal subsets are not supported
+			}
+			else if (*_ptr == '/')
+			{
+				_ptr++;
+				read_end_tag();
+				return _node_type;
+			}
+			else
+			{
+				read_start_tag();
+				return _node_type;
+			}
+		}
+	}
+
+	void xml_reader::skip_past (std::string_view terminator)
+	{
+		std::string_view rest (_ptr, _end - _ptr);
+		auto pos = rest.find(terminator);
+		if (pos == std::string_view::npos)
+			throw xml_read_exception("Unexpected end of XML document.");
+		_ptr += pos + terminator.size();
+	}
+
+	void xml_reader::skip_whitespace()
+	{
+		while ((_ptr != _end) && is_whitespace(*_ptr))
+			_ptr++;
+	}
+
+	std::string_view xml_reader::read_name()
+	{
+		auto start = _ptr;
+		_ptr = _scanner->find_name_end(_ptr, _end);
+		return { start, (size_t)(_ptr - start) };
+	}
+
+	// Fast path for start tags as xml_writer writes them: <Name A="value" B="value"/>, with one space before each attribute,
+	// no whitespace around '=', double quotes, and no references in values. Instead of scanning for the end of each token,
+	// it takes the structural characters of 32 bytes at a time from the scanner, and hops from one to the next.
+	// For anything else it returns false without having consumed anything, and the tag is read the slow way.
+	bool xml_reader::try_read_simple_start_tag()
+	{
+		const char* block = _ptr;
+		if (_end - block < 32)
+			return false;
+		uint32_t mask = _scanner->structural_mask(block);
+
+		// Returns nullptr when too close to the end of the document to read a whole block.
+		auto next = [this, &block, &mask]() -> const char*
+		{
+			while (mask == 0)
+			{
+				block += 32;
+				if (_end - block < 32)
+					return nullptr;
+				mask = _scanner->structural_mask(block);
+			}
+
+			auto p = block + first_set_bit(mask);
+			mask &= mask - 1;
+			return p;
+		};
+
+		auto p = next();
+		if ((p == nullptr) || (p == _ptr))
+			return false;
+		std::string_view name (_ptr, p - _ptr);
+
+		_raw_attributes.clear();
+		while (*p == ' ')
+		{
+			auto attr_name = p + 1;
+			auto eq = next();
+			if ((eq == nullptr) || (eq == attr_name) || (*eq != '='))
+				return false;
+
+			auto open_quote = next();
+			if ((open_quote != eq + 1) || (*open_quote != '"'))
+				return false;
+
+			// These can appear in a value without needing any unescaping; anything else ends the fast path.
+			const char* close_quote;
+			do
+			{
+				close_quote = next();
+				if (close_quote == nullptr)
+					return false;
+			} while ((*close_quote == ' ') || (*close_quote == '=') || (*close_quote == '/') || (*close_quote == '>') || (*close_quote == '\''));
+
+			if (*close_quote != '"')
+				return false;
+
+			_raw_attributes.push_back({ { attr_name, (size_t)(eq - attr_name) }, { open_quote + 1, (size_t)(close_quote - open_quote - 1) }, false });
+
+			p = next();
+			if (p != close_quote + 1)
+				return false;
+		}
+
+		if (*p == '>')
+		{
+			_ptr = p + 1;
+			_empty_element = false;
+		}
+		else if ((*p == '/') && (_end - p >= 2) && (p[1] == '>'))
+		{
+			_ptr = p + 2;
+			_empty_element = true;
+		}
+		else
+			return false;
+
+		_name = name;
+		return true;
+	}
+
+	void xml_reader::read_start_tag()
+	{
+		if (!try_read_simple_start_tag())
+			read_start_tag_general();
+
+		_open_elements.push_back(_name);
+		_node_type = node_type::start_element;
+		unescape_attributes();
+	}
+
+	void xml_reader::read_start_tag_general()
+	{
+		_name = read_name();
+		if (_name.empty())
+			throw xml_read_exception("Invalid XML element name.");
+
+		_raw_attributes.clear();
+		while (true)
+		{
+			skip_whitespace();
+			if (_ptr == _end)
+				throw xml_read_exception("Unexpected end of XML document.");
+
+			if (*_ptr == '>')
+			{
+				_ptr++;
+				_empty_element = false;
+				break;
+			}
+
+			if (*_ptr == '/')
+			{
+				if ((_end - _ptr < 2) || (_ptr[1] != '>'))
+					throw xml_read_exception("Invalid XML start tag.");
+				_ptr += 2;
+				_empty_element = true;
+				break;
+			}
+
+			auto name = read_name();
+			if (name.empty())
+				throw xml_read_exception("Invalid XML attribute.");
+
+			char quote;
+			if ((_end - _ptr >= 2) && (_ptr[0] == '=') && (_ptr[1] == '"'))
+			{
+				// Fast path for what xml_writer and MSXML write: no whitespace around '=', double quotes.
+				_ptr += 2;
+				quote = '"';
+			}
+			else
+			{
+				skip_whitespace();
+				if ((_ptr == _end) || (*_ptr != '='))
+					throw xml_read_exception("Invalid XML attribute.");
+				_ptr++;
+				skip_whitespace();
+				if ((_ptr == _end) || ((*_ptr != '"') && (*_ptr != '\'')))
+					throw xml_read_exception("Invalid XML attribute.");
+				quote = *_ptr++;
+			}
+
+			bool has_references;
+			auto closing = _scanner->find_value_end(_ptr, _end, quote, has_references);
+			if (closing == nullptr)
+				throw xml_read_exception("Unexpected end of XML document.");
+
+			_raw_attributes.push_back({ name, std::string_view(_ptr, closing - _ptr), has_references });
+			_ptr = closing + 1;
+		}
+	}
+
+	void xml_reader::read_end_tag()
+	{
+		if (_open_elements.empty())
+			throw xml_read_exception("Mismatched XML end tag.");
+
+		// Fast path for a well-formed document, where the end tag has the name of the innermost open element.
+		auto expected = _open_elements.back();
+		if (((size_t)(_end - _ptr) > expected.size()) && (_ptr[expected.size()] == '>') && (memcmp(_ptr, expected.data(), expected.size()) == 0))
+		{
+			_ptr += expected.size() + 1;
+			_open_elements.pop_back();
+			_name = expected;
+			_node_type = node_type::end_element;
+			return;
+		}
+
+		_name = read_name();
+		skip_whitespace();
+		if ((_ptr == _end) || (*_ptr != '>'))
+			throw xml_read_exception("Invalid XML end tag.");
+		_ptr++;
+
+		if (_open_elements.back() != _name)
+			throw xml_read_exception("Mismatched XML end tag.");
+		_open_elements.pop_back();
+		_node_type = node_type::end_element;
+	}
+
+	static char* append_utf8 (char* to, uint32_t cp)
+	{
+		if (cp < 0x80)
+			*to++ = (char)cp;
+		else if (cp < 0x800)
+		{
+			*to++ = (char)(0xC0 | (cp >> 6));
+			*to++ = (char)(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000)
+		{
+			*to++ = (char)(0xE0 | (cp >> 12));
+			*to++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+			*to++ = (char)(0x80 | (cp & 0x3F));
+		}
+		else
+		{
+			*to++ = (char)(0xF0 | (cp >> 18));
+			*to++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+			*to++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+			*to++ = (char)(0x80 | (cp & 0x3F));
+		}
+
+		return to;
+	}
+
+	void xml_reader::unescape_attributes()
+	{
+		// A reference is never shorter than what it stands for, so the unescaped values fit in as many bytes as the escaped ones.
+		// We size the buffer for all of them up front, so that it doesn't move while we hand out views into it.
+		size_t needed = 0;
+		for (auto& a : _raw_attributes)
+		{
+			if (a.has_references)
+				needed += a.value.size();
+		}
+
+		if (_unescaped.size() < needed)
+			_unescaped.resize(needed);
+
+		char* out = _unescaped.data();
+		for (auto& a : _raw_attributes)
+		{
+			if (!a.has_references)
+			{
+				_attributes.push_back({ a.name, a.value });
+				continue;
+			}
+
+			char* start = out;
+			for (size_t i = 0; i < a.value.size(); i++)
+			{
+				char c = a.value[i];
+				if (c == '\r')
+				{
+					// Line ends are normalized to \n before attribute values are, and attribute values turn whitespace into spaces.
+					if ((i + 1 < a.value.size()) && (a.value[i + 1] == '\n'))
+						i++;
+					*out++ = ' ';
+				}
+				else if ((c == '\t') || (c == '\n'))
+					*out++ = ' ';
+				else if (c != '&')
+					*out++ = c;
+				else
+				{
+					auto semicolon = a.value.find(';', i);
+					if (semicolon == std::string_view::npos)
+						throw xml_read_exception("Invalid XML reference.");
+					auto ref = a.value.substr(i + 1, semicolon - i - 1);
+					i = semicolon;
+
+					if (ref == "amp")
+						*out++ = '&';
+					else if (ref == "lt")
+						*out++ = '<';
+					else if (ref == "gt")
+						*out++ = '>';
+					else if (ref == "quot")
+						*out++ = '"';
+					else if (ref == "apos")
+						*out++ = '\'';
+					else if ((ref.size() >= 2) && (ref[0] == '#'))
+					{
+						bool hex = (ref[1] == 'x');
+						auto digits = ref.substr(hex ? 2 : 1);
+						if (digits.empty())
+							throw xml_read_exception("Invalid XML character reference.");
+						uint32_t cp = 0;
+						for (char d : digits)
+						{
+							uint32_t v;
+							if ((d >= '0') && (d <= '9'))
+								v = d - '0';
+							else if (hex && (d >= 'a') && (d <= 'f'))
+								v = d - 'a' + 10;
+							else if (hex && (d >= 'A') && (d <= 'F'))
+								v = d - 'A' + 10;
+							else
+								throw xml_read_exception("Invalid XML character reference.");
+							cp = cp * (hex ? 16 : 10) + v;
+							if (cp > 0x10FFFF)
+								throw xml_read_exception("Invalid XML character reference.");
+						}
+
+						out = append_utf8(out, cp);
+					}
+					else
+						throw xml_read_exception("Unknown XML entity reference.");
+				}
+			}
+
+			_attributes.push_back({ a.name, std::string_view(start, out - start) });
+		}
+	}
+
+	const xml_attribute* xml_reader::find_attribute (std::string_view name) const
+	{
+		for (auto& a : _attributes)
+		{
+			if (a.name == name)
+				return &a;
+		}
+
+		return nullptr;
+	}
+
+	void xml_reader::skip_element()
+	{
+		assert (_node_type == node_type::start_element);
+		size_t depth = _open_elements.size();
+		do
+			read();
+		while ((_node_type != node_type::end_element) || (_open_elements.size() >= depth));
+	}
+
+	// ========================================================================
+
+	static constexpr std::string_view entry_elem_name = "Entry";
+	static constexpr std::string_view index_attr_name = "index";
+	static constexpr std::string_view value_attr_name = "Value";
+
+	class xml_object_reader
+	{
+		xml_reader& _from;
+		std::span<const concrete_type* const> const _known_types;
+		work_stealing_pool* const _pool;
+		size_t const _min_parallel_children;
+		std::vector<std::string_view> _factory_params;
+
+	public:
+		xml_object_reader (xml_reader& from, std::span<const concrete_type* const> known_types, work_stealing_pool* pool = nullptr, size_t min_parallel_children = 0)
+			: _from(from), _known_types(known_types), _pool(pool), _min_parallel_children(min_parallel_children)
+		{ }
+
+		std::unique_ptr<object> read_new_object()
+		{
+			auto obj = create_object();
+			read_object (obj.get(), false);
+			return obj;
+		}
+
+		// Reads the attributes and child elements of the current start element into "obj", and stops on the end element.
+		void read_object (object* obj, bool ignore_index_attribute)
+		{
+			auto deserializable = dynamic_cast<deserialize_i*>(obj);
+			if (deserializable != nullptr)
+				deserializable->on_deserializing();
+
+			auto& plan = obj->type()->serialization_plan();
+			auto bits = plan.generated ? obj->changed_from_default_bits() : nullptr;
+			for (auto& attr : _from.attributes())
+			{
+				if (ignore_index_attribute && (attr.name == index_attr_name))
+					continue;
+
+				auto pi = find_property(plan, attr.name);
+				if ((pi == nullptr) || (pi->kind != serialized_prop_kind::value))
+					throw xml_read_exception("Unknown XML attribute.");
+				if (pi->is_factory_prop)
+					continue;
+
+				auto read_generated = plan.generated ? plan.generated->read_xml_value[pi - plan.props.data()] : nullptr;
+				if (read_generated)
+					read_generated (attr.value, obj, bits);
+				else
+					static_cast<const value_property*>(pi->prop)->set_from_string(attr.value, obj);
+			}
+
+			while (_from.read() == xml_reader::node_type::start_element)
+			{
+				auto pi = find_property(plan, _from.name());
+				auto kind = (pi != nullptr) ? pi->kind : serialized_prop_kind::other;
+
+				if (kind == serialized_prop_kind::value_collection)
+					read_value_collection (obj, static_cast<const value_collection_property*>(pi->prop));
+				else if (kind == serialized_prop_kind::object_collection)
+				{
+					auto oc_prop = static_cast<const object_collection_property*>(pi->prop);
+					if (!oc_prop->preallocated)
+						read_new_object_collection (obj, oc_prop);
+					else
+						read_existing_object_collection (obj, oc_prop);
+				}
+				else
+					throw xml_read_exception("Unknown XML element.");
+			}
+
+			if (deserializable != nullptr)
+				deserializable->on_deserialized();
+		}
+
+	private:
+		static const serialization_plan::prop_info* find_property (const serialization_plan& plan, std::string_view name)
+		{
+			size_t index = plan.find(name);
+			return (index != (size_t)-1) ? &plan.props[index] : nullptr;
+		}
+
+		std::unique_ptr<object> create_object()
+		{
+			auto name = _from.name();
+			auto it = std::find_if (_known_types.begin(), _known_types.end(), [name](const concrete_type* t) { return name == t->name(); });
+			if (it == _known_types.end())
+				throw xml_read_exception("Unknown XML element.");
+			auto type = *it;
+
+			// The factory params are needed in the order of factory_props(), which is not necessarily that of the attributes.
+			_factory_params.clear();
+			for (auto factory_prop : type->factory_props())
+			{
+				auto attr = _from.find_attribute(factory_prop->_name);
+				if (attr == nullptr)
+					throw xml_read_exception("Missing XML attribute for factory property.");
+				_factory_params.push_back(attr->value);
+			}
+
+			return type->create(_factory_params);
+		}
+
+		void read_new_object_collection (object* obj, const object_collection_property* prop)
+		{
+			auto collection = prop->collection_cast(obj);
+
+			// The children are read before they're added, and then added with a single insert_range,
+			// so that the collection raises one pair of notifications and grows its store once.
+			// When loading in parallel, we read the first children here, and hand the rest to the workers if there are more.
+			std::vector<std::unique_ptr<object>> children;
+			bool more = true;
+			while (more && ((_pool == nullptr) || (children.size() < _min_parallel_children)))
+			{
+				more = (_from.read() == xml_reader::node_type::start_element);
+				if (more)
+				{
+					children.push_back(create_object());
+					read_object (children.back().get(), false);
+				}
+			}
+
+			if (more)
+				read_new_object_collection_parallel (children);
+
+			collection->insert_objects (collection->child_count(), std::move(children));
+		}
+
+		void read_new_object_collection_parallel (std::vector<std::unique_ptr<object>>& children)
+		{
+			// Find where the child elements begin; the children need to be tokenized for that anyway.
+			// The text between them is whitespace, so a chunk can go from the beginning of its first child
+			// to the beginning of the next chunk's first child.
+			std::vector<const char*> child_begins;
+			const char* children_end = nullptr;
+			while (_from.read() == xml_reader::node_type::start_element)
+			{
+				child_begins.push_back(_from.node_begin());
+				_from.skip_element();
+				children_end = _from.node_end();
+			}
+
+			size_t child_count = child_begins.size();
+			if (child_count == 0)
+				return;
+
+			// A few chunks per worker, so that the ones that finish early can steal.
+			size_t chunk_count = std::min (child_count, _pool->concurrency() * 4);
+			struct chunk
+			{
+				size_t first_child;
+				size_t end_child;
+				std::vector<std::unique_ptr<object>> children;
+			};
+
+			std::vector<chunk> chunks (chunk_count);
+			for (size_t i = 0; i < chunk_count; i++)
+			{
+				chunks[i].first_child = child_count * i / chunk_count;
+				chunks[i].end_child = child_count * (i + 1) / chunk_count;
+			}
+
+			auto known_types = _known_types;
+			auto load_chunk = [&child_begins, children_end, known_types](chunk& c)
+			{
+				auto begin = child_begins[c.first_child];
+				auto end = (c.end_child < child_begins.size()) ? child_begins[c.end_child] : children_end;
+				xml_reader sub (std::string_view(begin, end - begin));
+				xml_object_reader sub_reader (sub, known_types);
+				c.children.reserve(c.end_child - c.first_child);
+				while (sub.read() == xml_reader::node_type::start_element)
+				{
+					c.children.push_back(sub_reader.create_object());
+					sub_reader.read_object (c.children.back().get(), false);
+				}
+			};
+
+			_pool->run ([this, &chunks, &load_chunk](size_t worker_index)
+			{
+				for (auto& c : chunks)
+					_pool->spawn (worker_index, [&load_chunk, &c](size_t) { load_chunk(c); });
+			});
+
+			children.reserve(children.size() + child_count);
+			for (auto& c : chunks)
+				std::move (c.children.begin(), c.children.end(), std::back_inserter(children));
+		}
+
+		void read_existing_object_collection (object* obj, const object_collection_property* prop)
+		{
+			auto collection = prop->collection_cast(obj);
+			for (size_t child_elem_index = 0; _from.read() == xml_reader::node_type::start_element; child_elem_index++)
+			{
+				size_t index = child_elem_index;
+				if (auto index_attr = _from.find_attribute(index_attr_name))
+					size_t_property_traits::from_string(index_attr->value, index);
+				if (index >= collection->child_count())
+					throw xml_read_exception("Invalid index in XML element.");
+
+				read_object (collection->child_at(index), true);
+			}
+		}
+
+		void read_value_collection (object* obj, const value_collection_property* prop)
+		{
+			while (_from.read() == xml_reader::node_type::start_element)
+			{
+				auto index_attr = _from.find_attribute(index_attr_name);
+				auto value_attr = _from.find_attribute(value_attr_name);
+				if ((_from.name() != entry_elem_name) || (index_attr == nullptr) || (value_attr == nullptr))
+					throw xml_read_exception("Invalid XML entry element.");
+
+				size_t index;
+				size_t_property_traits::from_string(index_attr->value, index);
+
+				if (prop->can_insert_remove())
+					prop->insert_value (value_attr->value, obj, index);
+				else
+					prop->set_value (value_attr->value, obj, index);
+
+				_from.skip_element();
+			}
+		}
+	};
+
+	void deserialize_to (xml_reader& from, object* obj, std::span<const concrete_type* const> known_types)
+	{
+		assert (from.current_node_type() == xml_reader::node_type::start_element);
+		xml_object_reader reader (from, known_types);
+		reader.read_object (obj, false);
+	}
+
+	void deserialize_to (xml_reader& from, object* obj, std::span<const concrete_type* const> known_types, work_stealing_pool& pool, size_t min_parallel_children)
+	{
+		assert (from.current_node_type() == xml_reader::node_type::start_element);
+		xml_object_reader reader (from, known_types, &pool, min_parallel_children);
+		reader.read_object (obj, false);
+	}
+
+	std::unique_ptr<object> deserialize (xml_reader& from, std::span<const concrete_type* const> known_types)
+	{
+		assert (from.current_node_type() == xml_reader::node_type::start_element);
+		xml_object_reader reader (from, known_types);
+		return reader.read_new_object();
+	}
+
+	std::unique_ptr<object> deserialize (xml_reader& from, std::span<const concrete_type* const> known_types, work_stealing_pool& pool, size_t min_parallel_children)
+	{
+		assert (from.current_node_type() == xml_reader::node_type::start_element);
+		xml_object_reader reader (from, known_types, &pool, min_parallel_children);
+		return reader.read_new_object();
+	}
+}
@@ -0,0 +1,122 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "serializer.h"
+#include "xml_scanner.h"
+#include <vector>
+
+namespace edge
+{
+	class xml_read_exception : public std::exception
+	{
+		const char* const _message;
+
+	public:
+		xml_read_exception (const char* message) : _message(message) { }
+		virtual const char* what() const noexcept override { return _message; }
+	};
+
+	struct xml_attribute
+	{
+		std::string_view name;
+		std::string_view value; // with entity and character references replaced
+	};
+
+	// Pull parser for UTF-8 XML in memory, enough of it for the documents written by xml_writer and by the MSXML serializer.
+	// It hands out string_views into the document; the only exception are attribute values that contain references,
+	// which are unescaped into a buffer kept by the reader. In both cases the views stay valid until the next call to read().
+	// The reader allocates only when it meets an element with more attributes, or longer escaped attributes, than it has seen before.
+	//
+	// The XML declaration, processing instructions, comments and DOCTYPE are skipped, and so is text between elements.
+	// Throws xml_read_exception for malformed input (mismatched tags, for example) rather than read past the end.
+	//
+	// The searches for the ends of names and attribute values are done by an xml_scanner, by default the fastest one for the CPU.
+	class xml_reader
+	{
+	public:
+		enum class node_type { none, start_element, end_element, end_of_document };
+
+	private:
+		struct raw_attribute
+		{
+			std::string_view name;
+			std::string_view value;
+			bool has_references;
+		};
+
+		const char* _ptr;
+		const char* const _end;
+		const xml_scanner* const _scanner;
+		const char* _node_begin = nullptr;
+		node_type _node_type = node_type::none;
+		std::string_view _name;
+		std::vector<raw_attribute> _raw_attributes;
+		std::vector<xml_attribute> _attributes;
+		std::vector<char> _unescaped;
+		std::vector<std::string_view> _open_elements;
+		bool _empty_element = false; // the current start tag ended with "/>", so the next read() returns its end_element
+
+	public:
+		xml_reader (std::string_view data, const xml_scanner* scanner = get_xml_scanner());
+
+		// Moves to the next start or end tag. An element written as <name/> is returned as a start_element followed by an end_element.
+		node_type read();
+
+		node_type current_node_type() const { return _node_type; }
+
+		// Name of the current start or end element.
+		std::string_view name() const { return _name; }
+
+		// Where the tag of the current node begins (its '<') and ends (past its '>'). For the end_element
+		// returned after an element written as <name/>, both are those of the <name/> tag.
+		const char* node_begin() const { return _node_begin; }
+		const char* node_end() const { return _ptr; }
+
+		// Attributes of the current start element, in document order.
+		std::span<const xml_attribute> attributes() const { return _attributes; }
+
+		const xml_attribute* find_attribute (std::string_view name) const;
+
+		// Number of elements that contain the current node; zero for the root element.
+		size_t depth() const { return _open_elements.size() - ((_node_type == node_type::start_element) ? 1 : 0); }
+
+		// When on a start element, reads past its content and stops on its end element.
+		void skip_element();
+
+	private:
+		void read_start_tag();
+		bool try_read_simple_start_tag();
+		void read_start_tag_general();
+		void read_end_tag();
+		void unescape_attributes();
+		void skip_whitespace();
+		std::string_view read_name();
+		void skip_past (std::string_view terminator);
+	};
+
+	// "from" must be on the start element of "obj"'s XML (usually the root element, after the first call to read());
+	// they return after reading its end element. Same format and same handling of preallocated collections
+	// as the deserialize_to in win32/xml_serializer.h. They throw xml_read_exception for unknown types and properties.
+	void deserialize_to (xml_reader& from, object* obj, std::span<const concrete_type* const> known_types);
+	std::unique_ptr<object> deserialize (xml_reader& from, std::span<const concrete_type* const> known_types);
+
+	class work_stealing_pool;
+
+	// Same as the above, except for variable-size collections with more than min_parallel_children children.
+	// Their first min_parallel_children children are loaded as usual; for the rest, the reader first finds where each child element
+	// begins, then the children are split into chunks that the threads of "pool" create and read, each with its own reader,
+	// and finally they are appended to the collection in document order on the calling thread. Collections within
+	// children that are being loaded by a worker are loaded serially, by that worker.
+	//
+	// Differences from a serial load that the types involved must be able to live with, for the children loaded by workers:
+	//  - They are read, and their deserialize_i functions called, on worker threads,
+	//    so they must not touch anything shared with other objects.
+	//  - They are inserted into the collection only once fully read, so the collection's observers see them
+	//    with their final property values, and don't see any property change events for them.
+	//  - Their memory comes from the global heap, as there is no object_allocation_scope on worker threads.
+	// The owner of the collection still gets on_deserialized after all its children were appended.
+	void deserialize_to (xml_reader& from, object* obj, std::span<const concrete_type* const> known_types, work_stealing_pool& pool, size_t min_parallel_children = 4096);
+	std::unique_ptr<object> deserialize (xml_reader& from, std::span<const concrete_type* const> known_types, work_stealing_pool& pool, size_t min_parallel_children = 4096);
+}
@@ -0,0 +1,257 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "xml_scanner.h"
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define EDGE_XML_SCANNER_X64
+	#include <immintrin.h>
+#endif
+
+// MSVC lets us use AVX2 intrinsics in any function; GCC and Clang want the function compiled for that target.
+#if defined(_MSC_VER) && !defined(__clang__)
+	#define EDGE_TARGET_AVX2
+#else
+	#define EDGE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace edge
+{
+	static bool is_name_end (char c)
+	{
+		return ((uint8_t)c <= 0x20) || (c == '/') || (c == '=') || (c == '>');
+	}
+
+	static const char* find_name_end_scalar (const char* p, const char* end)
+	{
+		while ((p != end) && !is_name_end(*p))
+			p++;
+		return p;
+	}
+
+	static const char* find_value_end_scalar (const char* p, const char* end, char quote, bool& needs_unescaping)
+	{
+		needs_unescaping = false;
+		for (; p != end; p++)
+		{
+			if (*p == quote)
+				return p;
+			if ((*p == '&') || ((uint8_t)*p < 0x20))
+				needs_unescaping = true;
+		}
+
+		return nullptr;
+	}
+
+	static uint32_t structural_mask_scalar (const char* p)
+	{
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < 32; i++)
+		{
+			char c = p[i];
+			if (((uint8_t)c <= 0x20) || (c == '"') || (c == '\'') || (c == '=') || (c == '/') || (c == '<') || (c == '>') || (c == '&'))
+				mask |= 1u << i;
+		}
+
+		return mask;
+	}
+
+	static const xml_scanner scalar_scanner = { &find_name_end_scalar, &find_value_end_scalar, &structural_mask_scalar };
+
+#ifdef EDGE_XML_SCANNER_X64
+	// The searches below look at 16 or 32 bytes at a time: compare them with each character of interest,
+	// OR the results, and take the index of the first match from the movemask. Bytes up to some limit are
+	// found by comparing the block with its unsigned minimum against the limit.
+	// The last bytes, fewer than a block, go to the scalar versions.
+
+	static const char* find_name_end_sse2 (const char* p, const char* end)
+	{
+		const __m128i space = _mm_set1_epi8(0x20);
+		const __m128i slash = _mm_set1_epi8('/');
+		const __m128i equal = _mm_set1_epi8('=');
+		const __m128i gt    = _mm_set1_epi8('>');
+		while (end - p >= 16)
+		{
+			__m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(p));
+			__m128i m = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8(_mm_min_epu8(v, space), v), _mm_cmpeq_epi8(v, slash)),
+			                          _mm_or_si128 (_mm_cmpeq_epi8(v, equal), _mm_cmpeq_epi8(v, gt)));
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+			if (mask)
+				return p + first_set_bit(mask);
+			p += 16;
+		}
+
+		return find_name_end_scalar (p, end);
+	}
+
+	static const char* find_value_end_sse2 (const char* p, const char* end, char quote, bool& needs_unescaping)
+	{
+		const __m128i q       = _mm_set1_epi8(quote);
+		const __m128i amp     = _mm_set1_epi8('&');
+		const __m128i control = _mm_set1_epi8(0x1F);
+		bool found_special = false;
+		while (end - p >= 16)
+		{
+			__m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(p));
+			uint32_t quote_mask = (uint32_t)_mm_movemask_epi8 (_mm_cmpeq_epi8(v, q));
+			uint32_t special_mask = (uint32_t)_mm_movemask_epi8 (_mm_or_si128 (_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(_mm_min_epu8(v, control), v)));
+			if (quote_mask)
+			{
+				unsigned int index = first_set_bit(quote_mask);
+				needs_unescaping = found_special || (special_mask & ((1u << index) - 1));
+				return p + index;
+			}
+
+			found_special |= (special_mask != 0);
+			p += 16;
+		}
+
+		auto result = find_value_end_scalar (p, end, quote, needs_unescaping);
+		needs_unescaping |= found_special;
+		return result;
+	}
+
+	static __m128i structural_bytes_sse2 (__m128i v)
+	{
+		__m128i m = _mm_cmpeq_epi8 (_mm_min_epu8(v, _mm_set1_epi8(0x20)), v);
+		m = _mm_or_si128 (m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+		m = _mm_or_si128 (m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+		m = _mm_or_si128 (m, _mm_cmpeq_epi8(v, _mm_set1_epi8('=')));
+		m = _mm_or_si128 (m, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+		m = _mm_or_si128 (m, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+		m = _mm_or_si128 (m, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+		m = _mm_or_si128 (m, _mm_cmpeq_epi8(v, _mm_set1_epi8('&')));
+		return m;
+	}
+
+	static uint32_t structural_mask_sse2 (const char* p)
+	{
+		uint32_t lo = (uint32_t)_mm_movemask_epi8 (structural_bytes_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+		uint32_t hi = (uint32_t)_mm_movemask_epi8 (structural_bytes_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16))));
+		return lo | (hi << 16);
+	}
+
+	static const xml_scanner sse2_scanner = { &find_name_end_sse2, &find_value_end_sse2, &structural_mask_sse2 };
+
+	EDGE_TARGET_AVX2 static const char* find_name_end_avx2 (const char* p, const char* end)
+	{
+		const __m256i space = _mm256_set1_epi8(0x20);
+		const __m256i slash = _mm256_set1_epi8('/');
+		const __m256i equal = _mm256_set1_epi8('=');
+		const __m256i gt    = _mm256_set1_epi8('>');
+		while (end - p >= 32)
+		{
+			__m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*>(p));
+			__m256i m = _mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8(_mm256_min_epu8(v, space), v), _mm256_cmpeq_epi8(v, slash)),
+			                             _mm256_or_si256 (_mm256_cmpeq_epi8(v, equal), _mm256_cmpeq_epi8(v, gt)));
+			uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+			if (mask)
+				return p + first_set_bit(mask);
+			p += 32;
+		}
+
+		return find_name_end_sse2 (p, end);
+	}
+
+	EDGE_TARGET_AVX2 static const char* find_value_end_avx2 (const char* p, const char* end, char quote, bool& needs_unescaping)
+	{
+		const __m256i q       = _mm256_set1_epi8(quote);
+		const __m256i amp     = _mm256_set1_epi8('&');
+		const __m256i control = _mm256_set1_epi8(0x1F);
+		bool found_special = false;
+		while (end - p >= 32)
+		{
+			__m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*>(p));
+			uint32_t quote_mask = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8(v, q));
+			uint32_t special_mask = (uint32_t)_mm256_movemask_epi8 (_mm256_or_si256 (_mm256_cmpeq_epi8(v, amp), _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v)));
+			if (quote_mask)
+			{
+				unsigned int index = first_set_bit(quote_mask);
+				needs_unescaping = found_special || (special_mask & ((1ull << index) - 1));
+				return p + index;
+			}
+
+			found_special |= (special_mask != 0);
+			p += 32;
+		}
+
+		auto result = find_value_end_sse2 (p, end, quote, needs_unescaping);
+		needs_unescaping |= found_special;
+		return result;
+	}
+
+	EDGE_TARGET_AVX2 static uint32_t structural_mask_avx2 (const char* p)
+	{
+		__m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*>(p));
+		__m256i m = _mm256_cmpeq_epi8 (_mm256_min_epu8(v, _mm256_set1_epi8(0x20)), v);
+		m = _mm256_or_si256 (m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+		m = _mm256_or_si256 (m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')));
+		m = _mm256_or_si256 (m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('=')));
+		m = _mm256_or_si256 (m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+		m = _mm256_or_si256 (m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('<')));
+		m = _mm256_or_si256 (m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('>')));
+		m = _mm256_or_si256 (m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('&')));
+		return (uint32_t)_mm256_movemask_epi8(m);
+	}
+
+	static const xml_scanner avx2_scanner = { &find_name_end_avx2, &find_value_end_avx2, &structural_mask_avx2 };
+
+	static bool cpu_supports_avx2()
+	{
+	#ifdef _MSC_VER
+		int info[4];
+		__cpuid (info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// The CPU must have AVX, and the OS must save the YMM registers on context switches.
+		__cpuid (info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx     = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || ((_xgetbv(0) & 6) != 6))
+			return false;
+
+		__cpuidex (info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	#else
+		return __builtin_cpu_supports("avx2");
+	#endif
+	}
+#endif
+
+	const xml_scanner* get_xml_scanner (simd_level level)
+	{
+		switch (level)
+		{
+		#ifdef EDGE_XML_SCANNER_X64
+			case simd_level::avx2:
+				return cpu_supports_avx2() ? &avx2_scanner : nullptr;
+
+			case simd_level::sse2:
+				return &sse2_scanner; // part of x64
+		#endif
+
+			case simd_level::scalar:
+				return &scalar_scanner;
+
+			default:
+				return nullptr;
+		}
+	}
+
+	const xml_scanner* get_xml_scanner()
+	{
+		static const xml_scanner* const best = []()
+		{
+			if (auto scanner = get_xml_scanner(simd_level::avx2))
+				return scanner;
+			if (auto scanner = get_xml_scanner(simd_level::sse2))
+				return scanner;
+			return &scalar_scanner;
+		}();
+
+		return best;
+	}
+}
@@ -0,0 +1,49 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include <cstdint>
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace edge
+{
+	enum class simd_level { scalar, sse2, avx2 };
+
+	// The character searches that xml_reader spends most of its time in, implemented for blocks of 16 or 32 bytes.
+	// They never read at or past "end".
+	struct xml_scanner
+	{
+		// First byte at or after "p" that ends a name: whitespace (or any other byte up to 0x20), '/', '=' or '>'.
+		// Returns "end" if there's none.
+		const char* (*find_name_end) (const char* p, const char* end);
+
+		// First occurrence of "quote" at or after "p", or nullptr if there's none. Sets "needs_unescaping" to whether
+		// there's an '&' or a byte below 0x20 (tab, CR, LF) before it, meaning the value must go through unescaping.
+		const char* (*find_value_end) (const char* p, const char* end, char quote, bool& needs_unescaping);
+
+		// Bit i is set if p[i] is one of the characters that can end a token within a tag: a byte up to 0x20,
+		// '"', '\'', '=', '/', '<', '>' or '&'. Reads exactly 32 bytes.
+		uint32_t (*structural_mask) (const char* p);
+	};
+
+	// Index of the lowest set bit; "mask" must not be zero.
+	inline unsigned int first_set_bit (uint32_t mask)
+	{
+	#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward (&index, mask);
+		return index;
+	#else
+		return __builtin_ctz(mask);
+	#endif
+	}
+
+	// The best implementation this CPU supports, chosen the first time this is called.
+	const xml_scanner* get_xml_scanner();
+
+	// A specific implementation, for testing and benchmarking; nullptr if the CPU or the compiler target doesn't support it.
+	const xml_scanner* get_xml_scanner (simd_level level);
+}
@@ -0,0 +1,385 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#include "xml_writer.h"
+#include "collections.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace edge
+{
+	xml_writer::xml_writer (out_stream_i* to, bool indent)
+		: _to(to), _indent(indent)
+	{ }
+
+	xml_writer::~xml_writer()
+	{
+		flush();
+	}
+
+	void xml_writer::flush()
+	{
+		if (_size > 0)
+		{
+			_to->write (_buffer.get(), _size);
+			_passed += _size;
+			_size = 0;
+		}
+	}
+
+	void xml_writer::write (const char* data, size_t size)
+	{
+		if (_size + size > buffer_size)
+		{
+			flush();
+			if (size > buffer_size)
+			{
+				_to->write (data, size);
+				_passed += size;
+				return;
+			}
+		}
+
+		memcpy (&_buffer[_size], data, size);
+		_size += size;
+	}
+
+	void xml_writer::write_escaped (std::string_view str)
+	{
+		// Copy the runs of characters that need no escaping in one go; in our documents that's usually the whole value.
+		auto run_start = str.data();
+		auto end = str.data() + str.size();
+		for (auto p = run_start; p != end; p++)
+		{
+			const char* replacement;
+			switch (*p)
+			{
+				case '&':  replacement = "&amp;";  break;
+				case '<':  replacement = "&lt;";   break;
+				case '>':  replacement = "&gt;";   break;
+				case '"':  replacement = "&quot;"; break;
+				// Attribute value normalization would turn these into spaces when reading, so they're written as character references.
+				case '\t': replacement = "&#9;";   break;
+				case '\n': replacement = "&#10;";  break;
+				case '\r': replacement = "&#13;";  break;
+				default:   continue;
+			}
+
+			write (run_start, p - run_start);
+			write (std::string_view(replacement));
+			run_start = p + 1;
+		}
+
+		write (run_start, end - run_start);
+	}
+
+	void xml_writer::close_start_tag()
+	{
+		if (_start_tag_open)
+		{
+			write ('>');
+			_start_tag_open = false;
+		}
+	}
+
+	void xml_writer::new_line (size_t depth)
+	{
+		if (_indent)
+		{
+			write ('\n');
+			for (size_t i = 0; i < depth; i++)
+				write ('\t');
+		}
+	}
+
+	void xml_writer::write_declaration()
+	{
+		assert (_open_elements.empty());
+		write (std::string_view("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"));
+	}
+
+	void xml_writer::start_element (std::string_view name)
+	{
+		close_start_tag();
+		new_line (_open_elements.size());
+		write ('<');
+		write (name);
+		_open_elements.push_back(name);
+		_start_tag_open = true;
+	}
+
+	void xml_writer::attribute (std::string_view name, std::string_view value)
+	{
+		assert (_start_tag_open);
+		write (' ');
+		write (name);
+		write ("=\"", 2);
+		write_escaped (value);
+		write ('"');
+	}
+
+	void xml_writer::attribute (std::string_view name, size_t value)
+	{
+		char buffer[24];
+		auto res = std::to_chars (buffer, buffer + sizeof(buffer), value);
+		attribute (name, std::string_view(buffer, res.ptr - buffer));
+	}
+
+	void xml_writer::copy_element (std::string_view text)
+	{
+		close_start_tag();
+		new_line (_open_elements.size());
+		write (text);
+	}
+
+	void xml_writer::end_element()
+	{
+		assert (!_open_elements.empty());
+		auto name = _open_elements.back();
+		_open_elements.pop_back();
+
+		if (_start_tag_open)
+		{
+			write ("/>", 2);
+			_start_tag_open = false;
+			return;
+		}
+
+		new_line (_open_elements.size());
+		write ("</", 2);
+		write (name);
+		write ('>');
+	}
+
+	// ========================================================================
+
+	static constexpr std::string_view entry_elem_name = "Entry";
+	static constexpr std::string_view index_attr_name = "index";
+	static constexpr std::string_view value_attr_name = "Value";
+
+	// The DOM serializer creates an element only when it finds something to put in it (an attribute, a child element),
+	// and discards the elements that stay empty. We can't take back what we've written, so we keep such elements pending
+	// until something is written into them, and then write them together with any pending ancestors.
+	class xml_object_writer : public object_writer_i
+	{
+	protected:
+		struct element
+		{
+			std::string_view name;
+			size_t index_attribute; // -1 for none
+			size_t start;           // position of the start tag in the output, -1 until passed to _to
+		};
+
+		xml_writer& _to;
+		std::vector<element> _elements;
+		size_t _written_count = 0; // the elements below this index in _elements have been passed to _to
+		std::string _value;
+
+	public:
+		xml_object_writer (xml_writer& to)
+			: _to(to)
+		{ }
+
+	protected:
+		virtual bool begin_object (const object* obj, const serialization_plan& plan, std::span<const size_t> values, size_t content_count, size_t index, bool force) override
+		{
+			begin_element (obj->type()->name(), index);
+			if (force || (plan.generated ? plan.generated->has_values(obj, plan) : !values.empty()))
+				write_pending_elements();
+
+			if (plan.generated)
+				plan.generated->write_xml_values (obj, plan, _to, _value);
+
+			for (size_t i : values)
+			{
+				auto value_prop = static_cast<const value_property*>(plan.props[i].prop);
+				value_prop->get_to_string(obj, _value);
+				_to.attribute (value_prop->_name, _value);
+			}
+
+			return true;
+		}
+
+		virtual void end_object (const object* obj) override
+		{
+			end_element();
+		}
+
+		virtual void begin_object_collection (const object* obj, const serialization_plan& plan, size_t prop_index, const object_collection_i* collection) override
+		{
+			begin_element (plan.props[prop_index].prop->_name, -1);
+		}
+
+		virtual void end_object_collection() override
+		{
+			end_element();
+		}
+
+		virtual void write_value_collection (const object* obj, const serialization_plan& plan, size_t prop_index) override
+		{
+			auto prop = static_cast<const value_collection_property*>(plan.props[prop_index].prop);
+			write_pending_elements();
+			_to.start_element (prop->_name);
+			size_t size = prop->size(obj);
+			for (size_t i = 0; i < size; i++)
+			{
+				prop->get_value(obj, i, _value);
+				_to.start_element (entry_elem_name);
+				_to.attribute (index_attr_name, i);
+				_to.attribute (value_attr_name, _value);
+				_to.end_element();
+			}
+			_to.end_element();
+		}
+
+		virtual void begin_object_property (const object* obj, const serialization_plan& plan, size_t prop_index) override
+		{
+		}
+
+		virtual bool uses_generated_serializers() const override { return true; }
+
+	protected:
+		void begin_element (std::string_view name, size_t index_attribute)
+		{
+			_elements.push_back({ name, index_attribute, (size_t)-1 });
+		}
+
+		void write_pending_elements()
+		{
+			for (; _written_count < _elements.size(); _written_count++)
+			{
+				auto& e = _elements[_written_count];
+				_to.start_element (e.name);
+				e.start = _to.position() - 1 - e.name.size();
+				if (e.index_attribute != (size_t)-1)
+					_to.attribute (index_attr_name, e.index_attribute);
+			}
+		}
+
+		void end_element()
+		{
+			if (_written_count == _elements.size())
+			{
+				_to.end_element();
+				_written_count--;
+			}
+
+			_elements.pop_back();
+		}
+	};
+
+	void serialize (xml_writer& to, const object* obj, bool force_serialize_unchanged)
+	{
+		xml_object_writer writer (to);
+		write_object (writer, obj, force_serialize_unchanged);
+	}
+
+	// ========================================================================
+
+	class incremental_xml_object_writer : public xml_object_writer
+	{
+		using cached_element = incremental_xml_text_serializer::cached_element;
+
+		struct frame
+		{
+			size_t previous_start; // of the object's element in the previous output, -1 if it wasn't written
+			size_t element;        // index in _elements
+		};
+
+		std::unordered_map<const object*, cached_element>& _cache;
+		const std::unordered_set<const object*>& _dirty;
+		std::string_view const _previous;
+		std::vector<frame> _frames;
+
+	public:
+		incremental_xml_object_writer (xml_writer& to, std::unordered_map<const object*, cached_element>& cache,
+			const std::unordered_set<const object*>& dirty, std::string_view previous)
+			: xml_object_writer(to), _cache(cache), _dirty(dirty), _previous(previous)
+		{ }
+
+	private:
+		size_t parent_previous_start() const { return _frames.empty() ? 0 : _frames.back().previous_start; }
+
+		size_t parent_new_start() const { return _frames.empty() ? 0 : _elements[_frames.back().element].start; }
+
+		virtual bool begin_object (const object* obj, const serialization_plan& plan, std::span<const size_t> values, size_t content_count, size_t index, bool force) override
+		{
+			size_t previous_start = (size_t)-1;
+			auto it = _cache.find(obj);
+			if ((it != _cache.end()) && (it->second.index == index) && ((it->second.size == 0) || (parent_previous_start() != (size_t)-1)))
+			{
+				if (it->second.size > 0)
+					previous_start = parent_previous_start() + it->second.offset;
+
+				if (_dirty.find(obj) == _dirty.end())
+				{
+					if (it->second.size > 0)
+					{
+						write_pending_elements();
+						_to.copy_element (_previous.substr(previous_start, it->second.size));
+						it->second.offset = _to.position() - it->second.size - parent_new_start();
+					}
+
+					return false;
+				}
+			}
+
+			_frames.push_back({ previous_start, _elements.size() });
+			return xml_object_writer::begin_object (obj, plan, values, content_count, index, force);
+		}
+
+		virtual void end_object (const object* obj) override
+		{
+			auto& e = _elements[_frames.back().element];
+			size_t start = e.start;
+			size_t index = e.index_attribute;
+			xml_object_writer::end_object(obj);
+			_frames.pop_back();
+
+			if (start == (size_t)-1)
+				_cache[obj] = { 0, 0, index };
+			else
+				_cache[obj] = { start - parent_new_start(), _to.position() - start, index };
+		}
+	};
+
+	struct char_vector_out_stream : out_stream_i
+	{
+		std::vector<char> buffer;
+
+		using out_stream_i::write;
+
+		virtual void write (const void* data, size_t size) override
+		{
+			buffer.insert (buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+		}
+	};
+
+	incremental_xml_text_serializer::incremental_xml_text_serializer (object* root, bool indent, bool force_serialize_unchanged)
+		: dirty_tree_tracker(root), _indent(indent), _force_serialize_unchanged(force_serialize_unchanged)
+	{ }
+
+	void incremental_xml_text_serializer::serialize (out_stream_i* to)
+	{
+		char_vector_out_stream out;
+		out.buffer.reserve (_previous.size());
+		{
+			xml_writer writer (&out, _indent);
+			writer.write_declaration();
+			incremental_xml_object_writer object_writer (writer, _elements, dirty_objects(), std::string_view(_previous.data(), _previous.size()));
+			write_object (object_writer, root(), _force_serialize_unchanged);
+		}
+
+		to->write (out.buffer.data(), out.buffer.size());
+		_previous = std::move(out.buffer);
+		clear_dirty();
+	}
+
+	void incremental_xml_text_serializer::on_detaching (object* obj)
+	{
+		_elements.erase(obj);
+		dirty_tree_tracker::on_detaching(obj);
+	}
+}
@@ -0,0 +1,105 @@
+
+// This file is part of the "edge" library, available at https://github.com/adigostin/edge
+// Copyright (c) 2011-2020 Adi Gostin, distributed under Apache License v2.0.
+
+#pragma once
+#include "serializer.h"
+#include "tree_observer.h"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+namespace edge
+{
+	// Writes XML as it is produced, SAX-style, into a fixed-size buffer that is passed to "to" whenever it fills up.
+	// Memory use depends on the depth of the document, not on its size. Output is UTF-8; names are written as they are,
+	// attribute values are escaped.
+	class xml_writer
+	{
+		static constexpr size_t buffer_size = 64 * 1024;
+
+		out_stream_i* const _to;
+		bool const _indent;
+		std::unique_ptr<char[]> const _buffer = std::make_unique<char[]>(buffer_size);
+		size_t _size = 0;
+		size_t _passed = 0; // bytes passed to "to" so far
+		std::vector<std::string_view> _open_elements;
+		bool _start_tag_open = false; // so we can close elements without children with "/>"
+
+	public:
+		// When "indent" is true, each element goes on its own line, indented with tabs.
+		xml_writer (out_stream_i* to, bool indent = true);
+		~xml_writer();
+
+		xml_writer (const xml_writer&) = delete;
+		xml_writer& operator= (const xml_writer&) = delete;
+
+		void write_declaration();
+
+		// "name" must stay valid until the matching end_element().
+		void start_element (std::string_view name);
+		void attribute (std::string_view name, std::string_view value);
+		void attribute (std::string_view name, size_t value);
+		void end_element();
+
+		size_t depth() const { return _open_elements.size(); }
+
+		// Count of bytes written so far, those still in the buffer included.
+		size_t position() const { return _passed + _size; }
+
+		// Writes, as the next child of the current element, an element taken from earlier output of a writer
+		// with the same "indent", at the same depth. The text goes from the '<' of the start tag to the end of the element.
+		void copy_element (std::string_view text);
+
+		// Passes what's in the buffer to the output stream. Also called by the destructor.
+		void flush();
+
+	private:
+		void write (const char* data, size_t size);
+		void write (std::string_view str) { write (str.data(), str.size()); }
+		void write (char c)
+		{
+			if (_size == buffer_size)
+				flush();
+			_buffer[_size++] = c;
+		}
+		void write_escaped (std::string_view str);
+		void close_start_tag();
+		void new_line (size_t depth);
+	};
+
+	// Writes an object tree with the same elements and attributes as the serialize() in win32/xml_serializer.h,
+	// but without building a DOM first. Writes nothing if force_serialize_unchanged is false and nothing in "obj" changed from default.
+	void serialize (xml_writer& to, const object* obj, bool force_serialize_unchanged);
+
+	// Portable counterpart of the incremental_xml_serializer in win32/xml_serializer.h. Keeps the previous output
+	// and where in it the element of each object is; the elements of objects that didn't change since the previous save
+	// are copied from there instead of being written again. Same output as write_declaration() followed by serialize().
+	//
+	// The text of an element depends on nothing outside its object, except for the indentation, which depends on the depth,
+	// and for the index attribute of the children of preallocated collections; neither changes while the object stays in the tree.
+	class incremental_xml_text_serializer : dirty_tree_tracker
+	{
+	public:
+		struct cached_element
+		{
+			size_t offset; // relative to the start of the parent object's element, so it stays valid when the parent's text is copied as a whole
+			size_t size;   // 0 if the object wrote nothing
+			size_t index;  // the index attribute
+		};
+
+	private:
+		bool const _indent;
+		bool const _force_serialize_unchanged;
+		std::unordered_map<const object*, cached_element> _elements;
+		std::vector<char> _previous;
+
+	public:
+		incremental_xml_text_serializer (object* root, bool indent = true, bool force_serialize_unchanged = true);
+
+		void serialize (out_stream_i* to);
+
+	private:
+		virtual void on_detaching (object* obj) override;
+	};
+}